@@ -3,6 +3,7 @@
 #include <criterion/details/benchmark_config.hpp>
 #include <criterion/details/benchmark_result.hpp>
 #include <criterion/details/console_writer.hpp>
+#include <criterion/details/coroutine.hpp>
 #include <criterion/details/csv_writer.hpp>
 #include <criterion/details/help.hpp>
 #include <criterion/details/indicators.hpp>
@@ -10,4 +11,7 @@
 #include <criterion/details/macros.hpp>
 #include <criterion/details/main.hpp>
 #include <criterion/details/md_writer.hpp>
-#include <criterion/details/structopt.hpp>
\ No newline at end of file
+#include <criterion/details/multiprocess.hpp>
+#include <criterion/details/registration.hpp>
+#include <criterion/details/structopt.hpp>
+#include <criterion/details/typed.hpp>
@@ -0,0 +1,35 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <optional>
+
+namespace criterion {
+
+// Counts heap allocations, if enabled by defining CRITERION_COUNT_ALLOCATIONS before including
+// criterion in the file with CRITERION_BENCHMARK_MAIN, which then replaces the global operator new.
+// Allocations of all threads are counted
+struct allocation_counter {
+  static inline std::atomic<std::uint64_t> allocations{0};
+  static inline bool enabled{false};
+
+  // Counts at the start and end of the measured part of the current iteration. benchmark::run()
+  // sets them around the whole iteration; SETUP_BENCHMARK and TEARDOWN_BENCHMARK (and the
+  // benchmark_fixture of criterion::register_benchmark) move them so that
+  // allocations during setup and teardown are left out
+  static inline std::uint64_t iteration_start{0};
+  static inline std::optional<std::uint64_t> iteration_end;
+
+  static std::uint64_t count() { return allocations.load(std::memory_order_relaxed); }
+
+  static void mark_start() {
+    if (enabled)
+      iteration_start = count();
+  }
+
+  static void mark_end() {
+    if (enabled)
+      iteration_end = count();
+  }
+};
+
+} // namespace criterion
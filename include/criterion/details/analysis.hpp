@@ -0,0 +1,277 @@
+#pragma once
+#include <criterion/details/baseline.hpp>
+#include <criterion/details/benchmark_result.hpp>
+#include <criterion/details/sample_format.hpp>
+#include <criterion/details/statistics.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <random>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace criterion {
+
+struct analysis_options {
+  estimator method{estimator::mean};
+  long double confidence_level{0.95};
+  outlier_policy outliers{outlier_policy::keep};
+};
+
+// Recomputes benchmark results from stored samples, without running any benchmark. The samples
+// are either raw iterations written by --export_samples or run means saved with --save_baseline
+class analysis {
+public:
+  struct benchmark_analysis {
+    benchmark_result result;
+    sample_estimate estimate;
+  };
+
+  std::vector<benchmark_analysis> benchmarks; // in the order they were stored
+
+  static std::optional<estimator> parse_estimator(const std::string &value) {
+    for (const auto method : {estimator::mean, estimator::median, estimator::lowest_rsd}) {
+      if (value == to_string(method))
+        return method;
+    }
+    return std::nullopt;
+  }
+
+  static std::optional<outlier_policy> parse_outlier_policy(const std::string &value) {
+    for (const auto policy :
+         {outlier_policy::keep, outlier_policy::drop_severe, outlier_policy::drop_mild}) {
+      if (value == to_string(policy))
+        return policy;
+    }
+    return std::nullopt;
+  }
+
+  // true if `filename` was written by --export_samples, false if it may be a baseline
+  static bool is_sample_file(const std::string &filename) {
+    std::ifstream is(filename, std::ios::binary);
+    char magic[sizeof(samples::magic)]{};
+    return is.read(magic, sizeof(magic)) &&
+           std::memcmp(magic, samples::magic, sizeof(samples::magic)) == 0;
+  }
+
+  // Estimates the execution time of a benchmark from the durations of the iterations in each
+  // of its runs. Every run may hold a single duration, e.g., the run means of a baseline
+  static benchmark_analysis analyze(const std::string &name,
+                                    const std::vector<std::vector<long double>> &runs,
+                                    std::size_t num_iterations, const analysis_options &options) {
+    std::vector<long double> pooled;
+    for (const auto &run : runs) {
+      pooled.insert(pooled.end(), run.begin(), run.end());
+    }
+    const auto outliers = classify_outliers(pooled);
+    const auto dropped = [&](long double sample) {
+      return (options.outliers == outlier_policy::drop_severe && outliers.severe(sample)) ||
+             (options.outliers == outlier_policy::drop_mild && outliers.mild_or_severe(sample));
+    };
+
+    // per run: (mean or median, relative standard deviation in %, kept durations)
+    struct run_summary {
+      long double value;
+      long double mean;
+      long double rsd;
+      std::vector<long double> durations;
+    };
+    std::vector<run_summary> summaries;
+    std::size_t num_dropped = 0;
+    for (const auto &run : runs) {
+      run_summary summary{0, 0, 0, {}};
+      for (const auto duration : run) {
+        if (dropped(duration)) {
+          num_dropped += 1;
+        } else {
+          summary.durations.push_back(duration);
+        }
+      }
+      if (summary.durations.empty())
+        continue;
+      summary.mean = sample_mean(summary.durations);
+      long double E = 0;
+      for (const auto duration : summary.durations) {
+        E += std::pow(duration - summary.mean, 2);
+      }
+      const auto standard_deviation = std::sqrt(E / summary.durations.size());
+      summary.rsd = summary.mean > 0 ? standard_deviation * 100 / summary.mean : 0;
+      summary.value = options.method == estimator::median ? sample_median(summary.durations)
+                                                          : summary.mean;
+      summaries.push_back(std::move(summary));
+    }
+
+    std::vector<long double> values;
+    long double fastest = 0, slowest = 0;
+    for (const auto &summary : summaries) {
+      values.push_back(summary.value);
+      const auto [lowest, highest] =
+          std::minmax_element(summary.durations.begin(), summary.durations.end());
+      if (*lowest > 0 && (fastest == 0 || *lowest < fastest))
+        fastest = *lowest;
+      slowest = std::max(slowest, *highest);
+    }
+
+    // the run with the lowest RSD, chosen the way benchmark::run() does: a later run only
+    // replaces it if its RSD and its mean are both lower
+    std::size_t lowest_rsd_index = 0;
+    for (std::size_t i = 1; i < summaries.size(); ++i) {
+      const auto &best = summaries[lowest_rsd_index];
+      if (summaries[i].rsd < best.rsd && summaries[i].mean < best.mean)
+        lowest_rsd_index = i;
+    }
+    const auto lowest_rsd = summaries.empty() ? run_summary{0, 0, 0, {}}
+                                              : summaries[lowest_rsd_index];
+
+    const auto z = normal_quantile(0.5L + options.confidence_level / 2);
+    long double estimate = 0, lower_bound = 0, upper_bound = 0;
+    if (options.method == estimator::lowest_rsd) {
+      estimate = lowest_rsd.mean;
+      const auto margin =
+          z * lowest_rsd.rsd / 100 * lowest_rsd.mean /
+          std::sqrt(static_cast<long double>(std::max(lowest_rsd.durations.size(), size_t{1})));
+      lower_bound = estimate - margin;
+      upper_bound = estimate + margin;
+    } else {
+      const auto statistic = [&](const std::vector<long double> &samples) {
+        return options.method == estimator::median ? sample_median(samples)
+                                                   : sample_mean(samples);
+      };
+      estimate = statistic(values);
+      std::tie(lower_bound, upper_bound) = bootstrap(values, statistic, options.confidence_level);
+    }
+
+    benchmark_analysis result;
+    result.result = benchmark_result{
+        .name = name,
+        .num_warmup_runs = 0,
+        .num_runs = summaries.size(),
+        .num_iterations = num_iterations,
+        .lowest_rsd = lowest_rsd.rsd,
+        .lowest_rsd_mean = lowest_rsd.mean,
+        .lowest_rsd_index = summaries.empty() ? 0 : lowest_rsd_index + 1,
+        .warmup_execution_time = 0,
+        .mean_execution_time = estimate,
+        .fastest_execution_time = fastest,
+        .slowest_execution_time = slowest,
+        .average_iteration_performance = (1E9 / estimate),
+        .fastest_iteration_performance = (1E9 / fastest),
+        .slowest_iteration_performance = (1E9 / slowest),
+        .interference = "",
+        .samples = values};
+    result.estimate = sample_estimate{options.method,     estimate,         lower_bound,
+                                      upper_bound,        options.confidence_level,
+                                      outliers,           options.outliers, num_dropped,
+                                      pooled.size()};
+    return result;
+  }
+
+  // Percentile bootstrap interval of `statistic` over `samples`. Resamples are seeded, so the same
+  // samples always give the same interval
+  template <class Statistic>
+  static std::pair<long double, long double> bootstrap(const std::vector<long double> &samples,
+                                                       Statistic statistic,
+                                                       long double confidence_level,
+                                                       std::size_t resamples = 1000) {
+    if (samples.size() < 2) {
+      const auto value = statistic(samples);
+      return {value, value};
+    }
+    std::mt19937 random{0};
+    std::uniform_int_distribution<std::size_t> pick(0, samples.size() - 1);
+    std::vector<long double> estimates, resample(samples.size());
+    estimates.reserve(resamples);
+    for (std::size_t i = 0; i < resamples; ++i) {
+      for (auto &sample : resample) {
+        sample = samples[pick(random)];
+      }
+      estimates.push_back(statistic(resample));
+    }
+    const auto tail = (1 - confidence_level) / 2;
+    return {sample_quantile(estimates, tail), sample_quantile(estimates, 1 - tail)};
+  }
+
+  static analysis from_baseline(const baseline &saved, const analysis_options &options) {
+    analysis result;
+    for (const auto &name : saved.order) {
+      const auto &entry = saved.entries.at(name);
+      std::vector<std::vector<long double>> runs;
+      for (const auto sample : entry.samples) {
+        runs.push_back({sample});
+      }
+      result.benchmarks.push_back(analyze(name, runs, entry.num_iterations, options));
+    }
+    return result;
+  }
+
+#if defined(__unix__) || defined(__APPLE__)
+  static std::optional<analysis> from_sample_file(const std::string &filename,
+                                                  const analysis_options &options) {
+    samples::reader reader(filename);
+    if (!reader.valid())
+      return std::nullopt;
+
+    // durations of each run of each benchmark, net of the measurement cost like in benchmark::run()
+    struct stored {
+      std::string name;
+      double measurement_cost;
+      std::size_t num_iterations{0};
+      std::map<std::uint32_t, std::vector<long double>> runs;
+    };
+    std::vector<stored> benchmarks;
+    std::unordered_map<std::uint32_t, std::size_t> index;
+    for (const auto &info : reader.benchmarks()) {
+      index[info.id] = benchmarks.size();
+      benchmarks.push_back({info.name, info.measurement_cost, 0, {}});
+    }
+    for (const auto &columns : reader.sample_blocks()) {
+      for (std::uint32_t i = 0; i < columns.rows; ++i) {
+        const auto it = index.find(columns.benchmark[i]);
+        if (it == index.end())
+          continue;
+        auto &b = benchmarks[it->second];
+        b.num_iterations = columns.batch_size[i];
+        b.runs[columns.run[i]].push_back(std::abs(columns.duration[i] - b.measurement_cost));
+      }
+    }
+
+    analysis result;
+    for (const auto &b : benchmarks) {
+      if (b.runs.empty())
+        continue;
+      std::vector<std::vector<long double>> runs;
+      for (const auto &[run, durations] : b.runs) {
+        runs.push_back(durations);
+      }
+      result.benchmarks.push_back(analyze(b.name, runs, b.num_iterations, options));
+    }
+    return result;
+  }
+#endif
+
+  // Loads `filename`, which is either a file written by --export_samples or a saved baseline
+  static std::optional<analysis> load(const std::string &filename,
+                                      const analysis_options &options) {
+    if (is_sample_file(filename)) {
+#if defined(__unix__) || defined(__APPLE__)
+      return from_sample_file(filename, options);
+#else
+      return std::nullopt;
+#endif
+    }
+    const auto saved =
+        baseline::load_file(filename, std::filesystem::path(filename).stem().string());
+    if (!saved.has_value())
+      return std::nullopt;
+    return from_baseline(saved.value(), options);
+  }
+};
+
+} // namespace criterion
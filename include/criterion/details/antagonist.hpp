@@ -0,0 +1,278 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+namespace criterion {
+
+// Background load to run alongside a benchmark, e.g., "membw:2,llc-thrash:1,cpu-spin:4,smt-sibling"
+struct interference_profile {
+  std::size_t membw{0};      // threads streaming through buffers larger than the LLC
+  std::size_t llc_thrash{0}; // threads writing to random cache lines of an LLC-sized buffer
+  std::size_t cpu_spin{0};   // threads spinning on other cores
+  bool smt_sibling{false};   // one thread spinning on the SMT sibling of the benchmark core
+
+  static constexpr std::size_t max_threads{256}; // of each kind
+
+  bool empty() const { return membw == 0 && llc_thrash == 0 && cpu_spin == 0 && !smt_sibling; }
+
+  std::string to_string() const {
+    std::vector<std::string> parts;
+    if (membw > 0)
+      parts.push_back("membw:" + std::to_string(membw));
+    if (llc_thrash > 0)
+      parts.push_back("llc-thrash:" + std::to_string(llc_thrash));
+    if (cpu_spin > 0)
+      parts.push_back("cpu-spin:" + std::to_string(cpu_spin));
+    if (smt_sibling)
+      parts.push_back("smt-sibling");
+
+    std::string result{""};
+    for (const auto &part : parts) {
+      if (!result.empty())
+        result += ",";
+      result += part;
+    }
+    return result;
+  }
+
+  // One name per thread, in the order antagonists starts them, e.g., "membw 1", "membw 2"
+  std::vector<std::string> thread_names() const {
+    std::vector<std::string> names;
+    for (std::size_t i = 0; i < membw; i++)
+      names.push_back("membw " + std::to_string(i + 1));
+    for (std::size_t i = 0; i < llc_thrash; i++)
+      names.push_back("llc-thrash " + std::to_string(i + 1));
+    for (std::size_t i = 0; i < cpu_spin; i++)
+      names.push_back("cpu-spin " + std::to_string(i + 1));
+    if (smt_sibling)
+      names.push_back("smt-sibling");
+    return names;
+  }
+
+  // Returns std::nullopt if `spec` is not a comma-separated list of known antagonists, each with
+  // at most max_threads threads
+  static std::optional<interference_profile> parse(const std::string &spec) {
+    interference_profile result;
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+      if (item.empty())
+        continue;
+      if (item == "smt-sibling") {
+        result.smt_sibling = true;
+        continue;
+      }
+
+      const auto colon = item.find(':');
+      if (colon == std::string::npos || colon + 1 == item.size())
+        return std::nullopt;
+      const auto kind = item.substr(0, colon);
+      const auto count_string = item.substr(colon + 1);
+      if (count_string.size() > 9 ||
+          !std::all_of(count_string.begin(), count_string.end(),
+                       [](char c) { return c >= '0' && c <= '9'; }))
+        return std::nullopt;
+      const std::size_t count = std::stoul(count_string);
+      if (count > max_threads)
+        return std::nullopt;
+
+      if (kind == "membw") {
+        result.membw = count;
+      } else if (kind == "llc-thrash") {
+        result.llc_thrash = count;
+      } else if (kind == "cpu-spin") {
+        result.cpu_spin = count;
+      } else {
+        return std::nullopt;
+      }
+    }
+    return result;
+  }
+};
+
+// Starts the threads described by an interference_profile on construction and stops them in
+// stop() or on destruction. On Linux the calling (benchmark) thread is pinned to the core it is
+// running on for the lifetime of the antagonists, the `smt-sibling` thread is pinned to its
+// hyperthread sibling and every other antagonist is kept off both
+class antagonists {
+  std::atomic<bool> stop_{false};
+  std::atomic<std::size_t> running_{0};
+  std::vector<std::thread> threads_;
+
+#if defined(__linux__)
+  bool pinned_{false};
+  cpu_set_t original_affinity_;
+  cpu_set_t others_affinity_;
+  std::optional<int> sibling_cpu_;
+
+  static std::optional<int> find_smt_sibling(int cpu) {
+    std::ifstream is("/sys/devices/system/cpu/cpu" + std::to_string(cpu) +
+                     "/topology/thread_siblings_list");
+    std::string list;
+    if (!is.is_open() || !std::getline(is, list))
+      return std::nullopt;
+
+    // e.g., "0,4" or "0-1"
+    std::replace(list.begin(), list.end(), '-', ',');
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+      if (!item.empty() && std::stoi(item) != cpu)
+        return std::stoi(item);
+    }
+    return std::nullopt;
+  }
+
+  void pin_benchmark_thread() {
+    const auto cpu = sched_getcpu();
+    if (cpu < 0 ||
+        pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &original_affinity_) != 0)
+      return;
+
+    cpu_set_t benchmark_affinity;
+    CPU_ZERO(&benchmark_affinity);
+    CPU_SET(cpu, &benchmark_affinity);
+    pinned_ = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &benchmark_affinity) == 0;
+
+    sibling_cpu_ = find_smt_sibling(cpu);
+    others_affinity_ = original_affinity_;
+    CPU_CLR(cpu, &others_affinity_);
+    if (sibling_cpu_)
+      CPU_CLR(sibling_cpu_.value(), &others_affinity_);
+  }
+
+  void pin_antagonist_thread(std::thread &thread, bool on_sibling) {
+    if (!pinned_)
+      return;
+    if (on_sibling) {
+      if (!sibling_cpu_)
+        return;
+      cpu_set_t sibling_affinity;
+      CPU_ZERO(&sibling_affinity);
+      CPU_SET(sibling_cpu_.value(), &sibling_affinity);
+      pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &sibling_affinity);
+    } else if (CPU_COUNT(&others_affinity_) > 0) {
+      pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &others_affinity_);
+    }
+  }
+
+  void unpin_benchmark_thread() {
+    if (pinned_) {
+      pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &original_affinity_);
+      pinned_ = false;
+    }
+  }
+#else
+  void pin_benchmark_thread() {}
+  void pin_antagonist_thread(std::thread &, bool) {}
+  void unpin_benchmark_thread() {}
+#endif
+
+  static std::size_t last_level_cache_size() {
+#if defined(_SC_LEVEL3_CACHE_SIZE)
+    const auto size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (size > 0)
+      return static_cast<std::size_t>(size);
+#endif
+    return std::size_t{32} << 20; // 32 MB
+  }
+
+  void stream_memory() {
+    // Copy between two buffers twice the size of the LLC so every pass goes to DRAM
+    const auto size = 2 * last_level_cache_size();
+    std::vector<char> source(size, 'x'), destination(size, 'y');
+    running_ += 1;
+
+    constexpr std::size_t chunk = 1 << 20;
+    while (!stop_.load(std::memory_order_relaxed)) {
+      for (std::size_t offset = 0; offset < size && !stop_.load(std::memory_order_relaxed);
+           offset += chunk) {
+        std::memcpy(destination.data() + offset, source.data() + offset,
+                    std::min(chunk, size - offset));
+      }
+    }
+  }
+
+  void thrash_last_level_cache(std::uint64_t seed) {
+    constexpr std::size_t cache_line = 64;
+    const auto lines = last_level_cache_size() / cache_line;
+    std::vector<std::uint64_t> buffer(lines * cache_line / sizeof(std::uint64_t), 0);
+    running_ += 1;
+
+    auto state = seed;
+    while (!stop_.load(std::memory_order_relaxed)) {
+      for (std::size_t i = 0; i < 4096; i++) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        buffer[((state >> 33) % lines) * (cache_line / sizeof(std::uint64_t))] += 1;
+      }
+    }
+  }
+
+  void spin() {
+    running_ += 1;
+    volatile std::uint64_t counter = 0;
+    while (!stop_.load(std::memory_order_relaxed)) {
+      counter = counter + 1;
+    }
+  }
+
+public:
+  explicit antagonists(const interference_profile &profile) {
+    if (profile.empty())
+      return;
+
+    pin_benchmark_thread();
+
+    for (std::size_t i = 0; i < profile.membw; i++) {
+      threads_.emplace_back([this] { stream_memory(); });
+      pin_antagonist_thread(threads_.back(), false);
+    }
+    for (std::size_t i = 0; i < profile.llc_thrash; i++) {
+      threads_.emplace_back([this, i] { thrash_last_level_cache(i + 1); });
+      pin_antagonist_thread(threads_.back(), false);
+    }
+    for (std::size_t i = 0; i < profile.cpu_spin; i++) {
+      threads_.emplace_back([this] { spin(); });
+      pin_antagonist_thread(threads_.back(), false);
+    }
+    if (profile.smt_sibling) {
+      threads_.emplace_back([this] { spin(); });
+      pin_antagonist_thread(threads_.back(), true);
+    }
+
+    // Don't start measuring until every antagonist has allocated its buffers and is running
+    while (running_.load() < threads_.size()) {
+      std::this_thread::yield();
+    }
+  }
+
+  antagonists(const antagonists &) = delete;
+  antagonists &operator=(const antagonists &) = delete;
+
+  ~antagonists() { stop(); }
+
+  void stop() {
+    stop_ = true;
+    for (auto &thread : threads_) {
+      thread.join();
+    }
+    threads_.clear();
+    unpin_benchmark_thread();
+  }
+};
+
+} // namespace criterion
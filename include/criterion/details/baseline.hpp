@@ -0,0 +1,165 @@
+#pragma once
+#include <criterion/details/benchmark.hpp>
+#include <criterion/details/benchmark_result.hpp>
+#include <criterion/details/statistics.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+namespace criterion {
+
+// Samples (mean execution time per benchmark run) saved with --save_baseline, one file per
+// baseline in .criterion/baselines. compare() tests these per-run means, which are close to
+// independent, unlike the iterations of a run; every iteration is kept by sample_writer instead.
+// Each benchmark is stored as two lines:
+//
+//   MergeSort/1K
+//   <iterations per run> <number of samples> <sample> <sample> ...
+class baseline {
+  static inline const std::string magic{"criterion-baseline 1"};
+
+public:
+  struct entry {
+    std::size_t num_iterations;
+    std::vector<long double> samples;
+  };
+
+  std::string name;
+  std::vector<std::string> order; // benchmark names, in the order they were saved
+  std::unordered_map<std::string, entry> entries;
+
+  static inline std::string directory{".criterion/baselines"};
+
+  // Baseline names become file names, so only [A-Za-z0-9_.-] are allowed
+  static bool valid_name(const std::string &baseline_name) {
+    if (baseline_name.empty() || baseline_name == "." || baseline_name == "..")
+      return false;
+    return std::all_of(baseline_name.begin(), baseline_name.end(), [](char c) {
+      return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.' || c == '-';
+    });
+  }
+
+  static std::string path(const std::string &baseline_name) {
+    return directory + "/" + baseline_name + ".baseline";
+  }
+
+  static std::optional<baseline> load(const std::string &baseline_name) {
+    return load_file(path(baseline_name), baseline_name);
+  }
+
+  // Loads a baseline from any path, e.g., one copied out of .criterion/baselines
+  static std::optional<baseline> load_file(const std::string &filename,
+                                           const std::string &baseline_name) {
+    std::ifstream is(filename);
+    if (!is.is_open())
+      return std::nullopt;
+
+    std::string line;
+    if (!std::getline(is, line) || line != magic)
+      return std::nullopt;
+
+    baseline result;
+    result.name = baseline_name;
+    std::string benchmark_name;
+    while (std::getline(is, benchmark_name) && std::getline(is, line)) {
+      std::istringstream samples(line);
+      entry e{0, {}};
+      std::size_t size = 0;
+      if (!(samples >> e.num_iterations >> size))
+        return std::nullopt;
+      e.samples.reserve(size);
+      long double sample = 0;
+      while (e.samples.size() < size && samples >> sample) {
+        e.samples.push_back(sample);
+      }
+      if (e.samples.size() != size)
+        return std::nullopt;
+      result.add(benchmark_name, std::move(e));
+    }
+    return result;
+  }
+
+  void add(const std::string &benchmark_name, entry e) {
+    if (entries.find(benchmark_name) == entries.end())
+      order.push_back(benchmark_name);
+    entries[benchmark_name] = std::move(e);
+  }
+
+  bool save() const {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error)
+      return false;
+
+    // write to a temporary file first so an interrupted save leaves the old baseline intact
+    const auto filename = path(name);
+    const auto temporary = filename + ".tmp";
+    {
+      std::ofstream os(temporary);
+      if (!os.is_open())
+        return false;
+      os << magic << "\n";
+      os << std::setprecision(std::numeric_limits<long double>::max_digits10);
+      for (const auto &benchmark_name : order) {
+        const auto &e = entries.at(benchmark_name);
+        os << benchmark_name << "\n" << e.num_iterations << " " << e.samples.size();
+        for (const auto sample : e.samples) {
+          os << " " << sample;
+        }
+        os << "\n";
+      }
+      if (!os.good())
+        return false;
+    }
+    std::filesystem::rename(temporary, filename, error);
+    return !error;
+  }
+
+  // Saves the samples of `results` as `baseline_name`. Benchmarks that were not run (e.g., due
+  // to --run_filtered) keep their previously saved samples
+  static bool save(const std::string &baseline_name,
+                   const std::unordered_map<std::string, benchmark_result> &results) {
+    auto updated = load(baseline_name).value_or(baseline{});
+    updated.name = baseline_name;
+    for (const auto &benchmark_name : benchmark::benchmark_execution_order) {
+      const auto &result = results.at(benchmark_name);
+      updated.add(benchmark_name, entry{result.num_iterations, result.samples});
+    }
+    return updated.save();
+  }
+
+  // Compares every benchmark in `results` that is also in this baseline. A change is only
+  // reported as an improvement or regression if it is significant (p < `alpha`) and larger than
+  // `noise_threshold`, e.g., 0.02 for 2%
+  std::vector<baseline_comparison>
+  compare(const std::unordered_map<std::string, benchmark_result> &results,
+          long double noise_threshold, long double alpha = 0.05) const {
+    std::vector<baseline_comparison> comparisons;
+    for (const auto &benchmark_name : benchmark::benchmark_execution_order) {
+      const auto it = entries.find(benchmark_name);
+      if (it == entries.end())
+        continue;
+      const auto comparison =
+          compare_samples(it->second.samples, results.at(benchmark_name).samples, 1 - alpha);
+      auto verdict = baseline_verdict::no_change;
+      if (comparison.p_value < alpha && std::abs(comparison.relative_change) > noise_threshold) {
+        verdict = comparison.relative_change < 0 ? baseline_verdict::improved
+                                                 : baseline_verdict::regressed;
+      }
+      comparisons.push_back({benchmark_name, name, comparison, verdict});
+    }
+    return comparisons;
+  }
+};
+
+} // namespace criterion
@@ -7,6 +7,8 @@
 #include <functional>
 #include <iomanip>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <numeric>
 #include <optional>
 #include <sstream>
@@ -16,10 +18,17 @@
 #include <utility>
 #include <vector>
 
+#include <criterion/details/allocations.hpp>
+#include <criterion/details/antagonist.hpp>
 #include <criterion/details/benchmark_config.hpp>
 #include <criterion/details/benchmark_result.hpp>
+#include <criterion/details/complexity.hpp>
 #include <criterion/details/console_writer.hpp>
 #include <criterion/details/indicators.hpp>
+#include <criterion/details/reporter.hpp>
+#include <criterion/details/sample_writer.hpp>
+#include <criterion/details/time_budget.hpp>
+#include <criterion/details/trace_writer.hpp>
 
 namespace criterion {
 
@@ -27,7 +36,9 @@ class benchmark {
   benchmark_config config_;
   using Fn = benchmark_config::Fn;
 
-  static inline constexpr std::size_t num_iterations_{20};
+  static inline constexpr std::size_t default_num_iterations_{20};
+  std::size_t num_iterations_{default_num_iterations_};
+  std::size_t num_warmup_runs_{0};
   std::size_t max_num_runs_{0};
   const long double ten_seconds_{1e+10};
   long double min_benchmark_time_{ten_seconds_};
@@ -52,9 +63,17 @@ class benchmark {
   long double estimate_execution_time() {
     using namespace std::chrono;
 
+    const auto &options = config_.options;
+    const auto min_warmup_runs =
+        options.warmup_runs.value_or(options.warmup_time ? std::size_t{1} : warmup_runs);
+    const auto warmup_start = steady_clock::now();
+
     long double result = 0;
     bool first_run{true};
-    for (std::size_t i = 0; i < warmup_runs; i++) {
+    for (num_warmup_runs_ = 0;
+         num_warmup_runs_ < min_warmup_runs ||
+         (options.warmup_time && steady_clock::now() - warmup_start < options.warmup_time.value());
+         num_warmup_runs_++) {
       std::chrono::steady_clock::time_point start_timestamp;
       std::optional<std::chrono::steady_clock::time_point> teardown_timestamp;
       const auto start = steady_clock::now();
@@ -78,7 +97,8 @@ class benchmark {
     if (early_estimate_execution_time_ < 1)
       early_estimate_execution_time_ = 1;
 
-    auto min_runs = 2;
+    const auto &options = config_.options;
+    std::size_t min_runs = options.max_time ? 1 : 2;
 
     if (early_estimate_execution_time_ <= 100) {              // 100ns
       benchmark_time_ = 5e+8;                                 // 500 ms
@@ -96,32 +116,173 @@ class benchmark {
 
     benchmark_time_ =
         std::max(early_estimate_execution_time_ * min_runs * num_iterations_, benchmark_time_);
+
+    if (options.min_time) {
+      benchmark_time_ = std::max(benchmark_time_, (long double)options.min_time->count());
+    }
+    if (options.max_time) {
+      benchmark_time_ = std::min(benchmark_time_, (long double)options.max_time->count());
+    }
+
+    if (options.samples) {
+      // exactly this many runs, unless max_time runs out first
+      max_num_runs_ = std::max(options.samples.value(), std::size_t{1});
+      if (!options.max_time) {
+        benchmark_time_ = std::numeric_limits<long double>::infinity();
+      }
+      return;
+    }
+
     const auto total_iterations = size_t(benchmark_time_) / early_estimate_execution_time_;
     max_num_runs_ = std::max(size_t(total_iterations / num_iterations_), size_t(min_runs));
   }
 
 public:
-  benchmark(const benchmark_config &config) : config_(config) {}
+  benchmark(const benchmark_config &config)
+      : config_(config),
+        num_iterations_(std::max(config.options.batch_size.value_or(default_num_iterations_),
+                                 std::size_t{1})) {}
 
   static inline std::unordered_map<std::string, benchmark_result> results;
   static inline std::vector<std::string> benchmark_execution_order;
   static inline bool show_console_output = true;
   static inline std::size_t warmup_runs = 3;
+  static inline interference_profile interference;
+  static inline std::optional<std::chrono::nanoseconds> time_budget;
+  static inline std::optional<time_budget_report> budget_report;
+  static inline sample_writer *sample_export{nullptr}; // set with --export_samples
+  static inline trace_writer *trace{nullptr};          // set with --trace
+  static inline std::vector<std::shared_ptr<reporter>> reporters;
+
+  // Runs a few iterations to estimate the cost and variance of this benchmark, e.g., to split a
+  // time budget across benchmarks. Stops once `max_time` ns have passed, but not before two
+  // iterations. Nothing is recorded
+  budget_pilot pilot(long double max_time) {
+    using namespace std::chrono;
+    const auto pilot_start = steady_clock::now();
+
+    std::shared_ptr<void> lazy_parameters;
+    if (config_.parameter_factory) {
+      lazy_parameters = config_.parameter_factory();
+      config_.parameters = lazy_parameters.get();
+    }
+
+    if (config_.before_instance) {
+      config_.before_instance(config_.parameters);
+    }
+
+    constexpr std::size_t max_pilot_iterations = 100;
+    std::vector<long double> durations;
+    long double iterations_time = 0;
+    while (durations.size() < 2 ||
+           (durations.size() < max_pilot_iterations && iterations_time < max_time)) {
+      std::optional<std::chrono::steady_clock::time_point> teardown_timestamp;
+      const auto iteration_start = steady_clock::now();
+      auto start = iteration_start;
+      config_.fn(start, teardown_timestamp, config_.parameters);
+      const auto iteration_end = steady_clock::now();
+      const auto end = teardown_timestamp.value_or(iteration_end);
+      durations.push_back(
+          static_cast<long double>(duration_cast<std::chrono::nanoseconds>(end - start).count()));
+      iterations_time += static_cast<long double>(
+          duration_cast<std::chrono::nanoseconds>(iteration_end - iteration_start).count());
+    }
+
+    if (config_.after_instance) {
+      config_.after_instance(config_.parameters);
+    }
+    lazy_parameters.reset();
+
+    const auto size = durations.size();
+    const long double mean = std::accumulate(durations.begin(), durations.end(), 0.0L) / size;
+    long double E = 0;
+    for (const auto duration : durations) {
+      E += std::pow(duration - mean, 2);
+    }
+    const long double standard_deviation = std::sqrt(E / size);
+
+    const auto iteration_cost = std::max(iterations_time / size, 1.0L);
+    const auto overhead =
+        static_cast<long double>(
+            duration_cast<std::chrono::nanoseconds>(steady_clock::now() - pilot_start).count()) -
+        iterations_time;
+
+    const auto &options = config_.options;
+    const auto num_warmup_runs =
+        options.warmup_runs.value_or(options.warmup_time ? std::size_t{1} : warmup_runs);
+    auto fixed_cost = std::max(overhead, 0.0L) + num_warmup_runs * iteration_cost;
+    if (options.warmup_time) {
+      fixed_cost = std::max(fixed_cost, (long double)options.warmup_time->count());
+    }
+    if (options.samples) {
+      fixed_cost += options.samples.value() * num_iterations_ * iteration_cost;
+    }
+
+    if (trace) {
+      trace->complete(trace->thread_track("benchmark"),
+                      config_.name + config_.parameterized_instance_name, "pilot", pilot_start,
+                      steady_clock::now(), {{"iterations", durations.size()}});
+    }
+
+    return budget_pilot{.name = config_.name + config_.parameterized_instance_name,
+                        .iteration_cost = iteration_cost,
+                        .relative_standard_deviation = mean > 0 ? standard_deviation / mean : 0,
+                        .fixed_cost = fixed_cost,
+                        .batch_size = num_iterations_,
+                        .adjustable_batch_size = !options.batch_size.has_value(),
+                        .allocatable = !options.samples.has_value()};
+  }
 
   void run() {
     std::chrono::steady_clock::time_point benchmark_start_timestamp;
 
     using namespace std::chrono;
 
+    // Phases of this run on the timeline of --trace, if any
+    const auto run_start = steady_clock::now();
+    auto phase_start = run_start;
+    const auto trace_track = trace ? trace->thread_track("benchmark") : 0;
+    const auto trace_phase = [&](const std::string &phase, const trace_writer::args &args = {}) {
+      const auto now = steady_clock::now();
+      if (trace)
+        trace->complete(trace_track, phase, "phase", phase_start, now, args);
+      phase_start = now;
+    };
+
     // run empty function to estimate minimum delay in scheduling and executing user function
     const auto estimated_minimum_measurement_cost = estimate_minimum_measurement_cost();
+    trace_phase("calibration", {{"measurement_cost_ns", estimated_minimum_measurement_cost}});
 
     const std::string benchmark_instance_name = config_.name + config_.parameterized_instance_name;
     benchmark_execution_order.push_back(benchmark_instance_name);
+    const auto sample_export_id =
+        sample_export ? sample_export->add_benchmark(benchmark_instance_name,
+                                                     estimated_minimum_measurement_cost)
+                      : 0;
+
+    // Construct lazily declared parameters now that this instance is actually being run
+    std::shared_ptr<void> lazy_parameters;
+    if (config_.parameter_factory) {
+      lazy_parameters = config_.parameter_factory();
+      config_.parameters = lazy_parameters.get();
+    }
+
+    if (config_.before_instance) {
+      config_.before_instance(config_.parameters);
+    }
+
+    // Start background interference (if any) before warmup so estimates see the same load
+    antagonists interference_threads{interference};
+    const auto interference_start = steady_clock::now();
+    trace_phase("setup");
 
     // Get an early estimate for execution time
     // Update number of iterations to run for this benchmark based on estimate
     update_iterations();
+    trace_phase("warmup", {{"runs", num_warmup_runs_},
+                           {"estimate_ns", early_estimate_execution_time_},
+                           {"batch_size", num_iterations_},
+                           {"max_runs", max_num_runs_}});
 
     const auto total_number_of_iterations = max_num_runs_ * num_iterations_;
 
@@ -136,7 +297,8 @@ public:
     mean_in_each_run.reserve(max_num_runs_);
 
     std::size_t num_runs = 0;
-    std::array<long double, num_iterations_> durations;
+    std::vector<long double> durations(num_iterations_);
+    std::uint64_t allocations = 0; // in measured iterations, if allocation_counter is enabled
 
     using namespace indicators;
 
@@ -161,15 +323,33 @@ public:
       if (first_run) {
         benchmark_start_timestamp = std::chrono::steady_clock::now();
       }
+      const auto run_allocations = allocations;
+      long double fixture_time = 0; // in SETUP_BENCHMARK and TEARDOWN_BENCHMARK, if traced
       for (std::size_t i = 0; i < num_iterations_; i++) {
         std::optional<std::chrono::steady_clock::time_point> teardown_timestamp;
+        allocation_counter::mark_start();
+        allocation_counter::iteration_end.reset();
         auto start = steady_clock::now();
+        const auto call_start = start;
         config_.fn(start, teardown_timestamp, config_.parameters);
         auto end = steady_clock::now();
+        if (allocation_counter::enabled) {
+          allocations += allocation_counter::iteration_end.value_or(allocation_counter::count()) -
+                         allocation_counter::iteration_start;
+        }
+        if (trace) {
+          fixture_time += static_cast<long double>(
+              duration_cast<std::chrono::nanoseconds>((start - call_start) +
+                                                      (end - teardown_timestamp.value_or(end)))
+                  .count());
+        }
         if (teardown_timestamp)
           end = teardown_timestamp.value();
         const auto execution_time = duration_cast<std::chrono::nanoseconds>(end - start).count();
         durations[i] = std::abs(execution_time - estimated_minimum_measurement_cost);
+        if (sample_export) {
+          sample_export->add(sample_export_id, num_runs, num_iterations_, start, execution_time);
+        }
         if (show_console_output) {
           bar.tick();
         }
@@ -227,6 +407,22 @@ public:
         slowest_execution_time = std::max(slowest_execution_time, current_worst_execution_time);
       }
 
+      if (trace) {
+        const auto now = steady_clock::now();
+        trace->complete(trace_track, "run " + std::to_string(num_runs + 1), "run", phase_start,
+                        now, {{"mean_ns", mean}, {"rsd_percentage", relative_standard_deviation}});
+        trace->counter("mean (ns)", phase_start, mean);
+        trace->counter("rsd (%)", phase_start, relative_standard_deviation);
+        trace->counter("setup and teardown (ns/iteration)", phase_start,
+                       fixture_time / num_iterations_);
+        if (allocation_counter::enabled) {
+          trace->counter("allocations (per iteration)", phase_start,
+                         static_cast<long double>(allocations - run_allocations) /
+                             num_iterations_);
+        }
+        phase_start = now;
+      }
+
       num_runs += 1;
 
       if (num_runs >= max_num_runs_) {
@@ -248,12 +444,26 @@ public:
       }
     }
 
+    interference_threads.stop();
+    if (trace) {
+      const auto interference_end = steady_clock::now();
+      for (const auto &thread : interference.thread_names()) {
+        trace->complete(trace->track("antagonist " + thread), thread, "antagonist",
+                        interference_start, interference_end);
+      }
+    }
+
+    if (config_.after_instance) {
+      config_.after_instance(config_.parameters);
+    }
+    trace_phase("teardown");
+
     const auto mean_execution_time =
         (std::accumulate(mean_in_each_run.begin(), mean_in_each_run.end(), 0.0) / num_runs);
 
     const auto benchmark_result = criterion::benchmark_result{
         .name = benchmark_instance_name,
-        .num_warmup_runs = warmup_runs,
+        .num_warmup_runs = num_warmup_runs_,
         .num_runs = max_num_runs_,
         .num_iterations = num_iterations_,
         .lowest_rsd = lowest_rsd,
@@ -265,9 +475,22 @@ public:
         .slowest_execution_time = slowest_execution_time,
         .average_iteration_performance = (1E9 / mean_execution_time),
         .fastest_iteration_performance = (1E9 / fastest_execution_time),
-        .slowest_iteration_performance = (1E9 / slowest_execution_time)};
+        .slowest_iteration_performance = (1E9 / slowest_execution_time),
+        .interference = interference.to_string(),
+        .samples = mean_in_each_run,
+        .allocations_per_iteration =
+            allocation_counter::enabled
+                ? std::optional<long double>(static_cast<long double>(allocations) /
+                                             (num_runs * num_iterations_))
+                : std::nullopt};
 
     results.insert(std::make_pair(benchmark_instance_name, benchmark_result));
+    complexity_registration_helper_struct::record(
+        config_.template_name.empty() ? config_.name : config_.template_name, config_.name,
+        config_.parameters, mean_execution_time);
+    for (const auto &r : reporters) {
+      r->on_benchmark_complete(benchmark_result);
+    }
 
     if (show_console_output) {
       bar.set_progress(total_number_of_iterations);
@@ -278,6 +501,13 @@ public:
 
       console_writer::write_result(benchmark_result);
     }
+    trace_phase("analysis");
+
+    if (trace) {
+      trace->complete(trace_track, benchmark_instance_name, "benchmark", run_start,
+                      steady_clock::now(), {{"runs", num_runs}, {"mean_ns", mean_execution_time}});
+      trace->flush();
+    }
   }
 };
 
@@ -1,15 +1,48 @@
 #pragma once
 #include <chrono>
 #include <functional>
+#include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
 
 namespace criterion {
 
+// Per-benchmark measurement settings. Unset fields fall back to the defaults, e.g.,
+// BENCHMARK_OPTIONS(MergeSort, .warmup_runs = 1, .samples = 3, .batch_size = 1)
+struct benchmark_options {
+  std::optional<std::size_t> warmup_runs{};              // number of warmup runs (default: 3)
+  std::optional<std::chrono::nanoseconds> warmup_time{}; // keep warming up for at least this long
+  std::optional<std::chrono::nanoseconds> min_time{};    // measure for at least this long
+  std::optional<std::chrono::nanoseconds> max_time{};    // measure for at most this long
+  std::optional<std::size_t> samples{};                  // exact number of runs
+  std::optional<std::size_t> batch_size{};               // iterations per run (default: 20)
+
+  // Fields set in `overrides` replace the ones set here
+  benchmark_options merged_with(const benchmark_options &overrides) const {
+    auto result = *this;
+    if (overrides.warmup_runs)
+      result.warmup_runs = overrides.warmup_runs;
+    if (overrides.warmup_time)
+      result.warmup_time = overrides.warmup_time;
+    if (overrides.min_time)
+      result.min_time = overrides.min_time;
+    if (overrides.max_time)
+      result.max_time = overrides.max_time;
+    if (overrides.samples)
+      result.samples = overrides.samples;
+    if (overrides.batch_size)
+      result.batch_size = overrides.batch_size;
+    return result;
+  }
+};
+
 struct benchmark_config {
   static inline std::tuple<> empty_tuple{};
   std::string name;
+  // name the config was registered under, e.g., "Forward" for "Forward<std::vector<int>>". Set by
+  // the registry; empty if it is the same as `name`
+  std::string template_name = "";
   using Fn = std::function<void(
       std::chrono::steady_clock::time_point &,                // start time stamp
       std::optional<std::chrono::steady_clock::time_point> &, // teardown time stamp
@@ -17,6 +50,19 @@ struct benchmark_config {
   Fn fn;
   std::string parameterized_instance_name = "";
   void *parameters = (void *)(&empty_tuple);
+  std::shared_ptr<void> owned_parameters{nullptr}; // keeps generated `parameters` alive
+
+  // Optional hooks called once per benchmark instance, before warmup and after the last run
+  using Hook = std::function<void(void *parameters)>;
+  Hook before_instance{nullptr};
+  Hook after_instance{nullptr};
+
+  // Optional factory for `parameters`, called only when the instance is run. The parameters it
+  // creates are released as soon as the instance completes
+  using ParameterFactory = std::function<std::shared_ptr<void>()>;
+  ParameterFactory parameter_factory{nullptr};
+
+  benchmark_options options{};
 
   enum class benchmark_reporting_type { console };
   benchmark_reporting_type reporting_type = benchmark_reporting_type::console;
@@ -1,6 +1,10 @@
 #pragma once
+#include <criterion/details/json_string.hpp>
+#include <iomanip>
+#include <optional>
 #include <sstream>
 #include <string>
+#include <vector>
 
 namespace criterion {
 
@@ -23,6 +27,13 @@ struct benchmark_result {
   long double fastest_iteration_performance; // iterations per second in the fastest case
   long double slowest_iteration_performance; // iterations per second in the slowest case
 
+  std::string interference; // background load active during the run, e.g., "membw:2", if any
+
+  std::vector<long double> samples; // mean execution time in each run
+
+  // heap allocations per iteration, if counted (see allocation_counter)
+  std::optional<long double> allocations_per_iteration{};
+
   std::string to_csv() const {
     std::stringstream os;
 
@@ -39,7 +50,7 @@ struct benchmark_result {
   std::string to_json() const {
     std::stringstream os;
     os << std::fixed << std::setprecision(2) << "    {\n"
-       << "      \"name\": \"" << name << "\",\n"
+       << "      \"name\": \"" << detail::json_escape(name) << "\",\n"
        << "      \"warmup_runs\": " << num_warmup_runs << ",\n"
        << "      \"iterations\": " << num_runs * num_iterations << ",\n"
        << "      \"mean_execution_time\": " << mean_execution_time << ",\n"
@@ -50,12 +61,48 @@ struct benchmark_result {
        << "      \"lowest_rsd_index\": " << lowest_rsd_index << ",\n"
        << "      \"average_iteration_performance\": " << average_iteration_performance << ",\n"
        << "      \"fastest_iteration_performance\": " << fastest_iteration_performance << ",\n"
-       << "      \"slowest_iteration_performance\": " << slowest_iteration_performance << "\n"
+       << "      \"slowest_iteration_performance\": " << slowest_iteration_performance << ",\n"
+       << "      \"runs\": " << num_runs;
+    if (allocations_per_iteration.has_value()) {
+      os << ",\n"
+         << "      \"allocations_per_iteration\": " << allocations_per_iteration.value();
+    }
+    if (!interference.empty()) {
+      os << ",\n"
+         << "      \"interference\": \"" << detail::json_escape(interference) << "\"";
+    }
+    os << "\n"
        << "    }";
 
     return os.str();
   }
 
+  // One line of JSON Lines, with the same keys as to_json()
+  std::string to_jsonl() const {
+    std::stringstream os;
+    os << std::fixed << std::setprecision(2) << "{\"name\":\"" << detail::json_escape(name)
+       << "\",\"warmup_runs\":" << num_warmup_runs
+       << ",\"iterations\":" << num_runs * num_iterations
+       << ",\"mean_execution_time\":" << mean_execution_time
+       << ",\"fastest_execution_time\":" << fastest_execution_time
+       << ",\"slowest_execution_time\":" << slowest_execution_time
+       << ",\"lowest_rsd_execution_time\":" << lowest_rsd_mean
+       << ",\"lowest_rsd_percentage\":" << lowest_rsd
+       << ",\"lowest_rsd_index\":" << lowest_rsd_index
+       << ",\"average_iteration_performance\":" << average_iteration_performance
+       << ",\"fastest_iteration_performance\":" << fastest_iteration_performance
+       << ",\"slowest_iteration_performance\":" << slowest_iteration_performance
+       << ",\"runs\":" << num_runs;
+    if (allocations_per_iteration.has_value()) {
+      os << ",\"allocations_per_iteration\":" << allocations_per_iteration.value();
+    }
+    if (!interference.empty()) {
+      os << ",\"interference\":\"" << detail::json_escape(interference) << "\"";
+    }
+    os << "}";
+    return os.str();
+  }
+
   std::string to_md() const {
     std::stringstream os;
     os << std::fixed << std::setprecision(2) << "|" << name << "|" << num_warmup_runs << "|"
@@ -0,0 +1,214 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace criterion {
+
+// Candidate models, in order of growth
+enum class complexity { o_1, o_log_n, o_n, o_n_log_n, o_n_squared, o_n_cubed };
+
+inline std::string to_string(complexity model) {
+  switch (model) {
+  case complexity::o_1:
+    return "O(1)";
+  case complexity::o_log_n:
+    return "O(log n)";
+  case complexity::o_n:
+    return "O(n)";
+  case complexity::o_n_log_n:
+    return "O(n log n)";
+  case complexity::o_n_squared:
+    return "O(n^2)";
+  case complexity::o_n_cubed:
+    return "O(n^3)";
+  }
+  return "";
+}
+
+struct complexity_fit {
+  complexity model{complexity::o_1};
+  long double coefficient{0}; // time = coefficient * f(n), in ns
+  long double rms{0};         // RMS of the residuals, relative to the mean time
+};
+
+// Least-squares fit of `time = coefficient * f(n)` for every model in `complexity`.
+// `points` are (n, mean execution time) pairs. Returns the fits, best (lowest RMS) first
+inline std::vector<complexity_fit>
+fit_complexity(const std::vector<std::pair<long double, long double>> &points) {
+  static const std::array<complexity, 6> models{complexity::o_1,         complexity::o_log_n,
+                                                complexity::o_n,         complexity::o_n_log_n,
+                                                complexity::o_n_squared, complexity::o_n_cubed};
+  const auto f = [](complexity model, long double n) -> long double {
+    switch (model) {
+    case complexity::o_1:
+      return 1;
+    case complexity::o_log_n:
+      return std::log2(n);
+    case complexity::o_n:
+      return n;
+    case complexity::o_n_log_n:
+      return n * std::log2(n);
+    case complexity::o_n_squared:
+      return n * n;
+    case complexity::o_n_cubed:
+      return n * n * n;
+    }
+    return 0;
+  };
+
+  std::vector<complexity_fit> result;
+  if (points.empty())
+    return result;
+
+  long double mean_time = 0;
+  for (const auto &[n, time] : points) {
+    mean_time += time;
+  }
+  mean_time /= points.size();
+
+  for (const auto model : models) {
+    long double sum_time_f = 0, sum_f_squared = 0;
+    for (const auto &[n, time] : points) {
+      sum_time_f += time * f(model, n);
+      sum_f_squared += f(model, n) * f(model, n);
+    }
+    if (sum_f_squared == 0 || !std::isfinite(sum_f_squared))
+      continue;
+
+    const auto coefficient = sum_time_f / sum_f_squared;
+    long double sum_squared_residuals = 0;
+    for (const auto &[n, time] : points) {
+      sum_squared_residuals += std::pow(time - coefficient * f(model, n), 2);
+    }
+    const auto rms = std::sqrt(sum_squared_residuals / points.size());
+    result.push_back({model, coefficient, mean_time > 0 ? rms / mean_time : rms});
+  }
+
+  std::stable_sort(result.begin(), result.end(),
+                   [](const auto &lhs, const auto &rhs) { return lhs.rms < rhs.rms; });
+  return result;
+}
+
+// The instances of a family that are fitted together, e.g., those of one type of a
+// TYPED_BENCHMARK, "Forward<std::vector<int>>"
+struct complexity_curve {
+  std::string name;
+  std::vector<std::pair<long double, long double>> points{}; // (n, mean execution time)
+
+  // Returns std::nullopt if fewer than two instances were run
+  std::optional<complexity_fit> best_fit() const {
+    if (points.size() < 2)
+      return std::nullopt;
+    const auto fits = fit_complexity(points);
+    if (fits.empty())
+      return std::nullopt;
+    return fits.front();
+  }
+};
+
+// A benchmark family whose instances are fitted against the size in one of its arguments.
+// Each type or value of a TYPED_BENCHMARK or VALUE_BENCHMARK gets a curve of its own, so, e.g.,
+// std::vector and std::list timings are never combined into one fit
+struct complexity_family {
+  std::string template_name;
+  std::function<long double(void *parameters)> size_of;
+  std::optional<complexity> expected;
+  std::vector<complexity_curve> curves{}; // in order of their first instance
+
+  // Fewer points cannot tell neighbouring models apart, e.g., O(n) from O(n log n)
+  static constexpr std::size_t min_points_to_fail = 4;
+
+  // How much worse the expected model must fit than the best one for a curve to fail: its
+  // relative RMS must be at least `rms_ratio` times and `rms_margin` above that of the best fit
+  static constexpr long double rms_ratio = 2;
+  static constexpr long double rms_margin = 0.05;
+
+  // A curve fails if it grows faster than expected, e.g., O(n^2) when O(n log n) was expected,
+  // and the expected model fits materially worse. A best fit that only ranks above the expected
+  // model by noise, e.g., a fraction of a percent of RMS, does not fail the run
+  bool failed(const complexity_curve &curve) const {
+    if (!expected.has_value() || curve.points.size() < min_points_to_fail)
+      return false;
+    const auto fits = fit_complexity(curve.points);
+    if (fits.empty() || fits.front().model <= expected.value())
+      return false;
+    const auto &best = fits.front();
+    const auto expected_fit = std::find_if(fits.begin(), fits.end(), [this](const auto &fit) {
+      return fit.model == expected.value();
+    });
+    if (expected_fit == fits.end())
+      return true;
+    return expected_fit->rms > best.rms * rms_ratio && expected_fit->rms - best.rms > rms_margin;
+  }
+
+  bool failed() const {
+    return std::any_of(curves.begin(), curves.end(),
+                       [this](const auto &curve) { return failed(curve); });
+  }
+};
+
+struct complexity_registration_helper_struct {
+  static std::vector<complexity_family> &registered_families() {
+    static std::vector<complexity_family> v;
+    return v;
+  }
+
+  template <class ArgTuple, std::size_t Index>
+  static void register_family(const std::string &template_name,
+                              std::optional<complexity> expected) {
+    using Arg = std::tuple_element_t<Index, ArgTuple>;
+    static_assert(std::is_arithmetic_v<Arg>, "the size argument of a benchmark must be numeric");
+    registered_families().push_back(
+        {template_name,
+         [](void *parameters) {
+           return static_cast<long double>(std::get<Index>(*static_cast<ArgTuple *>(parameters)));
+         },
+         expected});
+  }
+
+  // Called by every benchmark instance when it completes. `template_name` is the name the
+  // instance was registered under, e.g., "Forward", and `name` the name of its config, e.g.,
+  // "Forward<std::vector<int>>", which picks the curve it is fitted on
+  static void record(const std::string &template_name, const std::string &name, void *parameters,
+                     long double mean_execution_time) {
+    for (auto &family : registered_families()) {
+      if (family.template_name != template_name)
+        continue;
+      auto curve = std::find_if(family.curves.begin(), family.curves.end(),
+                                [&name](const auto &c) { return c.name == name; });
+      if (curve == family.curves.end()) {
+        family.curves.push_back({name});
+        curve = std::prev(family.curves.end());
+      }
+      curve->points.push_back({family.size_of(parameters), mean_execution_time});
+    }
+  }
+};
+
+} // namespace criterion
+
+// Fit the instances of a benchmark against the value of its ArgIndex-th argument, e.g.,
+// BENCHMARK_COMPLEXITY(Sort, 0) or BENCHMARK_COMPLEXITY(Sort, 0, criterion::complexity::o_n).
+// With an expected complexity, a best fit that grows faster makes the benchmark program fail
+#define BENCHMARK_COMPLEXITY(TemplateName, ArgIndex, ...)                                          \
+                                                                                                   \
+  namespace /* ensure internal linkage for struct */                                               \
+  {                                                                                                \
+  /* helper struct for static registration in ctor */                                              \
+  struct CONCAT(TemplateName, CONCAT(_complexity_struct_, __LINE__)) {                             \
+    CONCAT(TemplateName, CONCAT(_complexity_struct_, __LINE__))() { /* called once before main */  \
+      criterion::complexity_registration_helper_struct::register_family<                           \
+          CONCAT(TemplateName, BenchmarkParameters), ArgIndex>(                                    \
+          #TemplateName, std::optional<criterion::complexity>{__VA_ARGS__});                       \
+    }                                                                                              \
+  } CONCAT(TemplateName, CONCAT(_complexity_struct_instance_, __LINE__));                          \
+  }
@@ -1,7 +1,15 @@
 #pragma once
 #include <array>
 #include <criterion/details/benchmark_result.hpp>
+#include <criterion/details/complexity.hpp>
+#include <criterion/details/family_comparison.hpp>
+#include <criterion/details/history.hpp>
 #include <criterion/details/indicators.hpp>
+#include <criterion/details/statistics.hpp>
+#include <criterion/details/thresholds.hpp>
+#include <criterion/details/time_budget.hpp>
+#include <cstdint>
+#include <ctime>
 #include <iomanip>
 #include <sstream>
 #include <string>
@@ -52,6 +60,11 @@ public:
               << (result.num_runs > 1 ? " benchmark runs, " : " benchmark run, ")
               << result.num_iterations << " iterations per run\n";
 
+    if (!result.interference.empty()) {
+      std::cout << "      " << termcolor::yellow << "Interference: " << result.interference
+                << termcolor::reset << "\n";
+    }
+
     std::cout << "    " << termcolor::bold << termcolor::underline << "Execution Time"
               << termcolor::reset << "\n";
 
@@ -121,6 +134,269 @@ public:
               << worst_mean_iterations_percentage_difference << " %" << termcolor::reset << ")"
               << "\n";
 
+    if (result.allocations_per_iteration.has_value()) {
+      std::cout << "    " << termcolor::bold << termcolor::underline << "Allocations"
+                << termcolor::reset << "\n";
+
+      std::cout << "      Average    " << std::setprecision(2) << std::fixed << std::right
+                << std::setw(10) << result.allocations_per_iteration.value()
+                << " allocations/iteration\n";
+    }
+
+    std::cout << "\n";
+  }
+
+  static void write_complexity(const complexity_family &family, const complexity_curve &curve,
+                               const complexity_fit &fit) {
+    if (family.failed(curve)) {
+      std::cout << termcolor::bold << termcolor::red << " ✗ " << curve.name;
+    } else {
+      std::cout << termcolor::bold << termcolor::green << " ✓ " << curve.name;
+    }
+    std::cout << termcolor::reset << "\n";
+
+    std::cout << "    " << termcolor::bold << termcolor::underline << "Complexity"
+              << termcolor::reset << "\n";
+
+    std::cout << termcolor::yellow << termcolor::bold << termcolor::italic << "      Best fit     "
+              << std::right << std::setw(10) << to_string(fit.model) << termcolor::reset << " ("
+              << curve.points.size() << " instances)\n";
+
+    std::cout << "      Coefficient  " << std::right << std::setw(10)
+              << duration_to_string(fit.coefficient) << "\n";
+
+    std::cout << "      RMS          " << std::right << std::setw(10) << std::setprecision(2)
+              << std::fixed << fit.rms * 100 << " %\n";
+
+    if (family.expected.has_value()) {
+      std::cout << (family.failed(curve) ? termcolor::red : termcolor::green)
+                << "      Expected     " << std::right << std::setw(10)
+                << to_string(family.expected.value()) << termcolor::reset << "\n";
+    }
+
+    std::cout << "\n";
+  }
+
+  static void write_time_budget(const time_budget_report &report) {
+    if (report.under_sampled.empty()) {
+      std::cout << termcolor::bold << termcolor::green << " ✓ Time budget";
+    } else {
+      std::cout << termcolor::bold << termcolor::yellow << " ! Time budget ("
+                << report.under_sampled.size() << " of " << report.num_benchmarks
+                << " benchmarks under-sampled)";
+    }
+    std::cout << termcolor::reset << "\n";
+
+    std::cout << "    " << termcolor::bold << termcolor::underline << "Time Budget"
+              << termcolor::reset << "\n";
+
+    std::cout << "      Budget       " << std::right << std::setw(10)
+              << duration_to_string(report.budget) << "\n";
+    std::cout << "      Pilot        " << std::right << std::setw(10)
+              << duration_to_string(report.pilot_time) << "\n";
+    std::cout << (report.elapsed_time > report.budget ? termcolor::red : termcolor::green)
+              << "      Elapsed      " << std::right << std::setw(10)
+              << duration_to_string(report.elapsed_time) << termcolor::reset << "\n";
+
+    if (!report.under_sampled.empty()) {
+      std::cout << "    " << termcolor::bold << termcolor::underline << "Under-sampled"
+                << termcolor::reset << "\n";
+      std::size_t name_width = 0;
+      for (const auto &benchmark : report.under_sampled) {
+        name_width = std::max(name_width, benchmark.name.size());
+      }
+      for (const auto &benchmark : report.under_sampled) {
+        std::cout << termcolor::yellow << "      " << std::left << std::setw(name_width + 2)
+                  << benchmark.name << termcolor::reset << std::right << std::setw(10)
+                  << duration_to_string(benchmark.allocated_time);
+        if (benchmark.iterations < 2) {
+          std::cout << " (1 iteration)\n";
+        } else {
+          std::cout << " ± " << std::setprecision(2) << std::fixed
+                    << benchmark.relative_standard_error * 100 << " % (" << benchmark.iterations
+                    << " iterations)\n";
+        }
+      }
+    }
+
+    std::cout << "\n";
+  }
+
+  static void write_analysis(const benchmark_result &result, const sample_estimate &estimate) {
+    std::cout << termcolor::bold << termcolor::green << " ✓ " << result.name << termcolor::reset
+              << "\n";
+
+    std::cout << "    " << termcolor::bold << termcolor::underline << "Samples"
+              << termcolor::reset << "\n";
+
+    std::cout << "      " << result.num_runs << (result.num_runs == 1 ? " run, " : " runs, ")
+              << estimate.num_samples << " samples\n";
+
+    const auto &outliers = estimate.outliers;
+    std::cout << (outliers.total() > 0 ? termcolor::yellow : termcolor::white) << "      "
+              << outliers.total() << " outliers (" << std::setprecision(2) << std::fixed
+              << (estimate.num_samples > 0 ? outliers.total() * 100.0L / estimate.num_samples : 0)
+              << " %): " << outliers.low_severe << " low severe, " << outliers.low_mild
+              << " low mild, " << outliers.high_mild << " high mild, " << outliers.high_severe
+              << " high severe" << termcolor::reset << "\n";
+
+    if (estimate.num_dropped > 0) {
+      std::cout << "      " << estimate.num_dropped << " dropped ("
+                << to_string(estimate.policy) << " outliers)\n";
+    }
+
+    std::cout << "    " << termcolor::bold << termcolor::underline << "Execution Time ("
+              << to_string(estimate.method) << ")" << termcolor::reset << "\n";
+
+    std::cout << termcolor::yellow << termcolor::bold << termcolor::italic << "      Estimate     "
+              << std::right << std::setw(10) << duration_to_string(estimate.estimate)
+              << termcolor::reset << " [" << duration_to_string(estimate.lower_bound) << ", "
+              << duration_to_string(estimate.upper_bound) << "] (" << std::setprecision(2)
+              << std::fixed << estimate.confidence_level * 100 << " % confidence)\n";
+
+    std::cout << "      Fastest      " << std::right << std::setw(10)
+              << duration_to_string(result.fastest_execution_time) << "\n";
+
+    std::cout << "      Slowest      " << std::right << std::setw(10)
+              << duration_to_string(result.slowest_execution_time) << "\n";
+
+    // only known if the durations of individual iterations were stored
+    if (estimate.num_samples > result.num_runs) {
+      std::cout << "      Lowest RSD   " << std::right << std::setw(10)
+                << duration_to_string(result.lowest_rsd_mean) << " ± " << std::setprecision(2)
+                << result.lowest_rsd << "%"
+                << " (" << ordinal(result.lowest_rsd_index) << " run)\n";
+    }
+
+    std::cout << "\n";
+  }
+
+  static void write_baseline_comparison(const baseline_comparison &result) {
+    const auto &comparison = result.comparison;
+    const auto regressed = result.verdict == baseline_verdict::regressed;
+    const auto improved = result.verdict == baseline_verdict::improved;
+    if (regressed) {
+      std::cout << termcolor::bold << termcolor::red << " ✗ " << result.name;
+    } else if (improved) {
+      std::cout << termcolor::bold << termcolor::green << " ✓ " << result.name;
+    } else {
+      std::cout << termcolor::bold << " ~ " << result.name;
+    }
+    std::cout << termcolor::reset << "\n";
+
+    std::cout << "    " << termcolor::bold << termcolor::underline << "Baseline \""
+              << result.baseline_name << "\"" << termcolor::reset << "\n";
+
+    std::cout << "      Change       " << std::right << std::setw(10) << std::setprecision(2)
+              << std::fixed << comparison.relative_change * 100 << " % ["
+              << comparison.lower_bound * 100 << " %, " << comparison.upper_bound * 100
+              << " %]\n";
+
+    std::cout << "      p-value      " << std::right << std::setw(10) << std::setprecision(4)
+              << std::fixed << comparison.p_value << " (Mann-Whitney U)\n";
+
+    std::cout << (regressed ? termcolor::red : (improved ? termcolor::green : termcolor::white))
+              << "      Verdict      " << std::right << std::setw(10) << to_string(result.verdict)
+              << termcolor::reset << "\n";
+
+    std::cout << "\n";
+  }
+
+  static void write_family_comparison(const family_comparison &comparison) {
+    std::cout << termcolor::bold << " ~ " << comparison.title << termcolor::reset << "\n";
+
+    std::cout << "    " << termcolor::bold << termcolor::underline << "Relative to "
+              << comparison.reference_label << termcolor::reset << "\n";
+
+    std::size_t width = 8;
+    for (const auto &e : comparison.entries) {
+      width = std::max(width, e.label.size());
+    }
+
+    std::cout << "      Rank  " << std::left << std::setw(width) << "Instance" << std::right
+              << std::setw(12) << "Mean" << std::setw(10) << "Ratio" << "  "
+              << std::setprecision(0) << std::fixed << comparison.confidence_level * 100
+              << " % interval\n";
+
+    for (const auto &e : comparison.entries) {
+      std::stringstream rank;
+      rank << (e.tied ? "=" : "") << e.rank;
+      std::cout << (e.rank == 1 ? termcolor::green : termcolor::white) << "      " << std::right
+                << std::setw(4) << rank.str() << "  " << std::left << std::setw(width) << e.label
+                << std::right << std::setw(12) << duration_to_string(e.mean) << std::setw(9)
+                << std::setprecision(2) << std::fixed << e.ratio << "x  ";
+      if (e.reference) {
+        std::cout << "reference";
+      } else {
+        std::cout << "[" << e.lower_bound << "x, " << e.upper_bound << "x]";
+      }
+      std::cout << termcolor::reset << "\n";
+    }
+
+    std::cout << "\n";
+  }
+
+  static void write_threshold_check(const threshold_check &check) {
+    if (check.passed) {
+      std::cout << termcolor::bold << termcolor::green << " ✓ " << check.benchmark;
+    } else {
+      std::cout << termcolor::bold << termcolor::red << " ✗ " << check.benchmark;
+    }
+    std::cout << termcolor::reset << "\n";
+
+    std::cout << "    " << termcolor::bold << termcolor::underline << "Threshold"
+              << termcolor::reset << "\n";
+
+    std::cout << (check.passed ? termcolor::white : termcolor::red) << "      "
+              << check.message() << termcolor::reset << "\n";
+
+    std::cout << "\n";
+  }
+
+  static void write_history(const history_series &series) {
+    const auto &records = series.records;
+    if (series.change_points.empty()) {
+      std::cout << termcolor::bold << termcolor::green << " ✓ " << series.name;
+    } else {
+      std::cout << termcolor::bold << termcolor::yellow << " ! " << series.name;
+    }
+    std::cout << termcolor::reset << "\n";
+
+    std::cout << "    " << termcolor::bold << termcolor::underline << "History" << termcolor::reset
+              << " (" << records.size() << (records.size() == 1 ? " run, " : " runs, ")
+              << series.change_points.size()
+              << (series.change_points.size() == 1 ? " change point)\n" : " change points)\n");
+
+    const auto date = [](std::int64_t timestamp) {
+      const auto time = static_cast<std::time_t>(timestamp);
+      std::stringstream os;
+      os << std::put_time(std::gmtime(&time), "%Y-%m-%d %H:%M");
+      return os.str();
+    };
+
+    std::cout << "      First        " << std::right << std::setw(10)
+              << duration_to_string(records.front().mean_execution_time) << " ("
+              << records.front().revision << ", " << date(records.front().timestamp) << ")\n";
+    std::cout << "      Last         " << std::right << std::setw(10)
+              << duration_to_string(records.back().mean_execution_time) << " ("
+              << records.back().revision << ", " << date(records.back().timestamp) << ")\n";
+
+    if (!series.change_points.empty()) {
+      std::cout << "    " << termcolor::bold << termcolor::underline << "Change Points"
+                << termcolor::reset << "\n";
+      for (const auto &change : series.change_points) {
+        const auto &record = records[change.index];
+        const auto relative_change = (change.mean_after - change.mean_before) / change.mean_before;
+        std::cout << "      " << termcolor::bold << record.revision << termcolor::reset << " ("
+                  << date(record.timestamp) << ") " << duration_to_string(change.mean_before)
+                  << " -> " << duration_to_string(change.mean_after) << " ("
+                  << (relative_change > 0 ? termcolor::red : termcolor::green) << std::showpos
+                  << std::setprecision(2) << std::fixed << relative_change * 100 << " %"
+                  << std::noshowpos << termcolor::reset << ", " << change.confidence * 100
+                  << " % confidence)\n";
+      }
+    }
+
     std::cout << "\n";
   }
 };
@@ -0,0 +1,295 @@
+#pragma once
+#if __has_include(<coroutine>) && defined(__cpp_impl_coroutine)
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <criterion/details/macros.hpp>
+
+namespace criterion {
+
+namespace async {
+class executor;
+}
+
+namespace detail {
+
+// State shared by task<T> promises regardless of the result type
+struct task_promise_base {
+  std::coroutine_handle<> continuation{std::noop_coroutine()};
+  std::exception_ptr exception{nullptr};
+
+  struct final_awaiter {
+    bool await_ready() const noexcept { return false; }
+
+    // symmetric transfer back to whoever co_await-ed this task
+    template <class Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+      return handle.promise().continuation;
+    }
+
+    void await_resume() const noexcept {}
+  };
+
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+  final_awaiter final_suspend() const noexcept { return {}; }
+  void unhandled_exception() noexcept { exception = std::current_exception(); }
+};
+
+} // namespace detail
+
+// Lazily started coroutine. Nothing runs until the task is co_await-ed or handed
+// to an executor; awaiting a task resumes the caller through symmetric transfer
+template <class T = void> class task {
+public:
+  struct promise_type : detail::task_promise_base {
+    std::optional<T> value;
+
+    task get_return_object() {
+      return task{std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+
+    template <class U> void return_value(U &&v) { value.emplace(std::forward<U>(v)); }
+
+    T result() {
+      if (exception)
+        std::rethrow_exception(exception);
+      return std::move(*value);
+    }
+  };
+
+  task(task &&other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+  task(const task &) = delete;
+  task &operator=(const task &) = delete;
+  ~task() {
+    if (handle_)
+      handle_.destroy();
+  }
+
+  bool await_ready() const noexcept { return false; }
+
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+    handle_.promise().continuation = awaiting;
+    return handle_;
+  }
+
+  T await_resume() { return handle_.promise().result(); }
+
+private:
+  friend class async::executor;
+  explicit task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+  std::coroutine_handle<promise_type> handle_;
+};
+
+template <> class task<void> {
+public:
+  struct promise_type : detail::task_promise_base {
+    task get_return_object() {
+      return task{std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+
+    void return_void() const noexcept {}
+
+    void result() {
+      if (exception)
+        std::rethrow_exception(exception);
+    }
+  };
+
+  task(task &&other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+  task(const task &) = delete;
+  task &operator=(const task &) = delete;
+  ~task() {
+    if (handle_)
+      handle_.destroy();
+  }
+
+  bool await_ready() const noexcept { return false; }
+
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+    handle_.promise().continuation = awaiting;
+    return handle_;
+  }
+
+  void await_resume() { handle_.promise().result(); }
+
+private:
+  friend class async::executor;
+  explicit task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+  std::coroutine_handle<promise_type> handle_;
+};
+
+namespace async {
+
+// Single-threaded run loop with a ready queue and a timer queue.
+//
+// Timers run on a virtual clock: when nothing is ready, the clock jumps straight
+// to the earliest deadline, so sleep_for() measures the cost of suspending,
+// queueing and resuming a coroutine and never the requested delay itself
+class executor {
+  struct timer {
+    std::chrono::nanoseconds deadline;
+    std::uint64_t sequence; // keeps timers with equal deadlines in FIFO order
+    std::coroutine_handle<> handle;
+
+    bool operator>(const timer &other) const {
+      return deadline != other.deadline ? deadline > other.deadline : sequence > other.sequence;
+    }
+  };
+
+  std::deque<std::coroutine_handle<>> ready_;
+  std::priority_queue<timer, std::vector<timer>, std::greater<timer>> timers_;
+  std::chrono::nanoseconds now_{0};
+  std::uint64_t sequence_{0};
+
+  static inline thread_local executor *current_{nullptr};
+
+  void drain() {
+    while (true) {
+      if (ready_.empty()) {
+        if (timers_.empty())
+          break;
+        // advance the virtual clock and release every timer that is now due
+        now_ = timers_.top().deadline;
+        while (!timers_.empty() && timers_.top().deadline <= now_) {
+          ready_.push_back(timers_.top().handle);
+          timers_.pop();
+        }
+      }
+      auto handle = ready_.front();
+      ready_.pop_front();
+      handle.resume();
+    }
+  }
+
+public:
+  executor() = default;
+  executor(const executor &) = delete;
+  executor &operator=(const executor &) = delete;
+
+  // Executor driving the coroutine that is currently running on this thread
+  static executor *current() { return current_; }
+
+  // Executor reused by ASYNC_BENCHMARK bodies, so the run loop is not rebuilt every iteration
+  static executor &this_thread() {
+    static thread_local executor instance;
+    return instance;
+  }
+
+  std::chrono::nanoseconds now() const { return now_; }
+
+  void schedule(std::coroutine_handle<> handle) { ready_.push_back(handle); }
+
+  void schedule_after(std::chrono::nanoseconds delay, std::coroutine_handle<> handle) {
+    timers_.push(timer{now_ + delay, sequence_++, handle});
+  }
+
+  // Start `t` and run the loop until there is nothing left to resume
+  template <class T> T run(task<T> t) {
+    // restores current() and drops pending work even if a resumed coroutine throws,
+    // so the thread-local executor is not left pointing at handles that `t` destroys
+    struct run_scope {
+      executor &self;
+      executor *previous;
+      ~run_scope() {
+        self.ready_.clear();
+        self.timers_ = {};
+        current_ = previous;
+      }
+    } scope{*this, std::exchange(current_, this)};
+    schedule(t.handle_);
+    drain();
+    return t.handle_.promise().result();
+  }
+};
+
+// Reschedule the calling coroutine at the back of the ready queue
+inline auto yield() {
+  struct awaiter {
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) const {
+      executor::current()->schedule(handle);
+    }
+    void await_resume() const noexcept {}
+  };
+  return awaiter{};
+}
+
+// Suspend the calling coroutine on the (virtual) timer queue
+inline auto sleep_for(std::chrono::nanoseconds delay) {
+  struct awaiter {
+    std::chrono::nanoseconds delay;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) const {
+      executor::current()->schedule_after(delay, handle);
+    }
+    void await_resume() const noexcept {}
+  };
+  return awaiter{delay};
+}
+
+} // namespace async
+
+} // namespace criterion
+
+// Same as BENCHMARK, but the body is a coroutine returning criterion::task<>.
+// Each iteration starts the coroutine on criterion::async::executor::this_thread() and
+// completes once the executor has nothing left to resume
+#define ASYNC_BENCHMARK(Name, ...)                                                                 \
+  typedef std::tuple<__VA_ARGS__> CONCAT(Name, BenchmarkParameters);                               \
+  namespace detail {                                                                               \
+  /* forward declare the benchmark coroutine that we define later */                               \
+  template <class T = CONCAT(Name, BenchmarkParameters)>                                           \
+  struct CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__)) {                          \
+    static criterion::task<> CONCAT(Name, CONCAT(_registered_coroutine_, __LINE__))(               \
+        std::chrono::steady_clock::time_point &,                                                   \
+        std::optional<std::chrono::steady_clock::time_point> &, void *);                           \
+                                                                                                   \
+    static inline void CONCAT(Name, CONCAT(_registered_fun_, __LINE__))(                           \
+        std::chrono::steady_clock::time_point &start,                                              \
+        std::optional<std::chrono::steady_clock::time_point> &teardown, void *parameters) {        \
+      criterion::async::executor::this_thread().run(                                               \
+          CONCAT(Name, CONCAT(_registered_coroutine_, __LINE__))(start, teardown, parameters));    \
+    }                                                                                              \
+  };                                                                                               \
+                                                                                                   \
+  namespace /* ensure internal linkage for struct */                                               \
+  {                                                                                                \
+  /* helper struct for static registration in ctor */                                              \
+  struct CONCAT(Name, CONCAT(_register_struct_, __LINE__)) {                                       \
+    CONCAT(Name, CONCAT(_register_struct_, __LINE__))() { /* called once before main */            \
+      criterion::benchmark_template_registration_helper_struct::register_benchmark_template(       \
+          criterion::benchmark_config{                                                             \
+              .name = #Name,                                                                       \
+              .fn = CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__)) <               \
+                    CONCAT(Name, BenchmarkParameters) >                                            \
+                    ::CONCAT(Name, CONCAT(_registered_fun_, __LINE__))});                          \
+      /* benchmarks without parameters have a single, implicit instance */                         \
+      if constexpr (std::tuple_size_v<CONCAT(Name, BenchmarkParameters)> == 0) {                   \
+        criterion::benchmark_template_registration_helper_struct::                                 \
+            execute_registered_benchmark_template(#Name, "",                                       \
+                                                  criterion::benchmark_config::empty_tuple);       \
+      }                                                                                            \
+    }                                                                                              \
+  } CONCAT(Name, CONCAT(_register_struct_instance_, __LINE__));                                    \
+  }                                                                                                \
+  }                                                                                                \
+                                                                                                   \
+  /* now actually defined to allow ASYNC_BENCHMARK("name") { ... } syntax */                       \
+  template <class T>                                                                               \
+  criterion::task<> detail::CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__))<T>::    \
+      CONCAT(Name, CONCAT(_registered_coroutine_, __LINE__))(                                      \
+          [[maybe_unused]] std::chrono::steady_clock::time_point & __benchmark_start_timestamp,    \
+          [[maybe_unused]] std::optional<std::chrono::steady_clock::time_point> &                  \
+              __benchmark_teardown_timestamp,                                                      \
+          [[maybe_unused]] void *__benchmark_parameters)
+
+#endif
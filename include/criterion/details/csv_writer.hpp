@@ -1,28 +1,36 @@
 #pragma once
 #include <criterion/details/benchmark.hpp>
 #include <criterion/details/benchmark_result.hpp>
+#include <criterion/details/reporter.hpp>
 #include <fstream>
 #include <iomanip>
 #include <sstream>
 #include <string>
 #include <unordered_map>
+#include <utility>
 
 namespace criterion {
 
 class csv_writer {
 public:
+  // Column names, shared by write_results and csv_reporter
+  static std::string header() {
+    return "name,warmup_runs,iterations,mean_execution_time,fastest_execution_time,slowest_"
+           "execution_time,lowest_rsd_execution_time,lowest_rsd_percentage,lowest_rsd_index,"
+           "average_iteration_performance,fastest_iteration_performance,slowest_iteration_"
+           "performance\n";
+  }
+
+  static std::string row(const benchmark_result &result) { return result.to_csv() + "\n"; }
+
   static bool write_results(const std::string &filename,
                             const std::unordered_map<std::string, benchmark_result> &results) {
     bool result{false};
     std::ofstream os(filename);
     if (os.is_open()) {
-      os << "name,warmup_runs,iterations,mean_execution_time,fastest_execution_time,slowest_"
-            "execution_time,lowest_rsd_execution_time,lowest_rsd_percentage,lowest_rsd_index,"
-            "average_iteration_performance,fastest_iteration_performance,slowest_iteration_"
-            "performance\n";
+      os << header();
       for (const auto &name : benchmark::benchmark_execution_order) {
-        const auto &this_result = results.at(name);
-        os << this_result.to_csv() << "\n";
+        os << row(results.at(name));
       }
       result = true;
     }
@@ -31,4 +39,29 @@ public:
   }
 };
 
+// Writes one CSV row per benchmark as it completes, with the same columns as csv_writer
+class csv_reporter : public reporter {
+  std::string filename_;
+  record_file file_;
+
+public:
+  explicit csv_reporter(std::string filename) : filename_(std::move(filename)) {}
+
+  void on_run_start() override {
+    if (file_.open(filename_)) {
+      file_.append(csv_writer::header());
+    }
+  }
+
+  void on_benchmark_complete(const benchmark_result &result) override {
+    file_.append(csv_writer::row(result));
+  }
+
+  void on_run_end() override { file_.close(); }
+
+  bool good() const override { return file_.good(); }
+
+  std::string destination() const override { return filename_; }
+};
+
 } // namespace criterion
\ No newline at end of file
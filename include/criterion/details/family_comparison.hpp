@@ -0,0 +1,228 @@
+#pragma once
+#include <criterion/details/benchmark_result.hpp>
+#include <criterion/details/statistics.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace criterion {
+
+// Instances of one benchmark template relative to a reference instance, e.g., for
+// ConstructSharedPtr/new vs ConstructSharedPtr/make_shared, ranked from fastest to slowest
+struct family_comparison {
+  struct entry {
+    std::string name;        // e.g., "ToString/fn:double/size:10"
+    std::string label;       // the segment that differs, e.g., "fn:double" or "std::deque<int>"
+    long double mean;        // mean execution time
+    long double ratio;       // mean / mean of the reference, e.g., 0.5 if twice as fast
+    long double lower_bound; // confidence interval of ratio
+    long double upper_bound;
+    std::size_t rank; // 1 for the fastest; an instance tied with the one above shares its rank
+    bool tied;        // not significantly different from the instance ranked above
+    bool reference;
+  };
+
+  std::string title; // e.g., "ConstructSharedPtr" or "ToString/*/size:10"
+  std::string reference_label;
+  long double confidence_level;
+  std::vector<entry> entries; // fastest first
+
+  static std::vector<std::string> split(const std::string &name) {
+    std::vector<std::string> segments;
+    std::size_t begin = 0;
+    while (true) {
+      const auto end = name.find('/', begin);
+      segments.push_back(name.substr(begin, end - begin));
+      if (end == std::string::npos)
+        return segments;
+      begin = end + 1;
+    }
+  }
+
+  // true if `segment` of a name is `reference`, e.g., "make_shared", or a grid point whose value
+  // is `reference`, e.g., "fn:int" for "int"
+  static bool matches(const std::string &segment, const std::string &reference) {
+    return segment == reference ||
+           (segment.size() > reference.size() + 1 &&
+            segment.compare(segment.size() - reference.size() - 1, std::string::npos,
+                            ":" + reference) == 0);
+  }
+
+  // The segments of `name` that instances are compared by, starting with the template it was
+  // registered under. The type or value of a TYPED_BENCHMARK or VALUE_BENCHMARK instance is a
+  // segment of its own, e.g., "Forward", "std::vector<int>", "1K" for
+  // Forward<std::vector<int>>/1K, so instances of different types can be compared
+  static std::vector<std::string> segments_of(const std::string &name,
+                                              const std::string &template_name) {
+    auto segments = split(name);
+    auto &first = segments.front();
+    if (first != template_name && first.size() > template_name.size() + 2 &&
+        first.compare(0, template_name.size() + 1, template_name + "<") == 0 &&
+        first.back() == '>') {
+      auto argument = first.substr(template_name.size() + 1,
+                                   first.size() - template_name.size() - 2);
+      first = template_name;
+      segments.insert(segments.begin() + 1, std::move(argument));
+    }
+    return segments;
+  }
+
+  // Compares the instances of every template, in `order`, against a reference:
+  //
+  //   "first"    the first instance of each template
+  //   "fastest"  the fastest instance of each template
+  //   otherwise  the instances with a segment (see segments_of) that is `reference`, e.g.,
+  //              "make_shared", "std::deque<int>" or "int" (for "fn:int"), each compared with the
+  //              instances that only differ from it in that segment, e.g., ToString/fn:int/size:10
+  //              with ToString/fn:double/size:10
+  //
+  // Instances are grouped by `template_names` (instance name -> name the template was registered
+  // under), or by the first segment of their name if they are not in it, e.g., merged results.
+  // Templates with a single instance, or without a reference instance, are left out
+  static std::vector<family_comparison>
+  compare(const std::vector<std::string> &order,
+          const std::unordered_map<std::string, benchmark_result> &results,
+          const std::string &reference, long double confidence_level = 0.95,
+          const std::unordered_map<std::string, std::string> &template_names = {}) {
+    // (name, segments) of the instances of each template, in order of their first run
+    using instance = std::pair<std::string, std::vector<std::string>>;
+    std::vector<std::string> templates;
+    std::unordered_map<std::string, std::vector<instance>> instances;
+    for (const auto &name : order) {
+      if (results.find(name) == results.end())
+        continue;
+      const auto it = template_names.find(name);
+      auto segments =
+          segments_of(name, it == template_names.end() ? split(name).front() : it->second);
+      auto &family = instances[segments.front()];
+      if (family.empty())
+        templates.push_back(segments.front());
+      family.push_back({name, std::move(segments)});
+    }
+
+    const auto join = [](const std::vector<std::string> &segments) {
+      std::string result;
+      for (const auto &segment : segments) {
+        result += (result.empty() ? "" : "/") + segment;
+      }
+      return result;
+    };
+
+    std::vector<family_comparison> comparisons;
+    for (const auto &template_name : templates) {
+      const auto &family = instances.at(template_name);
+      if (family.size() < 2)
+        continue;
+
+      if (reference == "first" || reference == "fastest") {
+        std::vector<std::string> names, labels;
+        for (const auto &[name, segments] : family) {
+          names.push_back(name);
+          labels.push_back(segments.size() > 1
+                               ? join(std::vector<std::string>(segments.begin() + 1,
+                                                               segments.end()))
+                               : segments.front());
+        }
+        std::size_t reference_index = 0;
+        if (reference == "fastest") {
+          for (std::size_t i = 1; i < names.size(); ++i) {
+            if (results.at(names[i]).mean_execution_time <
+                results.at(names[reference_index]).mean_execution_time)
+              reference_index = i;
+          }
+        }
+        comparisons.push_back(
+            make(template_name, names, labels, reference_index, results, confidence_level));
+        continue;
+      }
+
+      // the position of the reference segment, from the first instance that has it
+      std::optional<std::size_t> position;
+      for (const auto &[name, segments] : family) {
+        for (std::size_t i = 1; i < segments.size() && !position; ++i) {
+          if (matches(segments[i], reference))
+            position = i;
+        }
+      }
+      if (!position.has_value())
+        continue;
+
+      // instances that only differ in that segment, e.g., ToString/*/size:10
+      std::vector<std::string> groups;
+      std::map<std::string, std::vector<const instance *>> grouped;
+      for (const auto &member : family) {
+        const auto &segments = member.second;
+        if (segments.size() <= position.value())
+          continue;
+        auto key = segments;
+        key[position.value()] = "*";
+        const auto title = join(key);
+        if (grouped[title].empty())
+          groups.push_back(title);
+        grouped[title].push_back(&member);
+      }
+      for (const auto &title : groups) {
+        const auto &members = grouped.at(title);
+        std::vector<std::string> names, labels;
+        std::optional<std::size_t> reference_index;
+        for (const auto member : members) {
+          const auto &segment = member->second[position.value()];
+          if (!reference_index && matches(segment, reference))
+            reference_index = names.size();
+          names.push_back(member->first);
+          labels.push_back(segment);
+        }
+        if (members.size() < 2 || !reference_index.has_value())
+          continue;
+        comparisons.push_back(
+            make(title, names, labels, reference_index.value(), results, confidence_level));
+      }
+    }
+    return comparisons;
+  }
+
+private:
+  static family_comparison make(const std::string &title, const std::vector<std::string> &names,
+                                const std::vector<std::string> &labels,
+                                std::size_t reference_index,
+                                const std::unordered_map<std::string, benchmark_result> &results,
+                                long double confidence_level) {
+    family_comparison result{title, labels[reference_index], confidence_level, {}};
+    const auto &reference = results.at(names[reference_index]);
+    for (std::size_t i = 0; i < names.size(); ++i) {
+      const auto &instance = results.at(names[i]);
+      entry e{names[i], labels[i], instance.mean_execution_time, 1, 1, 1, 0, false,
+              i == reference_index};
+      if (!e.reference) {
+        // the interval of the relative change of the mean, as for baseline comparisons
+        const auto comparison =
+            compare_samples(reference.samples, instance.samples, confidence_level);
+        e.ratio = instance.mean_execution_time / reference.mean_execution_time;
+        e.lower_bound = e.ratio + comparison.lower_bound - comparison.relative_change;
+        e.upper_bound = e.ratio + comparison.upper_bound - comparison.relative_change;
+      }
+      result.entries.push_back(e);
+    }
+
+    std::stable_sort(result.entries.begin(), result.entries.end(),
+                     [](const entry &a, const entry &b) { return a.mean < b.mean; });
+    for (std::size_t i = 0; i < result.entries.size(); ++i) {
+      auto &e = result.entries[i];
+      if (i == 0) {
+        e.rank = 1;
+        continue;
+      }
+      const auto &above = result.entries[i - 1];
+      e.tied = mann_whitney_u_p_value(results.at(above.name).samples,
+                                      results.at(e.name).samples) >= 1 - confidence_level;
+      e.rank = e.tied ? above.rank : i + 1;
+    }
+    return result;
+  }
+};
+
+} // namespace criterion
@@ -0,0 +1,427 @@
+#pragma once
+#include <criterion/details/baseline.hpp>
+#include <criterion/details/benchmark.hpp>
+#include <criterion/details/benchmark_result.hpp>
+#include <criterion/details/json_string.hpp>
+#include <criterion/details/registry.hpp>
+#include <criterion/details/statistics.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+namespace criterion {
+
+namespace detail {
+
+// Just enough of JSON to read Google Benchmark output: a value is null, a boolean, a number, a
+// string, an array or an object
+struct json_value {
+  enum class kind { null, boolean, number, string, array, object };
+  kind type{kind::null};
+  bool boolean{false};
+  long double number{0};
+  std::string string;
+  std::vector<json_value> array;
+  std::vector<std::pair<std::string, json_value>> object; // members, in order
+
+  const json_value *find(const std::string &key) const {
+    for (const auto &[name, member] : object) {
+      if (name == key)
+        return &member;
+    }
+    return nullptr;
+  }
+};
+
+class json_parser {
+  const std::string &text_;
+  std::size_t i_{0};
+
+  void skip_whitespace() {
+    while (i_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[i_])))
+      i_ += 1;
+  }
+
+  bool consume(const std::string &token) {
+    if (text_.compare(i_, token.size(), token) != 0)
+      return false;
+    i_ += token.size();
+    return true;
+  }
+
+  std::optional<std::string> parse_string() {
+    if (i_ >= text_.size() || text_[i_] != '"')
+      return std::nullopt;
+    i_ += 1;
+    std::string result;
+    while (i_ < text_.size() && text_[i_] != '"') {
+      if (text_[i_] == '\\' && i_ + 1 < text_.size()) {
+        i_ += 1;
+        i_ = json_unescape(text_, i_, result);
+      } else {
+        result += text_[i_];
+      }
+      i_ += 1;
+    }
+    if (i_ >= text_.size())
+      return std::nullopt;
+    i_ += 1;
+    return result;
+  }
+
+  std::optional<json_value> parse_value(std::size_t depth) {
+    skip_whitespace();
+    if (i_ >= text_.size() || depth > 64)
+      return std::nullopt;
+    json_value value;
+    const auto c = text_[i_];
+    if (c == '{') {
+      i_ += 1;
+      value.type = json_value::kind::object;
+      skip_whitespace();
+      if (consume("}"))
+        return value;
+      while (true) {
+        skip_whitespace();
+        const auto key = parse_string();
+        skip_whitespace();
+        if (!key || !consume(":"))
+          return std::nullopt;
+        auto member = parse_value(depth + 1);
+        if (!member)
+          return std::nullopt;
+        value.object.push_back({key.value(), std::move(member.value())});
+        skip_whitespace();
+        if (consume("}"))
+          return value;
+        if (!consume(","))
+          return std::nullopt;
+      }
+    } else if (c == '[') {
+      i_ += 1;
+      value.type = json_value::kind::array;
+      skip_whitespace();
+      if (consume("]"))
+        return value;
+      while (true) {
+        auto element = parse_value(depth + 1);
+        if (!element)
+          return std::nullopt;
+        value.array.push_back(std::move(element.value()));
+        skip_whitespace();
+        if (consume("]"))
+          return value;
+        if (!consume(","))
+          return std::nullopt;
+      }
+    } else if (c == '"') {
+      const auto string = parse_string();
+      if (!string)
+        return std::nullopt;
+      value.type = json_value::kind::string;
+      value.string = string.value();
+      return value;
+    } else if (consume("true")) {
+      value.type = json_value::kind::boolean;
+      value.boolean = true;
+      return value;
+    } else if (consume("false")) {
+      value.type = json_value::kind::boolean;
+      return value;
+    } else if (consume("null")) {
+      return value;
+    }
+
+    const char *begin = text_.c_str() + i_;
+    char *end = nullptr;
+    value.number = std::strtold(begin, &end);
+    if (end == begin)
+      return std::nullopt;
+    i_ += end - begin;
+    value.type = json_value::kind::number;
+    return value;
+  }
+
+public:
+  explicit json_parser(const std::string &text) : text_(text) {}
+
+  std::optional<json_value> parse() {
+    auto value = parse_value(0);
+    skip_whitespace();
+    if (!value || i_ != text_.size())
+      return std::nullopt;
+    return value;
+  }
+};
+
+} // namespace detail
+
+// Results in the JSON schema of Google Benchmark, so that its tools (e.g., compare.py) work on
+// criterion results. Runs are reported as repetitions, with the mean execution time per
+// iteration as their time, followed by the mean, median, stddev and cv aggregates over the
+// repetitions. Criterion measures wall-clock time only, so cpu_time is the same as real_time
+class gbench_json {
+  static std::string host_name() {
+#if defined(__unix__) || defined(__APPLE__)
+    char name[256]{};
+    if (gethostname(name, sizeof(name) - 1) == 0)
+      return name;
+#endif
+    return "";
+  }
+
+  // Clock speed of the first CPU in MHz, if known
+  static std::optional<long double> mhz_per_cpu() {
+#if defined(__linux__)
+    std::ifstream is("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(is, line)) {
+      if (line.rfind("cpu MHz", 0) == 0) {
+        const auto colon = line.find(':');
+        if (colon == std::string::npos)
+          break;
+        char *end = nullptr;
+        const auto value = std::strtold(line.c_str() + colon + 1, &end);
+        if (end != line.c_str() + colon + 1 && value > 0)
+          return value;
+        break;
+      }
+    }
+    // e.g., on ARM, where /proc/cpuinfo has no clock speed
+    std::ifstream max_frequency("/sys/devices/system/cpu/cpu0/cpufreq/cpuinfo_max_freq");
+    long double khz = 0;
+    if (max_frequency >> khz && khz > 0)
+      return khz / 1000;
+#endif
+    return std::nullopt;
+  }
+
+  // true if the frequency governor of any CPU is not "performance", i.e., clock speeds can change
+  // during the run. std::nullopt if no governor can be read, e.g., in most VMs
+  static std::optional<bool> cpu_scaling_enabled() {
+#if defined(__linux__)
+    std::optional<bool> result;
+    for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu) {
+      std::ifstream is("/sys/devices/system/cpu/cpu" + std::to_string(cpu) +
+                       "/cpufreq/scaling_governor");
+      std::string governor;
+      if (!(is >> governor))
+        continue;
+      result = result.value_or(false) || governor != "performance";
+    }
+    return result;
+#else
+    return std::nullopt;
+#endif
+  }
+
+  // Nanoseconds per unit of Google Benchmark's time_unit
+  static std::optional<long double> time_unit_scale(const std::string &unit) {
+    if (unit == "ns")
+      return 1;
+    if (unit == "us")
+      return 1e3;
+    if (unit == "ms")
+      return 1e6;
+    if (unit == "s")
+      return 1e9;
+    return std::nullopt;
+  }
+
+public:
+  static inline std::string executable; // reported in the context, e.g., argv[0]
+  static inline std::size_t max_repetitions = 100;
+
+  static bool write_results(const std::string &filename,
+                            const std::unordered_map<std::string, benchmark_result> &results) {
+    std::ofstream os(filename);
+    if (!os.is_open())
+      return false;
+
+    // only fields criterion can measure are written, e.g., no caches or library_build_type
+    const std::time_t t = std::time(nullptr);
+    os << "{\n  \"context\": {\n"
+       << "    \"date\": \"" << std::put_time(std::localtime(&t), "%Y-%m-%dT%H:%M:%S%z") << "\",\n"
+       << "    \"host_name\": \"" << detail::json_escape(host_name()) << "\",\n"
+       << "    \"executable\": \"" << detail::json_escape(executable) << "\",\n"
+       << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+    if (const auto mhz = mhz_per_cpu()) {
+      os << "    \"mhz_per_cpu\": " << static_cast<long long>(std::llround(mhz.value())) << ",\n";
+    }
+    if (const auto scaling = cpu_scaling_enabled()) {
+      os << "    \"cpu_scaling_enabled\": " << (scaling.value() ? "true" : "false") << ",\n";
+    }
+#if defined(__unix__) || defined(__APPLE__)
+    double load_average[3]{};
+    if (getloadavg(load_average, 3) == 3) {
+      os << "    \"load_avg\": [" << load_average[0] << "," << load_average[1] << ","
+         << load_average[2] << "],\n";
+    }
+#endif
+    os << "    \"json_schema_version\": 1\n"
+       << "  },\n  \"benchmarks\": [";
+
+    // family (the name the template was registered under, or the name up to the first '/' if
+    // it is not registered, e.g., for merged results) and instance indices, in execution order
+    const auto template_names = benchmark_registry::global().template_names();
+    std::unordered_map<std::string, std::size_t> families;
+    std::vector<std::size_t> family_sizes;
+
+    os << std::setprecision(std::numeric_limits<long double>::max_digits10);
+    bool first{true};
+    const auto entry = [&](const std::string &name, const std::string &run_name,
+                           std::size_t family_index, std::size_t instance_index,
+                           std::size_t repetitions, std::size_t repetition,
+                           const std::string &aggregate, std::size_t iterations, long double time) {
+      os << (first ? "\n" : ",\n");
+      first = false;
+      os << "    {\n"
+         << "      \"name\": \"" << detail::json_escape(name) << "\",\n"
+         << "      \"family_index\": " << family_index << ",\n"
+         << "      \"per_family_instance_index\": " << instance_index << ",\n"
+         << "      \"run_name\": \"" << detail::json_escape(run_name) << "\",\n"
+         << "      \"run_type\": \"" << (aggregate.empty() ? "iteration" : "aggregate") << "\",\n"
+         << "      \"repetitions\": " << repetitions << ",\n";
+      if (aggregate.empty()) {
+        os << "      \"repetition_index\": " << repetition << ",\n";
+      } else {
+        os << "      \"aggregate_name\": \"" << aggregate << "\",\n"
+           << "      \"aggregate_unit\": \"" << (aggregate == "cv" ? "percentage" : "time")
+           << "\",\n";
+      }
+      os << "      \"threads\": 1,\n"
+         << "      \"iterations\": " << iterations << ",\n"
+         << "      \"real_time\": " << time << ",\n"
+         << "      \"cpu_time\": " << time << ",\n"
+         << "      \"time_unit\": \"ns\"\n"
+         << "    }";
+    };
+
+    for (const auto &name : benchmark::benchmark_execution_order) {
+      const auto &result = results.at(name);
+      const auto template_name = template_names.find(name);
+      const auto family = template_name == template_names.end() ? name.substr(0, name.find('/'))
+                                                                : template_name->second;
+      if (families.find(family) == families.end()) {
+        families[family] = family_sizes.size();
+        family_sizes.push_back(0);
+      }
+      const auto family_index = families[family];
+      const auto instance_index = family_sizes[family_index]++;
+
+      // fast benchmarks can have 100,000s of runs, so consecutive runs are grouped into at most
+      // max_repetitions repetitions
+      const auto &samples = result.samples;
+      const auto runs_per_repetition = (samples.size() + max_repetitions - 1) / max_repetitions;
+      std::vector<long double> times;
+      std::vector<std::size_t> iterations;
+      for (std::size_t begin = 0; begin < samples.size(); begin += runs_per_repetition) {
+        const auto end = std::min(begin + runs_per_repetition, samples.size());
+        times.push_back(std::accumulate(samples.begin() + begin, samples.begin() + end, 0.0L) /
+                        (end - begin));
+        iterations.push_back((end - begin) * result.num_iterations);
+      }
+
+      for (std::size_t i = 0; i < times.size(); ++i) {
+        entry(name, name, family_index, instance_index, times.size(), i, "", iterations[i],
+              times[i]);
+      }
+      if (times.size() > 1) {
+        const auto mean = sample_mean(times);
+        const auto stddev = std::sqrt(sample_variance(times));
+        const auto aggregate = [&](const std::string &aggregate_name, long double value) {
+          entry(name + "_" + aggregate_name, name, family_index, instance_index, times.size(), 0,
+                aggregate_name, iterations.front(), value);
+        };
+        aggregate("mean", mean);
+        aggregate("median", sample_median(times));
+        aggregate("stddev", stddev);
+        aggregate("cv", mean > 0 ? stddev / mean : 0);
+      }
+    }
+    os << "\n  ]\n}\n";
+    return os.good();
+  }
+
+  // Reads Google Benchmark JSON output as a baseline. The times of the repetitions of each
+  // benchmark become its samples; if only aggregates were reported, the mean is the only sample
+  static std::optional<baseline> read_baseline(const std::string &filename,
+                                               const std::string &baseline_name) {
+    std::ifstream is(filename);
+    if (!is.is_open())
+      return std::nullopt;
+    std::stringstream buffer;
+    buffer << is.rdbuf();
+    const auto text = buffer.str();
+    const auto document = detail::json_parser(text).parse();
+    if (!document)
+      return std::nullopt;
+    const auto benchmarks = document->find("benchmarks");
+    if (!benchmarks || benchmarks->type != detail::json_value::kind::array)
+      return std::nullopt;
+
+    baseline result;
+    result.name = baseline_name;
+    // means of benchmarks that only reported aggregates
+    std::unordered_map<std::string, baseline::entry> means;
+    std::vector<std::string> means_order;
+    for (const auto &b : benchmarks->array) {
+      const auto name = b.find("name");
+      const auto run_name = b.find("run_name");
+      const auto run_type = b.find("run_type");
+      const auto aggregate = b.find("aggregate_name");
+      const auto iterations = b.find("iterations");
+      const auto real_time = b.find("real_time");
+      const auto time_unit = b.find("time_unit");
+      if (!name || !iterations || !real_time)
+        continue;
+      const auto scale = time_unit_scale(time_unit ? time_unit->string : "ns");
+      if (!scale)
+        continue;
+      const auto time = real_time->number * scale.value();
+      const auto benchmark_name = run_name ? run_name->string : name->string;
+
+      if (run_type && run_type->string == "aggregate") {
+        if (aggregate && aggregate->string == "mean") {
+          if (means.find(benchmark_name) == means.end())
+            means_order.push_back(benchmark_name);
+          means[benchmark_name] =
+              baseline::entry{static_cast<std::size_t>(iterations->number), {time}};
+        }
+        continue;
+      }
+      auto it = result.entries.find(benchmark_name);
+      if (it == result.entries.end()) {
+        result.add(benchmark_name,
+                   baseline::entry{static_cast<std::size_t>(iterations->number), {}});
+        it = result.entries.find(benchmark_name);
+      }
+      it->second.samples.push_back(time);
+    }
+    for (const auto &benchmark_name : means_order) {
+      if (result.entries.find(benchmark_name) == result.entries.end()) {
+        result.add(benchmark_name, means[benchmark_name]);
+      }
+    }
+    return result;
+  }
+};
+
+} // namespace criterion
@@ -0,0 +1,154 @@
+#pragma once
+#include <array>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <criterion/details/range.hpp>
+
+namespace criterion {
+
+// A parameter value with the label used for it in instance names
+template <class T> struct named_value {
+  std::string label;
+  T value;
+};
+
+template <class T> named_value<std::decay_t<T>> named(const std::string &label, T &&value) {
+  return {label, std::forward<T>(value)};
+}
+
+// One dimension of a parameter grid, e.g., "size" with values 10, 100 and 1000
+template <class T> struct grid_axis {
+  std::string name;
+  std::vector<named_value<T>> values;
+};
+
+// Keeps only the grid points for which `predicate(arguments...)` returns true
+template <class Predicate> struct grid_filter { Predicate predicate; };
+
+template <class Predicate> grid_filter<std::decay_t<Predicate>> where(Predicate &&predicate) {
+  return {std::forward<Predicate>(predicate)};
+}
+
+// Keeps only the grid points whose instance name matches `regex_string`
+struct grid_name_filter {
+  std::regex regexp;
+
+  bool operator()(const std::string &instance_name) const {
+    std::smatch matches;
+    return std::regex_search(instance_name, matches, regexp);
+  }
+};
+
+inline grid_name_filter matching(const std::string &regex_string) {
+  return {std::regex(regex_string)};
+}
+
+namespace detail {
+
+template <class> inline constexpr bool always_false = false;
+
+template <class T> std::string grid_label(const T &value) {
+  if constexpr (std::is_integral_v<T>) {
+    return range_instance_name(static_cast<long long>(value)).substr(1);
+  } else if constexpr (std::is_arithmetic_v<T>) {
+    std::stringstream os;
+    os << value;
+    return os.str();
+  } else if constexpr (std::is_convertible_v<const T &, std::string>) {
+    return std::string(value);
+  } else {
+    static_assert(always_false<T>, "use criterion::named(label, value) for this axis value");
+  }
+}
+
+template <class T> struct axis_value_type { using type = T; };
+template <class T> struct axis_value_type<named_value<T>> { using type = T; };
+
+template <class T, class U> named_value<T> to_named_value(U &&value) {
+  if constexpr (std::is_same_v<std::decay_t<U>, named_value<T>>) {
+    return std::forward<U>(value);
+  } else {
+    return {grid_label(value), std::forward<U>(value)};
+  }
+}
+
+template <class T> struct is_vector : std::false_type {};
+template <class T, class A> struct is_vector<std::vector<T, A>> : std::true_type {};
+
+template <class T> struct is_grid_filter : std::false_type {};
+template <class P> struct is_grid_filter<grid_filter<P>> : std::true_type {};
+
+} // namespace detail
+
+template <class T> grid_axis<T> axis(const std::string &name, const std::vector<T> &values) {
+  grid_axis<T> result{name, {}};
+  for (const auto &value : values) {
+    result.values.push_back(detail::to_named_value<T>(value));
+  }
+  return result;
+}
+
+template <class First, class... Rest,
+          class = std::enable_if_t<!detail::is_vector<std::decay_t<First>>::value>>
+auto axis(const std::string &name, First &&first, Rest &&...rest) {
+  using T = typename detail::axis_value_type<std::decay_t<First>>::type;
+  grid_axis<T> result{name, {}};
+  result.values.push_back(detail::to_named_value<T>(std::forward<First>(first)));
+  (result.values.push_back(detail::to_named_value<T>(std::forward<Rest>(rest))), ...);
+  return result;
+}
+
+// Calls `fn(instance_name, arguments)` for every point in the Cartesian product of `axes`, in
+// row-major order, with names like "/fn:int/size:1K". Points rejected by `filter` are skipped
+template <class ArgTuple, class AxisTuple, class Filter, class Fn, std::size_t... I>
+void for_each_grid_point(const AxisTuple &axes, const Filter &filter, Fn &&fn,
+                         std::index_sequence<I...>) {
+  constexpr auto N = sizeof...(I);
+  static_assert(N > 0, "a grid needs at least one axis");
+  const std::array<std::size_t, N> sizes{std::get<I>(axes).values.size()...};
+  for (const auto size : sizes) {
+    if (size == 0)
+      return;
+  }
+
+  std::array<std::size_t, N> index{};
+  while (true) {
+    std::string instance_name{""};
+    ((instance_name += "/" +
+                       (std::get<I>(axes).name.empty() ? "" : std::get<I>(axes).name + ":") +
+                       std::get<I>(axes).values[index[I]].label),
+     ...);
+
+    ArgTuple arguments{static_cast<std::tuple_element_t<I, ArgTuple>>(
+        std::get<I>(axes).values[index[I]].value)...};
+
+    bool keep = true;
+    if constexpr (std::is_same_v<Filter, grid_name_filter>) {
+      keep = filter(instance_name);
+    } else if constexpr (detail::is_grid_filter<Filter>::value) {
+      keep = std::apply(filter.predicate, std::as_const(arguments));
+    }
+    if (keep) {
+      fn(instance_name, std::move(arguments));
+    }
+
+    // odometer increment, last axis fastest
+    std::size_t axis = N;
+    while (axis > 0) {
+      axis -= 1;
+      if (++index[axis] < sizes[axis])
+        break;
+      index[axis] = 0;
+      if (axis == 0)
+        return;
+    }
+  }
+}
+
+} // namespace criterion
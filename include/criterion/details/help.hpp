@@ -2,6 +2,26 @@
 #include <criterion/details/indicators.hpp>
 #include <sstream>
 #include <string>
+#include <utility>
+#include <vector>
+
+// Short forms of options, e.g., -e for --export_results. structopt gives every field the short
+// form of its first letter, so fields that share one, e.g., export_results and export_samples,
+// would take it from each other. These short forms are expanded to their long form before parsing
+// instead (see expand_criterion_short_options), and the help only shows the ones listed here
+static inline const std::vector<std::pair<char, std::string>> criterion_short_options{
+    {'w', "warmup"},     {'l', "list"},        {'r', "run_filtered"},  {'e', "export_results"},
+    {'a', "antagonist"}, {'t', "time_budget"}, {'s', "save_baseline"}, {'b', "baseline"},
+    {'n', "noise_threshold"}, {'q', "quiet"}, {'h', "help"}};
+
+// e.g., "-e,--export_results", or "--export_samples" for an option without a short form
+static inline std::string criterion_option_flags(const std::string &long_name) {
+  for (const auto &[short_name, name] : criterion_short_options) {
+    if (name == long_name)
+      return std::string{'-', short_name} + ",--" + long_name;
+  }
+  return "--" + long_name;
+}
 
 static inline void print_criterion_help(const std::string &program_name) {
   std::cout << "\n";
@@ -11,14 +31,46 @@ static inline void print_criterion_help(const std::string &program_name) {
   std::cout << "\n";
   std::cout << termcolor::bold << "SYNOPSIS\n" << termcolor::reset;
   std::cout << termcolor::bold << "     " << program_name << "\n           " << termcolor::reset
-            << "[" << termcolor::bold << "-w,--warmup" << termcolor::reset << " <number>]\n"
-            << "           [" << termcolor::bold << "-l,--list" << termcolor::reset << "] "
+            << "[" << termcolor::bold << criterion_option_flags("warmup") << termcolor::reset
+            << " <number>]\n"
+            << "           [" << termcolor::bold << criterion_option_flags("list")
+            << termcolor::reset << "] "
             << "[" << termcolor::bold << "--list_filtered" << termcolor::reset << " <regex>] "
-            << "[" << termcolor::bold << "-r,--run_filtered" << termcolor::reset << " <regex>] "
-            << "\n           [" << termcolor::bold << "-e,--export_results" << termcolor::reset
-            << " {csv,json,md,asciidoc} <filename>]\n"
-            << "           [" << termcolor::bold << "-q,--quiet" << termcolor::reset << "] "
-            << "[" << termcolor::bold << "-h,--help" << termcolor::reset << "] ";
+            << "[" << termcolor::bold << criterion_option_flags("run_filtered") << termcolor::reset
+            << " <regex>] "
+            << "\n           [" << termcolor::bold << criterion_option_flags("export_results")
+            << termcolor::reset << " {csv,json,jsonl,md,asciidoc,html,gbench-json,junit,"
+            << "openmetrics} <filename>]\n"
+            << "           [" << termcolor::bold << criterion_option_flags("antagonist")
+            << termcolor::reset << " <list>] [" << termcolor::bold
+            << criterion_option_flags("time_budget") << termcolor::reset << " <duration>]\n"
+            << "           [" << termcolor::bold << criterion_option_flags("save_baseline")
+            << termcolor::reset << " <name>] [" << termcolor::bold
+            << criterion_option_flags("baseline") << termcolor::reset << " <name>] ["
+            << termcolor::bold << criterion_option_flags("noise_threshold") << termcolor::reset
+            << " <percent>]\n"
+            << "           [" << termcolor::bold << "--history" << termcolor::reset
+            << " <filename>] [" << termcolor::bold << "--revision" << termcolor::reset
+            << " <label>] [" << termcolor::bold << "--history_report" << termcolor::reset
+            << "]\n"
+            << "           [" << termcolor::bold << "--export_samples" << termcolor::reset
+            << " <filename>] [" << termcolor::bold << "--analyze" << termcolor::reset
+            << " <filename>] [" << termcolor::bold << "--estimator" << termcolor::reset
+            << " <name>]\n"
+            << "           [" << termcolor::bold << "--confidence" << termcolor::reset
+            << " <percent>] [" << termcolor::bold << "--outliers" << termcolor::reset
+            << " {keep,severe,mild}]\n"
+            << "           [" << termcolor::bold << "--reporters" << termcolor::reset
+            << " <format:filename,...>] [" << termcolor::bold << "--thresholds" << termcolor::reset
+            << " <filename>]\n"
+            << "           [" << termcolor::bold << "--trace" << termcolor::reset
+            << " <filename>] [" << termcolor::bold << "--compare" << termcolor::reset
+            << " <reference>]\n"
+            << "           [" << termcolor::bold << "--shard" << termcolor::reset << " <i/N>] ["
+            << termcolor::bold << "--merge" << termcolor::reset << " <filename>...]\n"
+            << "           [" << termcolor::bold << criterion_option_flags("quiet")
+            << termcolor::reset << "] "
+            << "[" << termcolor::bold << criterion_option_flags("help") << termcolor::reset << "] ";
   std::cout << "\n";
   std::cout << termcolor::bold << "DESCRIPTION\n" << termcolor::reset;
   std::cout
@@ -27,12 +79,13 @@ static inline void print_criterion_help(const std::string &program_name) {
   std::cout << "\n";
   std::cout << "     The options are as follows:\n";
   std::cout << "\n";
-  std::cout << termcolor::bold << "     -w,--warmup " << termcolor::reset << termcolor::underline
-            << "number" << termcolor::reset << "\n";
+  std::cout << termcolor::bold << "     " << criterion_option_flags("warmup") << " "
+            << termcolor::reset << termcolor::underline << "number" << termcolor::reset << "\n";
   std::cout << "          Number of warmup runs (at least 1) to execute before the benchmark "
                "(default=3)\n";
   std::cout << "\n";
-  std::cout << termcolor::bold << "     -l,--list " << termcolor::reset << "\n";
+  std::cout << termcolor::bold << "     " << criterion_option_flags("list") << " "
+            << termcolor::reset << "\n";
   std::cout << "          Print the list of available benchmarks\n";
   std::cout << "\n";
   std::cout << termcolor::bold << "     --list_filtered " << termcolor::reset
@@ -40,12 +93,13 @@ static inline void print_criterion_help(const std::string &program_name) {
   std::cout
       << "          Print a filtered list of available benchmarks (based on user-provided regex)\n";
   std::cout << "\n";
-  std::cout << termcolor::bold << "     -r,--run_filtered " << termcolor::reset << termcolor::underline
-            << "regex" << termcolor::reset << "\n";
+  std::cout << termcolor::bold << "     " << criterion_option_flags("run_filtered") << " "
+            << termcolor::reset << termcolor::underline << "regex" << termcolor::reset << "\n";
   std::cout
       << "          Run a filtered list of available benchmarks (based on user-provided regex)\n";
   std::cout << "\n";
-  std::cout << termcolor::bold << "     -e,--export_results " << termcolor::reset
+  std::cout << termcolor::bold << "     " << criterion_option_flags("export_results") << " "
+            << termcolor::reset
             << termcolor::underline << "format" << termcolor::reset << " " << termcolor::underline
             << "filename" << termcolor::reset << "\n";
   std::cout
@@ -55,14 +109,138 @@ static inline void print_criterion_help(const std::string &program_name) {
             << "       Comma separated values (CSV) delimited text file\n";
   std::cout << "          " << termcolor::bold << "json" << termcolor::reset
             << "      JavaScript Object Notation (JSON) text file\n";
+  std::cout << "          " << termcolor::bold << "jsonl" << termcolor::reset
+            << "     JSON Lines text file, one object per benchmark\n";
   std::cout << "          " << termcolor::bold << "md" << termcolor::reset
             << "        Markdown (md) text file\n";
   std::cout << "          " << termcolor::bold << "asciidoc" << termcolor::reset
             << "  AsciiDoc (asciidoc) text file\n";
+  std::cout << "          " << termcolor::bold << "html" << termcolor::reset
+            << "      Self-contained HTML report with charts\n";
+  std::cout << "          " << termcolor::bold << "gbench-json" << termcolor::reset
+            << "  Google Benchmark JSON, e.g., for compare.py\n";
+  std::cout << "          " << termcolor::bold << "junit" << termcolor::reset
+            << "     JUnit XML, one test case per benchmark, failed by --thresholds\n";
+  std::cout << "          " << termcolor::bold << "openmetrics" << termcolor::reset
+            << "  OpenMetrics gauges, e.g., for the node_exporter textfile collector\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     " << criterion_option_flags("antagonist") << " "
+            << termcolor::reset << termcolor::underline << "list" << termcolor::reset << "\n";
+  std::cout << "          Run background threads alongside each benchmark, e.g., "
+               "membw:2,llc-thrash:1,cpu-spin:2,smt-sibling\n";
+  std::cout << "\n";
+  std::cout << "          " << termcolor::bold << "membw:N" << termcolor::reset
+            << "       N threads saturating memory bandwidth\n";
+  std::cout << "          " << termcolor::bold << "llc-thrash:N" << termcolor::reset
+            << "  N threads evicting the last level cache\n";
+  std::cout << "          " << termcolor::bold << "cpu-spin:N" << termcolor::reset
+            << "    N threads spinning on other cores\n";
+  std::cout << "          " << termcolor::bold << "smt-sibling" << termcolor::reset
+            << "   1 thread spinning on the SMT sibling of the benchmark core\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     " << criterion_option_flags("time_budget") << " "
+            << termcolor::reset << termcolor::underline << "duration" << termcolor::reset << "\n";
+  std::cout << "          Finish all benchmarks within the given time, e.g., 15m, 90s or 1h30m. "
+               "A short pilot\n          run of each benchmark decides how much of the budget "
+               "it gets\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     " << criterion_option_flags("save_baseline") << " "
+            << termcolor::reset << termcolor::underline << "name" << termcolor::reset << "\n";
+  std::cout << "          Save the samples of every benchmark that was run as a named baseline in "
+               ".criterion/baselines\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     " << criterion_option_flags("baseline") << " "
+            << termcolor::reset << termcolor::underline << "name" << termcolor::reset << "\n";
+  std::cout << "          Compare against a saved baseline, or Google Benchmark JSON output if "
+               "name ends in\n          .json. Exits with status 1 if any benchmark regressed\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     " << criterion_option_flags("noise_threshold") << " "
+            << termcolor::reset
+            << termcolor::underline << "percent" << termcolor::reset << "\n";
+  std::cout << "          Changes smaller than this are reported as no change (default=2)\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     --history " << termcolor::reset << termcolor::underline
+            << "filename" << termcolor::reset << "\n";
+  std::cout << "          Append the results to a JSON Lines history file, one record per "
+               "benchmark\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     --revision " << termcolor::reset << termcolor::underline
+            << "label" << termcolor::reset << "\n";
+  std::cout << "          Revision to record the results under, e.g., a commit hash "
+               "(default=unknown)\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     --history_report " << termcolor::reset << "\n";
+  std::cout << "          Report change points in the history file instead of running "
+               "benchmarks\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     --export_samples " << termcolor::reset
+            << termcolor::underline << "filename" << termcolor::reset << "\n";
+  std::cout << "          Stream the duration, start time, batch size and CPU of every measured "
+               "iteration\n          to a binary file (see sample_format.hpp for the layout)\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     --analyze " << termcolor::reset << termcolor::underline
+            << "filename" << termcolor::reset << "\n";
+  std::cout << "          Recompute results from a file written by --export_samples or a saved "
+               "baseline,\n          instead of running benchmarks\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     --estimator " << termcolor::reset << termcolor::underline
+            << "name" << termcolor::reset << "\n";
+  std::cout << "          Estimator used by --analyze (default=mean)\n";
+  std::cout << "\n";
+  std::cout << "          " << termcolor::bold << "mean" << termcolor::reset
+            << "        Mean of the run means, as reported when benchmarks run\n";
+  std::cout << "          " << termcolor::bold << "median" << termcolor::reset
+            << "      Median of the run medians\n";
+  std::cout << "          " << termcolor::bold << "lowest_rsd" << termcolor::reset
+            << "  Mean of the run with the lowest relative standard deviation\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     --confidence " << termcolor::reset << termcolor::underline
+            << "percent" << termcolor::reset << "\n";
+  std::cout << "          Confidence level of intervals and baseline comparisons (default=95)\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     --outliers " << termcolor::reset << termcolor::underline
+            << "policy" << termcolor::reset << "\n";
+  std::cout << "          Outliers that --analyze leaves out: keep all, drop severe, or drop mild "
+               "and severe\n          (default=keep)\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     --reporters " << termcolor::reset << termcolor::underline
+            << "list" << termcolor::reset << "\n";
+  std::cout << "          Export to several files at once, e.g., "
+               "csv:results.csv,jsonl:results.jsonl,html:report.html\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     --thresholds " << termcolor::reset << termcolor::underline
+            << "filename" << termcolor::reset << "\n";
+  std::cout << "          Check benchmarks against limits, one \"<regex> <metric> <limit>\" per "
+               "line, with\n          max_time, max_regression or max_allocations. Exits with "
+               "status 1 if any check fails\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     --trace " << termcolor::reset << termcolor::underline
+            << "filename" << termcolor::reset << "\n";
+  std::cout << "          Write a timeline of the run in the Chrome trace event format, for "
+               "chrome://tracing\n          or ui.perfetto.dev\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     --compare " << termcolor::reset << termcolor::underline
+            << "reference" << termcolor::reset << "\n";
+  std::cout << "          Rank the instances of each benchmark relative to a reference: first, "
+               "fastest, or the\n          instances with a name segment, e.g., make_shared or "
+               "int (for fn:int)\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     --shard " << termcolor::reset << termcolor::underline
+            << "i/N" << termcolor::reset << "\n";
+  std::cout << "          Only list and run the i-th of N parts of the (filtered) benchmarks, "
+               "e.g., 2/4, to\n          spread them across machines\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     --merge " << termcolor::reset << termcolor::underline
+            << "filename..." << termcolor::reset << "\n";
+  std::cout << "          Combine the results in JSON or JSON Lines exports, --export_samples "
+               "files or saved\n          baselines, e.g., of every shard, instead of running "
+               "benchmarks\n";
   std::cout << "\n";
-  std::cout << termcolor::bold << "     -q,--quiet " << termcolor::reset << "\n";
+  std::cout << termcolor::bold << "     " << criterion_option_flags("quiet") << " "
+            << termcolor::reset << "\n";
   std::cout << "          Run benchmarks quietly, suppressing activity indicators\n";
   std::cout << "\n";
-  std::cout << termcolor::bold << "     -h,--help " << termcolor::reset << "\n";
+  std::cout << termcolor::bold << "     " << criterion_option_flags("help") << " "
+            << termcolor::reset << "\n";
   std::cout << "          Print this help message\n";
 }
\ No newline at end of file
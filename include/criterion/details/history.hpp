@@ -0,0 +1,188 @@
+#pragma once
+#include <criterion/details/benchmark_result.hpp>
+#include <criterion/details/json_string.hpp>
+#include <criterion/details/statistics.hpp>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace criterion {
+
+struct history_record {
+  std::string revision;
+  std::int64_t timestamp; // seconds since the epoch
+  std::string name;
+  long double mean_execution_time;
+  long double fastest_execution_time;
+  long double slowest_execution_time;
+  std::size_t num_runs;
+  std::size_t num_iterations;
+};
+
+// The series of one benchmark in a history file, oldest first
+struct history_series {
+  std::string name;
+  std::vector<history_record> records;
+  std::vector<change_point> change_points;
+};
+
+// Append-only history of benchmark results in JSON Lines, one record per benchmark per run:
+//
+//   {"revision":"a1b2c3d","timestamp":1767225600,"name":"MergeSort/1K","mean":...}
+class history {
+  // Parses the flat objects written by append(), e.g., {"name":"Foo","mean":1.5}, into a map
+  // from key to (unescaped) value
+  static std::optional<std::unordered_map<std::string, std::string>>
+  parse_line(const std::string &line) {
+    std::unordered_map<std::string, std::string> result;
+    std::size_t i = 0;
+    const auto skip_whitespace = [&]() {
+      while (i < line.size() && std::isspace(static_cast<unsigned char>(line[i])))
+        i += 1;
+    };
+    const auto parse_string = [&]() -> std::optional<std::string> {
+      if (i >= line.size() || line[i] != '"')
+        return std::nullopt;
+      i += 1;
+      std::string value;
+      while (i < line.size() && line[i] != '"') {
+        if (line[i] == '\\' && i + 1 < line.size()) {
+          i = detail::json_unescape(line, i + 1, value);
+        } else {
+          value += line[i];
+        }
+        i += 1;
+      }
+      if (i >= line.size())
+        return std::nullopt;
+      i += 1;
+      return value;
+    };
+
+    skip_whitespace();
+    if (i >= line.size() || line[i] != '{')
+      return std::nullopt;
+    i += 1;
+    while (true) {
+      skip_whitespace();
+      const auto key = parse_string();
+      skip_whitespace();
+      if (!key || i >= line.size() || line[i] != ':')
+        return std::nullopt;
+      i += 1;
+      skip_whitespace();
+      if (i < line.size() && line[i] == '"') {
+        const auto value = parse_string();
+        if (!value)
+          return std::nullopt;
+        result[key.value()] = value.value();
+      } else {
+        const auto start = i;
+        while (i < line.size() && line[i] != ',' && line[i] != '}')
+          i += 1;
+        result[key.value()] = line.substr(start, i - start);
+      }
+      skip_whitespace();
+      if (i < line.size() && line[i] == ',') {
+        i += 1;
+      } else if (i < line.size() && line[i] == '}') {
+        return result;
+      } else {
+        return std::nullopt;
+      }
+    }
+  }
+
+public:
+  // Appends one record per result, in `execution_order`, to `filename`
+  static bool append(const std::string &filename, const std::string &revision,
+                     const std::vector<std::string> &execution_order,
+                     const std::unordered_map<std::string, benchmark_result> &results) {
+    const auto timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+                               std::chrono::system_clock::now().time_since_epoch())
+                               .count();
+
+    // records of a run are buffered and appended together
+    std::stringstream records;
+    records << std::fixed << std::setprecision(2);
+    for (const auto &name : execution_order) {
+      const auto &result = results.at(name);
+      records << "{\"revision\":\"" << detail::json_escape(revision)
+              << "\",\"timestamp\":" << timestamp
+              << ",\"name\":\"" << detail::json_escape(result.name)
+              << "\",\"mean\":" << result.mean_execution_time
+              << ",\"fastest\":" << result.fastest_execution_time
+              << ",\"slowest\":" << result.slowest_execution_time
+              << ",\"runs\":" << result.num_runs << ",\"iterations\":" << result.num_iterations
+              << "}\n";
+    }
+
+    std::ofstream os(filename, std::ios::app);
+    if (!os.is_open())
+      return false;
+    os << records.str();
+    os.flush();
+    return os.good();
+  }
+
+  // Reads every well-formed record in `filename`. Malformed lines, e.g., from an interrupted
+  // write, are skipped
+  static std::optional<std::vector<history_record>> load(const std::string &filename) {
+    std::ifstream is(filename);
+    if (!is.is_open())
+      return std::nullopt;
+
+    std::vector<history_record> result;
+    std::string line;
+    while (std::getline(is, line)) {
+      const auto fields = parse_line(line);
+      if (!fields)
+        continue;
+      try {
+        const auto &f = fields.value();
+        result.push_back({f.at("revision"), std::stoll(f.at("timestamp")), f.at("name"),
+                          std::stold(f.at("mean")), std::stold(f.at("fastest")),
+                          std::stold(f.at("slowest")), std::stoull(f.at("runs")),
+                          std::stoull(f.at("iterations"))});
+      } catch (...) {
+        continue;
+      }
+    }
+    return result;
+  }
+
+  // Groups records by benchmark, in order of first appearance, and finds the change points in
+  // the mean execution time of each
+  static std::vector<history_series> analyze(const std::vector<history_record> &records) {
+    std::vector<history_series> result;
+    std::unordered_map<std::string, std::size_t> index;
+    for (const auto &record : records) {
+      const auto it = index.find(record.name);
+      if (it == index.end()) {
+        index[record.name] = result.size();
+        result.push_back({record.name, {record}, {}});
+      } else {
+        result[it->second].records.push_back(record);
+      }
+    }
+
+    for (auto &series : result) {
+      std::vector<long double> means;
+      means.reserve(series.records.size());
+      for (const auto &record : series.records) {
+        means.push_back(record.mean_execution_time);
+      }
+      series.change_points = detect_change_points(means);
+    }
+    return result;
+  }
+};
+
+} // namespace criterion
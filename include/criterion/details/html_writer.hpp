@@ -0,0 +1,465 @@
+#pragma once
+#include <criterion/details/baseline.hpp>
+#include <criterion/details/benchmark.hpp>
+#include <criterion/details/benchmark_result.hpp>
+#include <criterion/details/statistics.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace criterion {
+
+namespace detail {
+
+inline std::string html_escape(const std::string &value) {
+  std::string result;
+  for (const auto c : value) {
+    if (c == '<') {
+      result += "&lt;";
+    } else if (c == '>') {
+      result += "&gt;";
+    } else if (c == '&') {
+      result += "&amp;";
+    } else if (c == '"') {
+      result += "&quot;";
+    } else {
+      result += c;
+    }
+  }
+  return result;
+}
+
+inline std::string format_duration(long double ns) {
+  std::stringstream os;
+  os << std::setprecision(3);
+  if (ns < 1E3) {
+    os << ns << " ns";
+  } else if (ns < 1E6) {
+    os << ns / 1E3 << " us";
+  } else if (ns < 1E9) {
+    os << ns / 1E6 << " ms";
+  } else {
+    os << ns / 1E9 << " s";
+  }
+  return os.str();
+}
+
+inline std::string format_count(long double value) {
+  std::stringstream os;
+  os << std::setprecision(3);
+  if (value < 1E3) {
+    os << value;
+  } else if (value < 1E6) {
+    os << value / 1E3 << "k";
+  } else if (value < 1E9) {
+    os << value / 1E6 << "M";
+  } else {
+    os << value / 1E9 << "G";
+  }
+  return os.str();
+}
+
+// Size of a benchmark instance named like the ones INVOKE_BENCHMARK_RANGE generates, e.g., 1024
+// for "MergeSort/1K"
+inline std::optional<long double> instance_size(const std::string &instance_name) {
+  if (instance_name.size() < 2 || instance_name.front() != '/')
+    return std::nullopt;
+  std::size_t end = 1;
+  while (end < instance_name.size() &&
+         (std::isdigit(static_cast<unsigned char>(instance_name[end])) ||
+          instance_name[end] == '.')) {
+    end += 1;
+  }
+  if (end == 1)
+    return std::nullopt;
+  long double multiplier = 1;
+  const auto suffix = instance_name.substr(end);
+  if (suffix == "K") {
+    multiplier = 1024;
+  } else if (suffix == "M") {
+    multiplier = 1024 * 1024;
+  } else if (suffix == "G") {
+    multiplier = 1024 * 1024 * 1024;
+  } else if (!suffix.empty()) {
+    return std::nullopt;
+  }
+  try {
+    return std::stold(instance_name.substr(1, end - 1)) * multiplier;
+  } catch (...) {
+    return std::nullopt;
+  }
+}
+
+// A chart drawn as inline SVG, with linear or logarithmic axes. An axis that starts at 0 or
+// below, e.g., for a benchmark family that includes size 0, is drawn linear instead
+class svg_chart {
+  static constexpr double width_{520}, height_{260};
+  static constexpr double left_{70}, right_{20}, top_{15}, bottom_{40};
+  long double x_min_, x_max_, y_min_, y_max_;
+  bool log_x_, log_y_;
+  std::stringstream os_;
+
+  static long double transform(long double value, bool log) {
+    return log ? std::log10(std::max(value, (long double)1e-12)) : value;
+  }
+
+  static std::vector<long double> ticks(long double min, long double max, bool log) {
+    std::vector<long double> result;
+    if (log && min > 0) {
+      for (auto exponent = std::ceil(std::log10(min)); exponent <= std::log10(max); ++exponent) {
+        result.push_back(std::pow(10.0L, exponent));
+      }
+      if (result.size() >= 2)
+        return result;
+      result.clear();
+    }
+    for (int i = 0; i <= 4; ++i) {
+      result.push_back(min + (max - min) * i / 4);
+    }
+    return result;
+  }
+
+public:
+  svg_chart(long double x_min, long double x_max, long double y_min, long double y_max,
+            bool log_x = false, bool log_y = false)
+      : x_min_(x_min), x_max_(x_max > x_min ? x_max : x_min + 1), y_min_(y_min),
+        y_max_(y_max > y_min ? y_max : y_min + 1), log_x_(log_x && x_min > 0),
+        log_y_(log_y && y_min > 0) {
+    os_ << std::fixed << std::setprecision(1);
+  }
+
+  // e.g., "log-log", or "linear-log" if the x axis could not be logarithmic
+  std::string scale() const {
+    return std::string(log_x_ ? "log" : "linear") + "-" + (log_y_ ? "log" : "linear");
+  }
+
+  long double x(long double value) const {
+    const auto from = transform(x_min_, log_x_), to = transform(x_max_, log_x_);
+    return left_ + (transform(value, log_x_) - from) / (to - from) * (width_ - left_ - right_);
+  }
+
+  long double y(long double value) const {
+    const auto from = transform(y_min_, log_y_), to = transform(y_max_, log_y_);
+    return height_ - bottom_ -
+           (transform(value, log_y_) - from) / (to - from) * (height_ - top_ - bottom_);
+  }
+
+  template <class XFormat, class YFormat>
+  void axes(const std::string &x_label, const std::string &y_label, XFormat &&x_format,
+            YFormat &&y_format) {
+    os_ << "<g class=\"axis\"><line x1=\"" << left_ << "\" y1=\"" << height_ - bottom_
+        << "\" x2=\"" << width_ - right_ << "\" y2=\"" << height_ - bottom_ << "\"/><line x1=\""
+        << left_ << "\" y1=\"" << top_ << "\" x2=\"" << left_ << "\" y2=\"" << height_ - bottom_
+        << "\"/>";
+    for (const auto tick : ticks(x_min_, x_max_, log_x_)) {
+      os_ << "<text x=\"" << x(tick) << "\" y=\"" << height_ - bottom_ + 14
+          << "\" text-anchor=\"middle\">" << html_escape(x_format(tick)) << "</text>";
+    }
+    for (const auto tick : ticks(y_min_, y_max_, log_y_)) {
+      os_ << "<text x=\"" << left_ - 6 << "\" y=\"" << y(tick) + 4
+          << "\" text-anchor=\"end\">" << html_escape(y_format(tick)) << "</text>";
+    }
+    os_ << "<text x=\"" << (left_ + width_ - right_) / 2 << "\" y=\"" << height_ - 4
+        << "\" text-anchor=\"middle\">" << html_escape(x_label) << "</text>";
+    os_ << "<text transform=\"translate(12," << (top_ + height_ - bottom_) / 2
+        << ") rotate(-90)\" text-anchor=\"middle\">" << html_escape(y_label) << "</text></g>";
+  }
+
+  void line(const std::vector<std::pair<long double, long double>> &points,
+            const std::string &css_class) {
+    if (points.empty())
+      return;
+    os_ << "<polyline class=\"" << css_class << "\" points=\"";
+    for (const auto &[px, py] : points) {
+      os_ << x(px) << "," << y(py) << " ";
+    }
+    os_ << "\"/>";
+  }
+
+  void dots(const std::vector<std::pair<long double, long double>> &points,
+            const std::string &css_class) {
+    for (const auto &[px, py] : points) {
+      os_ << "<circle class=\"" << css_class << "\" cx=\"" << x(px) << "\" cy=\"" << y(py)
+          << "\" r=\"2.5\"/>";
+    }
+  }
+
+  std::string str() const {
+    std::stringstream result;
+    result << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << width_ << "\" height=\""
+           << height_ << "\" viewBox=\"0 0 " << width_ << " " << height_ << "\">" << os_.str()
+           << "</svg>";
+    return result.str();
+  }
+};
+
+// Gaussian kernel density estimate of `samples` at `points` evenly spaced points in [min, max]
+inline std::vector<std::pair<long double, long double>>
+kernel_density(const std::vector<long double> &samples, long double min, long double max,
+               std::size_t points = 100) {
+  std::vector<std::pair<long double, long double>> result;
+  if (samples.empty())
+    return result;
+  // Silverman's rule of thumb, using the interquartile range if it is smaller so that a few
+  // outliers do not smooth away the shape of the distribution
+  auto spread = std::sqrt(sample_variance(samples));
+  const auto iqr = (sample_quantile(samples, 0.75) - sample_quantile(samples, 0.25)) / 1.34L;
+  if (iqr > 0)
+    spread = std::min(spread, iqr);
+  auto bandwidth = 1.06L * spread * std::pow((long double)samples.size(), -0.2L);
+  if (!(bandwidth > 0))
+    bandwidth = std::max((max - min) / 50, (long double)1e-3);
+  const auto normalization =
+      1 / (samples.size() * bandwidth * std::sqrt(2 * 3.14159265358979323846L));
+  for (std::size_t i = 0; i < points; ++i) {
+    const auto at = min + (max - min) * i / (points - 1);
+    long double density = 0;
+    for (const auto sample : samples) {
+      const auto u = (at - sample) / bandwidth;
+      density += std::exp(-0.5L * u * u);
+    }
+    result.push_back({at, density * normalization});
+  }
+  return result;
+}
+
+} // namespace detail
+
+class html_writer {
+  static std::string distribution_chart(const std::vector<long double> &samples,
+                                        const std::vector<long double> *baseline_samples) {
+    // leave out the slowest and fastest 1% so that a few outliers do not flatten the plot
+    auto min = sample_quantile(samples, 0.01);
+    auto max = sample_quantile(samples, 0.99);
+    if (baseline_samples && !baseline_samples->empty()) {
+      min = std::min(min, sample_quantile(*baseline_samples, 0.01));
+      max = std::max(max, sample_quantile(*baseline_samples, 0.99));
+    }
+    const auto margin = std::max((max - min) * 0.1L, max * 0.01L);
+    min = std::max(min - margin, (long double)0);
+    max += margin;
+
+    const auto density = detail::kernel_density(samples, min, max);
+    std::vector<std::pair<long double, long double>> baseline_density;
+    if (baseline_samples) {
+      baseline_density = detail::kernel_density(*baseline_samples, min, max);
+    }
+    long double highest = 0;
+    for (const auto &points : {density, baseline_density}) {
+      for (const auto &point : points) {
+        highest = std::max(highest, point.second);
+      }
+    }
+
+    detail::svg_chart chart(min, max, 0, highest * 1.05L);
+    chart.axes(
+        "mean execution time per run", "density", [](long double v) {
+          return detail::format_duration(v);
+        },
+        [](long double) { return std::string{""}; });
+    chart.line(baseline_density, "baseline");
+    chart.line(density, "current");
+    return chart.str();
+  }
+
+  // Total time against total iterations after each run. The slope of the least-squares line
+  // through the origin is the time per iteration; runs that stray from it stand out
+  static std::string regression_chart(const benchmark_result &result) {
+    std::vector<std::pair<long double, long double>> points;
+    long double iterations = 0, time = 0, xy = 0, xx = 0;
+    const auto step = std::max(result.samples.size() / 500, std::size_t{1});
+    for (std::size_t i = 0; i < result.samples.size(); ++i) {
+      iterations += result.num_iterations;
+      time += result.samples[i] * result.num_iterations;
+      xy += iterations * time;
+      xx += iterations * iterations;
+      if (i % step == 0 || i + 1 == result.samples.size()) {
+        points.push_back({iterations, time});
+      }
+    }
+    const auto slope = xx > 0 ? xy / xx : 0;
+
+    detail::svg_chart chart(0, iterations, 0, std::max(time, slope * iterations));
+    chart.axes(
+        "iterations", "total time",
+        [](long double v) { return detail::format_count(v); },
+        [](long double v) { return detail::format_duration(v); });
+    chart.line({{0, 0}, {iterations, slope * iterations}}, "fit");
+    chart.dots(points, "current");
+    return chart.str();
+  }
+
+  // Benchmarks named like "MergeSort/1K", "MergeSort/2K", ..., grouped by the part before the
+  // last '/' and sorted by size
+  static std::map<std::string, std::vector<std::pair<long double, std::string>>> families() {
+    std::map<std::string, std::vector<std::pair<long double, std::string>>> result;
+    for (const auto &name : benchmark::benchmark_execution_order) {
+      const auto slash = name.rfind('/');
+      if (slash == std::string::npos)
+        continue;
+      if (const auto size = detail::instance_size(name.substr(slash))) {
+        result[name.substr(0, slash)].push_back({size.value(), name});
+      }
+    }
+    for (auto it = result.begin(); it != result.end();) {
+      if (it->second.size() < 2) {
+        it = result.erase(it);
+      } else {
+        std::sort(it->second.begin(), it->second.end());
+        ++it;
+      }
+    }
+    return result;
+  }
+
+  static std::string family_chart(const std::string &family,
+                                  const std::vector<std::pair<long double, std::string>> &members,
+                                  const std::unordered_map<std::string, benchmark_result> &results,
+                                  const baseline *base) {
+    std::vector<std::pair<long double, long double>> current, previous;
+    for (const auto &[size, name] : members) {
+      current.push_back({size, results.at(name).mean_execution_time});
+      if (base) {
+        const auto it = base->entries.find(name);
+        if (it != base->entries.end() && !it->second.samples.empty()) {
+          previous.push_back({size, sample_mean(it->second.samples)});
+        }
+      }
+    }
+
+    long double y_min = current.front().second, y_max = current.front().second;
+    for (const auto &points : {current, previous}) {
+      for (const auto &point : points) {
+        y_min = std::min(y_min, point.second);
+        y_max = std::max(y_max, point.second);
+      }
+    }
+
+    detail::svg_chart chart(current.front().first, current.back().first, y_min * 0.8L,
+                            y_max * 1.25L, true, true);
+    chart.axes(
+        "size", "mean execution time",
+        [](long double v) { return detail::format_count(v); },
+        [](long double v) { return detail::format_duration(v); });
+    chart.line(previous, "baseline");
+    chart.dots(previous, "baseline");
+    chart.line(current, "current");
+    chart.dots(current, "current");
+    return "<figure>" + chart.str() + "<figcaption>" + detail::html_escape(family) + " (" +
+           chart.scale() + ")</figcaption></figure>";
+  }
+
+public:
+  // A single, self-contained HTML page with a summary table and inline SVG charts. If `base` is
+  // given, e.g., from --baseline, its samples are drawn alongside the current ones
+  static bool write_results(const std::string &filename,
+                            const std::unordered_map<std::string, benchmark_result> &results,
+                            const baseline *base = nullptr) {
+    bool result{false};
+    std::ofstream os(filename);
+    if (os.is_open()) {
+      os << "<!DOCTYPE html>\n<html>\n<head>\n<meta charset=\"utf-8\">\n"
+         << "<title>Criterion Benchmark Results</title>\n<style>\n"
+         << "body { font-family: sans-serif; margin: 2em; color: #222; }\n"
+         << "table { border-collapse: collapse; }\n"
+         << "th, td { border: 1px solid #ccc; padding: 4px 8px; text-align: right; }\n"
+         << "th:first-child, td:first-child { text-align: left; }\n"
+         << ".charts { display: flex; flex-wrap: wrap; gap: 1em; }\n"
+         << "svg text { font-size: 11px; fill: #444; }\n"
+         << "svg .axis line { stroke: #888; }\n"
+         << "svg polyline { fill: none; stroke-width: 2; }\n"
+         << "svg .current { stroke: #1f77b4; fill: #1f77b4; }\n"
+         << "svg polyline.current { fill: none; }\n"
+         << "svg .baseline { stroke: #ff7f0e; fill: #ff7f0e; stroke-dasharray: 5 3; }\n"
+         << "svg polyline.baseline { fill: none; }\n"
+         << "svg .fit { stroke: #d62728; stroke-width: 1; }\n"
+         << ".legend span { margin-right: 1em; }\n"
+         << "</style>\n</head>\n<body>\n<h1>Criterion Benchmark Results</h1>\n";
+
+      os << "<p class=\"legend\"><span style=\"color: #1f77b4\">&#9632; current run</span>";
+      if (base) {
+        os << "<span style=\"color: #ff7f0e\">&#9632; baseline \""
+           << detail::html_escape(base->name) << "\"</span>";
+      }
+      os << "</p>\n";
+
+      os << "<table>\n<tr><th>Name</th><th>Warmup Runs</th><th>Runs</th><th>Iterations per "
+            "Run</th><th>Mean</th><th>Fastest</th><th>Slowest</th>";
+      if (base) {
+        os << "<th>Change</th><th>p-value</th>";
+      }
+      os << "</tr>\n";
+      for (const auto &name : benchmark::benchmark_execution_order) {
+        const auto &this_result = results.at(name);
+        os << "<tr><td><a href=\"#" << detail::html_escape(name) << "\">"
+           << detail::html_escape(name) << "</a></td><td>" << this_result.num_warmup_runs
+           << "</td><td>" << this_result.samples.size() << "</td><td>"
+           << this_result.num_iterations << "</td><td>"
+           << detail::format_duration(this_result.mean_execution_time) << "</td><td>"
+           << detail::format_duration(this_result.fastest_execution_time) << "</td><td>"
+           << detail::format_duration(this_result.slowest_execution_time) << "</td>";
+        if (base) {
+          const auto it = base->entries.find(name);
+          if (it != base->entries.end()) {
+            const auto comparison = compare_samples(it->second.samples, this_result.samples);
+            os << std::fixed << std::setprecision(2) << "<td>" << std::showpos
+               << comparison.relative_change * 100 << std::noshowpos << " %</td><td>"
+               << std::setprecision(4) << comparison.p_value << "</td>";
+            os.unsetf(std::ios::fixed);
+          } else {
+            os << "<td></td><td></td>";
+          }
+        }
+        os << "</tr>\n";
+      }
+      os << "</table>\n";
+
+      const auto benchmark_families = families();
+      if (!benchmark_families.empty()) {
+        os << "<h2>Families</h2>\n<div class=\"charts\">\n";
+        for (const auto &[family, members] : benchmark_families) {
+          os << family_chart(family, members, results, base) << "\n";
+        }
+        os << "</div>\n";
+      }
+
+      for (const auto &name : benchmark::benchmark_execution_order) {
+        const auto &this_result = results.at(name);
+        os << "<h2 id=\"" << detail::html_escape(name) << "\">" << detail::html_escape(name)
+           << "</h2>\n<div class=\"charts\">\n";
+        if (this_result.samples.empty()) {
+          os << "</div>\n";
+          continue;
+        }
+        const std::vector<long double> *baseline_samples = nullptr;
+        if (base) {
+          const auto it = base->entries.find(name);
+          if (it != base->entries.end())
+            baseline_samples = &it->second.samples;
+        }
+        os << "<figure>" << distribution_chart(this_result.samples, baseline_samples)
+           << "<figcaption>Distribution of the mean execution time per run ("
+           << this_result.samples.size() << " runs)</figcaption></figure>\n";
+        os << "<figure>" << regression_chart(this_result)
+           << "<figcaption>Total time vs. iterations</figcaption></figure>\n";
+        os << "</div>\n";
+      }
+
+      os << "</body>\n</html>\n";
+      result = true;
+    }
+    os.close();
+    return result;
+  }
+};
+
+} // namespace criterion
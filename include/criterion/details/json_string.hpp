@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace criterion {
+
+namespace detail {
+
+// `value` escaped for use inside a JSON string: quotes, backslashes and every control character,
+// e.g., a tab in a benchmark name, as \u00XX, so each record stays on one line
+inline std::string json_escape(const std::string &value) {
+  std::string result;
+  result.reserve(value.size());
+  for (const auto c : value) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+      result += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(c));
+      result += escaped;
+    } else {
+      result += c;
+    }
+  }
+  return result;
+}
+
+// Appends the character of the escape sequence that starts after the backslash at text[i - 1]
+// to `result`, and returns the index of the last character of the sequence. Code points outside
+// of ASCII are not expected in benchmark names and become '?'
+inline std::size_t json_unescape(const std::string &text, std::size_t i, std::string &result) {
+  switch (text[i]) {
+  case 'n':
+    result += '\n';
+    return i;
+  case 't':
+    result += '\t';
+    return i;
+  case 'r':
+    result += '\r';
+    return i;
+  case 'b':
+    result += '\b';
+    return i;
+  case 'f':
+    result += '\f';
+    return i;
+  case 'u': {
+    const auto code_point = std::strtoul(text.substr(i + 1, 4).c_str(), nullptr, 16);
+    result += code_point < 0x80 ? static_cast<char>(code_point) : '?';
+    return i + 4 < text.size() ? i + 4 : text.size() - 1;
+  }
+  default:
+    result += text[i];
+    return i;
+  }
+}
+
+} // namespace detail
+
+} // namespace criterion
@@ -0,0 +1,129 @@
+#pragma once
+#include <criterion/details/benchmark.hpp>
+#include <criterion/details/benchmark_result.hpp>
+#include <criterion/details/html_writer.hpp>
+#include <criterion/details/thresholds.hpp>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace criterion {
+
+// JUnit XML for CI systems. Every benchmark is a test case, grouped into one test suite per
+// benchmark family (the part of the name before '/'), that fails if any of its threshold
+// checks failed (see thresholds)
+class junit_writer {
+  static std::string family(const std::string &name) { return name.substr(0, name.find('/')); }
+
+public:
+  static bool write_results(const std::string &filename,
+                            const std::unordered_map<std::string, benchmark_result> &results,
+                            const std::vector<threshold_check> &checks) {
+    std::ofstream os(filename);
+    if (!os.is_open())
+      return false;
+
+    std::unordered_map<std::string, std::vector<const threshold_check *>> checks_of;
+    for (const auto &check : checks) {
+      checks_of[check.benchmark].push_back(&check);
+    }
+
+    // suites in the order their first benchmark ran
+    std::vector<std::string> suites;
+    std::map<std::string, std::vector<std::string>> cases;
+    for (const auto &name : benchmark::benchmark_execution_order) {
+      if (results.find(name) == results.end())
+        continue;
+      auto &suite = cases[family(name)];
+      if (suite.empty())
+        suites.push_back(family(name));
+      suite.push_back(name);
+    }
+
+    const auto failed = [&](const std::string &name) {
+      const auto it = checks_of.find(name);
+      if (it == checks_of.end())
+        return false;
+      for (const auto check : it->second) {
+        if (!check->passed)
+          return true;
+      }
+      return false;
+    };
+
+    // total time spent in measured iterations, in seconds
+    const auto seconds = [&](const std::string &name) {
+      const auto &result = results.at(name);
+      return result.mean_execution_time * result.num_runs * result.num_iterations / 1E9;
+    };
+
+    std::size_t total_failures = 0;
+    long double total_time = 0;
+    for (const auto &[name, result] : results) {
+      total_failures += failed(name) ? 1 : 0;
+      total_time += seconds(name);
+    }
+
+    os << std::fixed << std::setprecision(6);
+    os << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+    os << "<testsuites name=\"criterion\" tests=\"" << results.size() << "\" failures=\""
+       << total_failures << "\" time=\"" << total_time << "\">\n";
+    for (const auto &suite : suites) {
+      std::size_t suite_failures = 0;
+      long double suite_time = 0;
+      for (const auto &name : cases.at(suite)) {
+        suite_failures += failed(name) ? 1 : 0;
+        suite_time += seconds(name);
+      }
+      os << "  <testsuite name=\"" << detail::html_escape(suite) << "\" tests=\""
+         << cases.at(suite).size() << "\" failures=\"" << suite_failures << "\" time=\""
+         << suite_time << "\">\n";
+      for (const auto &name : cases.at(suite)) {
+        const auto &result = results.at(name);
+        os << "    <testcase name=\"" << detail::html_escape(name) << "\" classname=\""
+           << detail::html_escape(suite) << "\" time=\"" << seconds(name) << "\">\n";
+
+        const auto it = checks_of.find(name);
+        std::vector<const threshold_check *> failures;
+        if (it != checks_of.end()) {
+          for (const auto check : it->second) {
+            if (!check->passed)
+              failures.push_back(check);
+          }
+        }
+        if (!failures.empty()) {
+          os << "      <failure message=\"" << detail::html_escape(failures.front()->message())
+             << "\" type=\"" << to_string(failures.front()->metric) << "\">";
+          for (const auto check : failures) {
+            os << detail::html_escape(check->message()) << "\n";
+          }
+          os << "</failure>\n";
+        }
+
+        std::stringstream out;
+        out << std::fixed << std::setprecision(2) << "mean_execution_time: "
+            << result.mean_execution_time << " ns\n"
+            << "iterations: " << result.num_runs * result.num_iterations << "\n";
+        if (result.allocations_per_iteration.has_value()) {
+          out << "allocations_per_iteration: " << result.allocations_per_iteration.value() << "\n";
+        }
+        if (it != checks_of.end()) {
+          for (const auto check : it->second) {
+            out << check->message() << "\n";
+          }
+        }
+        os << "      <system-out>" << detail::html_escape(out.str()) << "</system-out>\n";
+        os << "    </testcase>\n";
+      }
+      os << "  </testsuite>\n";
+    }
+    os << "</testsuites>\n";
+    return os.good();
+  }
+};
+
+} // namespace criterion
@@ -1,60 +1,128 @@
 #pragma once
+#include <algorithm>
 #include <chrono>
 #include <criterion/details/benchmark.hpp>
 #include <criterion/details/benchmark_config.hpp>
 #include <criterion/details/csv_writer.hpp>
+#include <criterion/details/grid.hpp>
+#include <criterion/details/range.hpp>
+#include <criterion/details/registry.hpp>
 #include <functional>
-#include <regex>
+#include <memory>
+#include <optional>
 #include <string>
-#include <unordered_map>
+#include <tuple>
 #include <vector>
 
 namespace criterion {
 
 struct benchmark_registration_helper_struct {
-  static std::vector<benchmark_config> &registered_benchmarks() {
-    static std::vector<benchmark_config> v;
-    return v;
+  static void register_benchmark(const benchmark_config &config) {
+    benchmark_registry::global().register_instance(config);
   }
 
-  static void register_benchmark(const benchmark_config &config) {
-    registered_benchmarks().push_back(config);
+  // Only the benchmarks in this shard of the (filtered) list are listed and run, e.g., --shard 2/4
+  static inline std::optional<benchmark_shard> shard;
+
+  static std::vector<const benchmark_instance *>
+  select(const std::vector<const benchmark_instance *> &instances) {
+    return shard.has_value() ? shard->select(instances) : instances;
   }
 
   static void execute_registered_benchmarks() {
-    for (const auto &config : registered_benchmarks()) {
-      benchmark{config}.run();
+    const auto &registry = benchmark_registry::global();
+    std::vector<const benchmark_instance *> instances;
+    instances.reserve(registry.instances().size());
+    for (const auto &instance : registry.instances()) {
+      instances.push_back(&instance);
     }
+    execute(select(instances));
   }
 
-  static void list_registered_benchmarks() {
-    for (const auto &config : registered_benchmarks()) {
-      std::cout << config.name << config.parameterized_instance_name << "\n";
-    }
-  }
+  static void list_registered_benchmarks() { list_filtered_registered_benchmarks(""); }
 
   static void list_filtered_registered_benchmarks(const std::string &regex_string) {
-    std::regex regexp(regex_string);
-    std::smatch matches;
-    for (const auto &config : registered_benchmarks()) {
-      const auto benchmark_instance_name = config.name + config.parameterized_instance_name;
-      std::regex_search(benchmark_instance_name, matches, regexp);
-      if (!matches.empty()) {
-        std::cout << benchmark_instance_name << "\n";
-      }
+    for (const auto instance : select(benchmark_registry::global().filter(regex_string))) {
+      std::cout << instance->name << "\n";
     }
   }
 
   static void execute_filtered_registered_benchmarks(const std::string &regex_string) {
-    std::regex regexp(regex_string);
-    std::smatch matches;
-    for (const auto &config : registered_benchmarks()) {
-      const auto benchmark_instance_name = config.name + config.parameterized_instance_name;
-      std::regex_search(benchmark_instance_name, matches, regexp);
-      if (!matches.empty()) {
-        benchmark{config}.run();
+    execute(select(benchmark_registry::global().filter(regex_string)));
+  }
+
+  static void execute(const std::vector<const benchmark_instance *> &instances) {
+    if (benchmark::time_budget.has_value()) {
+      execute_benchmarks_within_budget(instances, benchmark::time_budget.value());
+      return;
+    }
+    const auto &registry = benchmark_registry::global();
+    for (const auto instance : instances) {
+      benchmark{registry.configure(*instance)}.run();
+    }
+  }
+
+  // Runs a short pilot of every instance, then splits what is left of `budget` across them based
+  // on their cost and variance (see allocate_time_budget). The outcome, including instances that
+  // got less time than they would without a budget, is saved in benchmark::budget_report
+  static void execute_benchmarks_within_budget(
+      const std::vector<const benchmark_instance *> &instances, std::chrono::nanoseconds budget) {
+    using namespace std::chrono;
+    const auto &registry = benchmark_registry::global();
+    const auto start = steady_clock::now();
+    const auto elapsed = [&start]() {
+      return static_cast<long double>(
+          duration_cast<nanoseconds>(steady_clock::now() - start).count());
+    };
+
+    // spend at most a tenth of the budget on pilots
+    const auto pilot_time = static_cast<long double>(budget.count()) / 10 /
+                            static_cast<long double>(std::max(instances.size(), std::size_t{1}));
+
+    // Lazy parameters are built once per instance, for its pilot, and shared with its run
+    std::vector<benchmark_config> configs;
+    std::vector<budget_pilot> pilots;
+    configs.reserve(instances.size());
+    pilots.reserve(instances.size());
+    for (const auto instance : instances) {
+      auto config = registry.configure(*instance);
+      if (config.parameter_factory) {
+        config.owned_parameters = config.parameter_factory();
+        config.parameters = config.owned_parameters.get();
+        config.parameter_factory = nullptr;
+      }
+      pilots.push_back(benchmark{config}.pilot(pilot_time));
+      configs.push_back(std::move(config));
+    }
+
+    time_budget_report report{.budget = static_cast<long double>(budget.count()),
+                              .pilot_time = elapsed(),
+                              .elapsed_time = 0,
+                              .num_benchmarks = instances.size(),
+                              .under_sampled = {}};
+
+    const auto allocations = allocate_time_budget(pilots, report.budget - report.pilot_time);
+    for (std::size_t i = 0; i < instances.size(); ++i) {
+      auto config = std::move(configs[i]); // released, with its parameters, after the run
+      const auto &allocation = allocations[i];
+      if (pilots[i].allocatable) {
+        // an allocation never exceeds the budget, but keep the conversion defined regardless
+        const auto time = nanoseconds(static_cast<nanoseconds::rep>(
+            std::clamp(allocation.time, (long double)0, static_cast<long double>(budget.count()))));
+        config.options.min_time = time;
+        config.options.max_time = time;
+        config.options.batch_size = allocation.batch_size;
+      }
+      if (allocation.under_sampled) {
+        report.under_sampled.push_back(
+            {pilots[i].name, allocation.time, allocation.iterations,
+             allocation.relative_standard_error});
       }
+      benchmark{config}.run();
     }
+
+    report.elapsed_time = elapsed();
+    benchmark::budget_report = report;
   }
 };
 
@@ -62,37 +130,93 @@ struct benchmark_registration_helper_struct {
 
 #define SETUP_BENCHMARK(...)                                                                       \
   __VA_ARGS__                                                                                      \
+  ::criterion::allocation_counter::mark_start();                                                   \
   __benchmark_start_timestamp =                                                                    \
       std::chrono::steady_clock::now(); // updated benchmark start timestamp
 
 #define TEARDOWN_BENCHMARK(...)                                                                    \
   __benchmark_teardown_timestamp = std::chrono::steady_clock::now();                               \
+  ::criterion::allocation_counter::mark_end();                                                     \
   __VA_ARGS__
 
 namespace criterion {
 
 struct benchmark_template_registration_helper_struct {
-  static std::unordered_multimap<std::string, benchmark_config> &registered_benchmark_templates() {
-    static std::unordered_multimap<std::string, benchmark_config> m;
-    return m;
+  static void register_benchmark_template(const benchmark_config &config) {
+    benchmark_registry::global().register_template(config.name, config);
   }
 
-  static void register_benchmark_template(const benchmark_config &config) {
-    registered_benchmark_templates().insert({config.name, config});
+  // Same as above, but found under `template_name` rather than the name of the benchmark
+  static void register_benchmark_template(const std::string &template_name,
+                                          const benchmark_config &config) {
+    benchmark_registry::global().register_template(template_name, config);
   }
 
   template <class ArgTuple>
   static void execute_registered_benchmark_template(const std::string &template_name,
                                                     const std::string &instance_name,
                                                     ArgTuple &arg_tuple) {
-    for (auto &[k, v] : registered_benchmark_templates()) {
-      if (k == template_name) {
-        benchmark_registration_helper_struct::register_benchmark(
-            benchmark_config{.name = template_name,
-                             .fn = v.fn,
-                             .parameterized_instance_name = instance_name,
-                             .parameters = (void *)(&arg_tuple)});
-      }
+    benchmark_registry::global().instantiate(template_name, instance_name, (void *)(&arg_tuple),
+                                             nullptr);
+  }
+
+  // Same as above, but each instance shares ownership of arguments generated at runtime
+  template <class ArgTuple>
+  static void execute_registered_benchmark_template(const std::string &template_name,
+                                                    const std::string &instance_name,
+                                                    std::shared_ptr<ArgTuple> arg_tuple) {
+    benchmark_registry::global().instantiate(template_name, instance_name,
+                                             (void *)(arg_tuple.get()), arg_tuple);
+  }
+
+  // Same as above, but the arguments are only created by `factory` when the instance is run
+  template <class ArgTuple>
+  static void
+  execute_registered_benchmark_template_lazily(const std::string &template_name,
+                                               const std::string &instance_name,
+                                               std::shared_ptr<ArgTuple> (*factory)()) {
+    benchmark_registry::global().instantiate(
+        template_name, instance_name, nullptr, nullptr,
+        [factory]() { return std::shared_ptr<void>(factory()); });
+  }
+
+  // One instance per value, named "/8", "/16", "/1K" etc., for benchmarks with one parameter
+  template <class ArgTuple>
+  static void
+  execute_registered_benchmark_template_for_range(const std::string &template_name,
+                                                  const std::vector<long long> &values) {
+    static_assert(std::tuple_size_v<ArgTuple> == 1,
+                  "range invocations require a benchmark with exactly one parameter");
+    using Arg = std::tuple_element_t<0, ArgTuple>;
+    for (const auto value : values) {
+      execute_registered_benchmark_template(
+          template_name, range_instance_name(value),
+          std::make_shared<ArgTuple>(static_cast<Arg>(value)));
+    }
+  }
+
+  // One instance per point in the Cartesian product of `args` - one criterion::axis per benchmark
+  // parameter, optionally followed by a criterion::where or criterion::matching filter
+  template <class ArgTuple, class... Args>
+  static void execute_registered_benchmark_template_for_grid(const std::string &template_name,
+                                                             const Args &...args) {
+    constexpr auto num_axes = std::tuple_size_v<ArgTuple>;
+    static_assert(sizeof...(Args) == num_axes || sizeof...(Args) == num_axes + 1,
+                  "grid invocations require one axis per benchmark parameter, optionally "
+                  "followed by a filter");
+
+    const auto arguments = std::forward_as_tuple(args...);
+    const auto register_instance = [&](const std::string &instance_name, ArgTuple &&arg_tuple) {
+      execute_registered_benchmark_template(template_name, instance_name,
+                                            std::make_shared<ArgTuple>(std::move(arg_tuple)));
+    };
+
+    if constexpr (sizeof...(Args) == num_axes) {
+      for_each_grid_point<ArgTuple>(arguments, nullptr, register_instance,
+                                    std::make_index_sequence<num_axes>{});
+    } else {
+      for_each_grid_point<ArgTuple>(arguments, std::get<num_axes>(arguments), register_instance,
+                                    std::make_index_sequence<num_axes>{});
     }
   }
 };
@@ -283,6 +407,55 @@ struct benchmark_template_registration_helper_struct {
   } CONCAT(TemplateName, CONCAT(_instantiation_struct_instance_, __LINE__));                       \
   }
 
+// Run a benchmark for first, first * Multiplier, first * Multiplier^2, ... up to and including Last
+#define INVOKE_BENCHMARK_RANGE(TemplateName, First, Last, Multiplier)                              \
+                                                                                                   \
+  namespace /* ensure internal linkage for struct */                                               \
+  {                                                                                                \
+  /* helper struct for static registration in ctor */                                              \
+  struct CONCAT(TemplateName, CONCAT(_range_struct_, __LINE__)) {                                  \
+    CONCAT(TemplateName, CONCAT(_range_struct_, __LINE__))() { /* called once before main */       \
+      criterion::benchmark_template_registration_helper_struct::                                   \
+          execute_registered_benchmark_template_for_range<CONCAT(TemplateName,                     \
+                                                                 BenchmarkParameters)>(            \
+              #TemplateName, criterion::geometric_range(First, Last, Multiplier));                 \
+    }                                                                                              \
+  } CONCAT(TemplateName, CONCAT(_range_struct_instance_, __LINE__));                               \
+  }
+
+// Run a benchmark for first, first + Step, first + 2 * Step, ... up to and including Last
+#define INVOKE_BENCHMARK_DENSE_RANGE(TemplateName, First, Last, Step)                              \
+                                                                                                   \
+  namespace /* ensure internal linkage for struct */                                               \
+  {                                                                                                \
+  /* helper struct for static registration in ctor */                                              \
+  struct CONCAT(TemplateName, CONCAT(_dense_range_struct_, __LINE__)) {                            \
+    CONCAT(TemplateName, CONCAT(_dense_range_struct_, __LINE__))() { /* called once before main */ \
+      criterion::benchmark_template_registration_helper_struct::                                   \
+          execute_registered_benchmark_template_for_range<CONCAT(TemplateName,                     \
+                                                                 BenchmarkParameters)>(            \
+              #TemplateName, criterion::linear_range(First, Last, Step));                          \
+    }                                                                                              \
+  } CONCAT(TemplateName, CONCAT(_dense_range_struct_instance_, __LINE__));                         \
+  }
+
+// Run a benchmark for every combination of parameter values, e.g.,
+// INVOKE_BENCHMARK_GRID(ToString, criterion::axis("fn", ...), criterion::axis("size", 10, 1000))
+#define INVOKE_BENCHMARK_GRID(TemplateName, ...)                                                   \
+                                                                                                   \
+  namespace /* ensure internal linkage for struct */                                               \
+  {                                                                                                \
+  /* helper struct for static registration in ctor */                                              \
+  struct CONCAT(TemplateName, CONCAT(_grid_struct_, __LINE__)) {                                   \
+    CONCAT(TemplateName, CONCAT(_grid_struct_, __LINE__))() { /* called once before main */        \
+      criterion::benchmark_template_registration_helper_struct::                                   \
+          execute_registered_benchmark_template_for_grid<CONCAT(TemplateName,                      \
+                                                                BenchmarkParameters)>(             \
+              #TemplateName, __VA_ARGS__);                                                         \
+    }                                                                                              \
+  } CONCAT(TemplateName, CONCAT(_grid_struct_instance_, __LINE__));                                \
+  }
+
 #define GET_FIRST(first, ...) first
 #define GET_REST(first, ...) __VA_ARGS__
 
@@ -306,6 +479,72 @@ struct benchmark_template_registration_helper_struct {
   } CONCAT(TemplateName, CONCAT(CONCAT(_instantiation_struct_instance_, __LINE__), Index));        \
   }
 
+// Measurement settings for every instance of a benchmark, as criterion::benchmark_options fields,
+// e.g., BENCHMARK_OPTIONS(MergeSort, .warmup_runs = 1, .max_time = std::chrono::seconds(5))
+#define BENCHMARK_OPTIONS(TemplateName, ...)                                                       \
+                                                                                                   \
+  namespace /* ensure internal linkage for struct */                                               \
+  {                                                                                                \
+  /* helper struct for static registration in ctor */                                              \
+  struct CONCAT(TemplateName, CONCAT(_options_struct_, __LINE__)) {                                \
+    CONCAT(TemplateName, CONCAT(_options_struct_, __LINE__))() { /* called once before main */     \
+      criterion::benchmark_registry::global().set_template_options(                                \
+          #TemplateName, criterion::benchmark_options{__VA_ARGS__});                               \
+    }                                                                                              \
+  } CONCAT(TemplateName, CONCAT(_options_struct_instance_, __LINE__));                             \
+  }
+
+// Same as BENCHMARK_OPTIONS, but only for one instance, overriding the options of the benchmark,
+// e.g., BENCHMARK_INSTANCE_OPTIONS(MergeSort, "/10M", .samples = 3, .batch_size = 1)
+#define BENCHMARK_INSTANCE_OPTIONS(TemplateName, InstanceName, ...)                                \
+                                                                                                   \
+  namespace /* ensure internal linkage for struct */                                               \
+  {                                                                                                \
+  /* helper struct for static registration in ctor */                                              \
+  struct CONCAT(TemplateName, CONCAT(_instance_options_struct_, __LINE__)) {                       \
+    CONCAT(TemplateName, CONCAT(_instance_options_struct_, __LINE__))() {                          \
+      criterion::benchmark_registry::global().set_instance_options(                                \
+          #TemplateName, InstanceName, criterion::benchmark_options{__VA_ARGS__});                 \
+    }                                                                                              \
+  } CONCAT(TemplateName, CONCAT(_instance_options_struct_instance_, __LINE__));                    \
+  }
+
+// Same as INVOKE_BENCHMARK, but the arguments are only evaluated when the instance is run, and
+// released as soon as it completes, e.g., INVOKE_LAZY_BENCHMARK(Lookup, "/1G", MakeTable(1 << 30))
+#define INVOKE_LAZY_BENCHMARK(TemplateName, InstanceName, ...)                                     \
+                                                                                                   \
+  namespace /* ensure internal linkage for struct */                                               \
+  {                                                                                                \
+  /* helper struct for static registration in ctor */                                              \
+  struct CONCAT(TemplateName, CONCAT(_lazy_instantiation_struct_, __LINE__)) {                     \
+    CONCAT(TemplateName, CONCAT(_lazy_instantiation_struct_, __LINE__))                            \
+    () { /* called once before main */                                                             \
+      using ArgTuple = CONCAT(TemplateName, BenchmarkParameters);                                  \
+      criterion::benchmark_template_registration_helper_struct::                                   \
+          execute_registered_benchmark_template_lazily<ArgTuple>(                                  \
+              #TemplateName, InstanceName,                                                         \
+              []() { return std::make_shared<ArgTuple>(ArgTuple{__VA_ARGS__}); });                 \
+    }                                                                                              \
+  } CONCAT(TemplateName, CONCAT(_lazy_instantiation_struct_instance_, __LINE__));                  \
+  }
+
+#define INVOKE_LAZY_BENCHMARK_N(TemplateName, Index, PackedArgument)                               \
+                                                                                                   \
+  namespace /* ensure internal linkage for struct */                                               \
+  {                                                                                                \
+  /* helper struct for static registration in ctor */                                              \
+  struct CONCAT(TemplateName, CONCAT(CONCAT(_lazy_instantiation_struct_, __LINE__), Index)) {      \
+    CONCAT(TemplateName, CONCAT(CONCAT(_lazy_instantiation_struct_, __LINE__),                     \
+                                Index)()) { /* called once before main */                          \
+      using ArgTuple = CONCAT(TemplateName, BenchmarkParameters);                                  \
+      criterion::benchmark_template_registration_helper_struct::                                   \
+          execute_registered_benchmark_template_lazily<ArgTuple>(                                  \
+              #TemplateName, GET_FIRST(PackedArgument),                                            \
+              []() { return std::make_shared<ArgTuple>(ArgTuple{GET_REST(PackedArgument)}); });    \
+    }                                                                                              \
+  } CONCAT(TemplateName, CONCAT(CONCAT(_lazy_instantiation_struct_instance_, __LINE__), Index));   \
+  }
+
 #define _Args(...) __VA_ARGS__
 #define STRIP_PARENS(X) X
 #define PASS_PARAMETERS(X) STRIP_PARENS(_Args X)
@@ -590,4 +829,10 @@ struct benchmark_template_registration_helper_struct {
 #define INVOKE_BENCHMARK_FOR_EACH(TemplateName, ...)                                               \
   FOR_EACH(INVOKE_BENCHMARK_FOR_EACH_HELPER, TemplateName, __VA_ARGS__)
 
-  
\ No newline at end of file
+#define INVOKE_LAZY_BENCHMARK_FOR_EACH_HELPER(Index, TemplateName, ...)                            \
+  INVOKE_LAZY_BENCHMARK_N(TemplateName, Index, PASS_PARAMETERS(__VA_ARGS__))
+
+// Same as INVOKE_BENCHMARK_FOR_EACH, but each argument list is only evaluated when its instance is
+// run, and released as soon as it completes
+#define INVOKE_LAZY_BENCHMARK_FOR_EACH(TemplateName, ...)                                          \
+  FOR_EACH(INVOKE_LAZY_BENCHMARK_FOR_EACH_HELPER, TemplateName, __VA_ARGS__)
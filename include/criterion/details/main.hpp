@@ -1,13 +1,24 @@
 #pragma once
+#include <criterion/details/analysis.hpp>
 #include <criterion/details/asciidoc_writer.hpp>
+#include <criterion/details/baseline.hpp>
 #include <criterion/details/csv_writer.hpp>
+#include <criterion/details/gbench_json.hpp>
 #include <criterion/details/help.hpp>
+#include <criterion/details/html_writer.hpp>
 #include <criterion/details/indicators.hpp>
 #include <criterion/details/json_writer.hpp>
+#include <criterion/details/junit_writer.hpp>
 #include <criterion/details/macros.hpp>
 #include <criterion/details/md_writer.hpp>
+#include <criterion/details/merge.hpp>
+#include <criterion/details/openmetrics_writer.hpp>
 #include <criterion/details/structopt.hpp>
+#include <criterion/details/thresholds.hpp>
+#include <cstdlib>
 #include <cstring>
+#include <exception>
+#include <new>
 
 static inline void signal_handler(int signal) {
   indicators::show_console_cursor(true);
@@ -20,7 +31,17 @@ namespace criterion {
 struct options {
 
   struct export_options : structopt::sub_command {
-    enum class format_type { csv, json, md, asciidoc };
+    enum class format_type {
+      csv,
+      json,
+      jsonl,
+      md,
+      asciidoc,
+      html,
+      gbench_json,
+      junit,
+      openmetrics
+    };
 
     // Export format
     format_type format;
@@ -48,9 +69,69 @@ struct options {
   // Run benchmarks quietly
   std::optional<bool> quiet = false;
 
+  // --antagonist membw:2,llc-thrash:1,cpu-spin:2,smt-sibling
+  std::optional<std::string> antagonist;
+
+  // --time_budget 15m
+  std::optional<std::string> time_budget;
+
+  // Save samples as a named baseline, e.g., --save_baseline main
+  std::optional<std::string> save_baseline;
+
+  // Compare against a named baseline, e.g., --baseline main
+  std::optional<std::string> baseline;
+
+  // Changes smaller than this percentage are reported as "No change" (default=2)
+  std::optional<double> noise_threshold;
+
   // Prints help
   std::optional<bool> help = false;
 
+  // Append results to a JSON Lines history file, e.g., --history results.jsonl
+  std::optional<std::string> history;
+
+  // Revision label for the results appended to the history, e.g., --revision $(git rev-parse HEAD)
+  std::optional<std::string> revision;
+
+  // Report change points in the history instead of running benchmarks
+  std::optional<bool> history_report = false;
+
+  // Stream every measured iteration to a binary file, e.g., --export_samples samples.cbin
+  std::optional<std::string> export_samples;
+
+  // Recompute results from stored samples instead of running benchmarks, e.g.,
+  // --analyze samples.cbin or --analyze .criterion/baselines/main.baseline
+  std::optional<std::string> analyze;
+
+  // Estimator used by --analyze: mean, median or lowest_rsd (default=mean)
+  std::optional<std::string> estimator;
+
+  // Confidence level of intervals and significance tests, in percent (default=95)
+  std::optional<double> confidence;
+
+  // Outliers left out by --analyze: keep, severe or mild (default=keep)
+  std::optional<std::string> outliers;
+
+  // Export to several files at once, e.g., --reporters csv:result.csv,json:result.json
+  std::optional<std::string> reporters;
+
+  // Limits that benchmarks must stay within, e.g., --thresholds thresholds.txt
+  std::optional<std::string> thresholds;
+
+  // Write a timeline of the run in the Chrome trace event format, e.g., --trace trace.json
+  std::optional<std::string> trace;
+
+  // Rank the instances of each benchmark template relative to a reference, e.g., --compare first,
+  // --compare fastest or --compare make_shared
+  std::optional<std::string> compare;
+
+  // Only list and run one part of the benchmarks, e.g., --shard 2/4 for the second of four
+  std::optional<std::string> shard;
+
+  // Combine the results of several runs, e.g., of shards, instead of running benchmarks, e.g.,
+  // --merge shard1.json shard2.json
+  std::optional<std::vector<std::string>> merge;
+
   // Remaining arguments
   std::vector<std::string> remaining;
 };
@@ -59,7 +140,432 @@ struct options {
 
 STRUCTOPT(criterion::options::export_options, format, filename);
 STRUCTOPT(criterion::options, warmup, list, list_filtered, run_filtered, export_results, quiet,
-          help, remaining);
+          antagonist, time_budget, save_baseline, baseline, noise_threshold, help, history,
+          revision, history_report, export_samples, analyze, estimator, confidence,
+          outliers, reporters, thresholds, trace, compare, shard, merge, remaining);
+
+// Reporter that exports results in `format` (csv, json, jsonl, md, asciidoc, html, gbench-json,
+// junit or openmetrics) to `filename`. CSV and JSON Lines are appended to as benchmarks complete;
+// the other formats are rewritten after every benchmark, except HTML whose charts are only drawn
+// at the end of the run and JUnit whose test cases need the threshold `checks` made after the run
+static inline std::shared_ptr<criterion::reporter>
+make_criterion_reporter(const std::string &format, const std::string &filename,
+                        const criterion::baseline *baseline,
+                        const std::vector<criterion::threshold_check> *checks) {
+  if (format == "csv") {
+    return std::make_shared<criterion::csv_reporter>(filename);
+  } else if (format == "jsonl") {
+    return std::make_shared<criterion::jsonl_reporter>(filename);
+  } else if (format == "json") {
+    return std::make_shared<criterion::snapshot_reporter>(filename, [](const std::string &path) {
+      return criterion::json_writer::write_results(path, criterion::benchmark::results);
+    });
+  } else if (format == "md") {
+    return std::make_shared<criterion::snapshot_reporter>(filename, [](const std::string &path) {
+      return criterion::md_writer::write_results(path, criterion::benchmark::results);
+    });
+  } else if (format == "asciidoc") {
+    return std::make_shared<criterion::snapshot_reporter>(filename, [](const std::string &path) {
+      return criterion::asciidoc_writer::write_results(path, criterion::benchmark::results);
+    });
+  } else if (format == "gbench-json" || format == "gbench_json") {
+    return std::make_shared<criterion::snapshot_reporter>(filename, [](const std::string &path) {
+      return criterion::gbench_json::write_results(path, criterion::benchmark::results);
+    });
+  } else if (format == "openmetrics") {
+    return std::make_shared<criterion::snapshot_reporter>(filename, [](const std::string &path) {
+      return criterion::openmetrics_writer::write_results(path, criterion::benchmark::results);
+    });
+  } else if (format == "html") {
+    return std::make_shared<criterion::snapshot_reporter>(
+        filename,
+        [baseline](const std::string &path) {
+          return criterion::html_writer::write_results(path, criterion::benchmark::results,
+                                                       baseline);
+        },
+        false);
+  } else if (format == "junit") {
+    return std::make_shared<criterion::snapshot_reporter>(
+        filename,
+        [checks](const std::string &path) {
+          return criterion::junit_writer::write_results(path, criterion::benchmark::results,
+                                                        *checks);
+        },
+        false);
+  }
+  return nullptr;
+}
+
+// The arguments with every short form in criterion_short_options, e.g., -e, replaced by its long
+// form, e.g., --export_results, so it cannot be parsed as another option with the same initial.
+// The gbench-json export format is passed on as gbench_json, the name of its enum value
+static inline std::vector<std::string> expand_criterion_short_options(int argc, char *argv[]) {
+  std::vector<std::string> arguments(argv, argv + argc);
+  for (std::size_t i = 1; i < arguments.size(); ++i) {
+    auto &argument = arguments[i];
+    if (argument == "--")
+      break;
+    if (argument.size() == 2 && argument[0] == '-') {
+      for (const auto &[short_name, long_name] : criterion_short_options) {
+        if (argument[1] == short_name) {
+          argument = "--" + long_name;
+          break;
+        }
+      }
+    }
+    if (argument == "--export_results" && i + 1 < arguments.size() &&
+        arguments[i + 1] == "gbench-json") {
+      arguments[i + 1] = "gbench_json";
+    }
+  }
+  return arguments;
+}
+
+// Prints "Error: <message>" and exits with status 1, e.g.,
+// criterion_error("Invalid shard \"", value, "\"")
+template <class... Message>
+[[noreturn]] static inline void criterion_error(const Message &...message) {
+  std::cout << termcolor::bold << termcolor::red << "Error: ";
+  (std::cout << ... << message);
+  std::cout << termcolor::reset << "\n";
+  exit(1);
+}
+
+// Prints "Warning: <message>" and carries on
+template <class... Message> static inline void criterion_warning(const Message &...message) {
+  std::cout << termcolor::bold << termcolor::yellow << "Warning: ";
+  (std::cout << ... << message);
+  std::cout << termcolor::reset << "\n";
+}
+
+// Handles the options that do something other than run benchmarks, e.g., --help or --list, and
+// exits if one of them is set. --list and --list_filtered only show the benchmarks of --shard
+static inline void run_criterion_commands(const criterion::options &options,
+                                          const char *program_name) {
+  if (options.shard.has_value()) {
+    const auto shard = criterion::benchmark_shard::parse(options.shard.value());
+    if (!shard.has_value())
+      criterion_error("Invalid shard \"", options.shard.value(),
+                      "\" (use i/N with 1 <= i <= N, e.g., 2/4)");
+    criterion::benchmark_registration_helper_struct::shard = shard.value();
+  }
+
+  if (options.help.value() == true) {
+    print_criterion_help(program_name);
+    exit(0);
+  } else if (options.list.value() == true) {
+    criterion::benchmark_registration_helper_struct::list_registered_benchmarks();
+    exit(0);
+  } else if (options.list_filtered.has_value()) {
+    criterion::benchmark_registration_helper_struct::list_filtered_registered_benchmarks(
+        options.list_filtered.value());
+    exit(0);
+  } else if (options.history_report.value() == true) {
+    if (!options.history.has_value())
+      criterion_error("--history_report requires --history <filename>");
+    const auto records = criterion::history::load(options.history.value());
+    if (!records.has_value())
+      criterion_error("Failed to read history from ", options.history.value());
+    for (const auto &series : criterion::history::analyze(records.value())) {
+      if (options.quiet.value() == false || !series.change_points.empty()) {
+        criterion::console_writer::write_history(series);
+      }
+    }
+    exit(0);
+  } else if (!options.remaining.empty()) {
+    criterion_error("Unrecognized argument \"", options.remaining[0], "\"");
+  }
+}
+
+// Applies the options that change how benchmarks are selected and measured
+static inline void apply_criterion_measurement_options(const criterion::options &options) {
+  if (options.warmup.has_value()) {
+    const auto warmup = options.warmup.value();
+    if (warmup > 0) {
+      criterion::benchmark::warmup_runs = options.warmup.value();
+    } else {
+      criterion::benchmark::warmup_runs = 1;
+    }
+  }
+
+  if (options.quiet.value() == true) {
+    criterion::benchmark::show_console_output = false;
+  }
+
+  if (options.antagonist.has_value()) {
+    const auto profile = criterion::interference_profile::parse(options.antagonist.value());
+    if (!profile.has_value())
+      criterion_error("Invalid antagonist list \"", options.antagonist.value(),
+                      "\" (use membw:N, llc-thrash:N, cpu-spin:N or smt-sibling, with N <= ",
+                      criterion::interference_profile::max_threads, ")");
+    criterion::benchmark::interference = profile.value();
+  }
+
+  if (options.time_budget.has_value()) {
+    const auto budget = criterion::parse_duration(options.time_budget.value());
+    if (!budget.has_value())
+      criterion_error("Invalid time budget \"", options.time_budget.value(), "\"");
+    criterion::benchmark::time_budget = budget.value();
+  }
+}
+
+// The baseline to compare against, from --baseline: a saved baseline, or the output of a Google
+// Benchmark binary if it ends in .json. Also checks the name given to --save_baseline
+static inline std::optional<criterion::baseline>
+load_criterion_baseline(const criterion::options &options) {
+  const auto gbench_baseline = options.baseline.has_value() && options.baseline->size() > 5 &&
+                               options.baseline->substr(options.baseline->size() - 5) == ".json";
+
+  for (const auto &baseline_name :
+       {options.save_baseline, gbench_baseline ? std::nullopt : options.baseline}) {
+    if (baseline_name.has_value() && !criterion::baseline::valid_name(baseline_name.value()))
+      criterion_error("Invalid baseline name \"", baseline_name.value(),
+                      "\" (use letters, digits, '_', '.' and '-')");
+  }
+
+  std::optional<criterion::baseline> baseline;
+  if (gbench_baseline) {
+    const auto &filename = options.baseline.value();
+    baseline = criterion::gbench_json::read_baseline(
+        filename, std::filesystem::path(filename).stem().string());
+    if (!baseline.has_value())
+      criterion_error("Failed to read Google Benchmark results from ", filename);
+  } else if (options.baseline.has_value()) {
+    baseline = criterion::baseline::load(options.baseline.value());
+    if (!baseline.has_value())
+      criterion_error("Failed to load baseline \"", options.baseline.value(), "\" from ",
+                      criterion::baseline::path(options.baseline.value()));
+  }
+  return baseline;
+}
+
+// Options of --analyze and --merge, with intervals at `confidence` percent
+static inline criterion::analysis_options
+make_criterion_analysis_options(const criterion::options &options, double confidence) {
+  criterion::analysis_options analysis_options;
+  analysis_options.confidence_level = confidence / 100;
+  if (options.estimator.has_value()) {
+    const auto method = criterion::analysis::parse_estimator(options.estimator.value());
+    if (!method.has_value())
+      criterion_error("Invalid estimator \"", options.estimator.value(),
+                      "\" (use mean, median or lowest_rsd)");
+    analysis_options.method = method.value();
+  }
+  if (options.outliers.has_value()) {
+    const auto policy = criterion::analysis::parse_outlier_policy(options.outliers.value());
+    if (!policy.has_value())
+      criterion_error("Invalid outlier policy \"", options.outliers.value(),
+                      "\" (use keep, severe or mild)");
+    analysis_options.outliers = policy.value();
+  }
+  return analysis_options;
+}
+
+static inline std::optional<criterion::thresholds>
+load_criterion_thresholds(const criterion::options &options) {
+  if (!options.thresholds.has_value())
+    return std::nullopt;
+  auto thresholds = criterion::thresholds::load(options.thresholds.value());
+  if (!thresholds.has_value())
+    criterion_error("Failed to read thresholds from ", options.thresholds.value(),
+                    " (use one \"<regex> <metric> <limit>\" per line)");
+  if (thresholds->uses(criterion::threshold_metric::max_allocations) &&
+      !criterion::allocation_counter::enabled) {
+    criterion_warning("max_allocations is not checked, since allocations are only counted if "
+                      "CRITERION_COUNT_ALLOCATIONS is defined");
+  }
+  return thresholds;
+}
+
+// Starts a reporter for --export_results and for each entry of --reporters, which receive each
+// result as soon as its benchmark completes, so a crash or timeout keeps the results so far
+static inline void add_criterion_reporters(const criterion::options &options,
+                                           const criterion::baseline *baseline,
+                                           const std::vector<criterion::threshold_check> *checks) {
+  std::vector<std::pair<std::string, std::string>> reports; // (format, filename)
+  if (options.export_results.has_value()) {
+    using format_type = criterion::options::export_options::format_type;
+    const auto &export_options = options.export_results.value();
+    const std::unordered_map<format_type, std::string> formats{
+        {format_type::csv, "csv"},
+        {format_type::json, "json"},
+        {format_type::jsonl, "jsonl"},
+        {format_type::md, "md"},
+        {format_type::asciidoc, "asciidoc"},
+        {format_type::html, "html"},
+        {format_type::gbench_json, "gbench-json"},
+        {format_type::junit, "junit"},
+        {format_type::openmetrics, "openmetrics"}};
+    reports.push_back({formats.at(export_options.format), export_options.filename});
+  }
+  if (options.reporters.has_value()) {
+    std::stringstream list(options.reporters.value());
+    std::string report;
+    while (std::getline(list, report, ',')) {
+      const auto separator = report.find(':');
+      if (separator == std::string::npos || separator + 1 == report.size())
+        criterion_error("Invalid reporter \"", report, "\" (use format:filename)");
+      reports.push_back({report.substr(0, separator), report.substr(separator + 1)});
+    }
+  }
+  for (const auto &[format, filename] : reports) {
+    auto reporter = make_criterion_reporter(format, filename, baseline, checks);
+    if (!reporter)
+      criterion_error("Unknown export format \"", format,
+                      "\" (use csv, json, jsonl, md, asciidoc, html, gbench-json, junit or "
+                      "openmetrics)");
+    reporter->on_run_start();
+    if (!reporter->good())
+      criterion_error("Failed to open ", filename);
+    criterion::benchmark::reporters.push_back(std::move(reporter));
+  }
+}
+
+// Adds a result that was not measured in this run, e.g., from --merge or --analyze
+static inline void add_criterion_result(const criterion::benchmark_result &result) {
+  criterion::benchmark::benchmark_execution_order.push_back(result.name);
+  criterion::benchmark::results.insert_or_assign(result.name, result);
+  for (const auto &reporter : criterion::benchmark::reporters) {
+    reporter->on_benchmark_complete(result);
+  }
+}
+
+// --merge: combines the results, samples or baselines of earlier runs, e.g., of shards
+static inline void merge_criterion_results(const criterion::options &options,
+                                           const criterion::analysis_options &analysis_options) {
+  criterion::result_merge merged;
+  for (const auto &filename : options.merge.value()) {
+    if (!merged.add(filename, analysis_options))
+      criterion_error("Failed to read results, samples or a baseline from ", filename);
+  }
+  for (const auto &[name, filename] : merged.duplicates) {
+    criterion_warning(name, " is in more than one input; using ", filename);
+  }
+  const auto summarized =
+      std::any_of(merged.benchmarks.begin(), merged.benchmarks.end(),
+                  [](const criterion::result_merge::entry &e) { return !e.estimate; });
+  if (summarized &&
+      (options.baseline || options.save_baseline || options.thresholds || options.compare)) {
+    criterion_warning("JSON and JSON Lines exports have no samples, so their results are "
+                      "compared by their mean alone; merge --export_samples files instead");
+  }
+  std::vector<std::string> registration_order;
+  for (const auto &instance : criterion::benchmark_registry::global().instances()) {
+    registration_order.emplace_back(instance.name);
+  }
+  merged.sort(registration_order);
+  for (const auto &[result, estimate, source] : merged.benchmarks) {
+    add_criterion_result(result);
+    if (criterion::benchmark::show_console_output) {
+      if (estimate.has_value()) {
+        criterion::console_writer::write_analysis(result, estimate.value());
+      } else {
+        criterion::console_writer::write_result(result);
+      }
+    }
+  }
+}
+
+// --analyze: recomputes results from stored samples or a baseline
+static inline void analyze_criterion_samples(const criterion::options &options,
+                                             const criterion::analysis_options &analysis_options) {
+  const auto &filename = options.analyze.value();
+  if (analysis_options.method == criterion::estimator::lowest_rsd &&
+      !criterion::analysis::is_sample_file(filename))
+    criterion_error("--estimator lowest_rsd requires samples written by --export_samples");
+  const auto analysis = criterion::analysis::load(filename, analysis_options);
+  if (!analysis.has_value())
+    criterion_error("Failed to read samples or a baseline from ", filename);
+  for (const auto &[result, estimate] : analysis->benchmarks) {
+    add_criterion_result(result);
+    if (criterion::benchmark::show_console_output) {
+      criterion::console_writer::write_analysis(result, estimate);
+    }
+  }
+}
+
+// Fits benchmark families registered with BENCHMARK_COMPLEXITY. Returns true if a fit grows
+// faster than expected
+static inline bool report_criterion_complexity() {
+  bool failed = false;
+  for (const auto &family :
+       criterion::complexity_registration_helper_struct::registered_families()) {
+    for (const auto &curve : family.curves) {
+      const auto fit = curve.best_fit();
+      if (!fit.has_value())
+        continue;
+      if (criterion::benchmark::show_console_output || family.failed(curve)) {
+        criterion::console_writer::write_complexity(family, curve, fit.value());
+      }
+      failed = failed || family.failed(curve);
+    }
+  }
+  return failed;
+}
+
+// --compare: ranks the instances of each benchmark template relative to a reference instance
+static inline void report_criterion_family_comparisons(const std::string &reference,
+                                                       double confidence) {
+  const auto comparisons = criterion::family_comparison::compare(
+      criterion::benchmark::benchmark_execution_order, criterion::benchmark::results, reference,
+      confidence / 100, criterion::benchmark_registry::global().template_names());
+  if (comparisons.empty()) {
+    criterion_warning("No benchmark has a reference instance \"", reference,
+                      "\" and other instances to compare it with");
+  }
+  for (const auto &comparison : comparisons) {
+    criterion::console_writer::write_family_comparison(comparison);
+  }
+}
+
+// Compares the results with `baseline`, by benchmark name. Sets `regressed` if any benchmark
+// got significantly slower
+static inline std::unordered_map<std::string, criterion::baseline_comparison>
+report_criterion_baseline_comparisons(const criterion::baseline &baseline, double noise_threshold,
+                                      double confidence, bool &regressed) {
+  std::unordered_map<std::string, criterion::baseline_comparison> comparisons;
+  for (const auto &comparison : baseline.compare(criterion::benchmark::results,
+                                                 noise_threshold / 100, 1 - confidence / 100)) {
+    const auto this_regressed = comparison.verdict == criterion::baseline_verdict::regressed;
+    if (criterion::benchmark::show_console_output || this_regressed) {
+      criterion::console_writer::write_baseline_comparison(comparison);
+    }
+    regressed = regressed || this_regressed;
+    comparisons.insert_or_assign(comparison.name, comparison);
+  }
+  return comparisons;
+}
+
+// Checks the results against --thresholds. Returns true if any check failed
+static inline bool report_criterion_threshold_checks(
+    const criterion::thresholds &thresholds,
+    const std::unordered_map<std::string, criterion::baseline_comparison> &comparisons,
+    double confidence, std::vector<criterion::threshold_check> &checks) {
+  bool failed = false;
+  checks = thresholds.evaluate(criterion::benchmark::benchmark_execution_order,
+                               criterion::benchmark::results, comparisons, confidence / 100);
+  for (const auto &check : checks) {
+    if (criterion::benchmark::show_console_output || !check.passed) {
+      criterion::console_writer::write_threshold_check(check);
+    }
+    failed = failed || !check.passed;
+  }
+  return failed;
+}
+
+// --save_baseline and --history
+static inline void save_criterion_results(const criterion::options &options) {
+  if (options.save_baseline.has_value() &&
+      !criterion::baseline::save(options.save_baseline.value(), criterion::benchmark::results))
+    criterion_error("Failed to save baseline to ",
+                    criterion::baseline::path(options.save_baseline.value()));
+
+  if (options.history.has_value() &&
+      !criterion::history::append(options.history.value(), options.revision.value_or("unknown"),
+                                  criterion::benchmark::benchmark_execution_order,
+                                  criterion::benchmark::results))
+    criterion_error("Failed to append results to ", options.history.value());
+}
 
 static inline int criterion_main(int argc, char *argv[]) {
   const auto program_name = argv[0];
@@ -72,79 +578,160 @@ static inline int criterion_main(int argc, char *argv[]) {
   std::signal(SIGFPE, signal_handler);
 
   try {
-    auto options = structopt::app(program_name).parse<criterion::options>(argc, argv);
-
-    if (options.help.value() == true) {
-      print_criterion_help(program_name);
-      exit(0);
-    } else if (options.list.value() == true) {
-      criterion::benchmark_registration_helper_struct::list_registered_benchmarks();
-      exit(0);
-    } else if (options.list_filtered.has_value()) {
-      criterion::benchmark_registration_helper_struct::list_filtered_registered_benchmarks(
-          options.list_filtered.value());
-      exit(0);
-    } else if (!options.remaining.empty()) {
-      std::cout << termcolor::bold << termcolor::red;
-      std::cout << "Error: Unrecognized argument \"";
-      std::cout << options.remaining[0];
-      std::cout << "\"" << termcolor::reset << "\n";
-      exit(1);
-    }
-
-    if (options.warmup.has_value()) {
-      const auto warmup = options.warmup.value();
-      if (warmup > 0) {
-        criterion::benchmark::warmup_runs = options.warmup.value();
-      } else {
-        criterion::benchmark::warmup_runs = 1;
-      }
+    auto options = structopt::app(program_name)
+                       .parse<criterion::options>(expand_criterion_short_options(argc, argv));
+    criterion::gbench_json::executable = program_name;
+    criterion::openmetrics_writer::revision = options.revision.value_or("unknown");
+
+    run_criterion_commands(options, program_name);
+    apply_criterion_measurement_options(options);
+
+    const auto baseline = load_criterion_baseline(options);
+
+    const auto noise_threshold = options.noise_threshold.value_or(2.0);
+    if (noise_threshold < 0)
+      criterion_error("Invalid noise threshold \"", noise_threshold, "\"");
+
+    const auto confidence = options.confidence.value_or(95.0);
+    if (!(confidence > 0 && confidence < 100))
+      criterion_error("Invalid confidence level \"", confidence,
+                      "\" (use a percentage between 0 and 100)");
+
+    const auto analysis_options = make_criterion_analysis_options(options, confidence);
+
+    criterion::sample_writer sample_export;
+    if (options.export_samples.has_value()) {
+      if (!sample_export.open(options.export_samples.value()))
+        criterion_error("Failed to open ", options.export_samples.value());
+      criterion::benchmark::sample_export = &sample_export;
     }
 
-    if (options.quiet.value() == true) {
-      criterion::benchmark::show_console_output = false;
+    criterion::trace_writer trace;
+    if (options.trace.has_value()) {
+      if (!trace.open(options.trace.value(), program_name))
+        criterion_error("Failed to open ", options.trace.value());
+      criterion::benchmark::trace = &trace;
     }
 
-    // Run benchmarks
-    if (options.run_filtered.has_value()) { // Run filtered
+    const auto thresholds = load_criterion_thresholds(options);
+    std::vector<criterion::threshold_check> threshold_checks; // made after the run
+
+    add_criterion_reporters(options, baseline.has_value() ? &baseline.value() : nullptr,
+                            &threshold_checks);
+
+    // Run benchmarks, recompute their results from stored samples, or merge earlier results
+    if (options.merge.has_value()) {
+      merge_criterion_results(options, analysis_options);
+    } else if (options.analyze.has_value()) {
+      analyze_criterion_samples(options, analysis_options);
+    } else if (options.run_filtered.has_value()) { // Run filtered
       criterion::benchmark_registration_helper_struct::execute_filtered_registered_benchmarks(
           options.run_filtered.value());
     } else {
       criterion::benchmark_registration_helper_struct::execute_registered_benchmarks();
     }
 
-    if (options.export_results.has_value()) {
-      auto export_options = options.export_results.value();
-      if (export_options.format == criterion::options::export_options::format_type::csv) {
-        // CSV export
-        criterion::csv_writer::write_results(export_options.filename,
-                                             criterion::benchmark::results);
-      } else if (export_options.format == criterion::options::export_options::format_type::json) {
-        // JSON export
-        criterion::json_writer::write_results(export_options.filename,
-                                              criterion::benchmark::results);
-      } else if (export_options.format == criterion::options::export_options::format_type::md) {
-        // Markdown export
-        criterion::md_writer::write_results(export_options.filename, criterion::benchmark::results);
-      } else if (export_options.format ==
-                 criterion::options::export_options::format_type::asciidoc) {
-        // Markdown export
-        criterion::asciidoc_writer::write_results(export_options.filename,
-                                                  criterion::benchmark::results);
+    if (options.export_samples.has_value()) {
+      criterion::benchmark::sample_export = nullptr;
+      if (!sample_export.close())
+        criterion_error("Failed to write samples to ", options.export_samples.value());
+    }
+
+    // Complexity fits, baseline comparisons and exports, after the last benchmark
+    const auto report_start = std::chrono::steady_clock::now();
+
+    // Report on how the time budget was spent, and which benchmarks it did not cover
+    if (criterion::benchmark::budget_report.has_value()) {
+      const auto &report = criterion::benchmark::budget_report.value();
+      if (criterion::benchmark::show_console_output || !report.under_sampled.empty()) {
+        criterion::console_writer::write_time_budget(report);
       }
     }
 
+    const auto complexity_failed = report_criterion_complexity();
+
+    if (options.compare.has_value()) {
+      report_criterion_family_comparisons(options.compare.value(), confidence);
+    }
+
+    // Compare against the baseline, if any, before it is possibly overwritten below
+    bool regressed = false;
+    std::unordered_map<std::string, criterion::baseline_comparison> comparisons;
+    if (baseline.has_value()) {
+      comparisons = report_criterion_baseline_comparisons(baseline.value(), noise_threshold,
+                                                          confidence, regressed);
+    }
+
+    // Failures are also reported by the junit export, through threshold_checks
+    const auto threshold_failed =
+        thresholds.has_value() && report_criterion_threshold_checks(thresholds.value(), comparisons,
+                                                                    confidence, threshold_checks);
+
+    save_criterion_results(options);
+
+    // Write the complete results, e.g., HTML charts
+    for (const auto &reporter : criterion::benchmark::reporters) {
+      reporter->on_run_end();
+    }
+    for (const auto &reporter : criterion::benchmark::reporters) {
+      if (!reporter->good())
+        criterion_error("Failed to write results to ", reporter->destination());
+    }
+
+    if (options.trace.has_value()) {
+      trace.complete(trace.thread_track("benchmark"), "report", "phase", report_start,
+                     std::chrono::steady_clock::now());
+      criterion::benchmark::trace = nullptr;
+      if (!trace.close())
+        criterion_error("Failed to write trace to ", options.trace.value());
+    }
+
+    if (complexity_failed || regressed || threshold_failed) {
+      return 1;
+    }
+
   } catch (structopt::exception &e) {
     const auto message = e.what();
     if (message && std::strlen(message) > 0)
       std::cout << termcolor::bold << termcolor::red << message << termcolor::reset << "\n";
     print_criterion_help(program_name);
     exit(1);
+  } catch (std::exception &e) {
+    // e.g., a benchmark worker process that exited unexpectedly
+    criterion_error(e.what());
   }
   return 0;
 }
 
+// Counting allocations replaces the global operator new, which may only be done once in a
+// program, so it is opt-in: define CRITERION_COUNT_ALLOCATIONS before including criterion in the
+// file with CRITERION_BENCHMARK_MAIN
+#if defined(CRITERION_COUNT_ALLOCATIONS)
+// not inlined, or GCC sees free() of memory from operator new (-Wmismatched-new-delete)
+#if defined(__GNUC__)
+#define CRITERION_NOINLINE __attribute__((noinline))
+#else
+#define CRITERION_NOINLINE
+#endif
+#define CRITERION_ALLOCATION_COUNTER                                                               \
+  CRITERION_NOINLINE void *operator new(std::size_t size) {                                        \
+    ::criterion::allocation_counter::allocations.fetch_add(1, std::memory_order_relaxed);          \
+    if (void *pointer = std::malloc(size == 0 ? 1 : size))                                         \
+      return pointer;                                                                              \
+    throw std::bad_alloc();                                                                        \
+  }                                                                                                \
+  CRITERION_NOINLINE void operator delete(void *pointer) noexcept { std::free(pointer); }          \
+  CRITERION_NOINLINE void operator delete(void *pointer, std::size_t) noexcept {                   \
+    std::free(pointer);                                                                            \
+  }                                                                                                \
+  [[maybe_unused]] static const bool criterion_allocation_counter_enabled =                        \
+      (::criterion::allocation_counter::enabled = true);
+#else
+#define CRITERION_ALLOCATION_COUNTER
+#endif
+
 #define CRITERION_BENCHMARK_MAIN(...)                                                              \
-  int main(int argc, char *argv[]) { criterion_main(argc, argv); }
+  CRITERION_ALLOCATION_COUNTER                                                                     \
+  int main(int argc, char *argv[]) { return criterion_main(argc, argv); }
 
   
\ No newline at end of file
@@ -0,0 +1,172 @@
+#pragma once
+#include <criterion/details/analysis.hpp>
+#include <criterion/details/benchmark_result.hpp>
+#include <criterion/details/gbench_json.hpp>
+#include <criterion/details/statistics.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace criterion {
+
+// Combines the results of several runs of a suite, e.g., of its shards (see --shard) on different
+// machines, into one set of results. Every input is one of:
+//
+//   a file from --export_samples  every measured iteration, from which results are recomputed
+//   a saved baseline              the mean of each run, from which results are recomputed
+//   a JSON or JSON Lines export   results as they were reported, without their samples
+//
+// A benchmark found in more than one input is taken from the last of them
+class result_merge {
+  // A result from a JSON or JSON Lines export. Exports only summarize the runs, so the mean is
+  // the only sample
+  static std::optional<benchmark_result> from_json(const detail::json_value &object) {
+    using kind = detail::json_value::kind;
+    const auto name = object.find("name");
+    if (!name || name->type != kind::string)
+      return std::nullopt;
+    const auto number = [&object](const std::string &key) -> long double {
+      const auto value = object.find(key);
+      return value && value->type == kind::number ? value->number : 0;
+    };
+
+    benchmark_result result{};
+    result.name = name->string;
+    result.num_warmup_runs = static_cast<std::size_t>(number("warmup_runs"));
+    result.mean_execution_time = number("mean_execution_time");
+    result.fastest_execution_time = number("fastest_execution_time");
+    result.slowest_execution_time = number("slowest_execution_time");
+    result.lowest_rsd_mean = number("lowest_rsd_execution_time");
+    result.lowest_rsd = number("lowest_rsd_percentage");
+    result.lowest_rsd_index = static_cast<std::size_t>(number("lowest_rsd_index"));
+    result.average_iteration_performance = number("average_iteration_performance");
+    result.fastest_iteration_performance = number("fastest_iteration_performance");
+    result.slowest_iteration_performance = number("slowest_iteration_performance");
+    result.samples.push_back(result.mean_execution_time);
+    result.num_runs = std::max(static_cast<std::size_t>(number("runs")), std::size_t{1});
+    result.num_iterations = static_cast<std::size_t>(number("iterations")) / result.num_runs;
+    if (const auto allocations = object.find("allocations_per_iteration");
+        allocations && allocations->type == kind::number) {
+      result.allocations_per_iteration = allocations->number;
+    }
+    if (const auto interference = object.find("interference");
+        interference && interference->type == kind::string) {
+      result.interference = interference->string;
+    }
+    return result;
+  }
+
+  // Results from a JSON export ({"benchmarks": [...]}) or a JSON Lines export (an object per line)
+  static std::optional<std::vector<benchmark_result>> read_json(const std::string &text) {
+    std::vector<detail::json_value> objects;
+    // a JSON Lines export with a single benchmark is also one JSON document, but without
+    // "benchmarks"
+    const auto document = detail::json_parser(text).parse();
+    const auto benchmarks = document.has_value() ? document->find("benchmarks") : nullptr;
+    if (benchmarks) {
+      if (benchmarks->type != detail::json_value::kind::array)
+        return std::nullopt;
+      objects = benchmarks->array;
+    } else {
+      std::istringstream lines(text);
+      std::string line;
+      while (std::getline(lines, line)) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+          continue;
+        auto object = detail::json_parser(line).parse();
+        if (!object.has_value() || object->type != detail::json_value::kind::object)
+          return std::nullopt;
+        objects.push_back(std::move(object.value()));
+      }
+    }
+
+    std::vector<benchmark_result> results;
+    for (const auto &object : objects) {
+      auto result = from_json(object);
+      if (!result.has_value())
+        return std::nullopt;
+      results.push_back(std::move(result.value()));
+    }
+    return results;
+  }
+
+  std::unordered_map<std::string, std::size_t> index_; // name -> position in benchmarks
+
+public:
+  struct entry {
+    benchmark_result result;
+    // set if the result was recomputed from samples, not read from a JSON or JSON Lines export
+    std::optional<sample_estimate> estimate;
+    std::string source; // the input it was taken from
+  };
+
+  std::vector<entry> benchmarks;
+
+  // (benchmark, input) for every benchmark that an input replaced, e.g., because two shards ran it
+  std::vector<std::pair<std::string, std::string>> duplicates;
+
+  // Adds the results in `filename`. Samples are analyzed with `options`, like --analyze does
+  bool add(const std::string &filename, const analysis_options &options) {
+    std::optional<std::vector<benchmark_result>> exported;
+    if (!analysis::is_sample_file(filename)) {
+      std::ifstream is(filename);
+      if (!is.is_open())
+        return false;
+      std::stringstream buffer;
+      buffer << is.rdbuf();
+      exported = read_json(buffer.str());
+    }
+
+    std::vector<entry> added;
+    if (exported.has_value()) {
+      for (const auto &result : exported.value()) {
+        added.push_back({result, std::nullopt, filename});
+      }
+    } else {
+      const auto stored = analysis::load(filename, options);
+      if (!stored.has_value())
+        return false;
+      for (const auto &[result, estimate] : stored->benchmarks) {
+        added.push_back({result, estimate, filename});
+      }
+    }
+
+    for (auto &e : added) {
+      const auto [it, inserted] = index_.insert({e.result.name, benchmarks.size()});
+      if (inserted) {
+        benchmarks.push_back(std::move(e));
+      } else {
+        duplicates.push_back({e.result.name, filename});
+        benchmarks[it->second] = std::move(e);
+      }
+    }
+    return true;
+  }
+
+  // Orders the benchmarks like `order`, e.g., the registration order of this binary, so shards
+  // merge into the order an unsharded run would have. Benchmarks not in `order` come last, in the
+  // order of the inputs
+  void sort(const std::vector<std::string> &order) {
+    std::unordered_map<std::string, std::size_t> position;
+    for (std::size_t i = 0; i < order.size(); ++i) {
+      position.insert({order[i], i});
+    }
+    const auto rank = [&position, &order](const entry &e) {
+      const auto it = position.find(e.result.name);
+      return it == position.end() ? order.size() : it->second;
+    };
+    std::stable_sort(benchmarks.begin(), benchmarks.end(),
+                     [&rank](const entry &a, const entry &b) { return rank(a) < rank(b); });
+    for (std::size_t i = 0; i < benchmarks.size(); ++i) {
+      index_[benchmarks[i].result.name] = i;
+    }
+  }
+};
+
+} // namespace criterion
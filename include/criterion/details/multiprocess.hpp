@@ -0,0 +1,295 @@
+#pragma once
+#if defined(__unix__) || defined(__APPLE__)
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/prctl.h>
+#endif
+
+#include <criterion/details/macros.hpp>
+
+namespace criterion {
+
+// Sense-reversing spin barrier that lives in memory shared between processes
+class process_barrier {
+  std::atomic<std::uint32_t> count_{0};
+  std::atomic<std::uint32_t> generation_{0};
+  std::uint32_t parties_;
+
+public:
+  explicit process_barrier(std::uint32_t parties) : parties_(parties) {}
+
+  // `still_alive` is polled while spinning; return false from it to abandon the wait
+  template <class Predicate> bool wait(Predicate &&still_alive) {
+    const auto generation = generation_.load(std::memory_order_acquire);
+    if (count_.fetch_add(1, std::memory_order_acq_rel) + 1 == parties_) {
+      count_.store(0, std::memory_order_relaxed);
+      generation_.fetch_add(1, std::memory_order_release);
+      return true;
+    }
+
+    std::size_t spins = 0;
+    while (generation_.load(std::memory_order_acquire) == generation) {
+      if (++spins % 1024 == 0) {
+        std::this_thread::yield();
+        if (spins % (1024 * 64) == 0 && !still_alive())
+          return false;
+      }
+    }
+    return true;
+  }
+};
+
+// N cooperating processes (rank 0 is the benchmark process) sharing an mmap(MAP_SHARED) region.
+//
+// Workers are forked once per benchmark instance and then run the benchmark body in lock-step
+// with rank 0: every iteration starts and ends on a process-shared barrier, so the time measured
+// by rank 0 covers the cross-process work of all ranks
+class process_group {
+  static_assert(std::atomic<std::uint32_t>::is_always_lock_free,
+                "process_group requires address-free atomics");
+
+  enum class command : std::uint32_t { run, stop };
+
+  struct control_block {
+    process_barrier barrier;      // used at the start and end of every iteration
+    process_barrier user_barrier; // exposed to benchmark bodies through barrier()
+    std::atomic<command> next{command::run};
+
+    explicit control_block(std::uint32_t parties) : barrier(parties), user_barrier(parties) {}
+  };
+
+  // keep the user area cache-line aligned and away from the control block
+  static constexpr std::size_t control_block_size = (sizeof(control_block) + 127) / 128 * 128;
+
+  std::size_t num_processes_;
+  std::size_t shared_memory_size_;
+  std::size_t rank_{0};
+  void *region_{nullptr};
+  control_block *control_{nullptr};
+  std::vector<pid_t> workers_;
+
+  bool workers_alive() {
+    for (const auto pid : workers_) {
+      int status = 0;
+      if (waitpid(pid, &status, WNOHANG) == pid)
+        return false;
+    }
+    return true;
+  }
+
+  void synchronize() {
+    if (rank_ == 0) {
+      if (!control_->barrier.wait([this] { return workers_alive(); })) {
+        throw std::runtime_error("criterion: a benchmark worker process exited unexpectedly");
+      }
+    } else if (!control_->barrier.wait([] { return getppid() != 1; })) {
+      _exit(1); // the benchmark process is gone
+    }
+  }
+
+  [[noreturn]] void run_worker(std::size_t rank,
+                               const std::function<void(process_group &)> &body) {
+    rank_ = rank;
+    workers_.clear();
+#if defined(__linux__)
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+#endif
+    while (true) {
+      synchronize();
+      if (control_->next.load(std::memory_order_acquire) == command::stop)
+        _exit(0);
+      try {
+        body(*this);
+      } catch (...) {
+        _exit(1); // never unwind into the benchmark process's copy of the stack
+      }
+      synchronize();
+    }
+  }
+
+public:
+  process_group(std::size_t num_processes, std::size_t shared_memory_size)
+      : num_processes_(std::max<std::size_t>(num_processes, 1)),
+        shared_memory_size_(shared_memory_size) {}
+
+  process_group(const process_group &) = delete;
+  process_group &operator=(const process_group &) = delete;
+
+  ~process_group() { stop(); }
+
+  // 0 in the benchmark process, 1..size()-1 in the workers
+  std::size_t rank() const { return rank_; }
+
+  std::size_t size() const { return num_processes_; }
+
+  // Zero-initialized at the start of every benchmark instance
+  void *shared_memory() const { return static_cast<char *>(region_) + control_block_size; }
+
+  std::size_t shared_memory_size() const { return shared_memory_size_; }
+
+  template <class T> T *shared_memory_as() const { return static_cast<T *>(shared_memory()); }
+
+  // Wait until every process in the group has reached this point
+  void barrier() {
+    if (rank_ == 0) {
+      if (!control_->user_barrier.wait([this] { return workers_alive(); })) {
+        throw std::runtime_error("criterion: a benchmark worker process exited unexpectedly");
+      }
+    } else if (!control_->user_barrier.wait([] { return getppid() != 1; })) {
+      _exit(1); // the benchmark process is gone
+    }
+  }
+
+  // Map the shared region and fork the workers. Each worker runs `body` once per iteration
+  void start(const std::function<void(process_group &)> &body) {
+    stop();
+
+    const auto total_size = control_block_size + shared_memory_size_;
+    region_ = mmap(nullptr, total_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (region_ == MAP_FAILED) {
+      region_ = nullptr;
+      throw std::runtime_error("criterion: failed to map " + std::to_string(total_size) +
+                               " bytes of shared memory");
+    }
+    control_ = new (region_) control_block(static_cast<std::uint32_t>(num_processes_));
+
+    for (std::size_t rank = 1; rank < num_processes_; rank++) {
+      const auto pid = fork();
+      if (pid < 0) {
+        stop();
+        throw std::runtime_error("criterion: failed to fork benchmark worker process");
+      } else if (pid == 0) {
+        run_worker(rank, body);
+      }
+      workers_.push_back(pid);
+    }
+  }
+
+  // Run one iteration on every rank; rank 0 runs `body` in this process
+  template <class Body> void run_iteration(Body &&body) {
+    synchronize();
+    body(*this);
+    synchronize();
+  }
+
+  // Release the workers, wait for them to exit and unmap the shared region
+  void stop() {
+    if (region_ == nullptr)
+      return;
+
+    if (!workers_.empty()) {
+      control_->next.store(command::stop, std::memory_order_release);
+      if (control_->barrier.wait([this] { return workers_alive(); })) {
+        for (const auto pid : workers_) {
+          waitpid(pid, nullptr, 0);
+        }
+      } else {
+        for (const auto pid : workers_) {
+          kill(pid, SIGKILL);
+          waitpid(pid, nullptr, 0);
+        }
+      }
+      workers_.clear();
+    }
+
+    control_->~control_block();
+    munmap(region_, control_block_size + shared_memory_size_);
+    region_ = nullptr;
+    control_ = nullptr;
+  }
+};
+
+} // namespace criterion
+
+#define GET_PROCESS_GROUP (__benchmark_process_group)
+
+// Same as BENCHMARK, but the body runs in NumProcesses processes at once (rank 0 being the
+// benchmark process) that share SharedMemorySize bytes of mmap(MAP_SHARED) memory.
+// Use GET_PROCESS_GROUP inside the body to get the rank, the shared memory and a barrier
+#define MULTIPROCESS_BENCHMARK(Name, NumProcesses, SharedMemorySize, ...)                          \
+  typedef std::tuple<__VA_ARGS__> CONCAT(Name, BenchmarkParameters);                               \
+  namespace detail {                                                                               \
+  /* forward declare the benchmark function that we define later */                                \
+  template <class T = CONCAT(Name, BenchmarkParameters)>                                           \
+  struct CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__)) {                          \
+    static inline void CONCAT(Name, CONCAT(_registered_body_, __LINE__))(                          \
+        std::chrono::steady_clock::time_point &,                                                   \
+        std::optional<std::chrono::steady_clock::time_point> &, void *,                            \
+        criterion::process_group &);                                                               \
+                                                                                                   \
+    static criterion::process_group &process_group() {                                             \
+      static criterion::process_group group{NumProcesses, SharedMemorySize};                       \
+      return group;                                                                                \
+    }                                                                                              \
+                                                                                                   \
+    static inline void CONCAT(Name, CONCAT(_registered_fun_, __LINE__))(                           \
+        std::chrono::steady_clock::time_point &start,                                              \
+        std::optional<std::chrono::steady_clock::time_point> &teardown, void *parameters) {        \
+      process_group().run_iteration([&](criterion::process_group &group) {                         \
+        CONCAT(Name, CONCAT(_registered_body_, __LINE__))(start, teardown, parameters, group);     \
+      });                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    static void start_workers(void *parameters) {                                                  \
+      process_group().start([parameters](criterion::process_group &group) {                        \
+        std::chrono::steady_clock::time_point start;                                               \
+        std::optional<std::chrono::steady_clock::time_point> teardown;                             \
+        CONCAT(Name, CONCAT(_registered_body_, __LINE__))(start, teardown, parameters, group);     \
+      });                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    static void stop_workers(void *) { process_group().stop(); }                                   \
+  };                                                                                               \
+                                                                                                   \
+  namespace /* ensure internal linkage for struct */                                               \
+  {                                                                                                \
+  /* helper struct for static registration in ctor */                                              \
+  struct CONCAT(Name, CONCAT(_register_struct_, __LINE__)) {                                       \
+    CONCAT(Name, CONCAT(_register_struct_, __LINE__))() { /* called once before main */            \
+      using wrapper = CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__)) <             \
+                      CONCAT(Name, BenchmarkParameters) >;                                         \
+      criterion::benchmark_template_registration_helper_struct::register_benchmark_template(       \
+          criterion::benchmark_config{                                                             \
+              .name = #Name,                                                                       \
+              .fn = wrapper::CONCAT(Name, CONCAT(_registered_fun_, __LINE__)),                     \
+              .before_instance = wrapper::start_workers,                                           \
+              .after_instance = wrapper::stop_workers});                                           \
+      /* benchmarks without parameters have a single, implicit instance */                         \
+      if constexpr (std::tuple_size_v<CONCAT(Name, BenchmarkParameters)> == 0) {                   \
+        criterion::benchmark_template_registration_helper_struct::                                 \
+            execute_registered_benchmark_template(#Name, "",                                       \
+                                                  criterion::benchmark_config::empty_tuple);       \
+      }                                                                                            \
+    }                                                                                              \
+  } CONCAT(Name, CONCAT(_register_struct_instance_, __LINE__));                                    \
+  }                                                                                                \
+  }                                                                                                \
+                                                                                                   \
+  /* now actually defined to allow MULTIPROCESS_BENCHMARK("name") { ... } syntax */                \
+  template <class T>                                                                               \
+  void detail::CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__))<T>::CONCAT(          \
+      Name, CONCAT(_registered_body_, __LINE__))(                                                  \
+      [[maybe_unused]] std::chrono::steady_clock::time_point & __benchmark_start_timestamp,        \
+      [[maybe_unused]] std::optional<std::chrono::steady_clock::time_point> &                      \
+          __benchmark_teardown_timestamp,                                                          \
+      [[maybe_unused]] void *__benchmark_parameters,                                               \
+      [[maybe_unused]] criterion::process_group & __benchmark_process_group)
+
+#endif
@@ -0,0 +1,153 @@
+#pragma once
+#include <criterion/details/benchmark.hpp>
+#include <criterion/details/benchmark_result.hpp>
+#include <criterion/details/statistics.hpp>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#include <sys/types.h>
+#endif
+
+namespace criterion {
+
+// Results as OpenMetrics gauges, e.g., for the textfile collector of node_exporter:
+//
+//   criterion_mean_seconds{benchmark="MergeSort/1K",family="MergeSort",parameters="1K",
+//                          cpu="AMD EPYC 7B13",revision="a1b2c3d"} 1.912e-05
+//
+// Times are in seconds, the base unit of OpenMetrics
+class openmetrics_writer {
+  // Label values escape backslashes, quotes and line feeds only, as OpenMetrics requires
+  static std::string escape_label(const std::string &value) {
+    std::string result;
+    for (const auto c : value) {
+      if (c == '"' || c == '\\') {
+        result += '\\';
+        result += c;
+      } else if (c == '\n') {
+        result += "\\n";
+      } else {
+        result += c;
+      }
+    }
+    return result;
+  }
+
+  // (extra labels, e.g., ",quantile=\"0.9\"", value) of one metric for one benchmark
+  using values = std::vector<std::pair<std::string, long double>>;
+
+public:
+  static inline std::string revision{"unknown"}; // label of every sample, e.g., from --revision
+
+  // e.g., "AMD EPYC 7B13", or "unknown"
+  static std::string cpu_model() {
+#if defined(__linux__)
+    std::ifstream is("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(is, line)) {
+      if (line.rfind("model name", 0) == 0) {
+        const auto colon = line.find(':');
+        if (colon != std::string::npos && colon + 2 <= line.size())
+          return line.substr(colon + 2);
+      }
+    }
+#elif defined(__APPLE__)
+    char brand[256]{};
+    std::size_t size = sizeof(brand) - 1;
+    if (sysctlbyname("machdep.cpu.brand_string", brand, &size, nullptr, 0) == 0)
+      return brand;
+#endif
+    return "unknown";
+  }
+
+  static bool write_results(const std::string &filename,
+                            const std::unordered_map<std::string, benchmark_result> &results) {
+    std::ofstream os(filename);
+    if (!os.is_open())
+      return false;
+
+    const auto cpu = cpu_model();
+    const auto labels = [&](const std::string &name) {
+      const auto separator = name.find('/');
+      return "benchmark=\"" + escape_label(name) + "\",family=\"" +
+             escape_label(name.substr(0, separator)) + "\",parameters=\"" +
+             escape_label(separator == std::string::npos ? "" : name.substr(separator + 1)) +
+             "\",cpu=\"" + escape_label(cpu) + "\",revision=\"" + escape_label(revision) + "\"";
+    };
+
+    // one metric family at a time, with a sample per benchmark that has a value for it
+    os << std::setprecision(10);
+    const auto gauge =
+        [&](const std::string &metric, const std::string &unit, const std::string &help,
+            const std::function<values(const benchmark_result &)> &values_of) {
+          os << "# TYPE " << metric << " gauge\n";
+          if (!unit.empty())
+            os << "# UNIT " << metric << " " << unit << "\n";
+          os << "# HELP " << metric << " " << help << "\n";
+          for (const auto &name : benchmark::benchmark_execution_order) {
+            const auto it = results.find(name);
+            if (it == results.end())
+              continue;
+            for (const auto &[extra_labels, value] : values_of(it->second)) {
+              os << metric << "{" << labels(name) << extra_labels << "} " << value << "\n";
+            }
+          }
+        };
+    const auto seconds = [](long double ns) { return ns / 1E9; };
+    // a metric with one unlabeled value per benchmark
+    const auto single = [](std::function<long double(const benchmark_result &)> value_of) {
+      return [value_of](const benchmark_result &r) { return values{{"", value_of(r)}}; };
+    };
+
+    gauge("criterion_mean_seconds", "seconds", "Mean execution time per iteration",
+          single([&](const benchmark_result &r) { return seconds(r.mean_execution_time); }));
+    gauge("criterion_median_seconds", "seconds", "Median of the mean execution time of each run",
+          single([&](const benchmark_result &r) {
+            return seconds(r.samples.empty() ? r.mean_execution_time : sample_median(r.samples));
+          }));
+    gauge("criterion_quantile_seconds", "seconds",
+          "Quantiles of the mean execution time of each run", [&](const benchmark_result &r) {
+            values result;
+            for (const auto q : {"0.5", "0.9", "0.99"}) {
+              if (!r.samples.empty()) {
+                result.push_back({",quantile=\"" + std::string(q) + "\"",
+                                  seconds(sample_quantile(r.samples, std::stold(q)))});
+              }
+            }
+            return result;
+          });
+    gauge("criterion_fastest_seconds", "seconds", "Fastest execution time of an iteration",
+          single([&](const benchmark_result &r) { return seconds(r.fastest_execution_time); }));
+    gauge("criterion_slowest_seconds", "seconds", "Slowest execution time of an iteration",
+          single([&](const benchmark_result &r) { return seconds(r.slowest_execution_time); }));
+    gauge("criterion_throughput_iterations_per_second", "",
+          "Iterations per second in the average case",
+          single([](const benchmark_result &r) { return r.average_iteration_performance; }));
+    gauge("criterion_lowest_rsd_percent", "", "Lowest relative standard deviation of a run",
+          single([](const benchmark_result &r) { return r.lowest_rsd; }));
+    gauge("criterion_runs", "", "Number of benchmark runs",
+          single([](const benchmark_result &r) { return r.num_runs; }));
+    gauge("criterion_iterations", "", "Number of measured iterations",
+          single([](const benchmark_result &r) { return r.num_runs * r.num_iterations; }));
+    gauge("criterion_allocations_per_iteration", "", "Heap allocations per iteration, if counted",
+          [](const benchmark_result &r) {
+            values result;
+            if (r.allocations_per_iteration.has_value())
+              result.push_back({"", r.allocations_per_iteration.value()});
+            return result;
+          });
+
+    os << "# EOF\n";
+    return os.good();
+  }
+};
+
+} // namespace criterion
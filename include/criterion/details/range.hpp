@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace criterion {
+
+// Instance name for a generated parameter value, e.g., "/8", "/1000", "/1K" (1024) or "/16M".
+// Binary suffixes are only used for exact multiples, so every value gets a distinct name
+inline std::string range_instance_name(long long value) {
+  static const char *suffixes[] = {"", "K", "M", "G", "T"};
+  std::size_t suffix = 0;
+  auto magnitude = value;
+  while (magnitude != 0 && magnitude % 1024 == 0 && suffix + 1 < std::size(suffixes)) {
+    magnitude /= 1024;
+    suffix += 1;
+  }
+  return "/" + std::to_string(magnitude) + suffixes[suffix];
+}
+
+// first, first * multiplier, first * multiplier^2, ... up to and including last
+inline std::vector<long long> geometric_range(long long first, long long last,
+                                              long long multiplier) {
+  if (first <= 0 || last < first || multiplier < 2) {
+    throw std::invalid_argument("criterion: geometric range requires 0 < first <= last and a "
+                                "multiplier of at least 2");
+  }
+
+  std::vector<long long> result;
+  for (auto value = first; value < last; value *= multiplier) {
+    result.push_back(value);
+    if (value > last / multiplier)
+      break;
+  }
+  if (result.empty() || result.back() != last) {
+    result.push_back(last);
+  }
+  return result;
+}
+
+// first, first + step, first + 2 * step, ... up to and including last
+inline std::vector<long long> linear_range(long long first, long long last, long long step) {
+  if (last < first || step < 1) {
+    throw std::invalid_argument("criterion: linear range requires first <= last and a step of at "
+                                "least 1");
+  }
+
+  std::vector<long long> result;
+  for (auto value = first; value < last; value += step) {
+    result.push_back(value);
+    if (value > last - step)
+      break;
+  }
+  if (result.empty() || result.back() != last) {
+    result.push_back(last);
+  }
+  return result;
+}
+
+} // namespace criterion
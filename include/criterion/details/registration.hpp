@@ -0,0 +1,81 @@
+#pragma once
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <criterion/details/allocations.hpp>
+#include <criterion/details/benchmark_config.hpp>
+#include <criterion/details/macros.hpp>
+
+namespace criterion {
+
+// Passed to benchmarks registered with criterion::register_benchmark that take it as their first
+// argument. end_setup() and begin_teardown() do what SETUP_BENCHMARK and TEARDOWN_BENCHMARK do for
+// BENCHMARK - everything before end_setup() and after begin_teardown() is not measured
+class benchmark_fixture {
+  std::chrono::steady_clock::time_point &start_timestamp_;
+  std::optional<std::chrono::steady_clock::time_point> &teardown_timestamp_;
+
+public:
+  benchmark_fixture(std::chrono::steady_clock::time_point &start_timestamp,
+                    std::optional<std::chrono::steady_clock::time_point> &teardown_timestamp)
+      : start_timestamp_(start_timestamp), teardown_timestamp_(teardown_timestamp) {}
+
+  void end_setup() {
+    allocation_counter::mark_start();
+    start_timestamp_ = std::chrono::steady_clock::now();
+  }
+
+  void begin_teardown() {
+    teardown_timestamp_ = std::chrono::steady_clock::now();
+    allocation_counter::mark_end();
+  }
+};
+
+// Register a benchmark at runtime, e.g., from main() before calling criterion_main:
+//
+//   criterion::register_benchmark("Replay/" + request.id, Replay, request.body);
+//
+// `fn` is called once per iteration with the parameters, which are copied (or moved) into storage
+// owned by the benchmark. If `fn` takes a criterion::benchmark_fixture& as its first argument, it
+// can exclude setup and teardown from the measurement. Anything after the first '/' in `name` is
+// the instance name, like the names given to INVOKE_BENCHMARK
+template <class Fn, class... Params>
+void register_benchmark(const std::string &name, Fn &&fn, Params &&...params) {
+  using ArgTuple = std::tuple<std::decay_t<Params>...>;
+  using Callable = std::decay_t<Fn>;
+  static_assert(std::is_invocable_v<Callable &, benchmark_fixture &, std::decay_t<Params> &...> ||
+                    std::is_invocable_v<Callable &, std::decay_t<Params> &...>,
+                "register_benchmark requires a callable that takes the benchmark parameters, "
+                "optionally preceded by a criterion::benchmark_fixture&");
+
+  auto arguments = std::make_shared<ArgTuple>(std::forward<Params>(params)...);
+
+  benchmark_config config;
+  const auto slash = name.find('/');
+  config.name = name.substr(0, slash);
+  config.parameterized_instance_name = slash == std::string::npos ? "" : name.substr(slash);
+  config.parameters = (void *)(arguments.get());
+  config.owned_parameters = arguments;
+  config.fn = [callable = Callable(std::forward<Fn>(fn))](
+                  std::chrono::steady_clock::time_point &start_timestamp,
+                  std::optional<std::chrono::steady_clock::time_point> &teardown_timestamp,
+                  void *parameters) mutable {
+    auto &arg_tuple = *static_cast<ArgTuple *>(parameters);
+    if constexpr (std::is_invocable_v<Callable &, benchmark_fixture &,
+                                      std::decay_t<Params> &...>) {
+      benchmark_fixture fixture{start_timestamp, teardown_timestamp};
+      std::apply([&](auto &...args) { callable(fixture, args...); }, arg_tuple);
+    } else {
+      std::apply([&](auto &...args) { callable(args...); }, arg_tuple);
+    }
+  };
+
+  benchmark_registration_helper_struct::register_benchmark(config);
+}
+
+} // namespace criterion
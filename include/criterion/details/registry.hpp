@@ -0,0 +1,215 @@
+#pragma once
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <criterion/details/benchmark_config.hpp>
+
+namespace criterion {
+
+// Append-only storage for benchmark names. Names are copied into large chunks, so registering
+// 100k instances costs a handful of allocations, and views into the arena stay valid for as long
+// as the arena lives
+class name_arena {
+  static constexpr std::size_t chunk_size = 64 * 1024;
+  std::vector<std::unique_ptr<char[]>> chunks_;
+  char *current_{nullptr};
+  std::size_t used_{chunk_size};
+
+public:
+  // Stores the concatenation of `first` and `second`
+  std::string_view store(std::string_view first, std::string_view second = {}) {
+    const auto size = first.size() + second.size();
+    if (size == 0)
+      return {};
+    char *destination = nullptr;
+    if (size > chunk_size) {
+      chunks_.push_back(std::make_unique<char[]>(size));
+      destination = chunks_.back().get();
+    } else {
+      if (used_ + size > chunk_size) {
+        chunks_.push_back(std::make_unique<char[]>(chunk_size));
+        current_ = chunks_.back().get();
+        used_ = 0;
+      }
+      destination = current_ + used_;
+      used_ += size;
+    }
+    std::copy(first.begin(), first.end(), destination);
+    std::copy(second.begin(), second.end(), destination + first.size());
+    return {destination, size};
+  }
+};
+
+// A registered benchmark instance. Instances share the config of their template rather than each
+// holding a copy of its std::function and names
+struct benchmark_instance {
+  std::shared_ptr<const benchmark_config> prototype;
+  std::string_view template_name; // name the template was registered under, e.g., "Forward"
+  std::string_view name;          // full name, e.g., "Forward<std::vector<int>>/1K"
+  void *parameters;
+  std::shared_ptr<void> owned_parameters;
+  benchmark_config::ParameterFactory parameter_factory;
+
+  // e.g., "/1K"
+  std::string_view instance_name() const { return name.substr(prototype->name.size()); }
+
+  // The config to run this instance with
+  benchmark_config config() const {
+    auto result = *prototype;
+    result.parameterized_instance_name = std::string(instance_name());
+    result.parameters = parameters;
+    result.owned_parameters = owned_parameters;
+    result.parameter_factory = parameter_factory;
+    return result;
+  }
+};
+
+// One of `count` disjoint parts of a list of benchmarks, e.g., "2/4" for the second of four. The
+// k-th benchmark of the list (from 0) is in shard k % count + 1, which spreads the instances of a
+// template, e.g., over growing input sizes, across the shards. Processes given the same list
+// always pick the same benchmarks
+struct benchmark_shard {
+  std::size_t index; // from 1
+  std::size_t count;
+
+  static std::optional<benchmark_shard> parse(const std::string &value) {
+    const auto separator = value.find('/');
+    if (separator == std::string::npos)
+      return std::nullopt;
+    const auto number = [](const std::string &digits) -> std::optional<std::size_t> {
+      if (digits.empty() || digits.size() > 9)
+        return std::nullopt;
+      for (const auto c : digits) {
+        if (!std::isdigit(static_cast<unsigned char>(c)))
+          return std::nullopt;
+      }
+      return static_cast<std::size_t>(std::stoul(digits));
+    };
+    const auto index = number(value.substr(0, separator));
+    const auto count = number(value.substr(separator + 1));
+    if (!index || !count || index.value() < 1 || index.value() > count.value())
+      return std::nullopt;
+    return benchmark_shard{index.value(), count.value()};
+  }
+
+  template <class T> std::vector<T> select(const std::vector<T> &items) const {
+    std::vector<T> result;
+    for (std::size_t k = index - 1; k < items.size(); k += count) {
+      result.push_back(items[k]);
+    }
+    return result;
+  }
+};
+
+// Benchmark templates, looked up by name in O(1), and their instances in registration order
+class benchmark_registry {
+  name_arena names_;
+  std::unordered_map<std::string, std::vector<std::shared_ptr<const benchmark_config>>>
+      templates_;
+  std::vector<benchmark_instance> instances_;
+  std::unordered_map<std::string, benchmark_options> template_options_;
+  std::unordered_map<std::string, benchmark_options> instance_options_;
+
+public:
+  // The registry used by the BENCHMARK and INVOKE_BENCHMARK macros
+  static benchmark_registry &global() {
+    static benchmark_registry registry;
+    return registry;
+  }
+
+  // Several configs can share a template name, e.g., one per type of a TYPED_BENCHMARK
+  void register_template(const std::string &template_name, benchmark_config config) {
+    templates_[template_name].push_back(
+        std::make_shared<const benchmark_config>(std::move(config)));
+  }
+
+  // Adds an instance of every config registered under `template_name`
+  void instantiate(const std::string &template_name, std::string_view instance_name,
+                   void *parameters, const std::shared_ptr<void> &owned_parameters,
+                   const benchmark_config::ParameterFactory &parameter_factory = nullptr) {
+    const auto it = templates_.find(template_name);
+    if (it == templates_.end())
+      return;
+    for (const auto &prototype : it->second) {
+      instances_.push_back({prototype, it->first, names_.store(prototype->name, instance_name),
+                            parameters, owned_parameters, parameter_factory});
+    }
+  }
+
+  // Adds a standalone instance, e.g., from criterion::register_benchmark
+  void register_instance(const benchmark_config &config) {
+    auto prototype = std::make_shared<const benchmark_config>(config);
+    const auto name = names_.store(config.name, config.parameterized_instance_name);
+    instances_.push_back({prototype, name.substr(0, config.name.size()), name, config.parameters,
+                          config.owned_parameters, config.parameter_factory});
+  }
+
+  // Options for every instance of a template, e.g., from BENCHMARK_OPTIONS
+  void set_template_options(const std::string &template_name, const benchmark_options &options) {
+    auto &current = template_options_[template_name];
+    current = current.merged_with(options);
+  }
+
+  // Options for one instance of a template, e.g., ("MergeSort", "/10M"), overriding the
+  // template's options
+  void set_instance_options(const std::string &template_name, const std::string &instance_name,
+                            const benchmark_options &options) {
+    auto &current = instance_options_[template_name + instance_name];
+    current = current.merged_with(options);
+  }
+
+  // The config to run `instance` with, with template and instance options applied
+  benchmark_config configure(const benchmark_instance &instance) const {
+    auto config = instance.config();
+    const auto template_name = std::string(instance.template_name);
+    config.template_name = template_name;
+    if (const auto it = template_options_.find(template_name); it != template_options_.end()) {
+      config.options = config.options.merged_with(it->second);
+    }
+    const auto key = template_name + std::string(instance.instance_name());
+    if (const auto it = instance_options_.find(key); it != instance_options_.end()) {
+      config.options = config.options.merged_with(it->second);
+    }
+    return config;
+  }
+
+  // Makes room for `count` instances, e.g., before instantiating a generated suite, so adding
+  // them never moves the instances already registered
+  void reserve(std::size_t count) { instances_.reserve(count); }
+
+  const std::vector<benchmark_instance> &instances() const { return instances_; }
+
+  // Instance name -> name its template was registered under, e.g.,
+  // "Forward<std::vector<int>>/1K" -> "Forward"
+  std::unordered_map<std::string, std::string> template_names() const {
+    std::unordered_map<std::string, std::string> result;
+    for (const auto &instance : instances_) {
+      result.emplace(instance.name, instance.template_name);
+    }
+    return result;
+  }
+
+  // Instances whose name matches `regex_string`, in registration order
+  std::vector<const benchmark_instance *> filter(const std::string &regex_string) const {
+    const std::regex regexp(regex_string);
+    std::vector<const benchmark_instance *> result;
+    for (const auto &instance : instances_) {
+      if (std::regex_search(instance.name.begin(), instance.name.end(), regexp)) {
+        result.push_back(&instance);
+      }
+    }
+    return result;
+  }
+};
+
+} // namespace criterion
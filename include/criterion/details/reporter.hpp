@@ -0,0 +1,168 @@
+#pragma once
+#include <criterion/details/benchmark_result.hpp>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace criterion {
+
+// Receives results as benchmarks complete. Any number of reporters can be active at once (see
+// benchmark::reporters), e.g., to write CSV, JSON and HTML from the same run
+class reporter {
+public:
+  virtual ~reporter() = default;
+
+  virtual void on_run_start() {}
+
+  virtual void on_benchmark_complete(const benchmark_result &) {}
+
+  virtual void on_run_end() {}
+
+  // false if writing any of the output failed
+  virtual bool good() const = 0;
+
+  // where the output goes, for error messages
+  virtual std::string destination() const = 0;
+};
+
+// A file of records that are each on disk before append() returns, so a crash or a timeout
+// loses at most the record that was being written
+class record_file {
+#if defined(__unix__) || defined(__APPLE__)
+  int fd_{-1};
+#else
+  std::ofstream os_;
+#endif
+  bool good_{false};
+
+public:
+  record_file() = default;
+  record_file(const record_file &) = delete;
+  record_file &operator=(const record_file &) = delete;
+
+  ~record_file() { close(); }
+
+  bool open(const std::string &filename) {
+#if defined(__unix__) || defined(__APPLE__)
+    fd_ = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    good_ = fd_ >= 0;
+#else
+    os_.open(filename, std::ios::binary | std::ios::trunc);
+    good_ = os_.is_open();
+#endif
+    return good_;
+  }
+
+  bool append(const std::string &record) {
+    if (!good_)
+      return false;
+#if defined(__unix__) || defined(__APPLE__)
+    std::size_t written = 0;
+    while (written < record.size()) {
+      const auto n = ::write(fd_, record.data() + written, record.size() - written);
+      if (n < 0) {
+        if (errno == EINTR)
+          continue;
+        good_ = false;
+        return false;
+      }
+      written += static_cast<std::size_t>(n);
+    }
+    good_ = ::fsync(fd_) == 0;
+#else
+    os_ << record;
+    os_.flush();
+    good_ = os_.good();
+#endif
+    return good_;
+  }
+
+  bool close() {
+#if defined(__unix__) || defined(__APPLE__)
+    if (fd_ >= 0) {
+      if (::close(fd_) != 0)
+        good_ = false;
+      fd_ = -1;
+    }
+#else
+    if (os_.is_open())
+      os_.close();
+#endif
+    return good_;
+  }
+
+  bool good() const { return good_; }
+};
+
+// Writes one JSON object per benchmark as it completes
+class jsonl_reporter : public reporter {
+  std::string filename_;
+  record_file file_;
+
+public:
+  explicit jsonl_reporter(std::string filename) : filename_(std::move(filename)) {}
+
+  void on_run_start() override { file_.open(filename_); }
+
+  void on_benchmark_complete(const benchmark_result &result) override {
+    file_.append(result.to_jsonl() + "\n");
+  }
+
+  void on_run_end() override { file_.close(); }
+
+  bool good() const override { return file_.good(); }
+
+  std::string destination() const override { return filename_; }
+};
+
+// Rewrites a whole document, e.g., with json_writer, after every benchmark (if `incremental`)
+// and at the end of the run. Each version is written to a temporary file that then replaces the
+// previous one, so the file always holds a complete document with the results so far
+class snapshot_reporter : public reporter {
+  std::string filename_;
+  std::function<bool(const std::string &filename)> write_;
+  bool incremental_;
+  bool good_{true};
+
+  void snapshot() {
+    const auto temporary = filename_ + ".tmp";
+    std::error_code error;
+    if (!write_(temporary)) {
+      good_ = false;
+      std::filesystem::remove(temporary, error);
+      return;
+    }
+    std::filesystem::rename(temporary, filename_, error);
+    good_ = good_ && !error;
+  }
+
+public:
+  snapshot_reporter(std::string filename, std::function<bool(const std::string &filename)> write,
+                    bool incremental = true)
+      : filename_(std::move(filename)), write_(std::move(write)), incremental_(incremental) {}
+
+  // starts with an empty document, which also checks that the file can be written
+  void on_run_start() override { snapshot(); }
+
+  void on_benchmark_complete(const benchmark_result &) override {
+    if (incremental_)
+      snapshot();
+  }
+
+  void on_run_end() override { snapshot(); }
+
+  bool good() const override { return good_; }
+
+  std::string destination() const override { return filename_; }
+};
+
+} // namespace criterion
@@ -0,0 +1,182 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Layout of the raw samples written by --export_samples. This header has no other dependencies,
+// so tools can include it on its own to read the files.
+//
+// All integers are in host byte order. The file starts with a file_header, followed by blocks.
+// Every block starts on an 8-byte boundary with a block_header whose `size` is the number of
+// payload bytes that follow it (a multiple of 8), so readers can skip blocks they do not know.
+//
+//   benchmark block: count = benchmark id, payload = benchmark_payload, then the name, padded
+//   samples block:   count = number of rows, payload = one array per column, each padded to 8
+//                    bytes, in this order:
+//
+//     uint64_t timestamp[rows];  // ns since the export started, when the iteration started
+//     int64_t  duration[rows];   // measured ns, before subtracting the measurement cost
+//     uint32_t benchmark[rows];  // id of a preceding benchmark block
+//     uint32_t run[rows];        // 0, 1, 2, ... within the benchmark
+//     uint32_t batch_size[rows]; // iterations in the run
+//     int32_t  cpu[rows];        // CPU the iteration finished on, or -1 if unknown
+//
+// Blocks of a benchmark's samples come after its benchmark block, and rows are in the order
+// the iterations ran
+
+namespace criterion {
+namespace samples {
+
+static constexpr char magic[8] = {'C', 'R', 'T', 'S', 'M', 'P', 'L', 'S'};
+static constexpr std::uint32_t version = 1;
+
+enum class block_kind : std::uint32_t { benchmark = 1, samples = 2 };
+
+struct file_header {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t reserved;
+};
+
+struct block_header {
+  std::uint32_t kind;
+  std::uint32_t count;
+  std::uint64_t size;
+};
+
+struct benchmark_payload {
+  double measurement_cost; // ns, the cost of timing an empty function
+  std::uint64_t name_length;
+};
+
+static_assert(sizeof(file_header) == 16 && sizeof(block_header) == 16 &&
+                  sizeof(benchmark_payload) == 16,
+              "sample file structs must not be padded");
+
+inline constexpr std::uint64_t padded(std::uint64_t size) { return (size + 7) / 8 * 8; }
+
+// Views into a samples block. Valid as long as the reader that produced them
+struct sample_columns {
+  std::uint32_t rows;
+  const std::uint64_t *timestamp;
+  const std::int64_t *duration;
+  const std::uint32_t *benchmark;
+  const std::uint32_t *run;
+  const std::uint32_t *batch_size;
+  const std::int32_t *cpu;
+};
+
+struct benchmark_info {
+  std::uint32_t id;
+  std::string name;
+  double measurement_cost;
+};
+
+#if defined(__unix__) || defined(__APPLE__)
+
+// Maps a file written by --export_samples into memory, e.g.,
+//
+//   criterion::samples::reader reader("samples.cbin");
+//   for (const auto &columns : reader.sample_blocks())
+//     for (std::uint32_t i = 0; i < columns.rows; ++i)
+//       histogram[columns.benchmark[i]].add(columns.duration[i]);
+class reader {
+  const unsigned char *data_{nullptr};
+  std::size_t size_{0};
+  std::vector<benchmark_info> benchmarks_;
+  std::vector<sample_columns> blocks_;
+  bool valid_{false};
+
+  void parse() {
+    if (size_ < sizeof(file_header))
+      return;
+    file_header header;
+    std::memcpy(&header, data_, sizeof(header));
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version)
+      return;
+
+    std::size_t offset = sizeof(file_header);
+    while (offset + sizeof(block_header) <= size_) {
+      const auto *block = reinterpret_cast<const block_header *>(data_ + offset);
+      const auto *payload = data_ + offset + sizeof(block_header);
+      if (block->size > size_ - offset - sizeof(block_header))
+        break; // truncated, e.g., the run was interrupted
+      if (block->kind == static_cast<std::uint32_t>(block_kind::benchmark)) {
+        const auto *info = reinterpret_cast<const benchmark_payload *>(payload);
+        if (block->size < sizeof(benchmark_payload) ||
+            info->name_length > block->size - sizeof(benchmark_payload))
+          break; // the name runs past the block
+        benchmarks_.push_back(
+            {block->count,
+             std::string(reinterpret_cast<const char *>(payload + sizeof(benchmark_payload)),
+                         info->name_length),
+             info->measurement_cost});
+      } else if (block->kind == static_cast<std::uint32_t>(block_kind::samples)) {
+        const auto rows = block->count;
+        if (2 * padded(std::uint64_t{rows} * 8) + 4 * padded(std::uint64_t{rows} * 4) > block->size)
+          break; // the columns run past the block
+        auto column = payload;
+        const auto next = [&](std::size_t width) {
+          const auto *result = column;
+          column += padded(std::uint64_t{rows} * width);
+          return result;
+        };
+        sample_columns columns{rows,
+                               reinterpret_cast<const std::uint64_t *>(next(8)),
+                               reinterpret_cast<const std::int64_t *>(next(8)),
+                               reinterpret_cast<const std::uint32_t *>(next(4)),
+                               reinterpret_cast<const std::uint32_t *>(next(4)),
+                               reinterpret_cast<const std::uint32_t *>(next(4)),
+                               reinterpret_cast<const std::int32_t *>(next(4))};
+        blocks_.push_back(columns);
+      }
+      offset += sizeof(block_header) + block->size;
+    }
+    valid_ = true;
+  }
+
+public:
+  explicit reader(const std::string &filename) {
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+      return;
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+      void *mapped = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapped != MAP_FAILED) {
+        data_ = static_cast<const unsigned char *>(mapped);
+        size_ = st.st_size;
+      }
+    }
+    ::close(fd);
+    parse();
+  }
+
+  reader(const reader &) = delete;
+  reader &operator=(const reader &) = delete;
+
+  ~reader() {
+    if (data_)
+      ::munmap(const_cast<unsigned char *>(data_), size_);
+  }
+
+  // false if the file could not be read or is not a samples file
+  bool valid() const { return valid_; }
+
+  const std::vector<benchmark_info> &benchmarks() const { return benchmarks_; }
+
+  const std::vector<sample_columns> &sample_blocks() const { return blocks_; }
+};
+
+#endif
+
+} // namespace samples
+} // namespace criterion
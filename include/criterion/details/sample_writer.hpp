@@ -0,0 +1,217 @@
+#pragma once
+#include <criterion/details/sample_format.hpp>
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace criterion {
+
+// Streams every measured iteration to a file in the layout described in sample_format.hpp.
+// Rows are buffered per column and written as one samples block every `block_rows` rows, so
+// recording an iteration is a few appends to vectors that were reserved up front
+class sample_writer {
+  static constexpr std::size_t block_rows = 65536;
+
+#if defined(__unix__) || defined(__APPLE__)
+  int fd_{-1};
+#else
+  std::ofstream os_;
+#endif
+  bool good_{false};
+  std::chrono::steady_clock::time_point origin_;
+  std::uint32_t num_benchmarks_{0};
+
+  std::vector<std::uint64_t> timestamp_;
+  std::vector<std::int64_t> duration_;
+  std::vector<std::uint32_t> benchmark_;
+  std::vector<std::uint32_t> run_;
+  std::vector<std::uint32_t> batch_size_;
+  std::vector<std::int32_t> cpu_;
+
+  struct chunk {
+    const void *data;
+    std::size_t size;
+  };
+
+  // Writes the chunks back to back, with a single writev where available
+  bool write(std::vector<chunk> chunks) {
+    if (!good_)
+      return false;
+#if defined(__unix__) || defined(__APPLE__)
+    std::vector<iovec> buffers;
+    buffers.reserve(chunks.size());
+    for (const auto &c : chunks) {
+      if (c.size > 0)
+        buffers.push_back({const_cast<void *>(c.data), c.size});
+    }
+    std::size_t first = 0;
+    while (first < buffers.size()) {
+      const auto count = std::min<std::size_t>(buffers.size() - first, IOV_MAX);
+      const auto written = ::writev(fd_, buffers.data() + first, static_cast<int>(count));
+      if (written < 0) {
+        if (errno == EINTR)
+          continue;
+        good_ = false;
+        return false;
+      }
+      // skip what was written, which may end in the middle of a buffer
+      auto remaining = static_cast<std::size_t>(written);
+      while (first < buffers.size() && remaining >= buffers[first].iov_len) {
+        remaining -= buffers[first].iov_len;
+        first += 1;
+      }
+      if (first < buffers.size()) {
+        buffers[first].iov_base = static_cast<char *>(buffers[first].iov_base) + remaining;
+        buffers[first].iov_len -= remaining;
+      }
+    }
+#else
+    for (const auto &c : chunks) {
+      os_.write(static_cast<const char *>(c.data), c.size);
+    }
+    good_ = os_.good();
+#endif
+    return good_;
+  }
+
+  static int current_cpu() {
+#if defined(__linux__)
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+  }
+
+public:
+  sample_writer() = default;
+  sample_writer(const sample_writer &) = delete;
+  sample_writer &operator=(const sample_writer &) = delete;
+
+  ~sample_writer() { close(); }
+
+  bool open(const std::string &filename) {
+#if defined(__unix__) || defined(__APPLE__)
+    fd_ = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    good_ = fd_ >= 0;
+#else
+    os_.open(filename, std::ios::binary | std::ios::trunc);
+    good_ = os_.is_open();
+#endif
+    origin_ = std::chrono::steady_clock::now();
+
+    timestamp_.reserve(block_rows);
+    duration_.reserve(block_rows);
+    benchmark_.reserve(block_rows);
+    run_.reserve(block_rows);
+    batch_size_.reserve(block_rows);
+    cpu_.reserve(block_rows);
+
+    samples::file_header header{};
+    std::copy(std::begin(samples::magic), std::end(samples::magic), header.magic);
+    header.version = samples::version;
+    return write({{&header, sizeof(header)}});
+  }
+
+  bool good() const { return good_; }
+
+  // Starts a benchmark, returning the id to pass to add()
+  std::uint32_t add_benchmark(const std::string &name, long double measurement_cost) {
+    flush();
+    const auto id = num_benchmarks_++;
+    const samples::benchmark_payload payload{static_cast<double>(measurement_cost), name.size()};
+    const auto payload_size = sizeof(payload) + name.size();
+    const samples::block_header block{static_cast<std::uint32_t>(samples::block_kind::benchmark),
+                                      id, samples::padded(payload_size)};
+    static constexpr char zeros[8]{};
+    write({{&block, sizeof(block)},
+           {&payload, sizeof(payload)},
+           {name.data(), name.size()},
+           {zeros, samples::padded(payload_size) - payload_size}});
+    return id;
+  }
+
+  // Records one iteration of `benchmark` that started at `start` and took `duration` ns
+  void add(std::uint32_t benchmark, std::uint32_t run, std::uint32_t batch_size,
+           std::chrono::steady_clock::time_point start, std::int64_t duration) {
+    if (!good_)
+      return;
+    timestamp_.push_back(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(start - origin_).count());
+    duration_.push_back(duration);
+    benchmark_.push_back(benchmark);
+    run_.push_back(run);
+    batch_size_.push_back(batch_size);
+    cpu_.push_back(current_cpu());
+    if (timestamp_.size() >= block_rows)
+      flush();
+  }
+
+  // Writes the buffered rows as a samples block
+  bool flush() {
+    const auto rows = timestamp_.size();
+    if (rows == 0)
+      return good_;
+
+    static constexpr char zeros[8]{};
+    const auto padding = [&](std::size_t width) {
+      return chunk{zeros, samples::padded(rows * width) - rows * width};
+    };
+    const samples::block_header block{
+        static_cast<std::uint32_t>(samples::block_kind::samples), static_cast<std::uint32_t>(rows),
+        2 * samples::padded(rows * 8) + 4 * samples::padded(rows * 4)};
+    const auto result = write({{&block, sizeof(block)},
+                               {timestamp_.data(), rows * 8},
+                               {duration_.data(), rows * 8},
+                               {benchmark_.data(), rows * 4},
+                               padding(4),
+                               {run_.data(), rows * 4},
+                               padding(4),
+                               {batch_size_.data(), rows * 4},
+                               padding(4),
+                               {cpu_.data(), rows * 4},
+                               padding(4)});
+
+    timestamp_.clear();
+    duration_.clear();
+    benchmark_.clear();
+    run_.clear();
+    batch_size_.clear();
+    cpu_.clear();
+    return result;
+  }
+
+  bool close() {
+    flush();
+#if defined(__unix__) || defined(__APPLE__)
+    if (fd_ >= 0) {
+      if (::close(fd_) != 0)
+        good_ = false;
+      fd_ = -1;
+    }
+#else
+    if (os_.is_open()) {
+      os_.close();
+      good_ = good_ && !os_.fail();
+    }
+#endif
+    return good_;
+  }
+};
+
+} // namespace criterion
@@ -0,0 +1,323 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace criterion {
+
+inline long double sample_mean(const std::vector<long double> &samples) {
+  if (samples.empty())
+    return 0;
+  return std::accumulate(samples.begin(), samples.end(), 0.0L) / samples.size();
+}
+
+// Unbiased sample variance
+inline long double sample_variance(const std::vector<long double> &samples) {
+  if (samples.size() < 2)
+    return 0;
+  const auto m = sample_mean(samples);
+  long double E = 0;
+  for (const auto sample : samples) {
+    E += std::pow(sample - m, 2);
+  }
+  return E / (samples.size() - 1);
+}
+
+// Linearly interpolated quantile, e.g., q = 0.5 for the median
+inline long double sample_quantile(std::vector<long double> samples, long double q) {
+  if (samples.empty())
+    return 0;
+  std::sort(samples.begin(), samples.end());
+  const auto position = std::clamp(q, 0.0L, 1.0L) * (samples.size() - 1);
+  const auto below = static_cast<std::size_t>(position);
+  const auto above = std::min(below + 1, samples.size() - 1);
+  return samples[below] + (position - below) * (samples[above] - samples[below]);
+}
+
+inline long double sample_median(const std::vector<long double> &samples) {
+  return sample_quantile(samples, 0.5);
+}
+
+// z such that P(Z <= z) = p for a standard normal Z, e.g., 1.96 for p = 0.975
+inline long double normal_quantile(long double p) {
+  long double low = -40, high = 40;
+  for (std::size_t i = 0; i < 200; ++i) {
+    const auto mid = (low + high) / 2;
+    if (std::erfc(-mid / std::sqrt(2.0L)) / 2 < p) {
+      low = mid;
+    } else {
+      high = mid;
+    }
+  }
+  return (low + high) / 2;
+}
+
+// Outliers by Tukey's fences: samples more than 1.5 (mild) or 3 (severe) interquartile ranges
+// below the first or above the third quartile
+struct outlier_classification {
+  long double severe_low_fence;
+  long double mild_low_fence;
+  long double mild_high_fence;
+  long double severe_high_fence;
+  std::size_t low_severe{0};
+  std::size_t low_mild{0};
+  std::size_t high_mild{0};
+  std::size_t high_severe{0};
+
+  std::size_t total() const { return low_severe + low_mild + high_mild + high_severe; }
+
+  bool severe(long double sample) const {
+    return sample < severe_low_fence || sample > severe_high_fence;
+  }
+
+  bool mild_or_severe(long double sample) const {
+    return sample < mild_low_fence || sample > mild_high_fence;
+  }
+};
+
+inline outlier_classification classify_outliers(const std::vector<long double> &samples) {
+  const auto q1 = sample_quantile(samples, 0.25);
+  const auto q3 = sample_quantile(samples, 0.75);
+  const auto iqr = q3 - q1;
+  outlier_classification result{q1 - 3 * iqr, q1 - 1.5L * iqr, q3 + 1.5L * iqr, q3 + 3 * iqr};
+  for (const auto sample : samples) {
+    if (sample < result.severe_low_fence) {
+      result.low_severe += 1;
+    } else if (sample < result.mild_low_fence) {
+      result.low_mild += 1;
+    } else if (sample > result.severe_high_fence) {
+      result.high_severe += 1;
+    } else if (sample > result.mild_high_fence) {
+      result.high_mild += 1;
+    }
+  }
+  return result;
+}
+
+// Two-sided p-value of the Mann-Whitney U test that `a` and `b` come from the same distribution.
+// Uses the normal approximation, with tie and continuity corrections
+inline long double mann_whitney_u_p_value(const std::vector<long double> &a,
+                                          const std::vector<long double> &b) {
+  const long double n1 = a.size();
+  const long double n2 = b.size();
+  if (a.empty() || b.empty())
+    return 1;
+
+  // rank the pooled samples, giving tied samples their average rank
+  std::vector<std::pair<long double, bool>> pooled; // (sample, is from a)
+  pooled.reserve(a.size() + b.size());
+  for (const auto sample : a)
+    pooled.push_back({sample, true});
+  for (const auto sample : b)
+    pooled.push_back({sample, false});
+  std::sort(pooled.begin(), pooled.end(),
+            [](const auto &lhs, const auto &rhs) { return lhs.first < rhs.first; });
+
+  long double rank_sum = 0; // of the samples from `a`
+  long double tie_term = 0; // sum of t^3 - t over groups of t tied samples
+  for (std::size_t i = 0; i < pooled.size();) {
+    std::size_t j = i;
+    while (j < pooled.size() && pooled[j].first == pooled[i].first)
+      j += 1;
+    const long double rank = (i + 1 + j) / 2.0L; // average of ranks i + 1 ... j
+    for (std::size_t k = i; k < j; ++k) {
+      if (pooled[k].second)
+        rank_sum += rank;
+    }
+    const long double t = j - i;
+    tie_term += t * t * t - t;
+    i = j;
+  }
+
+  const auto n = n1 + n2;
+  const auto u = rank_sum - n1 * (n1 + 1) / 2;
+  const auto mu = n1 * n2 / 2;
+  const auto sigma = std::sqrt(n1 * n2 / 12 * ((n + 1) - tie_term / (n * (n - 1))));
+  if (!(sigma > 0))
+    return 1;
+  const auto z = std::max(std::abs(u - mu) - 0.5L, 0.0L) / sigma;
+  return std::erfc(z / std::sqrt(2.0L));
+}
+
+struct sample_comparison {
+  long double relative_change; // (current - baseline) / baseline mean, e.g., -0.05 if 5% faster
+  long double lower_bound;     // confidence interval of relative_change
+  long double upper_bound;
+  long double p_value; // two-sided Mann-Whitney U test
+};
+
+// Compares two sets of samples, e.g., mean execution times per benchmark run. The interval of
+// relative_change covers `confidence_level`, e.g., 0.95
+inline sample_comparison compare_samples(const std::vector<long double> &baseline,
+                                         const std::vector<long double> &current,
+                                         long double confidence_level = 0.95) {
+  const auto baseline_mean = sample_mean(baseline);
+  const auto current_mean = sample_mean(current);
+  if (!(baseline_mean > 0))
+    return {0, 0, 0, 1};
+
+  // Welch's standard error of the difference of means
+  const auto squared_error = [](const std::vector<long double> &samples) {
+    return samples.size() < 2 ? 0 : sample_variance(samples) / samples.size();
+  };
+  const auto standard_error = std::sqrt(squared_error(baseline) + squared_error(current));
+  const auto relative_change = (current_mean - baseline_mean) / baseline_mean;
+  const auto z = normal_quantile(0.5L + confidence_level / 2);
+  const auto margin = z * standard_error / baseline_mean;
+  return {relative_change, relative_change - margin, relative_change + margin,
+          mann_whitney_u_p_value(baseline, current)};
+}
+
+struct change_point {
+  std::size_t index;       // of the first point after the change
+  long double confidence;  // e.g., 0.99
+  long double mean_before; // of the points since the previous change point
+  long double mean_after;  // of the points up to the next change point
+};
+
+// Change-point analysis with CUSUM and bootstrapping: the cumulative sum of a segment's deviations
+// from its mean peaks where the mean shifts, and the shift is significant if the range of the sum
+// exceeds that of most shuffled copies of the segment. Segments are split at significant peaks
+// and searched again. Shuffles are seeded, so a series always gives the same change points
+inline std::vector<change_point> detect_change_points(const std::vector<long double> &series,
+                                                      long double min_confidence = 0.95,
+                                                      std::size_t bootstraps = 1000) {
+  std::mt19937 random{0};
+
+  // (range of the CUSUM, index of its peak) of series[begin, end)
+  const auto cusum = [](std::vector<long double>::const_iterator begin,
+                        std::vector<long double>::const_iterator end) {
+    const auto size = static_cast<std::size_t>(end - begin);
+    const auto m = std::accumulate(begin, end, 0.0L) / size;
+    long double sum = 0, lowest = 0, highest = 0, peak = 0;
+    std::size_t peak_index = 0;
+    for (std::size_t i = 0; i + 1 < size; ++i) {
+      sum += *(begin + i) - m;
+      lowest = std::min(lowest, sum);
+      highest = std::max(highest, sum);
+      if (std::abs(sum) > peak) {
+        peak = std::abs(sum);
+        peak_index = i + 1;
+      }
+    }
+    return std::make_pair(highest - lowest, peak_index);
+  };
+
+  std::vector<std::pair<std::size_t, long double>> found; // (index, confidence)
+  std::vector<std::pair<std::size_t, std::size_t>> segments{{0, series.size()}};
+  std::vector<long double> shuffled;
+  while (!segments.empty()) {
+    const auto [begin, end] = segments.back();
+    segments.pop_back();
+    if (end - begin < 4)
+      continue;
+
+    const auto [range, peak] = cusum(series.begin() + begin, series.begin() + end);
+    if (!(range > 0) || peak == 0)
+      continue;
+
+    shuffled.assign(series.begin() + begin, series.begin() + end);
+    std::size_t smaller = 0;
+    for (std::size_t i = 0; i < bootstraps; ++i) {
+      std::shuffle(shuffled.begin(), shuffled.end(), random);
+      if (cusum(shuffled.begin(), shuffled.end()).first < range)
+        smaller += 1;
+    }
+    const auto confidence = static_cast<long double>(smaller) / bootstraps;
+    if (confidence < min_confidence)
+      continue;
+
+    found.push_back({begin + peak, confidence});
+    segments.push_back({begin, begin + peak});
+    segments.push_back({begin + peak, end});
+  }
+
+  std::sort(found.begin(), found.end());
+  std::vector<change_point> result;
+  for (std::size_t i = 0; i < found.size(); ++i) {
+    const auto previous = i == 0 ? 0 : found[i - 1].first;
+    const auto next = i + 1 == found.size() ? series.size() : found[i + 1].first;
+    const auto index = found[i].first;
+    result.push_back(
+        {index, found[i].second,
+         std::accumulate(series.begin() + previous, series.begin() + index, 0.0L) /
+             (index - previous),
+         std::accumulate(series.begin() + index, series.begin() + next, 0.0L) / (next - index)});
+  }
+  return result;
+}
+
+// How the execution time of a benchmark is estimated from its runs
+enum class estimator {
+  mean,      // mean of the run means (what a benchmark run reports)
+  median,    // median of the run medians
+  lowest_rsd // mean of the run with the lowest relative standard deviation
+};
+
+inline std::string to_string(estimator method) {
+  switch (method) {
+  case estimator::mean:
+    return "mean";
+  case estimator::median:
+    return "median";
+  case estimator::lowest_rsd:
+    return "lowest_rsd";
+  }
+  return "";
+}
+
+// Which outliers (see classify_outliers) are left out of an estimate
+enum class outlier_policy { keep, drop_severe, drop_mild };
+
+inline std::string to_string(outlier_policy policy) {
+  switch (policy) {
+  case outlier_policy::keep:
+    return "keep";
+  case outlier_policy::drop_severe:
+    return "severe";
+  case outlier_policy::drop_mild:
+    return "mild";
+  }
+  return "";
+}
+
+// Estimate of a benchmark's execution time, recomputed from stored samples
+struct sample_estimate {
+  estimator method;
+  long double estimate;
+  long double lower_bound; // confidence interval of the estimate
+  long double upper_bound;
+  long double confidence_level; // e.g., 0.95
+  outlier_classification outliers;
+  outlier_policy policy;
+  std::size_t num_dropped; // outliers left out due to the policy
+  std::size_t num_samples; // before dropping outliers
+};
+
+enum class baseline_verdict { improved, regressed, no_change };
+
+inline std::string to_string(baseline_verdict verdict) {
+  switch (verdict) {
+  case baseline_verdict::improved:
+    return "Improved";
+  case baseline_verdict::regressed:
+    return "Regressed";
+  case baseline_verdict::no_change:
+    return "No change";
+  }
+  return "";
+}
+
+// Outcome of comparing a benchmark against a saved baseline
+struct baseline_comparison {
+  std::string name;
+  std::string baseline_name;
+  sample_comparison comparison;
+  baseline_verdict verdict;
+};
+
+} // namespace criterion
@@ -0,0 +1,209 @@
+#pragma once
+#include <criterion/details/benchmark_result.hpp>
+#include <criterion/details/statistics.hpp>
+#include <criterion/details/time_budget.hpp>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <optional>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace criterion {
+
+enum class threshold_metric { max_time, max_regression, max_allocations };
+
+inline std::string to_string(threshold_metric metric) {
+  switch (metric) {
+  case threshold_metric::max_time:
+    return "max_time";
+  case threshold_metric::max_regression:
+    return "max_regression";
+  case threshold_metric::max_allocations:
+    return "max_allocations";
+  }
+  return "";
+}
+
+// One threshold applied to one benchmark. `value` is the mean execution time in ns, the change
+// from the baseline in %, or the heap allocations per iteration
+struct threshold_check {
+  std::string benchmark;
+  threshold_metric metric;
+  long double limit;
+  long double value;
+  std::optional<std::pair<long double, long double>> interval; // confidence interval of `value`
+  long double confidence_level;
+  bool passed;
+
+  static std::string format(threshold_metric metric, long double value) {
+    std::stringstream os;
+    os << std::fixed << std::setprecision(2) << value;
+    if (metric == threshold_metric::max_time) {
+      os << " ns";
+    } else if (metric == threshold_metric::max_regression) {
+      os << " %";
+    }
+    return os.str();
+  }
+
+  // e.g., "max_time: 1843.20 ns [1801.10 ns, 1885.30 ns] at 95 % confidence exceeds 1500.00 ns"
+  std::string message() const {
+    std::stringstream os;
+    os << to_string(metric) << ": " << format(metric, value);
+    if (interval.has_value()) {
+      os << " [" << format(metric, interval->first) << ", " << format(metric, interval->second)
+         << "] at " << std::setprecision(0) << std::fixed << confidence_level * 100
+         << " % confidence";
+    }
+    if (!passed) {
+      os << " exceeds ";
+    } else if (value > limit) {
+      os << " is not significantly above ";
+    } else {
+      os << " is within ";
+    }
+    os << format(metric, limit);
+    return os.str();
+  }
+};
+
+// Limits that benchmarks must stay within, read from a file with one rule per line:
+//
+//   # benchmark regex   metric            limit
+//   MergeSort/.*        max_time          2ms
+//   .*                  max_regression    5%
+//   Vector/Reserve.*    max_allocations   1
+//
+// A rule applies to every benchmark whose name matches the regex (like --run_filtered), and a
+// benchmark must pass all of the rules that apply to it
+class thresholds {
+  struct rule {
+    std::string pattern;
+    std::regex regexp;
+    threshold_metric metric;
+    long double limit; // ns, % or allocations per iteration, like threshold_check::value
+  };
+
+  static std::optional<long double> parse_limit(threshold_metric metric, std::string value) {
+    if (metric == threshold_metric::max_time) {
+      const auto duration = parse_duration(value);
+      if (!duration.has_value())
+        return std::nullopt;
+      return static_cast<long double>(duration->count());
+    }
+    if (metric == threshold_metric::max_regression && !value.empty() && value.back() == '%')
+      value.pop_back();
+    std::size_t parsed = 0;
+    long double limit = 0;
+    try {
+      limit = std::stold(value, &parsed);
+    } catch (...) {
+      return std::nullopt;
+    }
+    if (parsed != value.size() || limit < 0)
+      return std::nullopt;
+    return limit;
+  }
+
+public:
+  std::vector<rule> rules;
+
+  static std::optional<thresholds> load(const std::string &filename) {
+    std::ifstream is(filename);
+    if (!is.is_open())
+      return std::nullopt;
+
+    thresholds result;
+    std::string line;
+    while (std::getline(is, line)) {
+      const auto comment = line.find('#');
+      if (comment != std::string::npos)
+        line.erase(comment);
+      std::istringstream fields(line);
+      std::string pattern, metric_name, limit, extra;
+      if (!(fields >> pattern))
+        continue;
+      if (!(fields >> metric_name >> limit) || (fields >> extra))
+        return std::nullopt;
+
+      std::optional<threshold_metric> metric;
+      for (const auto m : {threshold_metric::max_time, threshold_metric::max_regression,
+                           threshold_metric::max_allocations}) {
+        if (metric_name == to_string(m))
+          metric = m;
+      }
+      if (!metric.has_value())
+        return std::nullopt;
+      const auto value = parse_limit(metric.value(), limit);
+      if (!value.has_value())
+        return std::nullopt;
+      try {
+        result.rules.push_back({pattern, std::regex(pattern), metric.value(), value.value()});
+      } catch (const std::regex_error &) {
+        return std::nullopt;
+      }
+    }
+    return result;
+  }
+
+  bool uses(threshold_metric metric) const {
+    for (const auto &r : rules) {
+      if (r.metric == metric)
+        return true;
+    }
+    return false;
+  }
+
+  // Checks the benchmarks in `order` against every rule that applies to them. max_regression is
+  // only checked for benchmarks in `comparisons` (i.e., with --baseline), and only fails if the
+  // whole confidence interval of the change is above the limit. max_allocations is only checked
+  // if allocations were counted
+  std::vector<threshold_check>
+  evaluate(const std::vector<std::string> &order,
+           const std::unordered_map<std::string, benchmark_result> &results,
+           const std::unordered_map<std::string, baseline_comparison> &comparisons,
+           long double confidence_level) const {
+    const auto z = normal_quantile(0.5L + confidence_level / 2);
+    std::vector<threshold_check> checks;
+    for (const auto &name : order) {
+      const auto &result = results.at(name);
+      for (const auto &r : rules) {
+        if (!std::regex_search(name.begin(), name.end(), r.regexp))
+          continue;
+        threshold_check check{name, r.metric, r.limit, 0, std::nullopt, confidence_level, true};
+        if (r.metric == threshold_metric::max_time) {
+          const auto margin =
+              result.samples.empty()
+                  ? 0
+                  : z * std::sqrt(sample_variance(result.samples) / result.samples.size());
+          check.value = result.mean_execution_time;
+          check.interval = std::make_pair(check.value - margin, check.value + margin);
+          check.passed = check.value <= r.limit;
+        } else if (r.metric == threshold_metric::max_regression) {
+          const auto it = comparisons.find(name);
+          if (it == comparisons.end())
+            continue;
+          const auto &comparison = it->second.comparison;
+          check.value = comparison.relative_change * 100;
+          check.interval =
+              std::make_pair(comparison.lower_bound * 100, comparison.upper_bound * 100);
+          check.passed = check.interval->first <= r.limit;
+        } else {
+          if (!result.allocations_per_iteration.has_value())
+            continue;
+          check.value = result.allocations_per_iteration.value();
+          check.passed = check.value <= r.limit;
+        }
+        checks.push_back(check);
+      }
+    }
+    return checks;
+  }
+};
+
+} // namespace criterion
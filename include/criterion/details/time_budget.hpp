@@ -0,0 +1,174 @@
+#pragma once
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace criterion {
+
+// Parses durations like "15m", "90s", "1h30m" or "250ms". A number without a unit is in seconds.
+// Durations that do not fit in std::chrono::nanoseconds, about 292 years, are rejected
+inline std::optional<std::chrono::nanoseconds> parse_duration(const std::string &input) {
+  long double result = 0;
+  std::size_t i = 0;
+  while (i < input.size()) {
+    const auto number_start = i;
+    while (i < input.size() && (std::isdigit(static_cast<unsigned char>(input[i])) ||
+                                input[i] == '.')) {
+      i += 1;
+    }
+    const auto unit_start = i;
+    while (i < input.size() && std::isalpha(static_cast<unsigned char>(input[i]))) {
+      i += 1;
+    }
+    const auto number = input.substr(number_start, unit_start - number_start);
+    if (number.empty() || std::count(number.begin(), number.end(), '.') > 1)
+      return std::nullopt;
+
+    long double value = 0;
+    std::size_t parsed = 0;
+    try {
+      value = std::stold(number, &parsed);
+    } catch (...) {
+      return std::nullopt;
+    }
+    if (parsed != number.size())
+      return std::nullopt;
+
+    const auto unit = input.substr(unit_start, i - unit_start);
+    if (unit == "ns") {
+      result += value;
+    } else if (unit == "us") {
+      result += value * 1e3;
+    } else if (unit == "ms") {
+      result += value * 1e6;
+    } else if (unit == "s" || (unit.empty() && number_start == 0 && i == input.size())) {
+      result += value * 1e9;
+    } else if (unit == "m" || unit == "min") {
+      result += value * 60e9;
+    } else if (unit == "h") {
+      result += value * 3600e9;
+    } else {
+      return std::nullopt;
+    }
+  }
+  if (result < 1 || result >= static_cast<long double>(std::chrono::nanoseconds::max().count()))
+    return std::nullopt;
+  return std::chrono::nanoseconds(static_cast<std::chrono::nanoseconds::rep>(result));
+}
+
+// What a short pilot run learned about a benchmark instance. Times are in nanoseconds
+struct budget_pilot {
+  std::string name;
+  long double iteration_cost;              // wall time per iteration, incl. setup and teardown
+  long double relative_standard_deviation; // of the measured execution time, e.g., 0.05 for 5%
+  long double fixed_cost;     // time spent regardless of the allocation, e.g., warming up
+  std::size_t batch_size;     // iterations per run
+  bool adjustable_batch_size; // false if set by the benchmark's options
+  bool allocatable;           // false if the benchmark's options fix the number of samples
+};
+
+struct budget_allocation {
+  long double time;                    // time to spend on benchmark runs
+  std::size_t batch_size;              // iterations per run
+  std::size_t iterations;              // expected number of iterations
+  long double relative_standard_error; // expected error of the mean, e.g., 0.01 for 1%
+  bool under_sampled; // fewer than two iterations, or more than the acceptable error
+};
+
+// Splits `available` nanoseconds across benchmark instances. The relative standard error of an
+// instance's mean is rsd / sqrt(time / cost), so the summed squared error is smallest when each
+// instance gets time in proportion to rsd * sqrt(cost). Instances that cannot afford a single
+// iteration get exactly one, and the rest of the budget is split again
+inline std::vector<budget_allocation>
+allocate_time_budget(const std::vector<budget_pilot> &pilots, long double available,
+                     long double acceptable_relative_standard_error = 0.01) {
+  const auto weight = [](const budget_pilot &pilot) {
+    return std::max(pilot.relative_standard_deviation, (long double)0.01) *
+           std::sqrt(pilot.iteration_cost);
+  };
+
+  long double remaining = available;
+  for (const auto &pilot : pilots) {
+    remaining -= pilot.fixed_cost;
+  }
+
+  std::vector<bool> single_iteration(pilots.size(), false);
+  std::vector<long double> times(pilots.size(), 0);
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    long double total_weight = 0;
+    long double share = remaining;
+    for (std::size_t i = 0; i < pilots.size(); ++i) {
+      if (!pilots[i].allocatable)
+        continue;
+      if (single_iteration[i]) {
+        share -= pilots[i].iteration_cost;
+      } else {
+        total_weight += weight(pilots[i]);
+      }
+    }
+    share = std::max(share, (long double)0);
+
+    for (std::size_t i = 0; i < pilots.size(); ++i) {
+      if (!pilots[i].allocatable)
+        continue;
+      if (single_iteration[i]) {
+        times[i] = pilots[i].iteration_cost;
+        continue;
+      }
+      times[i] = total_weight > 0 ? share * weight(pilots[i]) / total_weight : 0;
+      if (times[i] < pilots[i].iteration_cost) {
+        single_iteration[i] = true;
+        changed = true;
+      }
+    }
+  }
+
+  std::vector<budget_allocation> result;
+  result.reserve(pilots.size());
+  for (std::size_t i = 0; i < pilots.size(); ++i) {
+    const auto &pilot = pilots[i];
+    if (!pilot.allocatable) {
+      result.push_back({0, pilot.batch_size, 0, 0, false});
+      continue;
+    }
+    auto batch_size = pilot.batch_size;
+    if (pilot.adjustable_batch_size && pilot.iteration_cost > 0) {
+      // leave room for at least two runs
+      const auto affordable = static_cast<std::size_t>(times[i] / (2 * pilot.iteration_cost));
+      batch_size = std::clamp(affordable, std::size_t{1}, pilot.batch_size);
+    }
+    const auto iterations = std::max(static_cast<std::size_t>(times[i] / pilot.iteration_cost),
+                                     std::size_t{1});
+    const auto relative_standard_error =
+        pilot.relative_standard_deviation / std::sqrt((long double)iterations);
+    result.push_back({times[i], batch_size, iterations, relative_standard_error,
+                      iterations < 2 ||
+                          relative_standard_error > acceptable_relative_standard_error});
+  }
+  return result;
+}
+
+// Summary of a run with --time_budget
+struct time_budget_report {
+  struct under_sampled_benchmark {
+    std::string name;
+    long double allocated_time;
+    std::size_t iterations;
+    long double relative_standard_error;
+  };
+
+  long double budget;
+  long double pilot_time;
+  long double elapsed_time;
+  std::size_t num_benchmarks;
+  std::vector<under_sampled_benchmark> under_sampled;
+};
+
+} // namespace criterion
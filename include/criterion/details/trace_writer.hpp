@@ -0,0 +1,197 @@
+#pragma once
+#include <criterion/details/json_string.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace criterion {
+
+// Writes a timeline of the benchmark run in the Chrome trace event format, which
+// chrome://tracing and https://ui.perfetto.dev open. Phases are complete ("X") events on one
+// track per thread, and per-run statistics are counter ("C") events. Events are written in the
+// JSON array format, whose closing ']' is optional, and only whole: they are buffered and written
+// after every benchmark or once the buffer is full. A trace that was cut short by a crash still
+// loads, up to the last events written
+class trace_writer {
+  static constexpr std::size_t buffer_size_{1 << 16};
+
+#if defined(__unix__) || defined(__APPLE__)
+  int fd_{-1};
+#else
+  std::ofstream os_;
+#endif
+  bool open_{false};
+  bool good_{false};
+  std::string buffer_;
+  bool first_{true};
+  std::chrono::steady_clock::time_point origin_;
+  std::unordered_map<std::thread::id, std::uint32_t> threads_;
+  std::unordered_map<std::string, std::uint32_t> tracks_;
+  std::uint32_t num_tracks_{0};
+
+  static std::string quote(const std::string &value) {
+    return "\"" + detail::json_escape(value) + "\"";
+  }
+
+  // microseconds since the trace was opened, with nanosecond precision
+  std::string timestamp(std::chrono::steady_clock::time_point t) const {
+    std::stringstream os;
+    os << std::fixed << std::setprecision(3)
+       << std::chrono::duration_cast<std::chrono::nanoseconds>(t - origin_).count() / 1E3;
+    return os.str();
+  }
+
+  // JSON has no NaN or infinity, e.g., for the RSD of a run whose mean is 0
+  static long double finite(long double value) { return std::isfinite(value) ? value : 0; }
+
+  void event(const std::string &body) {
+    buffer_ += (first_ ? "\n{" : ",\n{") + body + "}";
+    first_ = false;
+    if (buffer_.size() >= buffer_size_)
+      flush();
+  }
+
+  std::uint32_t new_track(const std::string &name) {
+    const auto id = ++num_tracks_;
+    event("\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(id) +
+          ",\"args\":{\"name\":" + quote(name) + "}");
+    event("\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(id) +
+          ",\"args\":{\"sort_index\":" + std::to_string(id) + "}");
+    return id;
+  }
+
+public:
+  using args = std::vector<std::pair<std::string, long double>>;
+
+  trace_writer() = default;
+  trace_writer(const trace_writer &) = delete;
+  trace_writer &operator=(const trace_writer &) = delete;
+
+  ~trace_writer() { close(); }
+
+  bool open(const std::string &filename, const std::string &process_name) {
+#if defined(__unix__) || defined(__APPLE__)
+    fd_ = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    open_ = fd_ >= 0;
+#else
+    os_.open(filename, std::ios::binary | std::ios::trunc);
+    open_ = os_.is_open();
+#endif
+    if (!open_)
+      return false;
+    good_ = true;
+    origin_ = std::chrono::steady_clock::now();
+    buffer_ = "[";
+    event("\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":" +
+          quote(process_name) + "}");
+    return flush();
+  }
+
+  // Writes the buffered events, e.g., after each benchmark
+  bool flush() {
+    if (!open_ || !good_)
+      return false;
+#if defined(__unix__) || defined(__APPLE__)
+    std::size_t written = 0;
+    while (written < buffer_.size()) {
+      const auto n = ::write(fd_, buffer_.data() + written, buffer_.size() - written);
+      if (n < 0) {
+        if (errno == EINTR)
+          continue;
+        good_ = false;
+        break;
+      }
+      written += static_cast<std::size_t>(n);
+    }
+#else
+    os_ << buffer_;
+    os_.flush();
+    good_ = os_.good();
+#endif
+    buffer_.clear();
+    return good_;
+  }
+
+  // The track of the calling thread, which is named `name` the first time
+  std::uint32_t thread_track(const std::string &name) {
+    const auto id = std::this_thread::get_id();
+    const auto it = threads_.find(id);
+    if (it != threads_.end())
+      return it->second;
+    return threads_[id] = new_track(name);
+  }
+
+  // A track that is not tied to a thread of this process, e.g., for background threads that
+  // record nothing themselves
+  std::uint32_t track(const std::string &name) {
+    const auto it = tracks_.find(name);
+    if (it != tracks_.end())
+      return it->second;
+    return tracks_[name] = new_track(name);
+  }
+
+  void complete(std::uint32_t track, const std::string &name, const std::string &category,
+                std::chrono::steady_clock::time_point start,
+                std::chrono::steady_clock::time_point end, const args &arguments = {}) {
+    if (!open_)
+      return;
+    std::stringstream os;
+    os << "\"name\":" << quote(name) << ",\"cat\":" << quote(category)
+       << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << track << ",\"ts\":" << timestamp(start)
+       << ",\"dur\":" << std::fixed << std::setprecision(3)
+       << std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / 1E3;
+    if (!arguments.empty()) {
+      os << ",\"args\":{";
+      for (std::size_t i = 0; i < arguments.size(); ++i) {
+        os << (i > 0 ? "," : "") << quote(arguments[i].first) << ":" << std::setprecision(2)
+           << finite(arguments[i].second);
+      }
+      os << "}";
+    }
+    event(os.str());
+  }
+
+  // One sample of the counter track `name`
+  void counter(const std::string &name, std::chrono::steady_clock::time_point t,
+               long double value) {
+    if (!open_)
+      return;
+    std::stringstream os;
+    os << "\"name\":" << quote(name) << ",\"ph\":\"C\",\"pid\":1,\"ts\":" << timestamp(t)
+       << ",\"args\":{\"value\":" << std::fixed << std::setprecision(2) << finite(value) << "}";
+    event(os.str());
+  }
+
+  bool close() {
+    if (!open_)
+      return false;
+    buffer_ += "\n]\n";
+    flush();
+    open_ = false;
+#if defined(__unix__) || defined(__APPLE__)
+    if (::close(fd_) != 0)
+      good_ = false;
+    fd_ = -1;
+#else
+    os_.close();
+    good_ = good_ && !os_.fail();
+#endif
+    return good_;
+  }
+};
+
+} // namespace criterion
@@ -0,0 +1,197 @@
+#pragma once
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include <criterion/details/macros.hpp>
+
+namespace criterion {
+
+template <class... Types> struct type_list {};
+
+template <auto... Values> struct value_list {};
+
+// Stands in for a type in generic lambdas, e.g., [](auto tag) { using U = typename
+// decltype(tag)::type; }
+template <class T> struct type_tag { using type = T; };
+
+namespace detail {
+
+// Splits a stringized, parenthesized list like "(std::map<int, int>, std::list<int>)" on its
+// top-level commas: {"std::map<int, int>", "std::list<int>"}
+inline std::vector<std::string> split_stringized_list(const std::string &list) {
+  auto trim = [](const std::string &s) {
+    const auto first = s.find_first_not_of(" \t\n");
+    if (first == std::string::npos)
+      return std::string{""};
+    const auto last = s.find_last_not_of(" \t\n");
+    return s.substr(first, last - first + 1);
+  };
+
+  auto input = trim(list);
+  if (input.size() >= 2 && input.front() == '(' && input.back() == ')')
+    input = input.substr(1, input.size() - 2);
+
+  std::vector<std::string> result;
+  std::string current{""};
+  int depth = 0;
+  for (const auto c : input) {
+    if (c == '<' || c == '(' || c == '[' || c == '{') {
+      depth += 1;
+    } else if (c == '>' || c == ')' || c == ']' || c == '}') {
+      depth -= 1;
+    } else if (c == ',' && depth == 0) {
+      result.push_back(trim(current));
+      current.clear();
+      continue;
+    }
+    current += c;
+  }
+  result.push_back(trim(current));
+  return result;
+}
+
+} // namespace detail
+
+struct typed_benchmark_registration_helper_struct {
+  // Registers one template per type, all found under `template_name` by the INVOKE_BENCHMARK
+  // macros and named after the type, e.g., "Forward<std::vector<int>>"
+  template <class ArgTuple, class MakeFn, class... Types>
+  static void register_typed_benchmark_template(const std::string &template_name,
+                                                const std::string &stringized_types,
+                                                MakeFn &&make_fn, type_list<Types...>) {
+    const auto type_names = detail::split_stringized_list(stringized_types);
+    std::size_t index = 0;
+    (benchmark_template_registration_helper_struct::register_benchmark_template(
+         template_name,
+         benchmark_config{.name = template_name + "<" +
+                                  (index < type_names.size() ? type_names[index++] : "") + ">",
+                          .fn = make_fn(type_tag<Types>{})}),
+     ...);
+
+    // benchmarks without parameters have a single, implicit instance per type
+    if constexpr (std::tuple_size_v<ArgTuple> == 0) {
+      benchmark_template_registration_helper_struct::execute_registered_benchmark_template(
+          template_name, "", benchmark_config::empty_tuple);
+    }
+  }
+
+  // Same as above, but one template per compile-time value, e.g., "Blocked<16>"
+  template <class ArgTuple, class MakeFn, auto... Values>
+  static void register_value_benchmark_template(const std::string &template_name,
+                                                const std::string &stringized_values,
+                                                MakeFn &&make_fn, value_list<Values...>) {
+    const auto value_names = detail::split_stringized_list(stringized_values);
+    std::size_t index = 0;
+    const auto value_name = [&](auto value) {
+      const auto name = index < value_names.size() ? value_names[index] : "";
+      index += 1;
+      if constexpr (std::is_same_v<decltype(value), bool>) {
+        return std::string{value ? "true" : "false"};
+      } else if constexpr (std::is_integral_v<decltype(value)>) {
+        return std::to_string(value);
+      } else {
+        return name;
+      }
+    };
+    (benchmark_template_registration_helper_struct::register_benchmark_template(
+         template_name,
+         benchmark_config{.name = template_name + "<" + value_name(Values) + ">",
+                          .fn = make_fn(std::integral_constant<decltype(Values), Values>{})}),
+     ...);
+
+    // benchmarks without parameters have a single, implicit instance per value
+    if constexpr (std::tuple_size_v<ArgTuple> == 0) {
+      benchmark_template_registration_helper_struct::execute_registered_benchmark_template(
+          template_name, "", benchmark_config::empty_tuple);
+    }
+  }
+};
+
+} // namespace criterion
+
+// Same as BENCHMARK, but the body is instantiated once per type in the parenthesized Types list,
+// e.g., TYPED_BENCHMARK(Forward, (std::vector<int>, std::list<int>), std::size_t).
+// Use TypeParam inside the body to refer to the type of the current instantiation
+#define TYPED_BENCHMARK(Name, Types, ...)                                                          \
+  typedef std::tuple<__VA_ARGS__> CONCAT(Name, BenchmarkParameters);                               \
+  namespace detail {                                                                               \
+  /* forward declare the benchmark function that we define later */                                \
+  template <class TypeParam, class T = CONCAT(Name, BenchmarkParameters)>                          \
+  struct CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__)) {                          \
+    static inline void CONCAT(Name, CONCAT(_registered_fun_, __LINE__))(                           \
+        std::chrono::steady_clock::time_point &,                                                   \
+        std::optional<std::chrono::steady_clock::time_point> &, void *);                           \
+  };                                                                                               \
+                                                                                                   \
+  namespace /* ensure internal linkage for struct */                                               \
+  {                                                                                                \
+  /* helper struct for static registration in ctor */                                              \
+  struct CONCAT(Name, CONCAT(_register_struct_, __LINE__)) {                                       \
+    CONCAT(Name, CONCAT(_register_struct_, __LINE__))() { /* called once before main */            \
+      criterion::typed_benchmark_registration_helper_struct::register_typed_benchmark_template<    \
+          CONCAT(Name, BenchmarkParameters)>(                                                      \
+          #Name, #Types,                                                                           \
+          [](auto tag) {                                                                           \
+            using TypeParam = typename decltype(tag)::type;                                        \
+            return criterion::benchmark_config::Fn{                                                \
+                CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__)) <                   \
+                TypeParam > ::CONCAT(Name, CONCAT(_registered_fun_, __LINE__))};                   \
+          },                                                                                       \
+          criterion::type_list<PASS_PARAMETERS(Types)>{});                                         \
+    }                                                                                              \
+  } CONCAT(Name, CONCAT(_register_struct_instance_, __LINE__));                                    \
+  }                                                                                                \
+  }                                                                                                \
+                                                                                                   \
+  /* now actually defined to allow TYPED_BENCHMARK("name") { ... } syntax */                       \
+  template <class TypeParam, class T>                                                              \
+  void detail::CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__))<TypeParam, T>::      \
+      CONCAT(Name, CONCAT(_registered_fun_, __LINE__))(                                            \
+          [[maybe_unused]] std::chrono::steady_clock::time_point & __benchmark_start_timestamp,    \
+          [[maybe_unused]] std::optional<std::chrono::steady_clock::time_point> &                  \
+              __benchmark_teardown_timestamp,                                                      \
+          [[maybe_unused]] void *__benchmark_parameters)
+
+// Same as BENCHMARK, but the body is instantiated once per value in the parenthesized Values list,
+// with the value available as a compile-time constant named ValueName, e.g.,
+// VALUE_BENCHMARK(Blocked, BlockSize, (16, 32, 64, 128), std::size_t)
+#define VALUE_BENCHMARK(Name, ValueName, Values, ...)                                              \
+  typedef std::tuple<__VA_ARGS__> CONCAT(Name, BenchmarkParameters);                               \
+  namespace detail {                                                                               \
+  /* forward declare the benchmark function that we define later */                                \
+  template <auto ValueName, class T = CONCAT(Name, BenchmarkParameters)>                           \
+  struct CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__)) {                          \
+    static inline void CONCAT(Name, CONCAT(_registered_fun_, __LINE__))(                           \
+        std::chrono::steady_clock::time_point &,                                                   \
+        std::optional<std::chrono::steady_clock::time_point> &, void *);                           \
+  };                                                                                               \
+                                                                                                   \
+  namespace /* ensure internal linkage for struct */                                               \
+  {                                                                                                \
+  /* helper struct for static registration in ctor */                                              \
+  struct CONCAT(Name, CONCAT(_register_struct_, __LINE__)) {                                       \
+    CONCAT(Name, CONCAT(_register_struct_, __LINE__))() { /* called once before main */            \
+      criterion::typed_benchmark_registration_helper_struct::register_value_benchmark_template<    \
+          CONCAT(Name, BenchmarkParameters)>(                                                      \
+          #Name, #Values,                                                                          \
+          [](auto constant) {                                                                      \
+            return criterion::benchmark_config::Fn{                                                \
+                CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__)) <                   \
+                decltype(constant)::value > ::CONCAT(Name, CONCAT(_registered_fun_, __LINE__))};   \
+          },                                                                                       \
+          criterion::value_list<PASS_PARAMETERS(Values)>{});                                       \
+    }                                                                                              \
+  } CONCAT(Name, CONCAT(_register_struct_instance_, __LINE__));                                    \
+  }                                                                                                \
+  }                                                                                                \
+                                                                                                   \
+  /* now actually defined to allow VALUE_BENCHMARK("name") { ... } syntax */                       \
+  template <auto ValueName, class T>                                                               \
+  void detail::CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__))<ValueName, T>::      \
+      CONCAT(Name, CONCAT(_registered_fun_, __LINE__))(                                            \
+          [[maybe_unused]] std::chrono::steady_clock::time_point & __benchmark_start_timestamp,    \
+          [[maybe_unused]] std::optional<std::chrono::steady_clock::time_point> &                  \
+              __benchmark_teardown_timestamp,                                                      \
+          [[maybe_unused]] void *__benchmark_parameters)
@@ -0,0 +1,26 @@
+#include <criterion/criterion.hpp>
+#include <cstdlib>
+#include <deque>
+#include <list>
+#include <vector>
+
+TYPED_BENCHMARK(Forward, (std::vector<int>, std::deque<int>, std::list<int>), std::size_t)
+{
+  SETUP_BENCHMARK(
+    const auto size = GET_ARGUMENT(0);
+    TypeParam container;
+    for (std::size_t i = 0; i < size; ++i)
+      container.push_back(rand());
+  )
+
+  // Code being benchmarked
+  for (auto it = container.begin(); it != container.end(); ++it)
+    ++(*it);
+
+  TEARDOWN_BENCHMARK(
+    container.clear();
+  )
+}
+
+// Forward<std::vector<int>>/1K, Forward<std::deque<int>>/1K, ..., Forward<std::list<int>>/1M
+INVOKE_BENCHMARK_RANGE(Forward, 1 << 10, 1 << 20, 32)
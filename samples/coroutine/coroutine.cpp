@@ -0,0 +1,54 @@
+#include <criterion/criterion.hpp>
+#include <chrono>
+
+using namespace std::chrono_literals;
+
+criterion::task<int> Square(int value) { co_return value * value; }
+
+criterion::task<int> SleepThenSquare(int value) {
+  co_await criterion::async::sleep_for(1ms);
+  co_return co_await Square(value);
+}
+
+// Cost of suspending and resuming through the executor's ready queue
+ASYNC_BENCHMARK(CoroutineYield, std::size_t)
+{
+  SETUP_BENCHMARK(
+    const auto count = GET_ARGUMENT(0);
+  )
+
+  for (std::size_t i = 0; i < count; ++i)
+    co_await criterion::async::yield();
+}
+
+INVOKE_BENCHMARK_FOR_EACH(CoroutineYield,
+  ("/1", 1),
+  ("/100", 100),
+  ("/10K", 10000)
+)
+
+// Cost of allocating, starting and awaiting a child coroutine frame
+ASYNC_BENCHMARK(CoroutineAwaitTask, std::size_t)
+{
+  SETUP_BENCHMARK(
+    const auto count = GET_ARGUMENT(0);
+    int sum = 0;
+  )
+
+  for (std::size_t i = 0; i < count; ++i)
+    sum += co_await Square(static_cast<int>(i));
+}
+
+INVOKE_BENCHMARK_FOR_EACH(CoroutineAwaitTask,
+  ("/1", 1),
+  ("/100", 100),
+  ("/10K", 10000)
+)
+
+// Timers run on a virtual clock, so only the timer queue overhead is measured
+ASYNC_BENCHMARK(CoroutineTimerQueue)
+{
+  int sum = 0;
+  for (int i = 0; i < 100; ++i)
+    sum += co_await SleepThenSquare(i);
+}
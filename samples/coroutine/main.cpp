@@ -0,0 +1,2 @@
+#include <criterion/criterion.hpp>
+CRITERION_BENCHMARK_MAIN()
\ No newline at end of file
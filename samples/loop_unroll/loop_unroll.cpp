@@ -0,0 +1,36 @@
+#include <criterion/criterion.hpp>
+#include <cstdlib>
+#include <vector>
+
+// Sum a vector with UnrollFactor independent accumulators. UnrollFactor is a compile-time
+// constant, so the compiler can fully unroll the inner loop for each instantiation
+VALUE_BENCHMARK(Sum, UnrollFactor, (1, 2, 4, 8), std::size_t)
+{
+  SETUP_BENCHMARK(
+    const auto size = GET_ARGUMENT(0);
+    std::vector<int> vec(size);
+    for (auto &v : vec)
+      v = rand() % 100;
+    int accumulators[UnrollFactor] = {};
+  )
+
+  std::size_t i = 0;
+  for (; i + UnrollFactor <= size; i += UnrollFactor) {
+    for (std::size_t j = 0; j < UnrollFactor; ++j)
+      accumulators[j] += vec[i + j];
+  }
+  for (; i < size; ++i)
+    accumulators[0] += vec[i];
+
+  int sum = 0;
+  for (std::size_t j = 0; j < UnrollFactor; ++j)
+    sum += accumulators[j];
+
+  TEARDOWN_BENCHMARK(
+    if (sum < 0)
+      abort();
+  )
+}
+
+// Sum<1>/4K, Sum<2>/4K, Sum<4>/4K, Sum<8>/4K, ..., Sum<8>/1M
+INVOKE_BENCHMARK_RANGE(Sum, 1 << 12, 1 << 20, 16)
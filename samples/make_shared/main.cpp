@@ -1,2 +1,3 @@
+#define CRITERION_COUNT_ALLOCATIONS
 #include <criterion/criterion.hpp>
 CRITERION_BENCHMARK_MAIN()
\ No newline at end of file
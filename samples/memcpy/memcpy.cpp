@@ -18,8 +18,5 @@ BENCHMARK(Memcpy, size_t)
   )
 }
 
-INVOKE_BENCHMARK_FOR_EACH(Memcpy, 
-  ("/32k", 32000), 
-  ("/128k", 128000), 
-  ("/1M", 1000000)
-)
\ No newline at end of file
+// Memcpy/1K, Memcpy/4K, Memcpy/16K, ..., Memcpy/16M
+INVOKE_BENCHMARK_RANGE(Memcpy, 1 << 10, 1 << 24, 4)
\ No newline at end of file
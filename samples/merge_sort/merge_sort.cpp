@@ -29,4 +29,10 @@ INVOKE_BENCHMARK_FOR_EACH(MergeSort,
   ("/100K", 100000),
   ("/1M", 1000000),
   ("/10M", 10000000)
-)
\ No newline at end of file
+)
+
+// Fit MergeSort/10 ... MergeSort/10M against the size argument
+BENCHMARK_COMPLEXITY(MergeSort, 0, criterion::complexity::o_n_log_n)
+
+// Sorting 10M elements takes long enough that a few single-iteration runs suffice
+BENCHMARK_INSTANCE_OPTIONS(MergeSort, "/10M", .warmup_runs = 1, .samples = 3, .batch_size = 1)
@@ -0,0 +1,49 @@
+#include <criterion/criterion.hpp>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+struct Mailbox {
+  std::atomic<std::uint64_t> ping{0};
+  std::atomic<std::uint64_t> pong{0};
+};
+
+static void WaitFor(const std::atomic<std::uint64_t> &value, std::uint64_t expected) {
+  while (value.load(std::memory_order_acquire) != expected)
+    std::this_thread::yield();
+}
+
+// Round trips between two processes through a shared-memory mailbox
+MULTIPROCESS_BENCHMARK(PingPong, 2, sizeof(Mailbox), std::uint64_t)
+{
+  SETUP_BENCHMARK(
+    const auto round_trips = GET_ARGUMENT(0);
+    auto &group = GET_PROCESS_GROUP;
+    auto mailbox = group.shared_memory_as<Mailbox>();
+    const auto base = mailbox->ping.load();
+    group.barrier(); // every process has read `base`
+  )
+
+  for (std::uint64_t i = 1; i <= round_trips; ++i) {
+    if (group.rank() == 0) {
+      mailbox->ping.store(base + i, std::memory_order_release);
+      WaitFor(mailbox->pong, base + i);
+    } else {
+      WaitFor(mailbox->ping, base + i);
+      mailbox->pong.store(base + i, std::memory_order_release);
+    }
+  }
+}
+
+INVOKE_BENCHMARK_FOR_EACH(PingPong,
+  ("/1", 1),
+  ("/100", 100)
+)
+
+// Every process increments the same shared counter
+MULTIPROCESS_BENCHMARK(SharedCounter, 4, sizeof(std::atomic<std::uint64_t>))
+{
+  auto counter = GET_PROCESS_GROUP.shared_memory_as<std::atomic<std::uint64_t>>();
+  for (int i = 0; i < 1000; ++i)
+    counter->fetch_add(1, std::memory_order_relaxed);
+}
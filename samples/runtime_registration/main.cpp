@@ -0,0 +1,47 @@
+#include <criterion/criterion.hpp>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Captured requests, e.g., loaded from a corpus on disk
+static std::vector<std::pair<std::string, std::string>> LoadRequests() {
+  return {{"small", "GET /index.html HTTP/1.1\r\nHost: example.com\r\n\r\n"},
+          {"cookies", "GET /cart HTTP/1.1\r\nHost: example.com\r\nCookie: " +
+                          std::string(4096, 'c') + "\r\n\r\n"},
+          {"headers", "GET / HTTP/1.1\r\n" + [] {
+             std::string headers;
+             for (int i = 0; i < 100; ++i)
+               headers += "X-Header-" + std::to_string(i) + ": value\r\n";
+             return headers;
+           }() + "\r\n"}};
+}
+
+static std::vector<std::string> ParseHeaders(const std::string &request) {
+  std::vector<std::string> headers;
+  std::istringstream is(request);
+  std::string line;
+  while (std::getline(is, line) && line != "\r")
+    headers.push_back(line);
+  return headers;
+}
+
+int main(int argc, char *argv[]) {
+  for (const auto &[id, request] : LoadRequests()) {
+    // ParseHeaders/small, ParseHeaders/cookies, ParseHeaders/headers
+    criterion::register_benchmark(
+        "ParseHeaders/" + id, [](const std::string &request) { ParseHeaders(request); }, request);
+
+    // Same, but copying the request is not part of the measurement
+    criterion::register_benchmark(
+        "ParseHeadersCopy/" + id,
+        [](criterion::benchmark_fixture &fixture, const std::string &request) {
+          auto copy = request;
+          fixture.end_setup();
+          ParseHeaders(copy);
+        },
+        request);
+  }
+
+  return criterion_main(argc, argv);
+}
@@ -1,10 +1,11 @@
 #include <criterion/criterion.hpp>
 #include <set>
+#include <unordered_set>
 
-BENCHMARK(SetInsert) 
+TYPED_BENCHMARK(SetInsert, (std::set<int>, std::unordered_set<int>)) 
 {
   SETUP_BENCHMARK(
-    std::set<int> set; 
+    TypeParam set; 
     for (auto i = 0; i < 1E7; i++) 
       set.insert(i);
   )
@@ -14,4 +15,4 @@ BENCHMARK(SetInsert)
   TEARDOWN_BENCHMARK(
     set.clear();
   )
-}
\ No newline at end of file
+}
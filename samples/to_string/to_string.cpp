@@ -37,9 +37,8 @@ BENCHMARK(ToString, /* parameters -> */ std::function<std::vector<std::string>(i
   fn(size);
 }
 
-INVOKE_BENCHMARK_FOR_EACH(ToString, 
-  ("/int/10", IntToStringConversionTest, 10),
-  ("/int/1000", IntToStringConversionTest, 1000),
-  ("/double/10", DoubleToStringConversionTest, 10),
-  ("/double/1000", DoubleToStringConversionTest, 1000)
-)
\ No newline at end of file
+INVOKE_BENCHMARK_GRID(ToString,
+  criterion::axis("fn", criterion::named("int", IntToStringConversionTest),
+                        criterion::named("double", DoubleToStringConversionTest)),
+  criterion::axis("size", 10, 1000)
+)
@@ -1,4 +1,5 @@
 #include <criterion/criterion.hpp>
+#include <cstdlib>
 #include <vector>
 
 BENCHMARK(VectorSort, size_t) {
@@ -22,6 +23,28 @@ INVOKE_BENCHMARK_FOR_EACH(VectorSort,
   ("/10000", 10000)
 )
 
+static std::vector<int> RandomInts(std::size_t size) {
+  std::vector<int> result(size);
+  for (auto &value : result)
+    value = rand();
+  return result;
+}
+
+BENCHMARK(RandomVectorSort, std::vector<int>) {
+  SETUP_BENCHMARK(
+    auto vec = GET_ARGUMENT(0);
+  )
+
+  std::sort(vec.begin(), vec.end());
+}
+
+// The inputs are only generated when (and if) each instance is run, e.g., with
+// --run_filtered RandomVectorSort/1K the 10M-element input is never created
+INVOKE_LAZY_BENCHMARK_FOR_EACH(RandomVectorSort,
+  ("/1K", RandomInts(1000)),
+  ("/10M", RandomInts(10000000))
+)
+
 // vector_sort/10
 //    μ = 7.7ns ± 3.9% [N = 100000000]
 // vector_sort/100
@@ -2654,15 +2654,48 @@ public:
 #pragma once
 #include <chrono>
 #include <functional>
+#include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
 
 namespace criterion {
 
+// Per-benchmark measurement settings. Unset fields fall back to the defaults, e.g.,
+// BENCHMARK_OPTIONS(MergeSort, .warmup_runs = 1, .samples = 3, .batch_size = 1)
+struct benchmark_options {
+  std::optional<std::size_t> warmup_runs{};              // number of warmup runs (default: 3)
+  std::optional<std::chrono::nanoseconds> warmup_time{}; // keep warming up for at least this long
+  std::optional<std::chrono::nanoseconds> min_time{};    // measure for at least this long
+  std::optional<std::chrono::nanoseconds> max_time{};    // measure for at most this long
+  std::optional<std::size_t> samples{};                  // exact number of runs
+  std::optional<std::size_t> batch_size{};               // iterations per run (default: 20)
+
+  // Fields set in `overrides` replace the ones set here
+  benchmark_options merged_with(const benchmark_options &overrides) const {
+    auto result = *this;
+    if (overrides.warmup_runs)
+      result.warmup_runs = overrides.warmup_runs;
+    if (overrides.warmup_time)
+      result.warmup_time = overrides.warmup_time;
+    if (overrides.min_time)
+      result.min_time = overrides.min_time;
+    if (overrides.max_time)
+      result.max_time = overrides.max_time;
+    if (overrides.samples)
+      result.samples = overrides.samples;
+    if (overrides.batch_size)
+      result.batch_size = overrides.batch_size;
+    return result;
+  }
+};
+
 struct benchmark_config {
   static inline std::tuple<> empty_tuple{};
   std::string name;
+  // name the config was registered under, e.g., "Forward" for "Forward<std::vector<int>>". Set by
+  // the registry; empty if it is the same as `name`
+  std::string template_name = "";
   using Fn = std::function<void(
       std::chrono::steady_clock::time_point &,                // start time stamp
       std::optional<std::chrono::steady_clock::time_point> &, // teardown time stamp
@@ -2670,6 +2703,19 @@ struct benchmark_config {
   Fn fn;
   std::string parameterized_instance_name = "";
   void *parameters = (void *)(&empty_tuple);
+  std::shared_ptr<void> owned_parameters{nullptr}; // keeps generated `parameters` alive
+
+  // Optional hooks called once per benchmark instance, before warmup and after the last run
+  using Hook = std::function<void(void *parameters)>;
+  Hook before_instance{nullptr};
+  Hook after_instance{nullptr};
+
+  // Optional factory for `parameters`, called only when the instance is run. The parameters it
+  // creates are released as soon as the instance completes
+  using ParameterFactory = std::function<std::shared_ptr<void>()>;
+  ParameterFactory parameter_factory{nullptr};
+
+  benchmark_options options{};
 
   enum class benchmark_reporting_type { console };
   benchmark_reporting_type reporting_type = benchmark_reporting_type::console;
@@ -2678,10 +2724,795 @@ struct benchmark_config {
 } // namespace criterion
 
 #pragma once
+#include <algorithm>
 #include <array>
-// #include <criterion/details/benchmark_result.hpp>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace criterion {
+
+// Candidate models, in order of growth
+enum class complexity { o_1, o_log_n, o_n, o_n_log_n, o_n_squared, o_n_cubed };
+
+inline std::string to_string(complexity model) {
+  switch (model) {
+  case complexity::o_1:
+    return "O(1)";
+  case complexity::o_log_n:
+    return "O(log n)";
+  case complexity::o_n:
+    return "O(n)";
+  case complexity::o_n_log_n:
+    return "O(n log n)";
+  case complexity::o_n_squared:
+    return "O(n^2)";
+  case complexity::o_n_cubed:
+    return "O(n^3)";
+  }
+  return "";
+}
+
+struct complexity_fit {
+  complexity model{complexity::o_1};
+  long double coefficient{0}; // time = coefficient * f(n), in ns
+  long double rms{0};         // RMS of the residuals, relative to the mean time
+};
+
+// Least-squares fit of `time = coefficient * f(n)` for every model in `complexity`.
+// `points` are (n, mean execution time) pairs. Returns the fits, best (lowest RMS) first
+inline std::vector<complexity_fit>
+fit_complexity(const std::vector<std::pair<long double, long double>> &points) {
+  static const std::array<complexity, 6> models{complexity::o_1,         complexity::o_log_n,
+                                                complexity::o_n,         complexity::o_n_log_n,
+                                                complexity::o_n_squared, complexity::o_n_cubed};
+  const auto f = [](complexity model, long double n) -> long double {
+    switch (model) {
+    case complexity::o_1:
+      return 1;
+    case complexity::o_log_n:
+      return std::log2(n);
+    case complexity::o_n:
+      return n;
+    case complexity::o_n_log_n:
+      return n * std::log2(n);
+    case complexity::o_n_squared:
+      return n * n;
+    case complexity::o_n_cubed:
+      return n * n * n;
+    }
+    return 0;
+  };
+
+  std::vector<complexity_fit> result;
+  if (points.empty())
+    return result;
+
+  long double mean_time = 0;
+  for (const auto &[n, time] : points) {
+    mean_time += time;
+  }
+  mean_time /= points.size();
+
+  for (const auto model : models) {
+    long double sum_time_f = 0, sum_f_squared = 0;
+    for (const auto &[n, time] : points) {
+      sum_time_f += time * f(model, n);
+      sum_f_squared += f(model, n) * f(model, n);
+    }
+    if (sum_f_squared == 0 || !std::isfinite(sum_f_squared))
+      continue;
+
+    const auto coefficient = sum_time_f / sum_f_squared;
+    long double sum_squared_residuals = 0;
+    for (const auto &[n, time] : points) {
+      sum_squared_residuals += std::pow(time - coefficient * f(model, n), 2);
+    }
+    const auto rms = std::sqrt(sum_squared_residuals / points.size());
+    result.push_back({model, coefficient, mean_time > 0 ? rms / mean_time : rms});
+  }
+
+  std::stable_sort(result.begin(), result.end(),
+                   [](const auto &lhs, const auto &rhs) { return lhs.rms < rhs.rms; });
+  return result;
+}
+
+// The instances of a family that are fitted together, e.g., those of one type of a
+// TYPED_BENCHMARK, "Forward<std::vector<int>>"
+struct complexity_curve {
+  std::string name;
+  std::vector<std::pair<long double, long double>> points{}; // (n, mean execution time)
+
+  // Returns std::nullopt if fewer than two instances were run
+  std::optional<complexity_fit> best_fit() const {
+    if (points.size() < 2)
+      return std::nullopt;
+    const auto fits = fit_complexity(points);
+    if (fits.empty())
+      return std::nullopt;
+    return fits.front();
+  }
+};
+
+// A benchmark family whose instances are fitted against the size in one of its arguments.
+// Each type or value of a TYPED_BENCHMARK or VALUE_BENCHMARK gets a curve of its own, so, e.g.,
+// std::vector and std::list timings are never combined into one fit
+struct complexity_family {
+  std::string template_name;
+  std::function<long double(void *parameters)> size_of;
+  std::optional<complexity> expected;
+  std::vector<complexity_curve> curves{}; // in order of their first instance
+
+  // Fewer points cannot tell neighbouring models apart, e.g., O(n) from O(n log n)
+  static constexpr std::size_t min_points_to_fail = 4;
+
+  // How much worse the expected model must fit than the best one for a curve to fail: its
+  // relative RMS must be at least `rms_ratio` times and `rms_margin` above that of the best fit
+  static constexpr long double rms_ratio = 2;
+  static constexpr long double rms_margin = 0.05;
+
+  // A curve fails if it grows faster than expected, e.g., O(n^2) when O(n log n) was expected,
+  // and the expected model fits materially worse. A best fit that only ranks above the expected
+  // model by noise, e.g., a fraction of a percent of RMS, does not fail the run
+  bool failed(const complexity_curve &curve) const {
+    if (!expected.has_value() || curve.points.size() < min_points_to_fail)
+      return false;
+    const auto fits = fit_complexity(curve.points);
+    if (fits.empty() || fits.front().model <= expected.value())
+      return false;
+    const auto &best = fits.front();
+    const auto expected_fit = std::find_if(fits.begin(), fits.end(), [this](const auto &fit) {
+      return fit.model == expected.value();
+    });
+    if (expected_fit == fits.end())
+      return true;
+    return expected_fit->rms > best.rms * rms_ratio && expected_fit->rms - best.rms > rms_margin;
+  }
+
+  bool failed() const {
+    return std::any_of(curves.begin(), curves.end(),
+                       [this](const auto &curve) { return failed(curve); });
+  }
+};
+
+struct complexity_registration_helper_struct {
+  static std::vector<complexity_family> &registered_families() {
+    static std::vector<complexity_family> v;
+    return v;
+  }
+
+  template <class ArgTuple, std::size_t Index>
+  static void register_family(const std::string &template_name,
+                              std::optional<complexity> expected) {
+    using Arg = std::tuple_element_t<Index, ArgTuple>;
+    static_assert(std::is_arithmetic_v<Arg>, "the size argument of a benchmark must be numeric");
+    registered_families().push_back(
+        {template_name,
+         [](void *parameters) {
+           return static_cast<long double>(std::get<Index>(*static_cast<ArgTuple *>(parameters)));
+         },
+         expected});
+  }
+
+  // Called by every benchmark instance when it completes. `template_name` is the name the
+  // instance was registered under, e.g., "Forward", and `name` the name of its config, e.g.,
+  // "Forward<std::vector<int>>", which picks the curve it is fitted on
+  static void record(const std::string &template_name, const std::string &name, void *parameters,
+                     long double mean_execution_time) {
+    for (auto &family : registered_families()) {
+      if (family.template_name != template_name)
+        continue;
+      auto curve = std::find_if(family.curves.begin(), family.curves.end(),
+                                [&name](const auto &c) { return c.name == name; });
+      if (curve == family.curves.end()) {
+        family.curves.push_back({name});
+        curve = std::prev(family.curves.end());
+      }
+      curve->points.push_back({family.size_of(parameters), mean_execution_time});
+    }
+  }
+};
+
+} // namespace criterion
+
+// Fit the instances of a benchmark against the value of its ArgIndex-th argument, e.g.,
+// BENCHMARK_COMPLEXITY(Sort, 0) or BENCHMARK_COMPLEXITY(Sort, 0, criterion::complexity::o_n).
+// With an expected complexity, a best fit that grows faster makes the benchmark program fail
+#define BENCHMARK_COMPLEXITY(TemplateName, ArgIndex, ...)                                          \
+                                                                                                   \
+  namespace /* ensure internal linkage for struct */                                               \
+  {                                                                                                \
+  /* helper struct for static registration in ctor */                                              \
+  struct CONCAT(TemplateName, CONCAT(_complexity_struct_, __LINE__)) {                             \
+    CONCAT(TemplateName, CONCAT(_complexity_struct_, __LINE__))() { /* called once before main */  \
+      criterion::complexity_registration_helper_struct::register_family<                           \
+          CONCAT(TemplateName, BenchmarkParameters), ArgIndex>(                                    \
+          #TemplateName, std::optional<criterion::complexity>{__VA_ARGS__});                       \
+    }                                                                                              \
+  } CONCAT(TemplateName, CONCAT(_complexity_struct_instance_, __LINE__));                          \
+  }
+
+
+#pragma once
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace criterion {
+
+// Parses durations like "15m", "90s", "1h30m" or "250ms". A number without a unit is in seconds.
+// Durations that do not fit in std::chrono::nanoseconds, about 292 years, are rejected
+inline std::optional<std::chrono::nanoseconds> parse_duration(const std::string &input) {
+  long double result = 0;
+  std::size_t i = 0;
+  while (i < input.size()) {
+    const auto number_start = i;
+    while (i < input.size() && (std::isdigit(static_cast<unsigned char>(input[i])) ||
+                                input[i] == '.')) {
+      i += 1;
+    }
+    const auto unit_start = i;
+    while (i < input.size() && std::isalpha(static_cast<unsigned char>(input[i]))) {
+      i += 1;
+    }
+    const auto number = input.substr(number_start, unit_start - number_start);
+    if (number.empty() || std::count(number.begin(), number.end(), '.') > 1)
+      return std::nullopt;
+
+    long double value = 0;
+    std::size_t parsed = 0;
+    try {
+      value = std::stold(number, &parsed);
+    } catch (...) {
+      return std::nullopt;
+    }
+    if (parsed != number.size())
+      return std::nullopt;
+
+    const auto unit = input.substr(unit_start, i - unit_start);
+    if (unit == "ns") {
+      result += value;
+    } else if (unit == "us") {
+      result += value * 1e3;
+    } else if (unit == "ms") {
+      result += value * 1e6;
+    } else if (unit == "s" || (unit.empty() && number_start == 0 && i == input.size())) {
+      result += value * 1e9;
+    } else if (unit == "m" || unit == "min") {
+      result += value * 60e9;
+    } else if (unit == "h") {
+      result += value * 3600e9;
+    } else {
+      return std::nullopt;
+    }
+  }
+  if (result < 1 || result >= static_cast<long double>(std::chrono::nanoseconds::max().count()))
+    return std::nullopt;
+  return std::chrono::nanoseconds(static_cast<std::chrono::nanoseconds::rep>(result));
+}
+
+// What a short pilot run learned about a benchmark instance. Times are in nanoseconds
+struct budget_pilot {
+  std::string name;
+  long double iteration_cost;              // wall time per iteration, incl. setup and teardown
+  long double relative_standard_deviation; // of the measured execution time, e.g., 0.05 for 5%
+  long double fixed_cost;     // time spent regardless of the allocation, e.g., warming up
+  std::size_t batch_size;     // iterations per run
+  bool adjustable_batch_size; // false if set by the benchmark's options
+  bool allocatable;           // false if the benchmark's options fix the number of samples
+};
+
+struct budget_allocation {
+  long double time;                    // time to spend on benchmark runs
+  std::size_t batch_size;              // iterations per run
+  std::size_t iterations;              // expected number of iterations
+  long double relative_standard_error; // expected error of the mean, e.g., 0.01 for 1%
+  bool under_sampled; // fewer than two iterations, or more than the acceptable error
+};
+
+// Splits `available` nanoseconds across benchmark instances. The relative standard error of an
+// instance's mean is rsd / sqrt(time / cost), so the summed squared error is smallest when each
+// instance gets time in proportion to rsd * sqrt(cost). Instances that cannot afford a single
+// iteration get exactly one, and the rest of the budget is split again
+inline std::vector<budget_allocation>
+allocate_time_budget(const std::vector<budget_pilot> &pilots, long double available,
+                     long double acceptable_relative_standard_error = 0.01) {
+  const auto weight = [](const budget_pilot &pilot) {
+    return std::max(pilot.relative_standard_deviation, (long double)0.01) *
+           std::sqrt(pilot.iteration_cost);
+  };
+
+  long double remaining = available;
+  for (const auto &pilot : pilots) {
+    remaining -= pilot.fixed_cost;
+  }
+
+  std::vector<bool> single_iteration(pilots.size(), false);
+  std::vector<long double> times(pilots.size(), 0);
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    long double total_weight = 0;
+    long double share = remaining;
+    for (std::size_t i = 0; i < pilots.size(); ++i) {
+      if (!pilots[i].allocatable)
+        continue;
+      if (single_iteration[i]) {
+        share -= pilots[i].iteration_cost;
+      } else {
+        total_weight += weight(pilots[i]);
+      }
+    }
+    share = std::max(share, (long double)0);
+
+    for (std::size_t i = 0; i < pilots.size(); ++i) {
+      if (!pilots[i].allocatable)
+        continue;
+      if (single_iteration[i]) {
+        times[i] = pilots[i].iteration_cost;
+        continue;
+      }
+      times[i] = total_weight > 0 ? share * weight(pilots[i]) / total_weight : 0;
+      if (times[i] < pilots[i].iteration_cost) {
+        single_iteration[i] = true;
+        changed = true;
+      }
+    }
+  }
+
+  std::vector<budget_allocation> result;
+  result.reserve(pilots.size());
+  for (std::size_t i = 0; i < pilots.size(); ++i) {
+    const auto &pilot = pilots[i];
+    if (!pilot.allocatable) {
+      result.push_back({0, pilot.batch_size, 0, 0, false});
+      continue;
+    }
+    auto batch_size = pilot.batch_size;
+    if (pilot.adjustable_batch_size && pilot.iteration_cost > 0) {
+      // leave room for at least two runs
+      const auto affordable = static_cast<std::size_t>(times[i] / (2 * pilot.iteration_cost));
+      batch_size = std::clamp(affordable, std::size_t{1}, pilot.batch_size);
+    }
+    const auto iterations = std::max(static_cast<std::size_t>(times[i] / pilot.iteration_cost),
+                                     std::size_t{1});
+    const auto relative_standard_error =
+        pilot.relative_standard_deviation / std::sqrt((long double)iterations);
+    result.push_back({times[i], batch_size, iterations, relative_standard_error,
+                      iterations < 2 ||
+                          relative_standard_error > acceptable_relative_standard_error});
+  }
+  return result;
+}
+
+// Summary of a run with --time_budget
+struct time_budget_report {
+  struct under_sampled_benchmark {
+    std::string name;
+    long double allocated_time;
+    std::size_t iterations;
+    long double relative_standard_error;
+  };
+
+  long double budget;
+  long double pilot_time;
+  long double elapsed_time;
+  std::size_t num_benchmarks;
+  std::vector<under_sampled_benchmark> under_sampled;
+};
+
+} // namespace criterion
+
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace criterion {
+
+inline long double sample_mean(const std::vector<long double> &samples) {
+  if (samples.empty())
+    return 0;
+  return std::accumulate(samples.begin(), samples.end(), 0.0L) / samples.size();
+}
+
+// Unbiased sample variance
+inline long double sample_variance(const std::vector<long double> &samples) {
+  if (samples.size() < 2)
+    return 0;
+  const auto m = sample_mean(samples);
+  long double E = 0;
+  for (const auto sample : samples) {
+    E += std::pow(sample - m, 2);
+  }
+  return E / (samples.size() - 1);
+}
+
+// Linearly interpolated quantile, e.g., q = 0.5 for the median
+inline long double sample_quantile(std::vector<long double> samples, long double q) {
+  if (samples.empty())
+    return 0;
+  std::sort(samples.begin(), samples.end());
+  const auto position = std::clamp(q, 0.0L, 1.0L) * (samples.size() - 1);
+  const auto below = static_cast<std::size_t>(position);
+  const auto above = std::min(below + 1, samples.size() - 1);
+  return samples[below] + (position - below) * (samples[above] - samples[below]);
+}
+
+inline long double sample_median(const std::vector<long double> &samples) {
+  return sample_quantile(samples, 0.5);
+}
+
+// z such that P(Z <= z) = p for a standard normal Z, e.g., 1.96 for p = 0.975
+inline long double normal_quantile(long double p) {
+  long double low = -40, high = 40;
+  for (std::size_t i = 0; i < 200; ++i) {
+    const auto mid = (low + high) / 2;
+    if (std::erfc(-mid / std::sqrt(2.0L)) / 2 < p) {
+      low = mid;
+    } else {
+      high = mid;
+    }
+  }
+  return (low + high) / 2;
+}
+
+// Outliers by Tukey's fences: samples more than 1.5 (mild) or 3 (severe) interquartile ranges
+// below the first or above the third quartile
+struct outlier_classification {
+  long double severe_low_fence;
+  long double mild_low_fence;
+  long double mild_high_fence;
+  long double severe_high_fence;
+  std::size_t low_severe{0};
+  std::size_t low_mild{0};
+  std::size_t high_mild{0};
+  std::size_t high_severe{0};
+
+  std::size_t total() const { return low_severe + low_mild + high_mild + high_severe; }
+
+  bool severe(long double sample) const {
+    return sample < severe_low_fence || sample > severe_high_fence;
+  }
+
+  bool mild_or_severe(long double sample) const {
+    return sample < mild_low_fence || sample > mild_high_fence;
+  }
+};
+
+inline outlier_classification classify_outliers(const std::vector<long double> &samples) {
+  const auto q1 = sample_quantile(samples, 0.25);
+  const auto q3 = sample_quantile(samples, 0.75);
+  const auto iqr = q3 - q1;
+  outlier_classification result{q1 - 3 * iqr, q1 - 1.5L * iqr, q3 + 1.5L * iqr, q3 + 3 * iqr};
+  for (const auto sample : samples) {
+    if (sample < result.severe_low_fence) {
+      result.low_severe += 1;
+    } else if (sample < result.mild_low_fence) {
+      result.low_mild += 1;
+    } else if (sample > result.severe_high_fence) {
+      result.high_severe += 1;
+    } else if (sample > result.mild_high_fence) {
+      result.high_mild += 1;
+    }
+  }
+  return result;
+}
+
+// Two-sided p-value of the Mann-Whitney U test that `a` and `b` come from the same distribution.
+// Uses the normal approximation, with tie and continuity corrections
+inline long double mann_whitney_u_p_value(const std::vector<long double> &a,
+                                          const std::vector<long double> &b) {
+  const long double n1 = a.size();
+  const long double n2 = b.size();
+  if (a.empty() || b.empty())
+    return 1;
+
+  // rank the pooled samples, giving tied samples their average rank
+  std::vector<std::pair<long double, bool>> pooled; // (sample, is from a)
+  pooled.reserve(a.size() + b.size());
+  for (const auto sample : a)
+    pooled.push_back({sample, true});
+  for (const auto sample : b)
+    pooled.push_back({sample, false});
+  std::sort(pooled.begin(), pooled.end(),
+            [](const auto &lhs, const auto &rhs) { return lhs.first < rhs.first; });
+
+  long double rank_sum = 0; // of the samples from `a`
+  long double tie_term = 0; // sum of t^3 - t over groups of t tied samples
+  for (std::size_t i = 0; i < pooled.size();) {
+    std::size_t j = i;
+    while (j < pooled.size() && pooled[j].first == pooled[i].first)
+      j += 1;
+    const long double rank = (i + 1 + j) / 2.0L; // average of ranks i + 1 ... j
+    for (std::size_t k = i; k < j; ++k) {
+      if (pooled[k].second)
+        rank_sum += rank;
+    }
+    const long double t = j - i;
+    tie_term += t * t * t - t;
+    i = j;
+  }
+
+  const auto n = n1 + n2;
+  const auto u = rank_sum - n1 * (n1 + 1) / 2;
+  const auto mu = n1 * n2 / 2;
+  const auto sigma = std::sqrt(n1 * n2 / 12 * ((n + 1) - tie_term / (n * (n - 1))));
+  if (!(sigma > 0))
+    return 1;
+  const auto z = std::max(std::abs(u - mu) - 0.5L, 0.0L) / sigma;
+  return std::erfc(z / std::sqrt(2.0L));
+}
+
+struct sample_comparison {
+  long double relative_change; // (current - baseline) / baseline mean, e.g., -0.05 if 5% faster
+  long double lower_bound;     // confidence interval of relative_change
+  long double upper_bound;
+  long double p_value; // two-sided Mann-Whitney U test
+};
+
+// Compares two sets of samples, e.g., mean execution times per benchmark run. The interval of
+// relative_change covers `confidence_level`, e.g., 0.95
+inline sample_comparison compare_samples(const std::vector<long double> &baseline,
+                                         const std::vector<long double> &current,
+                                         long double confidence_level = 0.95) {
+  const auto baseline_mean = sample_mean(baseline);
+  const auto current_mean = sample_mean(current);
+  if (!(baseline_mean > 0))
+    return {0, 0, 0, 1};
+
+  // Welch's standard error of the difference of means
+  const auto squared_error = [](const std::vector<long double> &samples) {
+    return samples.size() < 2 ? 0 : sample_variance(samples) / samples.size();
+  };
+  const auto standard_error = std::sqrt(squared_error(baseline) + squared_error(current));
+  const auto relative_change = (current_mean - baseline_mean) / baseline_mean;
+  const auto z = normal_quantile(0.5L + confidence_level / 2);
+  const auto margin = z * standard_error / baseline_mean;
+  return {relative_change, relative_change - margin, relative_change + margin,
+          mann_whitney_u_p_value(baseline, current)};
+}
+
+struct change_point {
+  std::size_t index;       // of the first point after the change
+  long double confidence;  // e.g., 0.99
+  long double mean_before; // of the points since the previous change point
+  long double mean_after;  // of the points up to the next change point
+};
+
+// Change-point analysis with CUSUM and bootstrapping: the cumulative sum of a segment's deviations
+// from its mean peaks where the mean shifts, and the shift is significant if the range of the sum
+// exceeds that of most shuffled copies of the segment. Segments are split at significant peaks
+// and searched again. Shuffles are seeded, so a series always gives the same change points
+inline std::vector<change_point> detect_change_points(const std::vector<long double> &series,
+                                                      long double min_confidence = 0.95,
+                                                      std::size_t bootstraps = 1000) {
+  std::mt19937 random{0};
+
+  // (range of the CUSUM, index of its peak) of series[begin, end)
+  const auto cusum = [](std::vector<long double>::const_iterator begin,
+                        std::vector<long double>::const_iterator end) {
+    const auto size = static_cast<std::size_t>(end - begin);
+    const auto m = std::accumulate(begin, end, 0.0L) / size;
+    long double sum = 0, lowest = 0, highest = 0, peak = 0;
+    std::size_t peak_index = 0;
+    for (std::size_t i = 0; i + 1 < size; ++i) {
+      sum += *(begin + i) - m;
+      lowest = std::min(lowest, sum);
+      highest = std::max(highest, sum);
+      if (std::abs(sum) > peak) {
+        peak = std::abs(sum);
+        peak_index = i + 1;
+      }
+    }
+    return std::make_pair(highest - lowest, peak_index);
+  };
+
+  std::vector<std::pair<std::size_t, long double>> found; // (index, confidence)
+  std::vector<std::pair<std::size_t, std::size_t>> segments{{0, series.size()}};
+  std::vector<long double> shuffled;
+  while (!segments.empty()) {
+    const auto [begin, end] = segments.back();
+    segments.pop_back();
+    if (end - begin < 4)
+      continue;
+
+    const auto [range, peak] = cusum(series.begin() + begin, series.begin() + end);
+    if (!(range > 0) || peak == 0)
+      continue;
+
+    shuffled.assign(series.begin() + begin, series.begin() + end);
+    std::size_t smaller = 0;
+    for (std::size_t i = 0; i < bootstraps; ++i) {
+      std::shuffle(shuffled.begin(), shuffled.end(), random);
+      if (cusum(shuffled.begin(), shuffled.end()).first < range)
+        smaller += 1;
+    }
+    const auto confidence = static_cast<long double>(smaller) / bootstraps;
+    if (confidence < min_confidence)
+      continue;
+
+    found.push_back({begin + peak, confidence});
+    segments.push_back({begin, begin + peak});
+    segments.push_back({begin + peak, end});
+  }
+
+  std::sort(found.begin(), found.end());
+  std::vector<change_point> result;
+  for (std::size_t i = 0; i < found.size(); ++i) {
+    const auto previous = i == 0 ? 0 : found[i - 1].first;
+    const auto next = i + 1 == found.size() ? series.size() : found[i + 1].first;
+    const auto index = found[i].first;
+    result.push_back(
+        {index, found[i].second,
+         std::accumulate(series.begin() + previous, series.begin() + index, 0.0L) /
+             (index - previous),
+         std::accumulate(series.begin() + index, series.begin() + next, 0.0L) / (next - index)});
+  }
+  return result;
+}
+
+// How the execution time of a benchmark is estimated from its runs
+enum class estimator {
+  mean,      // mean of the run means (what a benchmark run reports)
+  median,    // median of the run medians
+  lowest_rsd // mean of the run with the lowest relative standard deviation
+};
+
+inline std::string to_string(estimator method) {
+  switch (method) {
+  case estimator::mean:
+    return "mean";
+  case estimator::median:
+    return "median";
+  case estimator::lowest_rsd:
+    return "lowest_rsd";
+  }
+  return "";
+}
+
+// Which outliers (see classify_outliers) are left out of an estimate
+enum class outlier_policy { keep, drop_severe, drop_mild };
+
+inline std::string to_string(outlier_policy policy) {
+  switch (policy) {
+  case outlier_policy::keep:
+    return "keep";
+  case outlier_policy::drop_severe:
+    return "severe";
+  case outlier_policy::drop_mild:
+    return "mild";
+  }
+  return "";
+}
+
+// Estimate of a benchmark's execution time, recomputed from stored samples
+struct sample_estimate {
+  estimator method;
+  long double estimate;
+  long double lower_bound; // confidence interval of the estimate
+  long double upper_bound;
+  long double confidence_level; // e.g., 0.95
+  outlier_classification outliers;
+  outlier_policy policy;
+  std::size_t num_dropped; // outliers left out due to the policy
+  std::size_t num_samples; // before dropping outliers
+};
+
+enum class baseline_verdict { improved, regressed, no_change };
+
+inline std::string to_string(baseline_verdict verdict) {
+  switch (verdict) {
+  case baseline_verdict::improved:
+    return "Improved";
+  case baseline_verdict::regressed:
+    return "Regressed";
+  case baseline_verdict::no_change:
+    return "No change";
+  }
+  return "";
+}
+
+// Outcome of comparing a benchmark against a saved baseline
+struct baseline_comparison {
+  std::string name;
+  std::string baseline_name;
+  sample_comparison comparison;
+  baseline_verdict verdict;
+};
+
+} // namespace criterion
+
+
+#pragma once
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace criterion {
+
+namespace detail {
+
+// `value` escaped for use inside a JSON string: quotes, backslashes and every control character,
+// e.g., a tab in a benchmark name, as \u00XX, so each record stays on one line
+inline std::string json_escape(const std::string &value) {
+  std::string result;
+  result.reserve(value.size());
+  for (const auto c : value) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+      result += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(c));
+      result += escaped;
+    } else {
+      result += c;
+    }
+  }
+  return result;
+}
+
+// Appends the character of the escape sequence that starts after the backslash at text[i - 1]
+// to `result`, and returns the index of the last character of the sequence. Code points outside
+// of ASCII are not expected in benchmark names and become '?'
+inline std::size_t json_unescape(const std::string &text, std::size_t i, std::string &result) {
+  switch (text[i]) {
+  case 'n':
+    result += '\n';
+    return i;
+  case 't':
+    result += '\t';
+    return i;
+  case 'r':
+    result += '\r';
+    return i;
+  case 'b':
+    result += '\b';
+    return i;
+  case 'f':
+    result += '\f';
+    return i;
+  case 'u': {
+    const auto code_point = std::strtoul(text.substr(i + 1, 4).c_str(), nullptr, 16);
+    result += code_point < 0x80 ? static_cast<char>(code_point) : '?';
+    return i + 4 < text.size() ? i + 4 : text.size() - 1;
+  }
+  default:
+    result += text[i];
+    return i;
+  }
+}
+
+} // namespace detail
+
+} // namespace criterion
+
+
+#pragma once
+// #include <criterion/details/json_string.hpp>
+#include <iomanip>
+#include <optional>
 #include <sstream>
 #include <string>
+#include <vector>
 
 namespace criterion {
 
@@ -2704,6 +3535,13 @@ struct benchmark_result {
   long double fastest_iteration_performance; // iterations per second in the fastest case
   long double slowest_iteration_performance; // iterations per second in the slowest case
 
+  std::string interference; // background load active during the run, e.g., "membw:2", if any
+
+  std::vector<long double> samples; // mean execution time in each run
+
+  // heap allocations per iteration, if counted (see allocation_counter)
+  std::optional<long double> allocations_per_iteration{};
+
   std::string to_csv() const {
     std::stringstream os;
 
@@ -2720,7 +3558,7 @@ struct benchmark_result {
   std::string to_json() const {
     std::stringstream os;
     os << std::fixed << std::setprecision(2) << "    {\n"
-       << "      \"name\": \"" << name << "\",\n"
+       << "      \"name\": \"" << detail::json_escape(name) << "\",\n"
        << "      \"warmup_runs\": " << num_warmup_runs << ",\n"
        << "      \"iterations\": " << num_runs * num_iterations << ",\n"
        << "      \"mean_execution_time\": " << mean_execution_time << ",\n"
@@ -2731,12 +3569,48 @@ struct benchmark_result {
        << "      \"lowest_rsd_index\": " << lowest_rsd_index << ",\n"
        << "      \"average_iteration_performance\": " << average_iteration_performance << ",\n"
        << "      \"fastest_iteration_performance\": " << fastest_iteration_performance << ",\n"
-       << "      \"slowest_iteration_performance\": " << slowest_iteration_performance << "\n"
+       << "      \"slowest_iteration_performance\": " << slowest_iteration_performance << ",\n"
+       << "      \"runs\": " << num_runs;
+    if (allocations_per_iteration.has_value()) {
+      os << ",\n"
+         << "      \"allocations_per_iteration\": " << allocations_per_iteration.value();
+    }
+    if (!interference.empty()) {
+      os << ",\n"
+         << "      \"interference\": \"" << detail::json_escape(interference) << "\"";
+    }
+    os << "\n"
        << "    }";
 
     return os.str();
   }
 
+  // One line of JSON Lines, with the same keys as to_json()
+  std::string to_jsonl() const {
+    std::stringstream os;
+    os << std::fixed << std::setprecision(2) << "{\"name\":\"" << detail::json_escape(name)
+       << "\",\"warmup_runs\":" << num_warmup_runs
+       << ",\"iterations\":" << num_runs * num_iterations
+       << ",\"mean_execution_time\":" << mean_execution_time
+       << ",\"fastest_execution_time\":" << fastest_execution_time
+       << ",\"slowest_execution_time\":" << slowest_execution_time
+       << ",\"lowest_rsd_execution_time\":" << lowest_rsd_mean
+       << ",\"lowest_rsd_percentage\":" << lowest_rsd
+       << ",\"lowest_rsd_index\":" << lowest_rsd_index
+       << ",\"average_iteration_performance\":" << average_iteration_performance
+       << ",\"fastest_iteration_performance\":" << fastest_iteration_performance
+       << ",\"slowest_iteration_performance\":" << slowest_iteration_performance
+       << ",\"runs\":" << num_runs;
+    if (allocations_per_iteration.has_value()) {
+      os << ",\"allocations_per_iteration\":" << allocations_per_iteration.value();
+    }
+    if (!interference.empty()) {
+      os << ",\"interference\":\"" << detail::json_escape(interference) << "\"";
+    }
+    os << "}";
+    return os.str();
+  }
+
   std::string to_md() const {
     std::stringstream os;
     os << std::fixed << std::setprecision(2) << "|" << name << "|" << num_warmup_runs << "|"
@@ -2749,30 +3623,673 @@ struct benchmark_result {
 };
 
 } // namespace criterion
-// #include <criterion/details/indicators.hpp>
+
+#pragma once
+// #include <criterion/details/benchmark_result.hpp>
+// #include <criterion/details/json_string.hpp>
+// #include <criterion/details/statistics.hpp>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
 #include <iomanip>
+#include <optional>
 #include <sstream>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace criterion {
 
-class console_writer {
-  static std::string duration_to_string(const long double &ns) {
-    const auto duration = std::abs(ns);
-    std::stringstream os;
-    if (duration < 1E3) {
-      os << std::fixed << std::setprecision(2) << duration << " ns";
-    } else if (duration < 1E6) {
-      os << std::fixed << std::setprecision(2) << (duration / 1E3) << " us";
-    } else if (duration < 1E9) {
-      os << std::fixed << std::setprecision(2) << (duration / 1E6) << " ms";
-    } else {
-      os << std::fixed << std::setprecision(2) << (duration / 1E9) << " s";
-    }
+struct history_record {
+  std::string revision;
+  std::int64_t timestamp; // seconds since the epoch
+  std::string name;
+  long double mean_execution_time;
+  long double fastest_execution_time;
+  long double slowest_execution_time;
+  std::size_t num_runs;
+  std::size_t num_iterations;
+};
 
-    std::string result{""};
-    if (ns < 0) {
-      result += "-";
+// The series of one benchmark in a history file, oldest first
+struct history_series {
+  std::string name;
+  std::vector<history_record> records;
+  std::vector<change_point> change_points;
+};
+
+// Append-only history of benchmark results in JSON Lines, one record per benchmark per run:
+//
+//   {"revision":"a1b2c3d","timestamp":1767225600,"name":"MergeSort/1K","mean":...}
+class history {
+  // Parses the flat objects written by append(), e.g., {"name":"Foo","mean":1.5}, into a map
+  // from key to (unescaped) value
+  static std::optional<std::unordered_map<std::string, std::string>>
+  parse_line(const std::string &line) {
+    std::unordered_map<std::string, std::string> result;
+    std::size_t i = 0;
+    const auto skip_whitespace = [&]() {
+      while (i < line.size() && std::isspace(static_cast<unsigned char>(line[i])))
+        i += 1;
+    };
+    const auto parse_string = [&]() -> std::optional<std::string> {
+      if (i >= line.size() || line[i] != '"')
+        return std::nullopt;
+      i += 1;
+      std::string value;
+      while (i < line.size() && line[i] != '"') {
+        if (line[i] == '\\' && i + 1 < line.size()) {
+          i = detail::json_unescape(line, i + 1, value);
+        } else {
+          value += line[i];
+        }
+        i += 1;
+      }
+      if (i >= line.size())
+        return std::nullopt;
+      i += 1;
+      return value;
+    };
+
+    skip_whitespace();
+    if (i >= line.size() || line[i] != '{')
+      return std::nullopt;
+    i += 1;
+    while (true) {
+      skip_whitespace();
+      const auto key = parse_string();
+      skip_whitespace();
+      if (!key || i >= line.size() || line[i] != ':')
+        return std::nullopt;
+      i += 1;
+      skip_whitespace();
+      if (i < line.size() && line[i] == '"') {
+        const auto value = parse_string();
+        if (!value)
+          return std::nullopt;
+        result[key.value()] = value.value();
+      } else {
+        const auto start = i;
+        while (i < line.size() && line[i] != ',' && line[i] != '}')
+          i += 1;
+        result[key.value()] = line.substr(start, i - start);
+      }
+      skip_whitespace();
+      if (i < line.size() && line[i] == ',') {
+        i += 1;
+      } else if (i < line.size() && line[i] == '}') {
+        return result;
+      } else {
+        return std::nullopt;
+      }
+    }
+  }
+
+public:
+  // Appends one record per result, in `execution_order`, to `filename`
+  static bool append(const std::string &filename, const std::string &revision,
+                     const std::vector<std::string> &execution_order,
+                     const std::unordered_map<std::string, benchmark_result> &results) {
+    const auto timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+                               std::chrono::system_clock::now().time_since_epoch())
+                               .count();
+
+    // records of a run are buffered and appended together
+    std::stringstream records;
+    records << std::fixed << std::setprecision(2);
+    for (const auto &name : execution_order) {
+      const auto &result = results.at(name);
+      records << "{\"revision\":\"" << detail::json_escape(revision)
+              << "\",\"timestamp\":" << timestamp
+              << ",\"name\":\"" << detail::json_escape(result.name)
+              << "\",\"mean\":" << result.mean_execution_time
+              << ",\"fastest\":" << result.fastest_execution_time
+              << ",\"slowest\":" << result.slowest_execution_time
+              << ",\"runs\":" << result.num_runs << ",\"iterations\":" << result.num_iterations
+              << "}\n";
+    }
+
+    std::ofstream os(filename, std::ios::app);
+    if (!os.is_open())
+      return false;
+    os << records.str();
+    os.flush();
+    return os.good();
+  }
+
+  // Reads every well-formed record in `filename`. Malformed lines, e.g., from an interrupted
+  // write, are skipped
+  static std::optional<std::vector<history_record>> load(const std::string &filename) {
+    std::ifstream is(filename);
+    if (!is.is_open())
+      return std::nullopt;
+
+    std::vector<history_record> result;
+    std::string line;
+    while (std::getline(is, line)) {
+      const auto fields = parse_line(line);
+      if (!fields)
+        continue;
+      try {
+        const auto &f = fields.value();
+        result.push_back({f.at("revision"), std::stoll(f.at("timestamp")), f.at("name"),
+                          std::stold(f.at("mean")), std::stold(f.at("fastest")),
+                          std::stold(f.at("slowest")), std::stoull(f.at("runs")),
+                          std::stoull(f.at("iterations"))});
+      } catch (...) {
+        continue;
+      }
+    }
+    return result;
+  }
+
+  // Groups records by benchmark, in order of first appearance, and finds the change points in
+  // the mean execution time of each
+  static std::vector<history_series> analyze(const std::vector<history_record> &records) {
+    std::vector<history_series> result;
+    std::unordered_map<std::string, std::size_t> index;
+    for (const auto &record : records) {
+      const auto it = index.find(record.name);
+      if (it == index.end()) {
+        index[record.name] = result.size();
+        result.push_back({record.name, {record}, {}});
+      } else {
+        result[it->second].records.push_back(record);
+      }
+    }
+
+    for (auto &series : result) {
+      std::vector<long double> means;
+      means.reserve(series.records.size());
+      for (const auto &record : series.records) {
+        means.push_back(record.mean_execution_time);
+      }
+      series.change_points = detect_change_points(means);
+    }
+    return result;
+  }
+};
+
+} // namespace criterion
+
+
+#pragma once
+// #include <criterion/details/benchmark_result.hpp>
+// #include <criterion/details/statistics.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace criterion {
+
+// Instances of one benchmark template relative to a reference instance, e.g., for
+// ConstructSharedPtr/new vs ConstructSharedPtr/make_shared, ranked from fastest to slowest
+struct family_comparison {
+  struct entry {
+    std::string name;        // e.g., "ToString/fn:double/size:10"
+    std::string label;       // the segment that differs, e.g., "fn:double" or "std::deque<int>"
+    long double mean;        // mean execution time
+    long double ratio;       // mean / mean of the reference, e.g., 0.5 if twice as fast
+    long double lower_bound; // confidence interval of ratio
+    long double upper_bound;
+    std::size_t rank; // 1 for the fastest; an instance tied with the one above shares its rank
+    bool tied;        // not significantly different from the instance ranked above
+    bool reference;
+  };
+
+  std::string title; // e.g., "ConstructSharedPtr" or "ToString/*/size:10"
+  std::string reference_label;
+  long double confidence_level;
+  std::vector<entry> entries; // fastest first
+
+  static std::vector<std::string> split(const std::string &name) {
+    std::vector<std::string> segments;
+    std::size_t begin = 0;
+    while (true) {
+      const auto end = name.find('/', begin);
+      segments.push_back(name.substr(begin, end - begin));
+      if (end == std::string::npos)
+        return segments;
+      begin = end + 1;
+    }
+  }
+
+  // true if `segment` of a name is `reference`, e.g., "make_shared", or a grid point whose value
+  // is `reference`, e.g., "fn:int" for "int"
+  static bool matches(const std::string &segment, const std::string &reference) {
+    return segment == reference ||
+           (segment.size() > reference.size() + 1 &&
+            segment.compare(segment.size() - reference.size() - 1, std::string::npos,
+                            ":" + reference) == 0);
+  }
+
+  // The segments of `name` that instances are compared by, starting with the template it was
+  // registered under. The type or value of a TYPED_BENCHMARK or VALUE_BENCHMARK instance is a
+  // segment of its own, e.g., "Forward", "std::vector<int>", "1K" for
+  // Forward<std::vector<int>>/1K, so instances of different types can be compared
+  static std::vector<std::string> segments_of(const std::string &name,
+                                              const std::string &template_name) {
+    auto segments = split(name);
+    auto &first = segments.front();
+    if (first != template_name && first.size() > template_name.size() + 2 &&
+        first.compare(0, template_name.size() + 1, template_name + "<") == 0 &&
+        first.back() == '>') {
+      auto argument = first.substr(template_name.size() + 1,
+                                   first.size() - template_name.size() - 2);
+      first = template_name;
+      segments.insert(segments.begin() + 1, std::move(argument));
+    }
+    return segments;
+  }
+
+  // Compares the instances of every template, in `order`, against a reference:
+  //
+  //   "first"    the first instance of each template
+  //   "fastest"  the fastest instance of each template
+  //   otherwise  the instances with a segment (see segments_of) that is `reference`, e.g.,
+  //              "make_shared", "std::deque<int>" or "int" (for "fn:int"), each compared with the
+  //              instances that only differ from it in that segment, e.g., ToString/fn:int/size:10
+  //              with ToString/fn:double/size:10
+  //
+  // Instances are grouped by `template_names` (instance name -> name the template was registered
+  // under), or by the first segment of their name if they are not in it, e.g., merged results.
+  // Templates with a single instance, or without a reference instance, are left out
+  static std::vector<family_comparison>
+  compare(const std::vector<std::string> &order,
+          const std::unordered_map<std::string, benchmark_result> &results,
+          const std::string &reference, long double confidence_level = 0.95,
+          const std::unordered_map<std::string, std::string> &template_names = {}) {
+    // (name, segments) of the instances of each template, in order of their first run
+    using instance = std::pair<std::string, std::vector<std::string>>;
+    std::vector<std::string> templates;
+    std::unordered_map<std::string, std::vector<instance>> instances;
+    for (const auto &name : order) {
+      if (results.find(name) == results.end())
+        continue;
+      const auto it = template_names.find(name);
+      auto segments =
+          segments_of(name, it == template_names.end() ? split(name).front() : it->second);
+      auto &family = instances[segments.front()];
+      if (family.empty())
+        templates.push_back(segments.front());
+      family.push_back({name, std::move(segments)});
+    }
+
+    const auto join = [](const std::vector<std::string> &segments) {
+      std::string result;
+      for (const auto &segment : segments) {
+        result += (result.empty() ? "" : "/") + segment;
+      }
+      return result;
+    };
+
+    std::vector<family_comparison> comparisons;
+    for (const auto &template_name : templates) {
+      const auto &family = instances.at(template_name);
+      if (family.size() < 2)
+        continue;
+
+      if (reference == "first" || reference == "fastest") {
+        std::vector<std::string> names, labels;
+        for (const auto &[name, segments] : family) {
+          names.push_back(name);
+          labels.push_back(segments.size() > 1
+                               ? join(std::vector<std::string>(segments.begin() + 1,
+                                                               segments.end()))
+                               : segments.front());
+        }
+        std::size_t reference_index = 0;
+        if (reference == "fastest") {
+          for (std::size_t i = 1; i < names.size(); ++i) {
+            if (results.at(names[i]).mean_execution_time <
+                results.at(names[reference_index]).mean_execution_time)
+              reference_index = i;
+          }
+        }
+        comparisons.push_back(
+            make(template_name, names, labels, reference_index, results, confidence_level));
+        continue;
+      }
+
+      // the position of the reference segment, from the first instance that has it
+      std::optional<std::size_t> position;
+      for (const auto &[name, segments] : family) {
+        for (std::size_t i = 1; i < segments.size() && !position; ++i) {
+          if (matches(segments[i], reference))
+            position = i;
+        }
+      }
+      if (!position.has_value())
+        continue;
+
+      // instances that only differ in that segment, e.g., ToString/*/size:10
+      std::vector<std::string> groups;
+      std::map<std::string, std::vector<const instance *>> grouped;
+      for (const auto &member : family) {
+        const auto &segments = member.second;
+        if (segments.size() <= position.value())
+          continue;
+        auto key = segments;
+        key[position.value()] = "*";
+        const auto title = join(key);
+        if (grouped[title].empty())
+          groups.push_back(title);
+        grouped[title].push_back(&member);
+      }
+      for (const auto &title : groups) {
+        const auto &members = grouped.at(title);
+        std::vector<std::string> names, labels;
+        std::optional<std::size_t> reference_index;
+        for (const auto member : members) {
+          const auto &segment = member->second[position.value()];
+          if (!reference_index && matches(segment, reference))
+            reference_index = names.size();
+          names.push_back(member->first);
+          labels.push_back(segment);
+        }
+        if (members.size() < 2 || !reference_index.has_value())
+          continue;
+        comparisons.push_back(
+            make(title, names, labels, reference_index.value(), results, confidence_level));
+      }
+    }
+    return comparisons;
+  }
+
+private:
+  static family_comparison make(const std::string &title, const std::vector<std::string> &names,
+                                const std::vector<std::string> &labels,
+                                std::size_t reference_index,
+                                const std::unordered_map<std::string, benchmark_result> &results,
+                                long double confidence_level) {
+    family_comparison result{title, labels[reference_index], confidence_level, {}};
+    const auto &reference = results.at(names[reference_index]);
+    for (std::size_t i = 0; i < names.size(); ++i) {
+      const auto &instance = results.at(names[i]);
+      entry e{names[i], labels[i], instance.mean_execution_time, 1, 1, 1, 0, false,
+              i == reference_index};
+      if (!e.reference) {
+        // the interval of the relative change of the mean, as for baseline comparisons
+        const auto comparison =
+            compare_samples(reference.samples, instance.samples, confidence_level);
+        e.ratio = instance.mean_execution_time / reference.mean_execution_time;
+        e.lower_bound = e.ratio + comparison.lower_bound - comparison.relative_change;
+        e.upper_bound = e.ratio + comparison.upper_bound - comparison.relative_change;
+      }
+      result.entries.push_back(e);
+    }
+
+    std::stable_sort(result.entries.begin(), result.entries.end(),
+                     [](const entry &a, const entry &b) { return a.mean < b.mean; });
+    for (std::size_t i = 0; i < result.entries.size(); ++i) {
+      auto &e = result.entries[i];
+      if (i == 0) {
+        e.rank = 1;
+        continue;
+      }
+      const auto &above = result.entries[i - 1];
+      e.tied = mann_whitney_u_p_value(results.at(above.name).samples,
+                                      results.at(e.name).samples) >= 1 - confidence_level;
+      e.rank = e.tied ? above.rank : i + 1;
+    }
+    return result;
+  }
+};
+
+} // namespace criterion
+
+
+#pragma once
+// #include <criterion/details/benchmark_result.hpp>
+// #include <criterion/details/statistics.hpp>
+// #include <criterion/details/time_budget.hpp>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <optional>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace criterion {
+
+enum class threshold_metric { max_time, max_regression, max_allocations };
+
+inline std::string to_string(threshold_metric metric) {
+  switch (metric) {
+  case threshold_metric::max_time:
+    return "max_time";
+  case threshold_metric::max_regression:
+    return "max_regression";
+  case threshold_metric::max_allocations:
+    return "max_allocations";
+  }
+  return "";
+}
+
+// One threshold applied to one benchmark. `value` is the mean execution time in ns, the change
+// from the baseline in %, or the heap allocations per iteration
+struct threshold_check {
+  std::string benchmark;
+  threshold_metric metric;
+  long double limit;
+  long double value;
+  std::optional<std::pair<long double, long double>> interval; // confidence interval of `value`
+  long double confidence_level;
+  bool passed;
+
+  static std::string format(threshold_metric metric, long double value) {
+    std::stringstream os;
+    os << std::fixed << std::setprecision(2) << value;
+    if (metric == threshold_metric::max_time) {
+      os << " ns";
+    } else if (metric == threshold_metric::max_regression) {
+      os << " %";
+    }
+    return os.str();
+  }
+
+  // e.g., "max_time: 1843.20 ns [1801.10 ns, 1885.30 ns] at 95 % confidence exceeds 1500.00 ns"
+  std::string message() const {
+    std::stringstream os;
+    os << to_string(metric) << ": " << format(metric, value);
+    if (interval.has_value()) {
+      os << " [" << format(metric, interval->first) << ", " << format(metric, interval->second)
+         << "] at " << std::setprecision(0) << std::fixed << confidence_level * 100
+         << " % confidence";
+    }
+    if (!passed) {
+      os << " exceeds ";
+    } else if (value > limit) {
+      os << " is not significantly above ";
+    } else {
+      os << " is within ";
+    }
+    os << format(metric, limit);
+    return os.str();
+  }
+};
+
+// Limits that benchmarks must stay within, read from a file with one rule per line:
+//
+//   # benchmark regex   metric            limit
+//   MergeSort/.*        max_time          2ms
+//   .*                  max_regression    5%
+//   Vector/Reserve.*    max_allocations   1
+//
+// A rule applies to every benchmark whose name matches the regex (like --run_filtered), and a
+// benchmark must pass all of the rules that apply to it
+class thresholds {
+  struct rule {
+    std::string pattern;
+    std::regex regexp;
+    threshold_metric metric;
+    long double limit; // ns, % or allocations per iteration, like threshold_check::value
+  };
+
+  static std::optional<long double> parse_limit(threshold_metric metric, std::string value) {
+    if (metric == threshold_metric::max_time) {
+      const auto duration = parse_duration(value);
+      if (!duration.has_value())
+        return std::nullopt;
+      return static_cast<long double>(duration->count());
+    }
+    if (metric == threshold_metric::max_regression && !value.empty() && value.back() == '%')
+      value.pop_back();
+    std::size_t parsed = 0;
+    long double limit = 0;
+    try {
+      limit = std::stold(value, &parsed);
+    } catch (...) {
+      return std::nullopt;
+    }
+    if (parsed != value.size() || limit < 0)
+      return std::nullopt;
+    return limit;
+  }
+
+public:
+  std::vector<rule> rules;
+
+  static std::optional<thresholds> load(const std::string &filename) {
+    std::ifstream is(filename);
+    if (!is.is_open())
+      return std::nullopt;
+
+    thresholds result;
+    std::string line;
+    while (std::getline(is, line)) {
+      const auto comment = line.find('#');
+      if (comment != std::string::npos)
+        line.erase(comment);
+      std::istringstream fields(line);
+      std::string pattern, metric_name, limit, extra;
+      if (!(fields >> pattern))
+        continue;
+      if (!(fields >> metric_name >> limit) || (fields >> extra))
+        return std::nullopt;
+
+      std::optional<threshold_metric> metric;
+      for (const auto m : {threshold_metric::max_time, threshold_metric::max_regression,
+                           threshold_metric::max_allocations}) {
+        if (metric_name == to_string(m))
+          metric = m;
+      }
+      if (!metric.has_value())
+        return std::nullopt;
+      const auto value = parse_limit(metric.value(), limit);
+      if (!value.has_value())
+        return std::nullopt;
+      try {
+        result.rules.push_back({pattern, std::regex(pattern), metric.value(), value.value()});
+      } catch (const std::regex_error &) {
+        return std::nullopt;
+      }
+    }
+    return result;
+  }
+
+  bool uses(threshold_metric metric) const {
+    for (const auto &r : rules) {
+      if (r.metric == metric)
+        return true;
+    }
+    return false;
+  }
+
+  // Checks the benchmarks in `order` against every rule that applies to them. max_regression is
+  // only checked for benchmarks in `comparisons` (i.e., with --baseline), and only fails if the
+  // whole confidence interval of the change is above the limit. max_allocations is only checked
+  // if allocations were counted
+  std::vector<threshold_check>
+  evaluate(const std::vector<std::string> &order,
+           const std::unordered_map<std::string, benchmark_result> &results,
+           const std::unordered_map<std::string, baseline_comparison> &comparisons,
+           long double confidence_level) const {
+    const auto z = normal_quantile(0.5L + confidence_level / 2);
+    std::vector<threshold_check> checks;
+    for (const auto &name : order) {
+      const auto &result = results.at(name);
+      for (const auto &r : rules) {
+        if (!std::regex_search(name.begin(), name.end(), r.regexp))
+          continue;
+        threshold_check check{name, r.metric, r.limit, 0, std::nullopt, confidence_level, true};
+        if (r.metric == threshold_metric::max_time) {
+          const auto margin =
+              result.samples.empty()
+                  ? 0
+                  : z * std::sqrt(sample_variance(result.samples) / result.samples.size());
+          check.value = result.mean_execution_time;
+          check.interval = std::make_pair(check.value - margin, check.value + margin);
+          check.passed = check.value <= r.limit;
+        } else if (r.metric == threshold_metric::max_regression) {
+          const auto it = comparisons.find(name);
+          if (it == comparisons.end())
+            continue;
+          const auto &comparison = it->second.comparison;
+          check.value = comparison.relative_change * 100;
+          check.interval =
+              std::make_pair(comparison.lower_bound * 100, comparison.upper_bound * 100);
+          check.passed = check.interval->first <= r.limit;
+        } else {
+          if (!result.allocations_per_iteration.has_value())
+            continue;
+          check.value = result.allocations_per_iteration.value();
+          check.passed = check.value <= r.limit;
+        }
+        checks.push_back(check);
+      }
+    }
+    return checks;
+  }
+};
+
+} // namespace criterion
+
+
+#pragma once
+#include <array>
+// #include <criterion/details/benchmark_result.hpp>
+// #include <criterion/details/complexity.hpp>
+// #include <criterion/details/family_comparison.hpp>
+// #include <criterion/details/history.hpp>
+// #include <criterion/details/indicators.hpp>
+// #include <criterion/details/statistics.hpp>
+// #include <criterion/details/thresholds.hpp>
+// #include <criterion/details/time_budget.hpp>
+#include <cstdint>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+namespace criterion {
+
+class console_writer {
+  static std::string duration_to_string(const long double &ns) {
+    const auto duration = std::abs(ns);
+    std::stringstream os;
+    if (duration < 1E3) {
+      os << std::fixed << std::setprecision(2) << duration << " ns";
+    } else if (duration < 1E6) {
+      os << std::fixed << std::setprecision(2) << (duration / 1E3) << " us";
+    } else if (duration < 1E9) {
+      os << std::fixed << std::setprecision(2) << (duration / 1E6) << " ms";
+    } else {
+      os << std::fixed << std::setprecision(2) << (duration / 1E9) << " s";
+    }
+
+    std::string result{""};
+    if (ns < 0) {
+      result += "-";
     }
     result += os.str();
     return result;
@@ -2800,6 +4317,11 @@ public:
               << (result.num_runs > 1 ? " benchmark runs, " : " benchmark run, ")
               << result.num_iterations << " iterations per run\n";
 
+    if (!result.interference.empty()) {
+      std::cout << "      " << termcolor::yellow << "Interference: " << result.interference
+                << termcolor::reset << "\n";
+    }
+
     std::cout << "    " << termcolor::bold << termcolor::underline << "Execution Time"
               << termcolor::reset << "\n";
 
@@ -2869,78 +4391,270 @@ public:
               << worst_mean_iterations_percentage_difference << " %" << termcolor::reset << ")"
               << "\n";
 
+    if (result.allocations_per_iteration.has_value()) {
+      std::cout << "    " << termcolor::bold << termcolor::underline << "Allocations"
+                << termcolor::reset << "\n";
+
+      std::cout << "      Average    " << std::setprecision(2) << std::fixed << std::right
+                << std::setw(10) << result.allocations_per_iteration.value()
+                << " allocations/iteration\n";
+    }
+
     std::cout << "\n";
   }
-};
-
-} // namespace criterion
 
-#pragma once
-#include <sstream>
-#include <string>
+  static void write_complexity(const complexity_family &family, const complexity_curve &curve,
+                               const complexity_fit &fit) {
+    if (family.failed(curve)) {
+      std::cout << termcolor::bold << termcolor::red << " ✗ " << curve.name;
+    } else {
+      std::cout << termcolor::bold << termcolor::green << " ✓ " << curve.name;
+    }
+    std::cout << termcolor::reset << "\n";
 
-namespace criterion {
+    std::cout << "    " << termcolor::bold << termcolor::underline << "Complexity"
+              << termcolor::reset << "\n";
 
-struct benchmark_result {
-  std::string name;
-  std::size_t num_warmup_runs;
-  std::size_t num_runs;
-  std::size_t num_iterations;
+    std::cout << termcolor::yellow << termcolor::bold << termcolor::italic << "      Best fit     "
+              << std::right << std::setw(10) << to_string(fit.model) << termcolor::reset << " ("
+              << curve.points.size() << " instances)\n";
 
-  long double lowest_rsd;       // Lowest relative standard deviation (RSD)
-  long double lowest_rsd_mean;  // mean @ lowest RSD
-  std::size_t lowest_rsd_index; // which run had the lowest RSD best estimate
+    std::cout << "      Coefficient  " << std::right << std::setw(10)
+              << duration_to_string(fit.coefficient) << "\n";
 
-  long double warmup_execution_time;  // execution time during warmup
-  long double mean_execution_time;    // global mean execution time
-  long double fastest_execution_time; // global best execution time
-  long double slowest_execution_time; // global worst execution time
+    std::cout << "      RMS          " << std::right << std::setw(10) << std::setprecision(2)
+              << std::fixed << fit.rms * 100 << " %\n";
 
-  long double average_iteration_performance; // iterations per second in the average case
-  long double fastest_iteration_performance; // iterations per second in the fastest case
-  long double slowest_iteration_performance; // iterations per second in the slowest case
+    if (family.expected.has_value()) {
+      std::cout << (family.failed(curve) ? termcolor::red : termcolor::green)
+                << "      Expected     " << std::right << std::setw(10)
+                << to_string(family.expected.value()) << termcolor::reset << "\n";
+    }
 
-  std::string to_csv() const {
-    std::stringstream os;
+    std::cout << "\n";
+  }
 
-    os << '"' << name << "\",";
-    os << std::fixed << std::setprecision(2) << num_warmup_runs << ',' << num_runs * num_iterations
-       << ',' << mean_execution_time << ',' << fastest_execution_time << ','
-       << slowest_execution_time << ',' << lowest_rsd_mean << ',' << lowest_rsd << ','
-       << lowest_rsd_index << ',' << average_iteration_performance << ','
-       << fastest_iteration_performance << ',' << slowest_iteration_performance;
+  static void write_time_budget(const time_budget_report &report) {
+    if (report.under_sampled.empty()) {
+      std::cout << termcolor::bold << termcolor::green << " ✓ Time budget";
+    } else {
+      std::cout << termcolor::bold << termcolor::yellow << " ! Time budget ("
+                << report.under_sampled.size() << " of " << report.num_benchmarks
+                << " benchmarks under-sampled)";
+    }
+    std::cout << termcolor::reset << "\n";
 
-    return os.str();
-  }
+    std::cout << "    " << termcolor::bold << termcolor::underline << "Time Budget"
+              << termcolor::reset << "\n";
 
-  std::string to_json() const {
-    std::stringstream os;
-    os << std::fixed << std::setprecision(2) << "    {\n"
-       << "      \"name\": \"" << name << "\",\n"
-       << "      \"warmup_runs\": " << num_warmup_runs << ",\n"
-       << "      \"iterations\": " << num_runs * num_iterations << ",\n"
-       << "      \"mean_execution_time\": " << mean_execution_time << ",\n"
-       << "      \"fastest_execution_time\": " << fastest_execution_time << ",\n"
-       << "      \"slowest_execution_time\": " << slowest_execution_time << ",\n"
-       << "      \"lowest_rsd_execution_time\": " << lowest_rsd_mean << ",\n"
-       << "      \"lowest_rsd_percentage\": " << lowest_rsd << ",\n"
-       << "      \"lowest_rsd_index\": " << lowest_rsd_index << ",\n"
-       << "      \"average_iteration_performance\": " << average_iteration_performance << ",\n"
-       << "      \"fastest_iteration_performance\": " << fastest_iteration_performance << ",\n"
-       << "      \"slowest_iteration_performance\": " << slowest_iteration_performance << "\n"
-       << "    }";
+    std::cout << "      Budget       " << std::right << std::setw(10)
+              << duration_to_string(report.budget) << "\n";
+    std::cout << "      Pilot        " << std::right << std::setw(10)
+              << duration_to_string(report.pilot_time) << "\n";
+    std::cout << (report.elapsed_time > report.budget ? termcolor::red : termcolor::green)
+              << "      Elapsed      " << std::right << std::setw(10)
+              << duration_to_string(report.elapsed_time) << termcolor::reset << "\n";
+
+    if (!report.under_sampled.empty()) {
+      std::cout << "    " << termcolor::bold << termcolor::underline << "Under-sampled"
+                << termcolor::reset << "\n";
+      std::size_t name_width = 0;
+      for (const auto &benchmark : report.under_sampled) {
+        name_width = std::max(name_width, benchmark.name.size());
+      }
+      for (const auto &benchmark : report.under_sampled) {
+        std::cout << termcolor::yellow << "      " << std::left << std::setw(name_width + 2)
+                  << benchmark.name << termcolor::reset << std::right << std::setw(10)
+                  << duration_to_string(benchmark.allocated_time);
+        if (benchmark.iterations < 2) {
+          std::cout << " (1 iteration)\n";
+        } else {
+          std::cout << " ± " << std::setprecision(2) << std::fixed
+                    << benchmark.relative_standard_error * 100 << " % (" << benchmark.iterations
+                    << " iterations)\n";
+        }
+      }
+    }
 
-    return os.str();
+    std::cout << "\n";
   }
 
-  std::string to_md() const {
-    std::stringstream os;
-    os << std::fixed << std::setprecision(2) << "|" << name << "|" << num_warmup_runs << "|"
-       << num_runs * num_iterations << "|" << mean_execution_time << "|" << fastest_execution_time
-       << "|" << slowest_execution_time << "|" << lowest_rsd_mean << "|" << lowest_rsd << "|"
-       << lowest_rsd_index << "|" << average_iteration_performance << "|"
-       << fastest_iteration_performance << "|" << slowest_iteration_performance << "\n";
-    return os.str();
+  static void write_analysis(const benchmark_result &result, const sample_estimate &estimate) {
+    std::cout << termcolor::bold << termcolor::green << " ✓ " << result.name << termcolor::reset
+              << "\n";
+
+    std::cout << "    " << termcolor::bold << termcolor::underline << "Samples"
+              << termcolor::reset << "\n";
+
+    std::cout << "      " << result.num_runs << (result.num_runs == 1 ? " run, " : " runs, ")
+              << estimate.num_samples << " samples\n";
+
+    const auto &outliers = estimate.outliers;
+    std::cout << (outliers.total() > 0 ? termcolor::yellow : termcolor::white) << "      "
+              << outliers.total() << " outliers (" << std::setprecision(2) << std::fixed
+              << (estimate.num_samples > 0 ? outliers.total() * 100.0L / estimate.num_samples : 0)
+              << " %): " << outliers.low_severe << " low severe, " << outliers.low_mild
+              << " low mild, " << outliers.high_mild << " high mild, " << outliers.high_severe
+              << " high severe" << termcolor::reset << "\n";
+
+    if (estimate.num_dropped > 0) {
+      std::cout << "      " << estimate.num_dropped << " dropped ("
+                << to_string(estimate.policy) << " outliers)\n";
+    }
+
+    std::cout << "    " << termcolor::bold << termcolor::underline << "Execution Time ("
+              << to_string(estimate.method) << ")" << termcolor::reset << "\n";
+
+    std::cout << termcolor::yellow << termcolor::bold << termcolor::italic << "      Estimate     "
+              << std::right << std::setw(10) << duration_to_string(estimate.estimate)
+              << termcolor::reset << " [" << duration_to_string(estimate.lower_bound) << ", "
+              << duration_to_string(estimate.upper_bound) << "] (" << std::setprecision(2)
+              << std::fixed << estimate.confidence_level * 100 << " % confidence)\n";
+
+    std::cout << "      Fastest      " << std::right << std::setw(10)
+              << duration_to_string(result.fastest_execution_time) << "\n";
+
+    std::cout << "      Slowest      " << std::right << std::setw(10)
+              << duration_to_string(result.slowest_execution_time) << "\n";
+
+    // only known if the durations of individual iterations were stored
+    if (estimate.num_samples > result.num_runs) {
+      std::cout << "      Lowest RSD   " << std::right << std::setw(10)
+                << duration_to_string(result.lowest_rsd_mean) << " ± " << std::setprecision(2)
+                << result.lowest_rsd << "%"
+                << " (" << ordinal(result.lowest_rsd_index) << " run)\n";
+    }
+
+    std::cout << "\n";
+  }
+
+  static void write_baseline_comparison(const baseline_comparison &result) {
+    const auto &comparison = result.comparison;
+    const auto regressed = result.verdict == baseline_verdict::regressed;
+    const auto improved = result.verdict == baseline_verdict::improved;
+    if (regressed) {
+      std::cout << termcolor::bold << termcolor::red << " ✗ " << result.name;
+    } else if (improved) {
+      std::cout << termcolor::bold << termcolor::green << " ✓ " << result.name;
+    } else {
+      std::cout << termcolor::bold << " ~ " << result.name;
+    }
+    std::cout << termcolor::reset << "\n";
+
+    std::cout << "    " << termcolor::bold << termcolor::underline << "Baseline \""
+              << result.baseline_name << "\"" << termcolor::reset << "\n";
+
+    std::cout << "      Change       " << std::right << std::setw(10) << std::setprecision(2)
+              << std::fixed << comparison.relative_change * 100 << " % ["
+              << comparison.lower_bound * 100 << " %, " << comparison.upper_bound * 100
+              << " %]\n";
+
+    std::cout << "      p-value      " << std::right << std::setw(10) << std::setprecision(4)
+              << std::fixed << comparison.p_value << " (Mann-Whitney U)\n";
+
+    std::cout << (regressed ? termcolor::red : (improved ? termcolor::green : termcolor::white))
+              << "      Verdict      " << std::right << std::setw(10) << to_string(result.verdict)
+              << termcolor::reset << "\n";
+
+    std::cout << "\n";
+  }
+
+  static void write_family_comparison(const family_comparison &comparison) {
+    std::cout << termcolor::bold << " ~ " << comparison.title << termcolor::reset << "\n";
+
+    std::cout << "    " << termcolor::bold << termcolor::underline << "Relative to "
+              << comparison.reference_label << termcolor::reset << "\n";
+
+    std::size_t width = 8;
+    for (const auto &e : comparison.entries) {
+      width = std::max(width, e.label.size());
+    }
+
+    std::cout << "      Rank  " << std::left << std::setw(width) << "Instance" << std::right
+              << std::setw(12) << "Mean" << std::setw(10) << "Ratio" << "  "
+              << std::setprecision(0) << std::fixed << comparison.confidence_level * 100
+              << " % interval\n";
+
+    for (const auto &e : comparison.entries) {
+      std::stringstream rank;
+      rank << (e.tied ? "=" : "") << e.rank;
+      std::cout << (e.rank == 1 ? termcolor::green : termcolor::white) << "      " << std::right
+                << std::setw(4) << rank.str() << "  " << std::left << std::setw(width) << e.label
+                << std::right << std::setw(12) << duration_to_string(e.mean) << std::setw(9)
+                << std::setprecision(2) << std::fixed << e.ratio << "x  ";
+      if (e.reference) {
+        std::cout << "reference";
+      } else {
+        std::cout << "[" << e.lower_bound << "x, " << e.upper_bound << "x]";
+      }
+      std::cout << termcolor::reset << "\n";
+    }
+
+    std::cout << "\n";
+  }
+
+  static void write_threshold_check(const threshold_check &check) {
+    if (check.passed) {
+      std::cout << termcolor::bold << termcolor::green << " ✓ " << check.benchmark;
+    } else {
+      std::cout << termcolor::bold << termcolor::red << " ✗ " << check.benchmark;
+    }
+    std::cout << termcolor::reset << "\n";
+
+    std::cout << "    " << termcolor::bold << termcolor::underline << "Threshold"
+              << termcolor::reset << "\n";
+
+    std::cout << (check.passed ? termcolor::white : termcolor::red) << "      "
+              << check.message() << termcolor::reset << "\n";
+
+    std::cout << "\n";
+  }
+
+  static void write_history(const history_series &series) {
+    const auto &records = series.records;
+    if (series.change_points.empty()) {
+      std::cout << termcolor::bold << termcolor::green << " ✓ " << series.name;
+    } else {
+      std::cout << termcolor::bold << termcolor::yellow << " ! " << series.name;
+    }
+    std::cout << termcolor::reset << "\n";
+
+    std::cout << "    " << termcolor::bold << termcolor::underline << "History" << termcolor::reset
+              << " (" << records.size() << (records.size() == 1 ? " run, " : " runs, ")
+              << series.change_points.size()
+              << (series.change_points.size() == 1 ? " change point)\n" : " change points)\n");
+
+    const auto date = [](std::int64_t timestamp) {
+      const auto time = static_cast<std::time_t>(timestamp);
+      std::stringstream os;
+      os << std::put_time(std::gmtime(&time), "%Y-%m-%d %H:%M");
+      return os.str();
+    };
+
+    std::cout << "      First        " << std::right << std::setw(10)
+              << duration_to_string(records.front().mean_execution_time) << " ("
+              << records.front().revision << ", " << date(records.front().timestamp) << ")\n";
+    std::cout << "      Last         " << std::right << std::setw(10)
+              << duration_to_string(records.back().mean_execution_time) << " ("
+              << records.back().revision << ", " << date(records.back().timestamp) << ")\n";
+
+    if (!series.change_points.empty()) {
+      std::cout << "    " << termcolor::bold << termcolor::underline << "Change Points"
+                << termcolor::reset << "\n";
+      for (const auto &change : series.change_points) {
+        const auto &record = records[change.index];
+        const auto relative_change = (change.mean_after - change.mean_before) / change.mean_before;
+        std::cout << "      " << termcolor::bold << record.revision << termcolor::reset << " ("
+                  << date(record.timestamp) << ") " << duration_to_string(change.mean_before)
+                  << " -> " << duration_to_string(change.mean_after) << " ("
+                  << (relative_change > 0 ? termcolor::red : termcolor::green) << std::showpos
+                  << std::setprecision(2) << std::fixed << relative_change * 100 << " %"
+                  << std::noshowpos << termcolor::reset << ", " << change.confidence * 100
+                  << " % confidence)\n";
+      }
+    }
+
+    std::cout << "\n";
   }
 };
 
@@ -2948,572 +4662,4287 @@ struct benchmark_result {
 
 #pragma once
 #include <algorithm>
-#include <array>
-#include <chrono>
-#include <cmath>
-#include <csignal>
-#include <functional>
-#include <iomanip>
-#include <iostream>
-#include <numeric>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
 #include <optional>
 #include <sstream>
 #include <string>
 #include <thread>
-#include <unordered_map>
-#include <utility>
 #include <vector>
 
-// #include <criterion/details/benchmark_config.hpp>
-// #include <criterion/details/benchmark_result.hpp>
-// #include <criterion/details/console_writer.hpp>
-// #include <criterion/details/indicators.hpp>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
 
 namespace criterion {
 
-class benchmark {
-  benchmark_config config_;
-  using Fn = benchmark_config::Fn;
+// Background load to run alongside a benchmark, e.g., "membw:2,llc-thrash:1,cpu-spin:4,smt-sibling"
+struct interference_profile {
+  std::size_t membw{0};      // threads streaming through buffers larger than the LLC
+  std::size_t llc_thrash{0}; // threads writing to random cache lines of an LLC-sized buffer
+  std::size_t cpu_spin{0};   // threads spinning on other cores
+  bool smt_sibling{false};   // one thread spinning on the SMT sibling of the benchmark core
 
-  static inline constexpr std::size_t num_iterations_{20};
-  std::size_t max_num_runs_{0};
-  const long double ten_seconds_{1e+10};
-  long double min_benchmark_time_{ten_seconds_};
-  long double benchmark_time_;
-  long double early_estimate_execution_time_;
+  static constexpr std::size_t max_threads{256}; // of each kind
 
-  long double estimate_minimum_measurement_cost() {
-    using namespace std::chrono;
-    std::vector<long double> durations;
+  bool empty() const { return membw == 0 && llc_thrash == 0 && cpu_spin == 0 && !smt_sibling; }
 
-    for (std::size_t i = 0; i < 10; i++) {
-      const auto start = steady_clock::now();
-      // do nothing
-      const auto end = steady_clock::now();
-      const auto execution_time =
-          static_cast<long double>(duration_cast<std::chrono::nanoseconds>(end - start).count());
-      durations.push_back(execution_time);
+  std::string to_string() const {
+    std::vector<std::string> parts;
+    if (membw > 0)
+      parts.push_back("membw:" + std::to_string(membw));
+    if (llc_thrash > 0)
+      parts.push_back("llc-thrash:" + std::to_string(llc_thrash));
+    if (cpu_spin > 0)
+      parts.push_back("cpu-spin:" + std::to_string(cpu_spin));
+    if (smt_sibling)
+      parts.push_back("smt-sibling");
+
+    std::string result{""};
+    for (const auto &part : parts) {
+      if (!result.empty())
+        result += ",";
+      result += part;
     }
-    return *std::min_element(durations.begin(), durations.end());
+    return result;
   }
 
-  long double estimate_execution_time() {
-    using namespace std::chrono;
+  // One name per thread, in the order antagonists starts them, e.g., "membw 1", "membw 2"
+  std::vector<std::string> thread_names() const {
+    std::vector<std::string> names;
+    for (std::size_t i = 0; i < membw; i++)
+      names.push_back("membw " + std::to_string(i + 1));
+    for (std::size_t i = 0; i < llc_thrash; i++)
+      names.push_back("llc-thrash " + std::to_string(i + 1));
+    for (std::size_t i = 0; i < cpu_spin; i++)
+      names.push_back("cpu-spin " + std::to_string(i + 1));
+    if (smt_sibling)
+      names.push_back("smt-sibling");
+    return names;
+  }
+
+  // Returns std::nullopt if `spec` is not a comma-separated list of known antagonists, each with
+  // at most max_threads threads
+  static std::optional<interference_profile> parse(const std::string &spec) {
+    interference_profile result;
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+      if (item.empty())
+        continue;
+      if (item == "smt-sibling") {
+        result.smt_sibling = true;
+        continue;
+      }
 
-    long double result = 0;
-    bool first_run{true};
-    for (std::size_t i = 0; i < warmup_runs; i++) {
-      std::chrono::steady_clock::time_point start_timestamp;
-      std::optional<std::chrono::steady_clock::time_point> teardown_timestamp;
-      const auto start = steady_clock::now();
-      config_.fn(start_timestamp, teardown_timestamp, config_.parameters);
-      const auto end = steady_clock::now();
-      const auto execution_time =
-          static_cast<long double>(duration_cast<std::chrono::nanoseconds>(end - start).count());
-      if (first_run) {
-        result = execution_time;
-        first_run = false;
+      const auto colon = item.find(':');
+      if (colon == std::string::npos || colon + 1 == item.size())
+        return std::nullopt;
+      const auto kind = item.substr(0, colon);
+      const auto count_string = item.substr(colon + 1);
+      if (count_string.size() > 9 ||
+          !std::all_of(count_string.begin(), count_string.end(),
+                       [](char c) { return c >= '0' && c <= '9'; }))
+        return std::nullopt;
+      const std::size_t count = std::stoul(count_string);
+      if (count > max_threads)
+        return std::nullopt;
+
+      if (kind == "membw") {
+        result.membw = count;
+      } else if (kind == "llc-thrash") {
+        result.llc_thrash = count;
+      } else if (kind == "cpu-spin") {
+        result.cpu_spin = count;
       } else {
-        result = std::min(execution_time, result);
+        return std::nullopt;
       }
     }
     return result;
   }
+};
 
-  void update_iterations() {
-    early_estimate_execution_time_ = estimate_execution_time();
+// Starts the threads described by an interference_profile on construction and stops them in
+// stop() or on destruction. On Linux the calling (benchmark) thread is pinned to the core it is
+// running on for the lifetime of the antagonists, the `smt-sibling` thread is pinned to its
+// hyperthread sibling and every other antagonist is kept off both
+class antagonists {
+  std::atomic<bool> stop_{false};
+  std::atomic<std::size_t> running_{0};
+  std::vector<std::thread> threads_;
+
+#if defined(__linux__)
+  bool pinned_{false};
+  cpu_set_t original_affinity_;
+  cpu_set_t others_affinity_;
+  std::optional<int> sibling_cpu_;
+
+  static std::optional<int> find_smt_sibling(int cpu) {
+    std::ifstream is("/sys/devices/system/cpu/cpu" + std::to_string(cpu) +
+                     "/topology/thread_siblings_list");
+    std::string list;
+    if (!is.is_open() || !std::getline(is, list))
+      return std::nullopt;
+
+    // e.g., "0,4" or "0-1"
+    std::replace(list.begin(), list.end(), '-', ',');
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+      if (!item.empty() && std::stoi(item) != cpu)
+        return std::stoi(item);
+    }
+    return std::nullopt;
+  }
 
-    if (early_estimate_execution_time_ < 1)
-      early_estimate_execution_time_ = 1;
+  void pin_benchmark_thread() {
+    const auto cpu = sched_getcpu();
+    if (cpu < 0 ||
+        pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &original_affinity_) != 0)
+      return;
 
-    auto min_runs = 2;
+    cpu_set_t benchmark_affinity;
+    CPU_ZERO(&benchmark_affinity);
+    CPU_SET(cpu, &benchmark_affinity);
+    pinned_ = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &benchmark_affinity) == 0;
 
-    if (early_estimate_execution_time_ <= 100) {              // 100ns
-      benchmark_time_ = 5e+8;                                 // 500 ms
-    } else if (early_estimate_execution_time_ <= 1000) {      // 1us
-      benchmark_time_ = 1e+9;                                 // 1s
-    } else if (early_estimate_execution_time_ <= 100000) {    // 100us
-      benchmark_time_ = 2.5e+9;                               // 2.5s
-    } else if (early_estimate_execution_time_ <= 1000000) {   // 1ms
-      benchmark_time_ = 5e+9;                                 // 5s
-    } else if (early_estimate_execution_time_ <= 100000000) { // 100ms
-      benchmark_time_ = 7.5e+9;                               // 7.5s
-    } else {
-      benchmark_time_ = min_benchmark_time_;
+    sibling_cpu_ = find_smt_sibling(cpu);
+    others_affinity_ = original_affinity_;
+    CPU_CLR(cpu, &others_affinity_);
+    if (sibling_cpu_)
+      CPU_CLR(sibling_cpu_.value(), &others_affinity_);
+  }
+
+  void pin_antagonist_thread(std::thread &thread, bool on_sibling) {
+    if (!pinned_)
+      return;
+    if (on_sibling) {
+      if (!sibling_cpu_)
+        return;
+      cpu_set_t sibling_affinity;
+      CPU_ZERO(&sibling_affinity);
+      CPU_SET(sibling_cpu_.value(), &sibling_affinity);
+      pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &sibling_affinity);
+    } else if (CPU_COUNT(&others_affinity_) > 0) {
+      pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &others_affinity_);
     }
+  }
 
-    benchmark_time_ =
-        std::max(early_estimate_execution_time_ * min_runs * num_iterations_, benchmark_time_);
-    const auto total_iterations = size_t(benchmark_time_) / early_estimate_execution_time_;
-    max_num_runs_ = std::max(size_t(total_iterations / num_iterations_), size_t(min_runs));
+  void unpin_benchmark_thread() {
+    if (pinned_) {
+      pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &original_affinity_);
+      pinned_ = false;
+    }
   }
+#else
+  void pin_benchmark_thread() {}
+  void pin_antagonist_thread(std::thread &, bool) {}
+  void unpin_benchmark_thread() {}
+#endif
 
-public:
-  benchmark(const benchmark_config &config) : config_(config) {}
+  static std::size_t last_level_cache_size() {
+#if defined(_SC_LEVEL3_CACHE_SIZE)
+    const auto size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (size > 0)
+      return static_cast<std::size_t>(size);
+#endif
+    return std::size_t{32} << 20; // 32 MB
+  }
 
-  static inline std::unordered_map<std::string, benchmark_result> results;
-  static inline std::vector<std::string> benchmark_execution_order;
-  static inline bool show_console_output = true;
-  static inline std::size_t warmup_runs = 3;
+  void stream_memory() {
+    // Copy between two buffers twice the size of the LLC so every pass goes to DRAM
+    const auto size = 2 * last_level_cache_size();
+    std::vector<char> source(size, 'x'), destination(size, 'y');
+    running_ += 1;
 
-  void run() {
-    std::chrono::steady_clock::time_point benchmark_start_timestamp;
+    constexpr std::size_t chunk = 1 << 20;
+    while (!stop_.load(std::memory_order_relaxed)) {
+      for (std::size_t offset = 0; offset < size && !stop_.load(std::memory_order_relaxed);
+           offset += chunk) {
+        std::memcpy(destination.data() + offset, source.data() + offset,
+                    std::min(chunk, size - offset));
+      }
+    }
+  }
 
-    using namespace std::chrono;
+  void thrash_last_level_cache(std::uint64_t seed) {
+    constexpr std::size_t cache_line = 64;
+    const auto lines = last_level_cache_size() / cache_line;
+    std::vector<std::uint64_t> buffer(lines * cache_line / sizeof(std::uint64_t), 0);
+    running_ += 1;
 
-    // run empty function to estimate minimum delay in scheduling and executing user function
-    const auto estimated_minimum_measurement_cost = estimate_minimum_measurement_cost();
+    auto state = seed;
+    while (!stop_.load(std::memory_order_relaxed)) {
+      for (std::size_t i = 0; i < 4096; i++) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        buffer[((state >> 33) % lines) * (cache_line / sizeof(std::uint64_t))] += 1;
+      }
+    }
+  }
 
-    const std::string benchmark_instance_name = config_.name + config_.parameterized_instance_name;
-    benchmark_execution_order.push_back(benchmark_instance_name);
+  void spin() {
+    running_ += 1;
+    volatile std::uint64_t counter = 0;
+    while (!stop_.load(std::memory_order_relaxed)) {
+      counter = counter + 1;
+    }
+  }
 
-    // Get an early estimate for execution time
-    // Update number of iterations to run for this benchmark based on estimate
-    update_iterations();
+public:
+  explicit antagonists(const interference_profile &profile) {
+    if (profile.empty())
+      return;
 
-    const auto total_number_of_iterations = max_num_runs_ * num_iterations_;
+    pin_benchmark_thread();
 
-    long double lowest_rsd = 100;
-    long double lowest_rsd_mean = 0;
-    std::size_t lowest_rsd_index = 0;
-    bool first_run{true};
+    for (std::size_t i = 0; i < profile.membw; i++) {
+      threads_.emplace_back([this] { stream_memory(); });
+      pin_antagonist_thread(threads_.back(), false);
+    }
+    for (std::size_t i = 0; i < profile.llc_thrash; i++) {
+      threads_.emplace_back([this, i] { thrash_last_level_cache(i + 1); });
+      pin_antagonist_thread(threads_.back(), false);
+    }
+    for (std::size_t i = 0; i < profile.cpu_spin; i++) {
+      threads_.emplace_back([this] { spin(); });
+      pin_antagonist_thread(threads_.back(), false);
+    }
+    if (profile.smt_sibling) {
+      threads_.emplace_back([this] { spin(); });
+      pin_antagonist_thread(threads_.back(), true);
+    }
 
-    long double fastest_execution_time = 0;
-    long double slowest_execution_time = 0;
-    std::vector<long double> mean_in_each_run{};
-    mean_in_each_run.reserve(max_num_runs_);
+    // Don't start measuring until every antagonist has allocated its buffers and is running
+    while (running_.load() < threads_.size()) {
+      std::this_thread::yield();
+    }
+  }
 
-    std::size_t num_runs = 0;
-    std::array<long double, num_iterations_> durations;
+  antagonists(const antagonists &) = delete;
+  antagonists &operator=(const antagonists &) = delete;
 
-    using namespace indicators;
+  ~antagonists() { stop(); }
 
-    // Hide cursor
-    if (show_console_output) {
-      show_console_cursor(false);
+  void stop() {
+    stop_ = true;
+    for (auto &thread : threads_) {
+      thread.join();
     }
+    threads_.clear();
+    unpin_benchmark_thread();
+  }
+};
 
-    BlockProgressBar bar{option::BarWidth{50},
-                         option::Start{"["},
-                         option::End{"]"},
-                         option::ShowElapsedTime{true},
-                         option::ShowRemainingTime{true},
-                         option::ShowPercentage{true},
-                         option::ForegroundColor{Color::white},
-                         option::FontStyles{std::vector<FontStyle>{FontStyle::bold}},
-                         option::MaxProgress{total_number_of_iterations},
-                         option::PrefixText{" > " + benchmark_instance_name + " "}};
+} // namespace criterion
 
-    while (true) {
-      // Benchmark runs
-      if (first_run) {
-        benchmark_start_timestamp = std::chrono::steady_clock::now();
-      }
-      for (std::size_t i = 0; i < num_iterations_; i++) {
-        std::optional<std::chrono::steady_clock::time_point> teardown_timestamp;
-        auto start = steady_clock::now();
-        config_.fn(start, teardown_timestamp, config_.parameters);
-        auto end = steady_clock::now();
-        if (teardown_timestamp)
-          end = teardown_timestamp.value();
-        const auto execution_time = duration_cast<std::chrono::nanoseconds>(end - start).count();
-        durations[i] = std::abs(execution_time - estimated_minimum_measurement_cost);
-        if (show_console_output) {
-          bar.tick();
-        }
-      }
-      auto size = num_iterations_;
-      const long double mean = std::accumulate(durations.begin(), durations.end(), 0.0) / size;
 
-      long double E = 0;
-      for (std::size_t i = 0; i < size; i++) {
-        E += std::pow(durations[i] - mean, 2);
-      }
-      const long double variance = E / size;
-      const long double standard_deviation = std::sqrt(variance);
-      const long double relative_standard_deviation = standard_deviation * 100 / mean;
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
 
-      const auto mean_in_this_run =
-          std::accumulate(durations.begin(), durations.end(), 0.0) / num_iterations_;
-      mean_in_each_run.push_back(mean_in_this_run);
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
-      if (first_run) {
-        lowest_rsd = relative_standard_deviation;
-        lowest_rsd_mean = mean;
-        lowest_rsd_index = num_runs + 1;
-        fastest_execution_time = *std::min_element(durations.begin(), durations.end());
-        slowest_execution_time = *std::max_element(durations.begin(), durations.end());
-        first_run = false;
-      } else {
-        // Save record of lowest RSD
-        const auto current_lowest_rsd = lowest_rsd;
-        const auto current_lowest_rsd_index = lowest_rsd_index;
-        lowest_rsd = std::min(relative_standard_deviation, lowest_rsd);
-        if (lowest_rsd < current_lowest_rsd) {
-          // There's a new LOWEST relative standard deviation
+// Layout of the raw samples written by --export_samples. This header has no other dependencies,
+// so tools can include it on its own to read the files.
+//
+// All integers are in host byte order. The file starts with a file_header, followed by blocks.
+// Every block starts on an 8-byte boundary with a block_header whose `size` is the number of
+// payload bytes that follow it (a multiple of 8), so readers can skip blocks they do not know.
+//
+//   benchmark block: count = benchmark id, payload = benchmark_payload, then the name, padded
+//   samples block:   count = number of rows, payload = one array per column, each padded to 8
+//                    bytes, in this order:
+//
+//     uint64_t timestamp[rows];  // ns since the export started, when the iteration started
+//     int64_t  duration[rows];   // measured ns, before subtracting the measurement cost
+//     uint32_t benchmark[rows];  // id of a preceding benchmark block
+//     uint32_t run[rows];        // 0, 1, 2, ... within the benchmark
+//     uint32_t batch_size[rows]; // iterations in the run
+//     int32_t  cpu[rows];        // CPU the iteration finished on, or -1 if unknown
+//
+// Blocks of a benchmark's samples come after its benchmark block, and rows are in the order
+// the iterations ran
 
-          if (mean < lowest_rsd_mean) {
-            lowest_rsd_mean = mean; // new mean is lower
-            lowest_rsd_index = num_runs + 1;
-          } else {
-            lowest_rsd = current_lowest_rsd; // go back to old estimate
-            lowest_rsd_index = current_lowest_rsd_index;
-          }
-        } else {
-          lowest_rsd = current_lowest_rsd; // go back to old estimate
-          lowest_rsd_index = current_lowest_rsd_index;
-        }
+namespace criterion {
+namespace samples {
 
-        // Save best and worst duration
-        const auto current_best_execution_time =
-            *std::min_element(durations.begin(), durations.end());
-        if (current_best_execution_time > 0)
-          fastest_execution_time = std::min(fastest_execution_time, current_best_execution_time);
+static constexpr char magic[8] = {'C', 'R', 'T', 'S', 'M', 'P', 'L', 'S'};
+static constexpr std::uint32_t version = 1;
 
-        const auto current_worst_execution_time =
-            *std::max_element(durations.begin(), durations.end());
-        slowest_execution_time = std::max(slowest_execution_time, current_worst_execution_time);
-      }
+enum class block_kind : std::uint32_t { benchmark = 1, samples = 2 };
 
-      num_runs += 1;
+struct file_header {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t reserved;
+};
 
-      if (num_runs >= max_num_runs_) {
-        break;
-      }
+struct block_header {
+  std::uint32_t kind;
+  std::uint32_t count;
+  std::uint64_t size;
+};
 
-      const auto now = std::chrono::steady_clock::now();
-      const auto elapsed_time =
-          std::chrono::duration_cast<std::chrono::nanoseconds>(now - benchmark_start_timestamp)
-              .count();
-      if (elapsed_time > benchmark_time_) {
-        break;
-      } else {
-        if (show_console_output) {
-          const auto percentage_completed = elapsed_time / benchmark_time_;
-          const auto new_bar_progress = percentage_completed * total_number_of_iterations;
-          bar.set_progress(new_bar_progress);
-        }
-      }
-    }
+struct benchmark_payload {
+  double measurement_cost; // ns, the cost of timing an empty function
+  std::uint64_t name_length;
+};
 
-    const auto mean_execution_time =
-        (std::accumulate(mean_in_each_run.begin(), mean_in_each_run.end(), 0.0) / num_runs);
+static_assert(sizeof(file_header) == 16 && sizeof(block_header) == 16 &&
+                  sizeof(benchmark_payload) == 16,
+              "sample file structs must not be padded");
+
+inline constexpr std::uint64_t padded(std::uint64_t size) { return (size + 7) / 8 * 8; }
+
+// Views into a samples block. Valid as long as the reader that produced them
+struct sample_columns {
+  std::uint32_t rows;
+  const std::uint64_t *timestamp;
+  const std::int64_t *duration;
+  const std::uint32_t *benchmark;
+  const std::uint32_t *run;
+  const std::uint32_t *batch_size;
+  const std::int32_t *cpu;
+};
 
-    const auto benchmark_result = criterion::benchmark_result{
-        .name = benchmark_instance_name,
-        .num_warmup_runs = warmup_runs,
-        .num_runs = max_num_runs_,
-        .num_iterations = num_iterations_,
-        .lowest_rsd = lowest_rsd,
-        .lowest_rsd_mean = lowest_rsd_mean,
-        .lowest_rsd_index = lowest_rsd_index,
-        .warmup_execution_time = early_estimate_execution_time_,
-        .mean_execution_time = mean_execution_time,
-        .fastest_execution_time = fastest_execution_time,
-        .slowest_execution_time = slowest_execution_time,
-        .average_iteration_performance = (1E9 / mean_execution_time),
-        .fastest_iteration_performance = (1E9 / fastest_execution_time),
-        .slowest_iteration_performance = (1E9 / slowest_execution_time)};
+struct benchmark_info {
+  std::uint32_t id;
+  std::string name;
+  double measurement_cost;
+};
 
-    results.insert(std::make_pair(benchmark_instance_name, benchmark_result));
+#if defined(__unix__) || defined(__APPLE__)
 
-    if (show_console_output) {
-      bar.set_progress(total_number_of_iterations);
-      bar.mark_as_completed();
+// Maps a file written by --export_samples into memory, e.g.,
+//
+//   criterion::samples::reader reader("samples.cbin");
+//   for (const auto &columns : reader.sample_blocks())
+//     for (std::uint32_t i = 0; i < columns.rows; ++i)
+//       histogram[columns.benchmark[i]].add(columns.duration[i]);
+class reader {
+  const unsigned char *data_{nullptr};
+  std::size_t size_{0};
+  std::vector<benchmark_info> benchmarks_;
+  std::vector<sample_columns> blocks_;
+  bool valid_{false};
+
+  void parse() {
+    if (size_ < sizeof(file_header))
+      return;
+    file_header header;
+    std::memcpy(&header, data_, sizeof(header));
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version)
+      return;
 
-      // Show console cursor
-      show_console_cursor(true);
+    std::size_t offset = sizeof(file_header);
+    while (offset + sizeof(block_header) <= size_) {
+      const auto *block = reinterpret_cast<const block_header *>(data_ + offset);
+      const auto *payload = data_ + offset + sizeof(block_header);
+      if (block->size > size_ - offset - sizeof(block_header))
+        break; // truncated, e.g., the run was interrupted
+      if (block->kind == static_cast<std::uint32_t>(block_kind::benchmark)) {
+        const auto *info = reinterpret_cast<const benchmark_payload *>(payload);
+        if (block->size < sizeof(benchmark_payload) ||
+            info->name_length > block->size - sizeof(benchmark_payload))
+          break; // the name runs past the block
+        benchmarks_.push_back(
+            {block->count,
+             std::string(reinterpret_cast<const char *>(payload + sizeof(benchmark_payload)),
+                         info->name_length),
+             info->measurement_cost});
+      } else if (block->kind == static_cast<std::uint32_t>(block_kind::samples)) {
+        const auto rows = block->count;
+        if (2 * padded(std::uint64_t{rows} * 8) + 4 * padded(std::uint64_t{rows} * 4) > block->size)
+          break; // the columns run past the block
+        auto column = payload;
+        const auto next = [&](std::size_t width) {
+          const auto *result = column;
+          column += padded(std::uint64_t{rows} * width);
+          return result;
+        };
+        sample_columns columns{rows,
+                               reinterpret_cast<const std::uint64_t *>(next(8)),
+                               reinterpret_cast<const std::int64_t *>(next(8)),
+                               reinterpret_cast<const std::uint32_t *>(next(4)),
+                               reinterpret_cast<const std::uint32_t *>(next(4)),
+                               reinterpret_cast<const std::uint32_t *>(next(4)),
+                               reinterpret_cast<const std::int32_t *>(next(4))};
+        blocks_.push_back(columns);
+      }
+      offset += sizeof(block_header) + block->size;
+    }
+    valid_ = true;
+  }
 
-      console_writer::write_result(benchmark_result);
+public:
+  explicit reader(const std::string &filename) {
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+      return;
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+      void *mapped = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapped != MAP_FAILED) {
+        data_ = static_cast<const unsigned char *>(mapped);
+        size_ = st.st_size;
+      }
     }
+    ::close(fd);
+    parse();
+  }
+
+  reader(const reader &) = delete;
+  reader &operator=(const reader &) = delete;
+
+  ~reader() {
+    if (data_)
+      ::munmap(const_cast<unsigned char *>(data_), size_);
   }
+
+  // false if the file could not be read or is not a samples file
+  bool valid() const { return valid_; }
+
+  const std::vector<benchmark_info> &benchmarks() const { return benchmarks_; }
+
+  const std::vector<sample_columns> &sample_blocks() const { return blocks_; }
 };
 
+#endif
+
+} // namespace samples
 } // namespace criterion
 
+
 #pragma once
-// #include <criterion/details/benchmark.hpp>
-// #include <criterion/details/benchmark_result.hpp>
+// #include <criterion/details/sample_format.hpp>
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
 #include <fstream>
-#include <iomanip>
-#include <sstream>
+#include <iterator>
 #include <string>
-#include <unordered_map>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
 
 namespace criterion {
 
-class csv_writer {
-public:
-  static bool write_results(const std::string &filename,
-                            const std::unordered_map<std::string, benchmark_result> &results) {
-    bool result{false};
-    std::ofstream os(filename);
-    if (os.is_open()) {
-      os << "name,warmup_runs,iterations,mean_execution_time,fastest_execution_time,slowest_"
-            "execution_time,lowest_rsd_execution_time,lowest_rsd_percentage,lowest_rsd_index,"
-            "average_iteration_performance,fastest_iteration_performance,slowest_iteration_"
-            "performance\n";
-      for (const auto &name : benchmark::benchmark_execution_order) {
-        const auto &this_result = results.at(name);
-        os << this_result.to_csv() << "\n";
+// Streams every measured iteration to a file in the layout described in sample_format.hpp.
+// Rows are buffered per column and written as one samples block every `block_rows` rows, so
+// recording an iteration is a few appends to vectors that were reserved up front
+class sample_writer {
+  static constexpr std::size_t block_rows = 65536;
+
+#if defined(__unix__) || defined(__APPLE__)
+  int fd_{-1};
+#else
+  std::ofstream os_;
+#endif
+  bool good_{false};
+  std::chrono::steady_clock::time_point origin_;
+  std::uint32_t num_benchmarks_{0};
+
+  std::vector<std::uint64_t> timestamp_;
+  std::vector<std::int64_t> duration_;
+  std::vector<std::uint32_t> benchmark_;
+  std::vector<std::uint32_t> run_;
+  std::vector<std::uint32_t> batch_size_;
+  std::vector<std::int32_t> cpu_;
+
+  struct chunk {
+    const void *data;
+    std::size_t size;
+  };
+
+  // Writes the chunks back to back, with a single writev where available
+  bool write(std::vector<chunk> chunks) {
+    if (!good_)
+      return false;
+#if defined(__unix__) || defined(__APPLE__)
+    std::vector<iovec> buffers;
+    buffers.reserve(chunks.size());
+    for (const auto &c : chunks) {
+      if (c.size > 0)
+        buffers.push_back({const_cast<void *>(c.data), c.size});
+    }
+    std::size_t first = 0;
+    while (first < buffers.size()) {
+      const auto count = std::min<std::size_t>(buffers.size() - first, IOV_MAX);
+      const auto written = ::writev(fd_, buffers.data() + first, static_cast<int>(count));
+      if (written < 0) {
+        if (errno == EINTR)
+          continue;
+        good_ = false;
+        return false;
+      }
+      // skip what was written, which may end in the middle of a buffer
+      auto remaining = static_cast<std::size_t>(written);
+      while (first < buffers.size() && remaining >= buffers[first].iov_len) {
+        remaining -= buffers[first].iov_len;
+        first += 1;
+      }
+      if (first < buffers.size()) {
+        buffers[first].iov_base = static_cast<char *>(buffers[first].iov_base) + remaining;
+        buffers[first].iov_len -= remaining;
       }
-      result = true;
     }
-    os.close();
+#else
+    for (const auto &c : chunks) {
+      os_.write(static_cast<const char *>(c.data), c.size);
+    }
+    good_ = os_.good();
+#endif
+    return good_;
+  }
+
+  static int current_cpu() {
+#if defined(__linux__)
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+  }
+
+public:
+  sample_writer() = default;
+  sample_writer(const sample_writer &) = delete;
+  sample_writer &operator=(const sample_writer &) = delete;
+
+  ~sample_writer() { close(); }
+
+  bool open(const std::string &filename) {
+#if defined(__unix__) || defined(__APPLE__)
+    fd_ = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    good_ = fd_ >= 0;
+#else
+    os_.open(filename, std::ios::binary | std::ios::trunc);
+    good_ = os_.is_open();
+#endif
+    origin_ = std::chrono::steady_clock::now();
+
+    timestamp_.reserve(block_rows);
+    duration_.reserve(block_rows);
+    benchmark_.reserve(block_rows);
+    run_.reserve(block_rows);
+    batch_size_.reserve(block_rows);
+    cpu_.reserve(block_rows);
+
+    samples::file_header header{};
+    std::copy(std::begin(samples::magic), std::end(samples::magic), header.magic);
+    header.version = samples::version;
+    return write({{&header, sizeof(header)}});
+  }
+
+  bool good() const { return good_; }
+
+  // Starts a benchmark, returning the id to pass to add()
+  std::uint32_t add_benchmark(const std::string &name, long double measurement_cost) {
+    flush();
+    const auto id = num_benchmarks_++;
+    const samples::benchmark_payload payload{static_cast<double>(measurement_cost), name.size()};
+    const auto payload_size = sizeof(payload) + name.size();
+    const samples::block_header block{static_cast<std::uint32_t>(samples::block_kind::benchmark),
+                                      id, samples::padded(payload_size)};
+    static constexpr char zeros[8]{};
+    write({{&block, sizeof(block)},
+           {&payload, sizeof(payload)},
+           {name.data(), name.size()},
+           {zeros, samples::padded(payload_size) - payload_size}});
+    return id;
+  }
+
+  // Records one iteration of `benchmark` that started at `start` and took `duration` ns
+  void add(std::uint32_t benchmark, std::uint32_t run, std::uint32_t batch_size,
+           std::chrono::steady_clock::time_point start, std::int64_t duration) {
+    if (!good_)
+      return;
+    timestamp_.push_back(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(start - origin_).count());
+    duration_.push_back(duration);
+    benchmark_.push_back(benchmark);
+    run_.push_back(run);
+    batch_size_.push_back(batch_size);
+    cpu_.push_back(current_cpu());
+    if (timestamp_.size() >= block_rows)
+      flush();
+  }
+
+  // Writes the buffered rows as a samples block
+  bool flush() {
+    const auto rows = timestamp_.size();
+    if (rows == 0)
+      return good_;
+
+    static constexpr char zeros[8]{};
+    const auto padding = [&](std::size_t width) {
+      return chunk{zeros, samples::padded(rows * width) - rows * width};
+    };
+    const samples::block_header block{
+        static_cast<std::uint32_t>(samples::block_kind::samples), static_cast<std::uint32_t>(rows),
+        2 * samples::padded(rows * 8) + 4 * samples::padded(rows * 4)};
+    const auto result = write({{&block, sizeof(block)},
+                               {timestamp_.data(), rows * 8},
+                               {duration_.data(), rows * 8},
+                               {benchmark_.data(), rows * 4},
+                               padding(4),
+                               {run_.data(), rows * 4},
+                               padding(4),
+                               {batch_size_.data(), rows * 4},
+                               padding(4),
+                               {cpu_.data(), rows * 4},
+                               padding(4)});
+
+    timestamp_.clear();
+    duration_.clear();
+    benchmark_.clear();
+    run_.clear();
+    batch_size_.clear();
+    cpu_.clear();
     return result;
   }
+
+  bool close() {
+    flush();
+#if defined(__unix__) || defined(__APPLE__)
+    if (fd_ >= 0) {
+      if (::close(fd_) != 0)
+        good_ = false;
+      fd_ = -1;
+    }
+#else
+    if (os_.is_open()) {
+      os_.close();
+      good_ = good_ && !os_.fail();
+    }
+#endif
+    return good_;
+  }
 };
 
 } // namespace criterion
 
+
 #pragma once
-// #include <criterion/details/benchmark.hpp>
-// #include <criterion/details/benchmark_result.hpp>
+// #include <criterion/details/json_string.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <fstream>
 #include <iomanip>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace criterion {
 
-class json_writer {
+// Writes a timeline of the benchmark run in the Chrome trace event format, which
+// chrome://tracing and https://ui.perfetto.dev open. Phases are complete ("X") events on one
+// track per thread, and per-run statistics are counter ("C") events. Events are written in the
+// JSON array format, whose closing ']' is optional, and only whole: they are buffered and written
+// after every benchmark or once the buffer is full. A trace that was cut short by a crash still
+// loads, up to the last events written
+class trace_writer {
+  static constexpr std::size_t buffer_size_{1 << 16};
+
+#if defined(__unix__) || defined(__APPLE__)
+  int fd_{-1};
+#else
+  std::ofstream os_;
+#endif
+  bool open_{false};
+  bool good_{false};
+  std::string buffer_;
+  bool first_{true};
+  std::chrono::steady_clock::time_point origin_;
+  std::unordered_map<std::thread::id, std::uint32_t> threads_;
+  std::unordered_map<std::string, std::uint32_t> tracks_;
+  std::uint32_t num_tracks_{0};
+
+  static std::string quote(const std::string &value) {
+    return "\"" + detail::json_escape(value) + "\"";
+  }
+
+  // microseconds since the trace was opened, with nanosecond precision
+  std::string timestamp(std::chrono::steady_clock::time_point t) const {
+    std::stringstream os;
+    os << std::fixed << std::setprecision(3)
+       << std::chrono::duration_cast<std::chrono::nanoseconds>(t - origin_).count() / 1E3;
+    return os.str();
+  }
+
+  // JSON has no NaN or infinity, e.g., for the RSD of a run whose mean is 0
+  static long double finite(long double value) { return std::isfinite(value) ? value : 0; }
+
+  void event(const std::string &body) {
+    buffer_ += (first_ ? "\n{" : ",\n{") + body + "}";
+    first_ = false;
+    if (buffer_.size() >= buffer_size_)
+      flush();
+  }
+
+  std::uint32_t new_track(const std::string &name) {
+    const auto id = ++num_tracks_;
+    event("\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(id) +
+          ",\"args\":{\"name\":" + quote(name) + "}");
+    event("\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(id) +
+          ",\"args\":{\"sort_index\":" + std::to_string(id) + "}");
+    return id;
+  }
+
 public:
-  static bool write_results(const std::string &filename,
-                            const std::unordered_map<std::string, benchmark_result> &results) {
-    bool result{false};
-    std::ofstream os(filename);
-    if (os.is_open()) {
-      os << "{\n";
-      os << "  \"benchmarks\": [\n";
+  using args = std::vector<std::pair<std::string, long double>>;
 
-      bool first{true};
-      for (const auto &name : benchmark::benchmark_execution_order) {
-        const auto &this_result = results.at(name);
-        if (first) {
-          first = false;
-        } else {
-          os << ",\n";
-        }
-        os << this_result.to_json();
+  trace_writer() = default;
+  trace_writer(const trace_writer &) = delete;
+  trace_writer &operator=(const trace_writer &) = delete;
+
+  ~trace_writer() { close(); }
+
+  bool open(const std::string &filename, const std::string &process_name) {
+#if defined(__unix__) || defined(__APPLE__)
+    fd_ = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    open_ = fd_ >= 0;
+#else
+    os_.open(filename, std::ios::binary | std::ios::trunc);
+    open_ = os_.is_open();
+#endif
+    if (!open_)
+      return false;
+    good_ = true;
+    origin_ = std::chrono::steady_clock::now();
+    buffer_ = "[";
+    event("\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":" +
+          quote(process_name) + "}");
+    return flush();
+  }
+
+  // Writes the buffered events, e.g., after each benchmark
+  bool flush() {
+    if (!open_ || !good_)
+      return false;
+#if defined(__unix__) || defined(__APPLE__)
+    std::size_t written = 0;
+    while (written < buffer_.size()) {
+      const auto n = ::write(fd_, buffer_.data() + written, buffer_.size() - written);
+      if (n < 0) {
+        if (errno == EINTR)
+          continue;
+        good_ = false;
+        break;
       }
+      written += static_cast<std::size_t>(n);
+    }
+#else
+    os_ << buffer_;
+    os_.flush();
+    good_ = os_.good();
+#endif
+    buffer_.clear();
+    return good_;
+  }
 
-      os << "\n";
-      os << "  ]\n";
+  // The track of the calling thread, which is named `name` the first time
+  std::uint32_t thread_track(const std::string &name) {
+    const auto id = std::this_thread::get_id();
+    const auto it = threads_.find(id);
+    if (it != threads_.end())
+      return it->second;
+    return threads_[id] = new_track(name);
+  }
+
+  // A track that is not tied to a thread of this process, e.g., for background threads that
+  // record nothing themselves
+  std::uint32_t track(const std::string &name) {
+    const auto it = tracks_.find(name);
+    if (it != tracks_.end())
+      return it->second;
+    return tracks_[name] = new_track(name);
+  }
+
+  void complete(std::uint32_t track, const std::string &name, const std::string &category,
+                std::chrono::steady_clock::time_point start,
+                std::chrono::steady_clock::time_point end, const args &arguments = {}) {
+    if (!open_)
+      return;
+    std::stringstream os;
+    os << "\"name\":" << quote(name) << ",\"cat\":" << quote(category)
+       << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << track << ",\"ts\":" << timestamp(start)
+       << ",\"dur\":" << std::fixed << std::setprecision(3)
+       << std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / 1E3;
+    if (!arguments.empty()) {
+      os << ",\"args\":{";
+      for (std::size_t i = 0; i < arguments.size(); ++i) {
+        os << (i > 0 ? "," : "") << quote(arguments[i].first) << ":" << std::setprecision(2)
+           << finite(arguments[i].second);
+      }
       os << "}";
-      result = true;
     }
-    os.close();
-    return result;
+    event(os.str());
+  }
+
+  // One sample of the counter track `name`
+  void counter(const std::string &name, std::chrono::steady_clock::time_point t,
+               long double value) {
+    if (!open_)
+      return;
+    std::stringstream os;
+    os << "\"name\":" << quote(name) << ",\"ph\":\"C\",\"pid\":1,\"ts\":" << timestamp(t)
+       << ",\"args\":{\"value\":" << std::fixed << std::setprecision(2) << finite(value) << "}";
+    event(os.str());
+  }
+
+  bool close() {
+    if (!open_)
+      return false;
+    buffer_ += "\n]\n";
+    flush();
+    open_ = false;
+#if defined(__unix__) || defined(__APPLE__)
+    if (::close(fd_) != 0)
+      good_ = false;
+    fd_ = -1;
+#else
+    os_.close();
+    good_ = good_ && !os_.fail();
+#endif
+    return good_;
   }
 };
 
 } // namespace criterion
 
+
 #pragma once
-// #include <criterion/details/benchmark.hpp>
 // #include <criterion/details/benchmark_result.hpp>
+#include <filesystem>
 #include <fstream>
-#include <iomanip>
-#include <sstream>
+#include <functional>
 #include <string>
-#include <unordered_map>
+#include <system_error>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace criterion {
 
-class md_writer {
+// Receives results as benchmarks complete. Any number of reporters can be active at once (see
+// benchmark::reporters), e.g., to write CSV, JSON and HTML from the same run
+class reporter {
 public:
-  static bool write_results(const std::string &filename,
-                            const std::unordered_map<std::string, benchmark_result> &results) {
-    bool result{false};
-    std::ofstream os(filename);
-    if (os.is_open()) {
+  virtual ~reporter() = default;
 
-      os << "|Name            |Warmup Runs|Iterations|Mean Execution Time (ns)|Fastest Execution "
-            "Time (ns)|Slowest Execution Time (ns)|Lowest RSD Execution Time (ns)|Lowest RSD "
-            "(%)|Lowest RSD Index|Average Iteration Performance (iterations/s)|Fastest Iteration "
-            "Performance (iterations/s)|Slowest Iteration Performance (iterations/s)|\n";
-      os << "|:---------------|----------:|---------:|-----------------------:|--------------------"
-            "------:|--------------------------:|-----------------------------:|-------------:|----"
-            "-----------:|-------------------------------------------:|----------------------------"
-            "---------------:|-------------------------------------------:|\n";
+  virtual void on_run_start() {}
 
-      for (const auto &name : benchmark::benchmark_execution_order) {
-        const auto &this_result = results.at(name);
-        os << this_result.to_md();
+  virtual void on_benchmark_complete(const benchmark_result &) {}
+
+  virtual void on_run_end() {}
+
+  // false if writing any of the output failed
+  virtual bool good() const = 0;
+
+  // where the output goes, for error messages
+  virtual std::string destination() const = 0;
+};
+
+// A file of records that are each on disk before append() returns, so a crash or a timeout
+// loses at most the record that was being written
+class record_file {
+#if defined(__unix__) || defined(__APPLE__)
+  int fd_{-1};
+#else
+  std::ofstream os_;
+#endif
+  bool good_{false};
+
+public:
+  record_file() = default;
+  record_file(const record_file &) = delete;
+  record_file &operator=(const record_file &) = delete;
+
+  ~record_file() { close(); }
+
+  bool open(const std::string &filename) {
+#if defined(__unix__) || defined(__APPLE__)
+    fd_ = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    good_ = fd_ >= 0;
+#else
+    os_.open(filename, std::ios::binary | std::ios::trunc);
+    good_ = os_.is_open();
+#endif
+    return good_;
+  }
+
+  bool append(const std::string &record) {
+    if (!good_)
+      return false;
+#if defined(__unix__) || defined(__APPLE__)
+    std::size_t written = 0;
+    while (written < record.size()) {
+      const auto n = ::write(fd_, record.data() + written, record.size() - written);
+      if (n < 0) {
+        if (errno == EINTR)
+          continue;
+        good_ = false;
+        return false;
       }
-      result = true;
+      written += static_cast<std::size_t>(n);
     }
-    os.close();
-    return result;
+    good_ = ::fsync(fd_) == 0;
+#else
+    os_ << record;
+    os_.flush();
+    good_ = os_.good();
+#endif
+    return good_;
+  }
+
+  bool close() {
+#if defined(__unix__) || defined(__APPLE__)
+    if (fd_ >= 0) {
+      if (::close(fd_) != 0)
+        good_ = false;
+      fd_ = -1;
+    }
+#else
+    if (os_.is_open())
+      os_.close();
+#endif
+    return good_;
+  }
+
+  bool good() const { return good_; }
+};
+
+// Writes one JSON object per benchmark as it completes
+class jsonl_reporter : public reporter {
+  std::string filename_;
+  record_file file_;
+
+public:
+  explicit jsonl_reporter(std::string filename) : filename_(std::move(filename)) {}
+
+  void on_run_start() override { file_.open(filename_); }
+
+  void on_benchmark_complete(const benchmark_result &result) override {
+    file_.append(result.to_jsonl() + "\n");
+  }
+
+  void on_run_end() override { file_.close(); }
+
+  bool good() const override { return file_.good(); }
+
+  std::string destination() const override { return filename_; }
+};
+
+// Rewrites a whole document, e.g., with json_writer, after every benchmark (if `incremental`)
+// and at the end of the run. Each version is written to a temporary file that then replaces the
+// previous one, so the file always holds a complete document with the results so far
+class snapshot_reporter : public reporter {
+  std::string filename_;
+  std::function<bool(const std::string &filename)> write_;
+  bool incremental_;
+  bool good_{true};
+
+  void snapshot() {
+    const auto temporary = filename_ + ".tmp";
+    std::error_code error;
+    if (!write_(temporary)) {
+      good_ = false;
+      std::filesystem::remove(temporary, error);
+      return;
+    }
+    std::filesystem::rename(temporary, filename_, error);
+    good_ = good_ && !error;
+  }
+
+public:
+  snapshot_reporter(std::string filename, std::function<bool(const std::string &filename)> write,
+                    bool incremental = true)
+      : filename_(std::move(filename)), write_(std::move(write)), incremental_(incremental) {}
+
+  // starts with an empty document, which also checks that the file can be written
+  void on_run_start() override { snapshot(); }
+
+  void on_benchmark_complete(const benchmark_result &) override {
+    if (incremental_)
+      snapshot();
   }
+
+  void on_run_end() override { snapshot(); }
+
+  bool good() const override { return good_; }
+
+  std::string destination() const override { return filename_; }
 };
 
 } // namespace criterion
 
+
 #pragma once
-// #include <criterion/details/benchmark.hpp>
-// #include <criterion/details/benchmark_result.hpp>
-#include <ctime>
-#include <fstream>
-#include <iomanip>
-#include <sstream>
-#include <string>
-#include <unordered_map>
+#include <atomic>
+#include <cstdint>
+#include <optional>
 
 namespace criterion {
 
-class asciidoc_writer {
-public:
-  static bool write_results(const std::string &filename,
-                            const std::unordered_map<std::string, benchmark_result> &results) {
-    bool result{false};
-    std::ofstream os(filename);
-    if (os.is_open()) {
+// Counts heap allocations, if enabled by defining CRITERION_COUNT_ALLOCATIONS before including
+// criterion in the file with CRITERION_BENCHMARK_MAIN, which then replaces the global operator new.
+// Allocations of all threads are counted
+struct allocation_counter {
+  static inline std::atomic<std::uint64_t> allocations{0};
+  static inline bool enabled{false};
 
-      std::time_t t = std::time(nullptr);
-      os << ".Criterion Benchmark Results (" << std::put_time(std::gmtime(&t), "%c %Z") << ")\n";
-      os << "[cols=\"<,>,>,>,>,>,>,>,>,>,>,>\", options=\"header\"]\n";
-      os << "|===\n";
-      os << "|Name            |Warmup Runs|Iterations|Mean Execution Time (ns)|Fastest Execution "
-            "Time (ns)|Slowest Execution Time (ns)|Lowest RSD Execution Time (ns)|Lowest RSD "
-            "(%)|Lowest RSD Index|Average Iteration Performance (iterations/s)|Fastest Iteration "
-            "Performance (iterations/s)|Slowest Iteration Performance (iterations/s)\n";
+  // Counts at the start and end of the measured part of the current iteration. benchmark::run()
+  // sets them around the whole iteration; SETUP_BENCHMARK and TEARDOWN_BENCHMARK (and the
+  // benchmark_fixture of criterion::register_benchmark) move them so that
+  // allocations during setup and teardown are left out
+  static inline std::uint64_t iteration_start{0};
+  static inline std::optional<std::uint64_t> iteration_end;
 
-      for (const auto &name : benchmark::benchmark_execution_order) {
-        const auto &this_result = results.at(name);
-        os << this_result.to_md();
-      }
-      os << "|===\n";
-      result = true;
-    }
-    os.close();
-    return result;
+  static std::uint64_t count() { return allocations.load(std::memory_order_relaxed); }
+
+  static void mark_start() {
+    if (enabled)
+      iteration_start = count();
+  }
+
+  static void mark_end() {
+    if (enabled)
+      iteration_end = count();
   }
 };
 
 } // namespace criterion
 
+
 #pragma once
+#include <algorithm>
+#include <array>
 #include <chrono>
-// #include <criterion/details/benchmark.hpp>
-// #include <criterion/details/benchmark_config.hpp>
-// #include <criterion/details/csv_writer.hpp>
+#include <cmath>
+#include <csignal>
 #include <functional>
-#include <regex>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+// #include <criterion/details/allocations.hpp>
+// #include <criterion/details/antagonist.hpp>
+// #include <criterion/details/benchmark_config.hpp>
+// #include <criterion/details/benchmark_result.hpp>
+// #include <criterion/details/complexity.hpp>
+// #include <criterion/details/console_writer.hpp>
+// #include <criterion/details/indicators.hpp>
+// #include <criterion/details/reporter.hpp>
+// #include <criterion/details/sample_writer.hpp>
+// #include <criterion/details/time_budget.hpp>
+// #include <criterion/details/trace_writer.hpp>
+
 namespace criterion {
 
-struct benchmark_registration_helper_struct {
-  static std::vector<benchmark_config> &registered_benchmarks() {
-    static std::vector<benchmark_config> v;
-    return v;
-  }
+class benchmark {
+  benchmark_config config_;
+  using Fn = benchmark_config::Fn;
 
-  static void register_benchmark(const benchmark_config &config) {
-    registered_benchmarks().push_back(config);
-  }
+  static inline constexpr std::size_t default_num_iterations_{20};
+  std::size_t num_iterations_{default_num_iterations_};
+  std::size_t num_warmup_runs_{0};
+  std::size_t max_num_runs_{0};
+  const long double ten_seconds_{1e+10};
+  long double min_benchmark_time_{ten_seconds_};
+  long double benchmark_time_;
+  long double early_estimate_execution_time_;
 
-  static void execute_registered_benchmarks() {
-    for (const auto &config : registered_benchmarks()) {
-      benchmark{config}.run();
-    }
-  }
+  long double estimate_minimum_measurement_cost() {
+    using namespace std::chrono;
+    std::vector<long double> durations;
 
-  static void list_registered_benchmarks() {
-    for (const auto &config : registered_benchmarks()) {
-      std::cout << config.name << config.parameterized_instance_name << "\n";
+    for (std::size_t i = 0; i < 10; i++) {
+      const auto start = steady_clock::now();
+      // do nothing
+      const auto end = steady_clock::now();
+      const auto execution_time =
+          static_cast<long double>(duration_cast<std::chrono::nanoseconds>(end - start).count());
+      durations.push_back(execution_time);
     }
+    return *std::min_element(durations.begin(), durations.end());
   }
 
-  static void list_filtered_registered_benchmarks(const std::string &regex_string) {
-    std::regex regexp(regex_string);
-    std::smatch matches;
-    for (const auto &config : registered_benchmarks()) {
-      const auto benchmark_instance_name = config.name + config.parameterized_instance_name;
-      std::regex_search(benchmark_instance_name, matches, regexp);
-      if (!matches.empty()) {
-        std::cout << benchmark_instance_name << "\n";
+  long double estimate_execution_time() {
+    using namespace std::chrono;
+
+    const auto &options = config_.options;
+    const auto min_warmup_runs =
+        options.warmup_runs.value_or(options.warmup_time ? std::size_t{1} : warmup_runs);
+    const auto warmup_start = steady_clock::now();
+
+    long double result = 0;
+    bool first_run{true};
+    for (num_warmup_runs_ = 0;
+         num_warmup_runs_ < min_warmup_runs ||
+         (options.warmup_time && steady_clock::now() - warmup_start < options.warmup_time.value());
+         num_warmup_runs_++) {
+      std::chrono::steady_clock::time_point start_timestamp;
+      std::optional<std::chrono::steady_clock::time_point> teardown_timestamp;
+      const auto start = steady_clock::now();
+      config_.fn(start_timestamp, teardown_timestamp, config_.parameters);
+      const auto end = steady_clock::now();
+      const auto execution_time =
+          static_cast<long double>(duration_cast<std::chrono::nanoseconds>(end - start).count());
+      if (first_run) {
+        result = execution_time;
+        first_run = false;
+      } else {
+        result = std::min(execution_time, result);
       }
     }
+    return result;
   }
 
-  static void execute_filtered_registered_benchmarks(const std::string &regex_string) {
-    std::regex regexp(regex_string);
-    std::smatch matches;
-    for (const auto &config : registered_benchmarks()) {
-      const auto benchmark_instance_name = config.name + config.parameterized_instance_name;
-      std::regex_search(benchmark_instance_name, matches, regexp);
-      if (!matches.empty()) {
-        benchmark{config}.run();
+  void update_iterations() {
+    early_estimate_execution_time_ = estimate_execution_time();
+
+    if (early_estimate_execution_time_ < 1)
+      early_estimate_execution_time_ = 1;
+
+    const auto &options = config_.options;
+    std::size_t min_runs = options.max_time ? 1 : 2;
+
+    if (early_estimate_execution_time_ <= 100) {              // 100ns
+      benchmark_time_ = 5e+8;                                 // 500 ms
+    } else if (early_estimate_execution_time_ <= 1000) {      // 1us
+      benchmark_time_ = 1e+9;                                 // 1s
+    } else if (early_estimate_execution_time_ <= 100000) {    // 100us
+      benchmark_time_ = 2.5e+9;                               // 2.5s
+    } else if (early_estimate_execution_time_ <= 1000000) {   // 1ms
+      benchmark_time_ = 5e+9;                                 // 5s
+    } else if (early_estimate_execution_time_ <= 100000000) { // 100ms
+      benchmark_time_ = 7.5e+9;                               // 7.5s
+    } else {
+      benchmark_time_ = min_benchmark_time_;
+    }
+
+    benchmark_time_ =
+        std::max(early_estimate_execution_time_ * min_runs * num_iterations_, benchmark_time_);
+
+    if (options.min_time) {
+      benchmark_time_ = std::max(benchmark_time_, (long double)options.min_time->count());
+    }
+    if (options.max_time) {
+      benchmark_time_ = std::min(benchmark_time_, (long double)options.max_time->count());
+    }
+
+    if (options.samples) {
+      // exactly this many runs, unless max_time runs out first
+      max_num_runs_ = std::max(options.samples.value(), std::size_t{1});
+      if (!options.max_time) {
+        benchmark_time_ = std::numeric_limits<long double>::infinity();
       }
+      return;
     }
+
+    const auto total_iterations = size_t(benchmark_time_) / early_estimate_execution_time_;
+    max_num_runs_ = std::max(size_t(total_iterations / num_iterations_), size_t(min_runs));
   }
-};
 
-} // namespace criterion
+public:
+  benchmark(const benchmark_config &config)
+      : config_(config),
+        num_iterations_(std::max(config.options.batch_size.value_or(default_num_iterations_),
+                                 std::size_t{1})) {}
 
-#define SETUP_BENCHMARK(...)                                                                       \
-  __VA_ARGS__                                                                                      \
-  __benchmark_start_timestamp =                                                                    \
-      std::chrono::steady_clock::now(); // updated benchmark start timestamp
+  static inline std::unordered_map<std::string, benchmark_result> results;
+  static inline std::vector<std::string> benchmark_execution_order;
+  static inline bool show_console_output = true;
+  static inline std::size_t warmup_runs = 3;
+  static inline interference_profile interference;
+  static inline std::optional<std::chrono::nanoseconds> time_budget;
+  static inline std::optional<time_budget_report> budget_report;
+  static inline sample_writer *sample_export{nullptr}; // set with --export_samples
+  static inline trace_writer *trace{nullptr};          // set with --trace
+  static inline std::vector<std::shared_ptr<reporter>> reporters;
+
+  // Runs a few iterations to estimate the cost and variance of this benchmark, e.g., to split a
+  // time budget across benchmarks. Stops once `max_time` ns have passed, but not before two
+  // iterations. Nothing is recorded
+  budget_pilot pilot(long double max_time) {
+    using namespace std::chrono;
+    const auto pilot_start = steady_clock::now();
 
-#define TEARDOWN_BENCHMARK(...)                                                                    \
-  __benchmark_teardown_timestamp = std::chrono::steady_clock::now();                               \
-  __VA_ARGS__
+    std::shared_ptr<void> lazy_parameters;
+    if (config_.parameter_factory) {
+      lazy_parameters = config_.parameter_factory();
+      config_.parameters = lazy_parameters.get();
+    }
 
-namespace criterion {
+    if (config_.before_instance) {
+      config_.before_instance(config_.parameters);
+    }
 
-struct benchmark_template_registration_helper_struct {
-  static std::unordered_multimap<std::string, benchmark_config> &registered_benchmark_templates() {
-    static std::unordered_multimap<std::string, benchmark_config> m;
-    return m;
-  }
+    constexpr std::size_t max_pilot_iterations = 100;
+    std::vector<long double> durations;
+    long double iterations_time = 0;
+    while (durations.size() < 2 ||
+           (durations.size() < max_pilot_iterations && iterations_time < max_time)) {
+      std::optional<std::chrono::steady_clock::time_point> teardown_timestamp;
+      const auto iteration_start = steady_clock::now();
+      auto start = iteration_start;
+      config_.fn(start, teardown_timestamp, config_.parameters);
+      const auto iteration_end = steady_clock::now();
+      const auto end = teardown_timestamp.value_or(iteration_end);
+      durations.push_back(
+          static_cast<long double>(duration_cast<std::chrono::nanoseconds>(end - start).count()));
+      iterations_time += static_cast<long double>(
+          duration_cast<std::chrono::nanoseconds>(iteration_end - iteration_start).count());
+    }
 
-  static void register_benchmark_template(const benchmark_config &config) {
-    registered_benchmark_templates().insert({config.name, config});
-  }
+    if (config_.after_instance) {
+      config_.after_instance(config_.parameters);
+    }
+    lazy_parameters.reset();
 
-  template <class ArgTuple>
-  static void execute_registered_benchmark_template(const std::string &template_name,
-                                                    const std::string &instance_name,
-                                                    ArgTuple &arg_tuple) {
-    for (auto &[k, v] : registered_benchmark_templates()) {
-      if (k == template_name) {
-        benchmark_registration_helper_struct::register_benchmark(
-            benchmark_config{.name = template_name,
-                             .fn = v.fn,
-                             .parameterized_instance_name = instance_name,
-                             .parameters = (void *)(&arg_tuple)});
-      }
+    const auto size = durations.size();
+    const long double mean = std::accumulate(durations.begin(), durations.end(), 0.0L) / size;
+    long double E = 0;
+    for (const auto duration : durations) {
+      E += std::pow(duration - mean, 2);
+    }
+    const long double standard_deviation = std::sqrt(E / size);
+
+    const auto iteration_cost = std::max(iterations_time / size, 1.0L);
+    const auto overhead =
+        static_cast<long double>(
+            duration_cast<std::chrono::nanoseconds>(steady_clock::now() - pilot_start).count()) -
+        iterations_time;
+
+    const auto &options = config_.options;
+    const auto num_warmup_runs =
+        options.warmup_runs.value_or(options.warmup_time ? std::size_t{1} : warmup_runs);
+    auto fixed_cost = std::max(overhead, 0.0L) + num_warmup_runs * iteration_cost;
+    if (options.warmup_time) {
+      fixed_cost = std::max(fixed_cost, (long double)options.warmup_time->count());
+    }
+    if (options.samples) {
+      fixed_cost += options.samples.value() * num_iterations_ * iteration_cost;
+    }
+
+    if (trace) {
+      trace->complete(trace->thread_track("benchmark"),
+                      config_.name + config_.parameterized_instance_name, "pilot", pilot_start,
+                      steady_clock::now(), {{"iterations", durations.size()}});
     }
+
+    return budget_pilot{.name = config_.name + config_.parameterized_instance_name,
+                        .iteration_cost = iteration_cost,
+                        .relative_standard_deviation = mean > 0 ? standard_deviation / mean : 0,
+                        .fixed_cost = fixed_cost,
+                        .batch_size = num_iterations_,
+                        .adjustable_batch_size = !options.batch_size.has_value(),
+                        .allocatable = !options.samples.has_value()};
   }
-};
 
-} // namespace criterion
+  void run() {
+    std::chrono::steady_clock::time_point benchmark_start_timestamp;
 
-#define CONCAT_IMPL(a, b) a##b
-#define CONCAT(a, b) CONCAT_IMPL(a, b)
+    using namespace std::chrono;
 
-#define BENCHMARK_WITHOUT_PARAMETERS(Name)                                                         \
-  typedef std::tuple<> CONCAT(Name, BenchmarkParameters);                                          \
-  namespace detail {                                                                               \
-  /* forward declare the benchmark function that we define later */                                \
-  template <class T = CONCAT(Name, BenchmarkParameters)>                                           \
-  struct CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__)) {                          \
-    static inline void CONCAT(Name, CONCAT(_registered_fun_, __LINE__))(                           \
-        std::chrono::steady_clock::time_point &,                                                   \
-        std::optional<std::chrono::steady_clock::time_point> &, void *);                           \
-  };                                                                                               \
-                                                                                                   \
-  namespace /* ensure internal linkage for struct */                                               \
-  {                                                                                                \
-  /* helper struct for static registration in ctor */                                              \
-  struct CONCAT(Name, CONCAT(_register_struct_, __LINE__)) {                                       \
-    CONCAT(Name, CONCAT(_register_struct_, __LINE__))() { /* called once before main */            \
+    // Phases of this run on the timeline of --trace, if any
+    const auto run_start = steady_clock::now();
+    auto phase_start = run_start;
+    const auto trace_track = trace ? trace->thread_track("benchmark") : 0;
+    const auto trace_phase = [&](const std::string &phase, const trace_writer::args &args = {}) {
+      const auto now = steady_clock::now();
+      if (trace)
+        trace->complete(trace_track, phase, "phase", phase_start, now, args);
+      phase_start = now;
+    };
+
+    // run empty function to estimate minimum delay in scheduling and executing user function
+    const auto estimated_minimum_measurement_cost = estimate_minimum_measurement_cost();
+    trace_phase("calibration", {{"measurement_cost_ns", estimated_minimum_measurement_cost}});
+
+    const std::string benchmark_instance_name = config_.name + config_.parameterized_instance_name;
+    benchmark_execution_order.push_back(benchmark_instance_name);
+    const auto sample_export_id =
+        sample_export ? sample_export->add_benchmark(benchmark_instance_name,
+                                                     estimated_minimum_measurement_cost)
+                      : 0;
+
+    // Construct lazily declared parameters now that this instance is actually being run
+    std::shared_ptr<void> lazy_parameters;
+    if (config_.parameter_factory) {
+      lazy_parameters = config_.parameter_factory();
+      config_.parameters = lazy_parameters.get();
+    }
+
+    if (config_.before_instance) {
+      config_.before_instance(config_.parameters);
+    }
+
+    // Start background interference (if any) before warmup so estimates see the same load
+    antagonists interference_threads{interference};
+    const auto interference_start = steady_clock::now();
+    trace_phase("setup");
+
+    // Get an early estimate for execution time
+    // Update number of iterations to run for this benchmark based on estimate
+    update_iterations();
+    trace_phase("warmup", {{"runs", num_warmup_runs_},
+                           {"estimate_ns", early_estimate_execution_time_},
+                           {"batch_size", num_iterations_},
+                           {"max_runs", max_num_runs_}});
+
+    const auto total_number_of_iterations = max_num_runs_ * num_iterations_;
+
+    long double lowest_rsd = 100;
+    long double lowest_rsd_mean = 0;
+    std::size_t lowest_rsd_index = 0;
+    bool first_run{true};
+
+    long double fastest_execution_time = 0;
+    long double slowest_execution_time = 0;
+    std::vector<long double> mean_in_each_run{};
+    mean_in_each_run.reserve(max_num_runs_);
+
+    std::size_t num_runs = 0;
+    std::vector<long double> durations(num_iterations_);
+    std::uint64_t allocations = 0; // in measured iterations, if allocation_counter is enabled
+
+    using namespace indicators;
+
+    // Hide cursor
+    if (show_console_output) {
+      show_console_cursor(false);
+    }
+
+    BlockProgressBar bar{option::BarWidth{50},
+                         option::Start{"["},
+                         option::End{"]"},
+                         option::ShowElapsedTime{true},
+                         option::ShowRemainingTime{true},
+                         option::ShowPercentage{true},
+                         option::ForegroundColor{Color::white},
+                         option::FontStyles{std::vector<FontStyle>{FontStyle::bold}},
+                         option::MaxProgress{total_number_of_iterations},
+                         option::PrefixText{" > " + benchmark_instance_name + " "}};
+
+    while (true) {
+      // Benchmark runs
+      if (first_run) {
+        benchmark_start_timestamp = std::chrono::steady_clock::now();
+      }
+      const auto run_allocations = allocations;
+      long double fixture_time = 0; // in SETUP_BENCHMARK and TEARDOWN_BENCHMARK, if traced
+      for (std::size_t i = 0; i < num_iterations_; i++) {
+        std::optional<std::chrono::steady_clock::time_point> teardown_timestamp;
+        allocation_counter::mark_start();
+        allocation_counter::iteration_end.reset();
+        auto start = steady_clock::now();
+        const auto call_start = start;
+        config_.fn(start, teardown_timestamp, config_.parameters);
+        auto end = steady_clock::now();
+        if (allocation_counter::enabled) {
+          allocations += allocation_counter::iteration_end.value_or(allocation_counter::count()) -
+                         allocation_counter::iteration_start;
+        }
+        if (trace) {
+          fixture_time += static_cast<long double>(
+              duration_cast<std::chrono::nanoseconds>((start - call_start) +
+                                                      (end - teardown_timestamp.value_or(end)))
+                  .count());
+        }
+        if (teardown_timestamp)
+          end = teardown_timestamp.value();
+        const auto execution_time = duration_cast<std::chrono::nanoseconds>(end - start).count();
+        durations[i] = std::abs(execution_time - estimated_minimum_measurement_cost);
+        if (sample_export) {
+          sample_export->add(sample_export_id, num_runs, num_iterations_, start, execution_time);
+        }
+        if (show_console_output) {
+          bar.tick();
+        }
+      }
+      auto size = num_iterations_;
+      const long double mean = std::accumulate(durations.begin(), durations.end(), 0.0) / size;
+
+      long double E = 0;
+      for (std::size_t i = 0; i < size; i++) {
+        E += std::pow(durations[i] - mean, 2);
+      }
+      const long double variance = E / size;
+      const long double standard_deviation = std::sqrt(variance);
+      const long double relative_standard_deviation = standard_deviation * 100 / mean;
+
+      const auto mean_in_this_run =
+          std::accumulate(durations.begin(), durations.end(), 0.0) / num_iterations_;
+      mean_in_each_run.push_back(mean_in_this_run);
+
+      if (first_run) {
+        lowest_rsd = relative_standard_deviation;
+        lowest_rsd_mean = mean;
+        lowest_rsd_index = num_runs + 1;
+        fastest_execution_time = *std::min_element(durations.begin(), durations.end());
+        slowest_execution_time = *std::max_element(durations.begin(), durations.end());
+        first_run = false;
+      } else {
+        // Save record of lowest RSD
+        const auto current_lowest_rsd = lowest_rsd;
+        const auto current_lowest_rsd_index = lowest_rsd_index;
+        lowest_rsd = std::min(relative_standard_deviation, lowest_rsd);
+        if (lowest_rsd < current_lowest_rsd) {
+          // There's a new LOWEST relative standard deviation
+
+          if (mean < lowest_rsd_mean) {
+            lowest_rsd_mean = mean; // new mean is lower
+            lowest_rsd_index = num_runs + 1;
+          } else {
+            lowest_rsd = current_lowest_rsd; // go back to old estimate
+            lowest_rsd_index = current_lowest_rsd_index;
+          }
+        } else {
+          lowest_rsd = current_lowest_rsd; // go back to old estimate
+          lowest_rsd_index = current_lowest_rsd_index;
+        }
+
+        // Save best and worst duration
+        const auto current_best_execution_time =
+            *std::min_element(durations.begin(), durations.end());
+        if (current_best_execution_time > 0)
+          fastest_execution_time = std::min(fastest_execution_time, current_best_execution_time);
+
+        const auto current_worst_execution_time =
+            *std::max_element(durations.begin(), durations.end());
+        slowest_execution_time = std::max(slowest_execution_time, current_worst_execution_time);
+      }
+
+      if (trace) {
+        const auto now = steady_clock::now();
+        trace->complete(trace_track, "run " + std::to_string(num_runs + 1), "run", phase_start,
+                        now, {{"mean_ns", mean}, {"rsd_percentage", relative_standard_deviation}});
+        trace->counter("mean (ns)", phase_start, mean);
+        trace->counter("rsd (%)", phase_start, relative_standard_deviation);
+        trace->counter("setup and teardown (ns/iteration)", phase_start,
+                       fixture_time / num_iterations_);
+        if (allocation_counter::enabled) {
+          trace->counter("allocations (per iteration)", phase_start,
+                         static_cast<long double>(allocations - run_allocations) /
+                             num_iterations_);
+        }
+        phase_start = now;
+      }
+
+      num_runs += 1;
+
+      if (num_runs >= max_num_runs_) {
+        break;
+      }
+
+      const auto now = std::chrono::steady_clock::now();
+      const auto elapsed_time =
+          std::chrono::duration_cast<std::chrono::nanoseconds>(now - benchmark_start_timestamp)
+              .count();
+      if (elapsed_time > benchmark_time_) {
+        break;
+      } else {
+        if (show_console_output) {
+          const auto percentage_completed = elapsed_time / benchmark_time_;
+          const auto new_bar_progress = percentage_completed * total_number_of_iterations;
+          bar.set_progress(new_bar_progress);
+        }
+      }
+    }
+
+    interference_threads.stop();
+    if (trace) {
+      const auto interference_end = steady_clock::now();
+      for (const auto &thread : interference.thread_names()) {
+        trace->complete(trace->track("antagonist " + thread), thread, "antagonist",
+                        interference_start, interference_end);
+      }
+    }
+
+    if (config_.after_instance) {
+      config_.after_instance(config_.parameters);
+    }
+    trace_phase("teardown");
+
+    const auto mean_execution_time =
+        (std::accumulate(mean_in_each_run.begin(), mean_in_each_run.end(), 0.0) / num_runs);
+
+    const auto benchmark_result = criterion::benchmark_result{
+        .name = benchmark_instance_name,
+        .num_warmup_runs = num_warmup_runs_,
+        .num_runs = max_num_runs_,
+        .num_iterations = num_iterations_,
+        .lowest_rsd = lowest_rsd,
+        .lowest_rsd_mean = lowest_rsd_mean,
+        .lowest_rsd_index = lowest_rsd_index,
+        .warmup_execution_time = early_estimate_execution_time_,
+        .mean_execution_time = mean_execution_time,
+        .fastest_execution_time = fastest_execution_time,
+        .slowest_execution_time = slowest_execution_time,
+        .average_iteration_performance = (1E9 / mean_execution_time),
+        .fastest_iteration_performance = (1E9 / fastest_execution_time),
+        .slowest_iteration_performance = (1E9 / slowest_execution_time),
+        .interference = interference.to_string(),
+        .samples = mean_in_each_run,
+        .allocations_per_iteration =
+            allocation_counter::enabled
+                ? std::optional<long double>(static_cast<long double>(allocations) /
+                                             (num_runs * num_iterations_))
+                : std::nullopt};
+
+    results.insert(std::make_pair(benchmark_instance_name, benchmark_result));
+    complexity_registration_helper_struct::record(
+        config_.template_name.empty() ? config_.name : config_.template_name, config_.name,
+        config_.parameters, mean_execution_time);
+    for (const auto &r : reporters) {
+      r->on_benchmark_complete(benchmark_result);
+    }
+
+    if (show_console_output) {
+      bar.set_progress(total_number_of_iterations);
+      bar.mark_as_completed();
+
+      // Show console cursor
+      show_console_cursor(true);
+
+      console_writer::write_result(benchmark_result);
+    }
+    trace_phase("analysis");
+
+    if (trace) {
+      trace->complete(trace_track, benchmark_instance_name, "benchmark", run_start,
+                      steady_clock::now(), {{"runs", num_runs}, {"mean_ns", mean_execution_time}});
+      trace->flush();
+    }
+  }
+};
+
+} // namespace criterion
+
+#pragma once
+// #include <criterion/details/benchmark.hpp>
+// #include <criterion/details/benchmark_result.hpp>
+// #include <criterion/details/statistics.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+namespace criterion {
+
+// Samples (mean execution time per benchmark run) saved with --save_baseline, one file per
+// baseline in .criterion/baselines. compare() tests these per-run means, which are close to
+// independent, unlike the iterations of a run; every iteration is kept by sample_writer instead.
+// Each benchmark is stored as two lines:
+//
+//   MergeSort/1K
+//   <iterations per run> <number of samples> <sample> <sample> ...
+class baseline {
+  static inline const std::string magic{"criterion-baseline 1"};
+
+public:
+  struct entry {
+    std::size_t num_iterations;
+    std::vector<long double> samples;
+  };
+
+  std::string name;
+  std::vector<std::string> order; // benchmark names, in the order they were saved
+  std::unordered_map<std::string, entry> entries;
+
+  static inline std::string directory{".criterion/baselines"};
+
+  // Baseline names become file names, so only [A-Za-z0-9_.-] are allowed
+  static bool valid_name(const std::string &baseline_name) {
+    if (baseline_name.empty() || baseline_name == "." || baseline_name == "..")
+      return false;
+    return std::all_of(baseline_name.begin(), baseline_name.end(), [](char c) {
+      return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.' || c == '-';
+    });
+  }
+
+  static std::string path(const std::string &baseline_name) {
+    return directory + "/" + baseline_name + ".baseline";
+  }
+
+  static std::optional<baseline> load(const std::string &baseline_name) {
+    return load_file(path(baseline_name), baseline_name);
+  }
+
+  // Loads a baseline from any path, e.g., one copied out of .criterion/baselines
+  static std::optional<baseline> load_file(const std::string &filename,
+                                           const std::string &baseline_name) {
+    std::ifstream is(filename);
+    if (!is.is_open())
+      return std::nullopt;
+
+    std::string line;
+    if (!std::getline(is, line) || line != magic)
+      return std::nullopt;
+
+    baseline result;
+    result.name = baseline_name;
+    std::string benchmark_name;
+    while (std::getline(is, benchmark_name) && std::getline(is, line)) {
+      std::istringstream samples(line);
+      entry e{0, {}};
+      std::size_t size = 0;
+      if (!(samples >> e.num_iterations >> size))
+        return std::nullopt;
+      e.samples.reserve(size);
+      long double sample = 0;
+      while (e.samples.size() < size && samples >> sample) {
+        e.samples.push_back(sample);
+      }
+      if (e.samples.size() != size)
+        return std::nullopt;
+      result.add(benchmark_name, std::move(e));
+    }
+    return result;
+  }
+
+  void add(const std::string &benchmark_name, entry e) {
+    if (entries.find(benchmark_name) == entries.end())
+      order.push_back(benchmark_name);
+    entries[benchmark_name] = std::move(e);
+  }
+
+  bool save() const {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error)
+      return false;
+
+    // write to a temporary file first so an interrupted save leaves the old baseline intact
+    const auto filename = path(name);
+    const auto temporary = filename + ".tmp";
+    {
+      std::ofstream os(temporary);
+      if (!os.is_open())
+        return false;
+      os << magic << "\n";
+      os << std::setprecision(std::numeric_limits<long double>::max_digits10);
+      for (const auto &benchmark_name : order) {
+        const auto &e = entries.at(benchmark_name);
+        os << benchmark_name << "\n" << e.num_iterations << " " << e.samples.size();
+        for (const auto sample : e.samples) {
+          os << " " << sample;
+        }
+        os << "\n";
+      }
+      if (!os.good())
+        return false;
+    }
+    std::filesystem::rename(temporary, filename, error);
+    return !error;
+  }
+
+  // Saves the samples of `results` as `baseline_name`. Benchmarks that were not run (e.g., due
+  // to --run_filtered) keep their previously saved samples
+  static bool save(const std::string &baseline_name,
+                   const std::unordered_map<std::string, benchmark_result> &results) {
+    auto updated = load(baseline_name).value_or(baseline{});
+    updated.name = baseline_name;
+    for (const auto &benchmark_name : benchmark::benchmark_execution_order) {
+      const auto &result = results.at(benchmark_name);
+      updated.add(benchmark_name, entry{result.num_iterations, result.samples});
+    }
+    return updated.save();
+  }
+
+  // Compares every benchmark in `results` that is also in this baseline. A change is only
+  // reported as an improvement or regression if it is significant (p < `alpha`) and larger than
+  // `noise_threshold`, e.g., 0.02 for 2%
+  std::vector<baseline_comparison>
+  compare(const std::unordered_map<std::string, benchmark_result> &results,
+          long double noise_threshold, long double alpha = 0.05) const {
+    std::vector<baseline_comparison> comparisons;
+    for (const auto &benchmark_name : benchmark::benchmark_execution_order) {
+      const auto it = entries.find(benchmark_name);
+      if (it == entries.end())
+        continue;
+      const auto comparison =
+          compare_samples(it->second.samples, results.at(benchmark_name).samples, 1 - alpha);
+      auto verdict = baseline_verdict::no_change;
+      if (comparison.p_value < alpha && std::abs(comparison.relative_change) > noise_threshold) {
+        verdict = comparison.relative_change < 0 ? baseline_verdict::improved
+                                                 : baseline_verdict::regressed;
+      }
+      comparisons.push_back({benchmark_name, name, comparison, verdict});
+    }
+    return comparisons;
+  }
+};
+
+} // namespace criterion
+
+
+#pragma once
+// #include <criterion/details/baseline.hpp>
+// #include <criterion/details/benchmark_result.hpp>
+// #include <criterion/details/sample_format.hpp>
+// #include <criterion/details/statistics.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <random>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace criterion {
+
+struct analysis_options {
+  estimator method{estimator::mean};
+  long double confidence_level{0.95};
+  outlier_policy outliers{outlier_policy::keep};
+};
+
+// Recomputes benchmark results from stored samples, without running any benchmark. The samples
+// are either raw iterations written by --export_samples or run means saved with --save_baseline
+class analysis {
+public:
+  struct benchmark_analysis {
+    benchmark_result result;
+    sample_estimate estimate;
+  };
+
+  std::vector<benchmark_analysis> benchmarks; // in the order they were stored
+
+  static std::optional<estimator> parse_estimator(const std::string &value) {
+    for (const auto method : {estimator::mean, estimator::median, estimator::lowest_rsd}) {
+      if (value == to_string(method))
+        return method;
+    }
+    return std::nullopt;
+  }
+
+  static std::optional<outlier_policy> parse_outlier_policy(const std::string &value) {
+    for (const auto policy :
+         {outlier_policy::keep, outlier_policy::drop_severe, outlier_policy::drop_mild}) {
+      if (value == to_string(policy))
+        return policy;
+    }
+    return std::nullopt;
+  }
+
+  // true if `filename` was written by --export_samples, false if it may be a baseline
+  static bool is_sample_file(const std::string &filename) {
+    std::ifstream is(filename, std::ios::binary);
+    char magic[sizeof(samples::magic)]{};
+    return is.read(magic, sizeof(magic)) &&
+           std::memcmp(magic, samples::magic, sizeof(samples::magic)) == 0;
+  }
+
+  // Estimates the execution time of a benchmark from the durations of the iterations in each
+  // of its runs. Every run may hold a single duration, e.g., the run means of a baseline
+  static benchmark_analysis analyze(const std::string &name,
+                                    const std::vector<std::vector<long double>> &runs,
+                                    std::size_t num_iterations, const analysis_options &options) {
+    std::vector<long double> pooled;
+    for (const auto &run : runs) {
+      pooled.insert(pooled.end(), run.begin(), run.end());
+    }
+    const auto outliers = classify_outliers(pooled);
+    const auto dropped = [&](long double sample) {
+      return (options.outliers == outlier_policy::drop_severe && outliers.severe(sample)) ||
+             (options.outliers == outlier_policy::drop_mild && outliers.mild_or_severe(sample));
+    };
+
+    // per run: (mean or median, relative standard deviation in %, kept durations)
+    struct run_summary {
+      long double value;
+      long double mean;
+      long double rsd;
+      std::vector<long double> durations;
+    };
+    std::vector<run_summary> summaries;
+    std::size_t num_dropped = 0;
+    for (const auto &run : runs) {
+      run_summary summary{0, 0, 0, {}};
+      for (const auto duration : run) {
+        if (dropped(duration)) {
+          num_dropped += 1;
+        } else {
+          summary.durations.push_back(duration);
+        }
+      }
+      if (summary.durations.empty())
+        continue;
+      summary.mean = sample_mean(summary.durations);
+      long double E = 0;
+      for (const auto duration : summary.durations) {
+        E += std::pow(duration - summary.mean, 2);
+      }
+      const auto standard_deviation = std::sqrt(E / summary.durations.size());
+      summary.rsd = summary.mean > 0 ? standard_deviation * 100 / summary.mean : 0;
+      summary.value = options.method == estimator::median ? sample_median(summary.durations)
+                                                          : summary.mean;
+      summaries.push_back(std::move(summary));
+    }
+
+    std::vector<long double> values;
+    long double fastest = 0, slowest = 0;
+    for (const auto &summary : summaries) {
+      values.push_back(summary.value);
+      const auto [lowest, highest] =
+          std::minmax_element(summary.durations.begin(), summary.durations.end());
+      if (*lowest > 0 && (fastest == 0 || *lowest < fastest))
+        fastest = *lowest;
+      slowest = std::max(slowest, *highest);
+    }
+
+    // the run with the lowest RSD, chosen the way benchmark::run() does: a later run only
+    // replaces it if its RSD and its mean are both lower
+    std::size_t lowest_rsd_index = 0;
+    for (std::size_t i = 1; i < summaries.size(); ++i) {
+      const auto &best = summaries[lowest_rsd_index];
+      if (summaries[i].rsd < best.rsd && summaries[i].mean < best.mean)
+        lowest_rsd_index = i;
+    }
+    const auto lowest_rsd = summaries.empty() ? run_summary{0, 0, 0, {}}
+                                              : summaries[lowest_rsd_index];
+
+    const auto z = normal_quantile(0.5L + options.confidence_level / 2);
+    long double estimate = 0, lower_bound = 0, upper_bound = 0;
+    if (options.method == estimator::lowest_rsd) {
+      estimate = lowest_rsd.mean;
+      const auto margin =
+          z * lowest_rsd.rsd / 100 * lowest_rsd.mean /
+          std::sqrt(static_cast<long double>(std::max(lowest_rsd.durations.size(), size_t{1})));
+      lower_bound = estimate - margin;
+      upper_bound = estimate + margin;
+    } else {
+      const auto statistic = [&](const std::vector<long double> &samples) {
+        return options.method == estimator::median ? sample_median(samples)
+                                                   : sample_mean(samples);
+      };
+      estimate = statistic(values);
+      std::tie(lower_bound, upper_bound) = bootstrap(values, statistic, options.confidence_level);
+    }
+
+    benchmark_analysis result;
+    result.result = benchmark_result{
+        .name = name,
+        .num_warmup_runs = 0,
+        .num_runs = summaries.size(),
+        .num_iterations = num_iterations,
+        .lowest_rsd = lowest_rsd.rsd,
+        .lowest_rsd_mean = lowest_rsd.mean,
+        .lowest_rsd_index = summaries.empty() ? 0 : lowest_rsd_index + 1,
+        .warmup_execution_time = 0,
+        .mean_execution_time = estimate,
+        .fastest_execution_time = fastest,
+        .slowest_execution_time = slowest,
+        .average_iteration_performance = (1E9 / estimate),
+        .fastest_iteration_performance = (1E9 / fastest),
+        .slowest_iteration_performance = (1E9 / slowest),
+        .interference = "",
+        .samples = values};
+    result.estimate = sample_estimate{options.method,     estimate,         lower_bound,
+                                      upper_bound,        options.confidence_level,
+                                      outliers,           options.outliers, num_dropped,
+                                      pooled.size()};
+    return result;
+  }
+
+  // Percentile bootstrap interval of `statistic` over `samples`. Resamples are seeded, so the same
+  // samples always give the same interval
+  template <class Statistic>
+  static std::pair<long double, long double> bootstrap(const std::vector<long double> &samples,
+                                                       Statistic statistic,
+                                                       long double confidence_level,
+                                                       std::size_t resamples = 1000) {
+    if (samples.size() < 2) {
+      const auto value = statistic(samples);
+      return {value, value};
+    }
+    std::mt19937 random{0};
+    std::uniform_int_distribution<std::size_t> pick(0, samples.size() - 1);
+    std::vector<long double> estimates, resample(samples.size());
+    estimates.reserve(resamples);
+    for (std::size_t i = 0; i < resamples; ++i) {
+      for (auto &sample : resample) {
+        sample = samples[pick(random)];
+      }
+      estimates.push_back(statistic(resample));
+    }
+    const auto tail = (1 - confidence_level) / 2;
+    return {sample_quantile(estimates, tail), sample_quantile(estimates, 1 - tail)};
+  }
+
+  static analysis from_baseline(const baseline &saved, const analysis_options &options) {
+    analysis result;
+    for (const auto &name : saved.order) {
+      const auto &entry = saved.entries.at(name);
+      std::vector<std::vector<long double>> runs;
+      for (const auto sample : entry.samples) {
+        runs.push_back({sample});
+      }
+      result.benchmarks.push_back(analyze(name, runs, entry.num_iterations, options));
+    }
+    return result;
+  }
+
+#if defined(__unix__) || defined(__APPLE__)
+  static std::optional<analysis> from_sample_file(const std::string &filename,
+                                                  const analysis_options &options) {
+    samples::reader reader(filename);
+    if (!reader.valid())
+      return std::nullopt;
+
+    // durations of each run of each benchmark, net of the measurement cost like in benchmark::run()
+    struct stored {
+      std::string name;
+      double measurement_cost;
+      std::size_t num_iterations{0};
+      std::map<std::uint32_t, std::vector<long double>> runs;
+    };
+    std::vector<stored> benchmarks;
+    std::unordered_map<std::uint32_t, std::size_t> index;
+    for (const auto &info : reader.benchmarks()) {
+      index[info.id] = benchmarks.size();
+      benchmarks.push_back({info.name, info.measurement_cost, 0, {}});
+    }
+    for (const auto &columns : reader.sample_blocks()) {
+      for (std::uint32_t i = 0; i < columns.rows; ++i) {
+        const auto it = index.find(columns.benchmark[i]);
+        if (it == index.end())
+          continue;
+        auto &b = benchmarks[it->second];
+        b.num_iterations = columns.batch_size[i];
+        b.runs[columns.run[i]].push_back(std::abs(columns.duration[i] - b.measurement_cost));
+      }
+    }
+
+    analysis result;
+    for (const auto &b : benchmarks) {
+      if (b.runs.empty())
+        continue;
+      std::vector<std::vector<long double>> runs;
+      for (const auto &[run, durations] : b.runs) {
+        runs.push_back(durations);
+      }
+      result.benchmarks.push_back(analyze(b.name, runs, b.num_iterations, options));
+    }
+    return result;
+  }
+#endif
+
+  // Loads `filename`, which is either a file written by --export_samples or a saved baseline
+  static std::optional<analysis> load(const std::string &filename,
+                                      const analysis_options &options) {
+    if (is_sample_file(filename)) {
+#if defined(__unix__) || defined(__APPLE__)
+      return from_sample_file(filename, options);
+#else
+      return std::nullopt;
+#endif
+    }
+    const auto saved =
+        baseline::load_file(filename, std::filesystem::path(filename).stem().string());
+    if (!saved.has_value())
+      return std::nullopt;
+    return from_baseline(saved.value(), options);
+  }
+};
+
+} // namespace criterion
+
+
+#pragma once
+// #include <criterion/details/benchmark.hpp>
+// #include <criterion/details/benchmark_result.hpp>
+// #include <criterion/details/reporter.hpp>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace criterion {
+
+class csv_writer {
+public:
+  // Column names, shared by write_results and csv_reporter
+  static std::string header() {
+    return "name,warmup_runs,iterations,mean_execution_time,fastest_execution_time,slowest_"
+           "execution_time,lowest_rsd_execution_time,lowest_rsd_percentage,lowest_rsd_index,"
+           "average_iteration_performance,fastest_iteration_performance,slowest_iteration_"
+           "performance\n";
+  }
+
+  static std::string row(const benchmark_result &result) { return result.to_csv() + "\n"; }
+
+  static bool write_results(const std::string &filename,
+                            const std::unordered_map<std::string, benchmark_result> &results) {
+    bool result{false};
+    std::ofstream os(filename);
+    if (os.is_open()) {
+      os << header();
+      for (const auto &name : benchmark::benchmark_execution_order) {
+        os << row(results.at(name));
+      }
+      result = true;
+    }
+    os.close();
+    return result;
+  }
+};
+
+// Writes one CSV row per benchmark as it completes, with the same columns as csv_writer
+class csv_reporter : public reporter {
+  std::string filename_;
+  record_file file_;
+
+public:
+  explicit csv_reporter(std::string filename) : filename_(std::move(filename)) {}
+
+  void on_run_start() override {
+    if (file_.open(filename_)) {
+      file_.append(csv_writer::header());
+    }
+  }
+
+  void on_benchmark_complete(const benchmark_result &result) override {
+    file_.append(csv_writer::row(result));
+  }
+
+  void on_run_end() override { file_.close(); }
+
+  bool good() const override { return file_.good(); }
+
+  std::string destination() const override { return filename_; }
+};
+
+} // namespace criterion
+
+#pragma once
+// #include <criterion/details/benchmark.hpp>
+// #include <criterion/details/benchmark_result.hpp>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+namespace criterion {
+
+class json_writer {
+public:
+  static bool write_results(const std::string &filename,
+                            const std::unordered_map<std::string, benchmark_result> &results) {
+    bool result{false};
+    std::ofstream os(filename);
+    if (os.is_open()) {
+      os << "{\n";
+      os << "  \"benchmarks\": [\n";
+
+      bool first{true};
+      for (const auto &name : benchmark::benchmark_execution_order) {
+        const auto &this_result = results.at(name);
+        if (first) {
+          first = false;
+        } else {
+          os << ",\n";
+        }
+        os << this_result.to_json();
+      }
+
+      os << "\n";
+      os << "  ]\n";
+      os << "}";
+      result = true;
+    }
+    os.close();
+    return result;
+  }
+};
+
+} // namespace criterion
+
+#pragma once
+// #include <criterion/details/benchmark.hpp>
+// #include <criterion/details/benchmark_result.hpp>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+namespace criterion {
+
+class md_writer {
+public:
+  static bool write_results(const std::string &filename,
+                            const std::unordered_map<std::string, benchmark_result> &results) {
+    bool result{false};
+    std::ofstream os(filename);
+    if (os.is_open()) {
+
+      os << "|Name            |Warmup Runs|Iterations|Mean Execution Time (ns)|Fastest Execution "
+            "Time (ns)|Slowest Execution Time (ns)|Lowest RSD Execution Time (ns)|Lowest RSD "
+            "(%)|Lowest RSD Index|Average Iteration Performance (iterations/s)|Fastest Iteration "
+            "Performance (iterations/s)|Slowest Iteration Performance (iterations/s)|\n";
+      os << "|:---------------|----------:|---------:|-----------------------:|--------------------"
+            "------:|--------------------------:|-----------------------------:|-------------:|----"
+            "-----------:|-------------------------------------------:|----------------------------"
+            "---------------:|-------------------------------------------:|\n";
+
+      for (const auto &name : benchmark::benchmark_execution_order) {
+        const auto &this_result = results.at(name);
+        os << this_result.to_md();
+      }
+      result = true;
+    }
+    os.close();
+    return result;
+  }
+};
+
+} // namespace criterion
+
+#pragma once
+// #include <criterion/details/benchmark.hpp>
+// #include <criterion/details/benchmark_result.hpp>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+namespace criterion {
+
+class asciidoc_writer {
+public:
+  static bool write_results(const std::string &filename,
+                            const std::unordered_map<std::string, benchmark_result> &results) {
+    bool result{false};
+    std::ofstream os(filename);
+    if (os.is_open()) {
+
+      std::time_t t = std::time(nullptr);
+      os << ".Criterion Benchmark Results (" << std::put_time(std::gmtime(&t), "%c %Z") << ")\n";
+      os << "[cols=\"<,>,>,>,>,>,>,>,>,>,>,>\", options=\"header\"]\n";
+      os << "|===\n";
+      os << "|Name            |Warmup Runs|Iterations|Mean Execution Time (ns)|Fastest Execution "
+            "Time (ns)|Slowest Execution Time (ns)|Lowest RSD Execution Time (ns)|Lowest RSD "
+            "(%)|Lowest RSD Index|Average Iteration Performance (iterations/s)|Fastest Iteration "
+            "Performance (iterations/s)|Slowest Iteration Performance (iterations/s)\n";
+
+      for (const auto &name : benchmark::benchmark_execution_order) {
+        const auto &this_result = results.at(name);
+        os << this_result.to_md();
+      }
+      os << "|===\n";
+      result = true;
+    }
+    os.close();
+    return result;
+  }
+};
+
+} // namespace criterion
+
+#pragma once
+// #include <criterion/details/baseline.hpp>
+// #include <criterion/details/benchmark.hpp>
+// #include <criterion/details/benchmark_result.hpp>
+// #include <criterion/details/statistics.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace criterion {
+
+namespace detail {
+
+inline std::string html_escape(const std::string &value) {
+  std::string result;
+  for (const auto c : value) {
+    if (c == '<') {
+      result += "&lt;";
+    } else if (c == '>') {
+      result += "&gt;";
+    } else if (c == '&') {
+      result += "&amp;";
+    } else if (c == '"') {
+      result += "&quot;";
+    } else {
+      result += c;
+    }
+  }
+  return result;
+}
+
+inline std::string format_duration(long double ns) {
+  std::stringstream os;
+  os << std::setprecision(3);
+  if (ns < 1E3) {
+    os << ns << " ns";
+  } else if (ns < 1E6) {
+    os << ns / 1E3 << " us";
+  } else if (ns < 1E9) {
+    os << ns / 1E6 << " ms";
+  } else {
+    os << ns / 1E9 << " s";
+  }
+  return os.str();
+}
+
+inline std::string format_count(long double value) {
+  std::stringstream os;
+  os << std::setprecision(3);
+  if (value < 1E3) {
+    os << value;
+  } else if (value < 1E6) {
+    os << value / 1E3 << "k";
+  } else if (value < 1E9) {
+    os << value / 1E6 << "M";
+  } else {
+    os << value / 1E9 << "G";
+  }
+  return os.str();
+}
+
+// Size of a benchmark instance named like the ones INVOKE_BENCHMARK_RANGE generates, e.g., 1024
+// for "MergeSort/1K"
+inline std::optional<long double> instance_size(const std::string &instance_name) {
+  if (instance_name.size() < 2 || instance_name.front() != '/')
+    return std::nullopt;
+  std::size_t end = 1;
+  while (end < instance_name.size() &&
+         (std::isdigit(static_cast<unsigned char>(instance_name[end])) ||
+          instance_name[end] == '.')) {
+    end += 1;
+  }
+  if (end == 1)
+    return std::nullopt;
+  long double multiplier = 1;
+  const auto suffix = instance_name.substr(end);
+  if (suffix == "K") {
+    multiplier = 1024;
+  } else if (suffix == "M") {
+    multiplier = 1024 * 1024;
+  } else if (suffix == "G") {
+    multiplier = 1024 * 1024 * 1024;
+  } else if (!suffix.empty()) {
+    return std::nullopt;
+  }
+  try {
+    return std::stold(instance_name.substr(1, end - 1)) * multiplier;
+  } catch (...) {
+    return std::nullopt;
+  }
+}
+
+// A chart drawn as inline SVG, with linear or logarithmic axes. An axis that starts at 0 or
+// below, e.g., for a benchmark family that includes size 0, is drawn linear instead
+class svg_chart {
+  static constexpr double width_{520}, height_{260};
+  static constexpr double left_{70}, right_{20}, top_{15}, bottom_{40};
+  long double x_min_, x_max_, y_min_, y_max_;
+  bool log_x_, log_y_;
+  std::stringstream os_;
+
+  static long double transform(long double value, bool log) {
+    return log ? std::log10(std::max(value, (long double)1e-12)) : value;
+  }
+
+  static std::vector<long double> ticks(long double min, long double max, bool log) {
+    std::vector<long double> result;
+    if (log && min > 0) {
+      for (auto exponent = std::ceil(std::log10(min)); exponent <= std::log10(max); ++exponent) {
+        result.push_back(std::pow(10.0L, exponent));
+      }
+      if (result.size() >= 2)
+        return result;
+      result.clear();
+    }
+    for (int i = 0; i <= 4; ++i) {
+      result.push_back(min + (max - min) * i / 4);
+    }
+    return result;
+  }
+
+public:
+  svg_chart(long double x_min, long double x_max, long double y_min, long double y_max,
+            bool log_x = false, bool log_y = false)
+      : x_min_(x_min), x_max_(x_max > x_min ? x_max : x_min + 1), y_min_(y_min),
+        y_max_(y_max > y_min ? y_max : y_min + 1), log_x_(log_x && x_min > 0),
+        log_y_(log_y && y_min > 0) {
+    os_ << std::fixed << std::setprecision(1);
+  }
+
+  // e.g., "log-log", or "linear-log" if the x axis could not be logarithmic
+  std::string scale() const {
+    return std::string(log_x_ ? "log" : "linear") + "-" + (log_y_ ? "log" : "linear");
+  }
+
+  long double x(long double value) const {
+    const auto from = transform(x_min_, log_x_), to = transform(x_max_, log_x_);
+    return left_ + (transform(value, log_x_) - from) / (to - from) * (width_ - left_ - right_);
+  }
+
+  long double y(long double value) const {
+    const auto from = transform(y_min_, log_y_), to = transform(y_max_, log_y_);
+    return height_ - bottom_ -
+           (transform(value, log_y_) - from) / (to - from) * (height_ - top_ - bottom_);
+  }
+
+  template <class XFormat, class YFormat>
+  void axes(const std::string &x_label, const std::string &y_label, XFormat &&x_format,
+            YFormat &&y_format) {
+    os_ << "<g class=\"axis\"><line x1=\"" << left_ << "\" y1=\"" << height_ - bottom_
+        << "\" x2=\"" << width_ - right_ << "\" y2=\"" << height_ - bottom_ << "\"/><line x1=\""
+        << left_ << "\" y1=\"" << top_ << "\" x2=\"" << left_ << "\" y2=\"" << height_ - bottom_
+        << "\"/>";
+    for (const auto tick : ticks(x_min_, x_max_, log_x_)) {
+      os_ << "<text x=\"" << x(tick) << "\" y=\"" << height_ - bottom_ + 14
+          << "\" text-anchor=\"middle\">" << html_escape(x_format(tick)) << "</text>";
+    }
+    for (const auto tick : ticks(y_min_, y_max_, log_y_)) {
+      os_ << "<text x=\"" << left_ - 6 << "\" y=\"" << y(tick) + 4
+          << "\" text-anchor=\"end\">" << html_escape(y_format(tick)) << "</text>";
+    }
+    os_ << "<text x=\"" << (left_ + width_ - right_) / 2 << "\" y=\"" << height_ - 4
+        << "\" text-anchor=\"middle\">" << html_escape(x_label) << "</text>";
+    os_ << "<text transform=\"translate(12," << (top_ + height_ - bottom_) / 2
+        << ") rotate(-90)\" text-anchor=\"middle\">" << html_escape(y_label) << "</text></g>";
+  }
+
+  void line(const std::vector<std::pair<long double, long double>> &points,
+            const std::string &css_class) {
+    if (points.empty())
+      return;
+    os_ << "<polyline class=\"" << css_class << "\" points=\"";
+    for (const auto &[px, py] : points) {
+      os_ << x(px) << "," << y(py) << " ";
+    }
+    os_ << "\"/>";
+  }
+
+  void dots(const std::vector<std::pair<long double, long double>> &points,
+            const std::string &css_class) {
+    for (const auto &[px, py] : points) {
+      os_ << "<circle class=\"" << css_class << "\" cx=\"" << x(px) << "\" cy=\"" << y(py)
+          << "\" r=\"2.5\"/>";
+    }
+  }
+
+  std::string str() const {
+    std::stringstream result;
+    result << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << width_ << "\" height=\""
+           << height_ << "\" viewBox=\"0 0 " << width_ << " " << height_ << "\">" << os_.str()
+           << "</svg>";
+    return result.str();
+  }
+};
+
+// Gaussian kernel density estimate of `samples` at `points` evenly spaced points in [min, max]
+inline std::vector<std::pair<long double, long double>>
+kernel_density(const std::vector<long double> &samples, long double min, long double max,
+               std::size_t points = 100) {
+  std::vector<std::pair<long double, long double>> result;
+  if (samples.empty())
+    return result;
+  // Silverman's rule of thumb, using the interquartile range if it is smaller so that a few
+  // outliers do not smooth away the shape of the distribution
+  auto spread = std::sqrt(sample_variance(samples));
+  const auto iqr = (sample_quantile(samples, 0.75) - sample_quantile(samples, 0.25)) / 1.34L;
+  if (iqr > 0)
+    spread = std::min(spread, iqr);
+  auto bandwidth = 1.06L * spread * std::pow((long double)samples.size(), -0.2L);
+  if (!(bandwidth > 0))
+    bandwidth = std::max((max - min) / 50, (long double)1e-3);
+  const auto normalization =
+      1 / (samples.size() * bandwidth * std::sqrt(2 * 3.14159265358979323846L));
+  for (std::size_t i = 0; i < points; ++i) {
+    const auto at = min + (max - min) * i / (points - 1);
+    long double density = 0;
+    for (const auto sample : samples) {
+      const auto u = (at - sample) / bandwidth;
+      density += std::exp(-0.5L * u * u);
+    }
+    result.push_back({at, density * normalization});
+  }
+  return result;
+}
+
+} // namespace detail
+
+class html_writer {
+  static std::string distribution_chart(const std::vector<long double> &samples,
+                                        const std::vector<long double> *baseline_samples) {
+    // leave out the slowest and fastest 1% so that a few outliers do not flatten the plot
+    auto min = sample_quantile(samples, 0.01);
+    auto max = sample_quantile(samples, 0.99);
+    if (baseline_samples && !baseline_samples->empty()) {
+      min = std::min(min, sample_quantile(*baseline_samples, 0.01));
+      max = std::max(max, sample_quantile(*baseline_samples, 0.99));
+    }
+    const auto margin = std::max((max - min) * 0.1L, max * 0.01L);
+    min = std::max(min - margin, (long double)0);
+    max += margin;
+
+    const auto density = detail::kernel_density(samples, min, max);
+    std::vector<std::pair<long double, long double>> baseline_density;
+    if (baseline_samples) {
+      baseline_density = detail::kernel_density(*baseline_samples, min, max);
+    }
+    long double highest = 0;
+    for (const auto &points : {density, baseline_density}) {
+      for (const auto &point : points) {
+        highest = std::max(highest, point.second);
+      }
+    }
+
+    detail::svg_chart chart(min, max, 0, highest * 1.05L);
+    chart.axes(
+        "mean execution time per run", "density", [](long double v) {
+          return detail::format_duration(v);
+        },
+        [](long double) { return std::string{""}; });
+    chart.line(baseline_density, "baseline");
+    chart.line(density, "current");
+    return chart.str();
+  }
+
+  // Total time against total iterations after each run. The slope of the least-squares line
+  // through the origin is the time per iteration; runs that stray from it stand out
+  static std::string regression_chart(const benchmark_result &result) {
+    std::vector<std::pair<long double, long double>> points;
+    long double iterations = 0, time = 0, xy = 0, xx = 0;
+    const auto step = std::max(result.samples.size() / 500, std::size_t{1});
+    for (std::size_t i = 0; i < result.samples.size(); ++i) {
+      iterations += result.num_iterations;
+      time += result.samples[i] * result.num_iterations;
+      xy += iterations * time;
+      xx += iterations * iterations;
+      if (i % step == 0 || i + 1 == result.samples.size()) {
+        points.push_back({iterations, time});
+      }
+    }
+    const auto slope = xx > 0 ? xy / xx : 0;
+
+    detail::svg_chart chart(0, iterations, 0, std::max(time, slope * iterations));
+    chart.axes(
+        "iterations", "total time",
+        [](long double v) { return detail::format_count(v); },
+        [](long double v) { return detail::format_duration(v); });
+    chart.line({{0, 0}, {iterations, slope * iterations}}, "fit");
+    chart.dots(points, "current");
+    return chart.str();
+  }
+
+  // Benchmarks named like "MergeSort/1K", "MergeSort/2K", ..., grouped by the part before the
+  // last '/' and sorted by size
+  static std::map<std::string, std::vector<std::pair<long double, std::string>>> families() {
+    std::map<std::string, std::vector<std::pair<long double, std::string>>> result;
+    for (const auto &name : benchmark::benchmark_execution_order) {
+      const auto slash = name.rfind('/');
+      if (slash == std::string::npos)
+        continue;
+      if (const auto size = detail::instance_size(name.substr(slash))) {
+        result[name.substr(0, slash)].push_back({size.value(), name});
+      }
+    }
+    for (auto it = result.begin(); it != result.end();) {
+      if (it->second.size() < 2) {
+        it = result.erase(it);
+      } else {
+        std::sort(it->second.begin(), it->second.end());
+        ++it;
+      }
+    }
+    return result;
+  }
+
+  static std::string family_chart(const std::string &family,
+                                  const std::vector<std::pair<long double, std::string>> &members,
+                                  const std::unordered_map<std::string, benchmark_result> &results,
+                                  const baseline *base) {
+    std::vector<std::pair<long double, long double>> current, previous;
+    for (const auto &[size, name] : members) {
+      current.push_back({size, results.at(name).mean_execution_time});
+      if (base) {
+        const auto it = base->entries.find(name);
+        if (it != base->entries.end() && !it->second.samples.empty()) {
+          previous.push_back({size, sample_mean(it->second.samples)});
+        }
+      }
+    }
+
+    long double y_min = current.front().second, y_max = current.front().second;
+    for (const auto &points : {current, previous}) {
+      for (const auto &point : points) {
+        y_min = std::min(y_min, point.second);
+        y_max = std::max(y_max, point.second);
+      }
+    }
+
+    detail::svg_chart chart(current.front().first, current.back().first, y_min * 0.8L,
+                            y_max * 1.25L, true, true);
+    chart.axes(
+        "size", "mean execution time",
+        [](long double v) { return detail::format_count(v); },
+        [](long double v) { return detail::format_duration(v); });
+    chart.line(previous, "baseline");
+    chart.dots(previous, "baseline");
+    chart.line(current, "current");
+    chart.dots(current, "current");
+    return "<figure>" + chart.str() + "<figcaption>" + detail::html_escape(family) + " (" +
+           chart.scale() + ")</figcaption></figure>";
+  }
+
+public:
+  // A single, self-contained HTML page with a summary table and inline SVG charts. If `base` is
+  // given, e.g., from --baseline, its samples are drawn alongside the current ones
+  static bool write_results(const std::string &filename,
+                            const std::unordered_map<std::string, benchmark_result> &results,
+                            const baseline *base = nullptr) {
+    bool result{false};
+    std::ofstream os(filename);
+    if (os.is_open()) {
+      os << "<!DOCTYPE html>\n<html>\n<head>\n<meta charset=\"utf-8\">\n"
+         << "<title>Criterion Benchmark Results</title>\n<style>\n"
+         << "body { font-family: sans-serif; margin: 2em; color: #222; }\n"
+         << "table { border-collapse: collapse; }\n"
+         << "th, td { border: 1px solid #ccc; padding: 4px 8px; text-align: right; }\n"
+         << "th:first-child, td:first-child { text-align: left; }\n"
+         << ".charts { display: flex; flex-wrap: wrap; gap: 1em; }\n"
+         << "svg text { font-size: 11px; fill: #444; }\n"
+         << "svg .axis line { stroke: #888; }\n"
+         << "svg polyline { fill: none; stroke-width: 2; }\n"
+         << "svg .current { stroke: #1f77b4; fill: #1f77b4; }\n"
+         << "svg polyline.current { fill: none; }\n"
+         << "svg .baseline { stroke: #ff7f0e; fill: #ff7f0e; stroke-dasharray: 5 3; }\n"
+         << "svg polyline.baseline { fill: none; }\n"
+         << "svg .fit { stroke: #d62728; stroke-width: 1; }\n"
+         << ".legend span { margin-right: 1em; }\n"
+         << "</style>\n</head>\n<body>\n<h1>Criterion Benchmark Results</h1>\n";
+
+      os << "<p class=\"legend\"><span style=\"color: #1f77b4\">&#9632; current run</span>";
+      if (base) {
+        os << "<span style=\"color: #ff7f0e\">&#9632; baseline \""
+           << detail::html_escape(base->name) << "\"</span>";
+      }
+      os << "</p>\n";
+
+      os << "<table>\n<tr><th>Name</th><th>Warmup Runs</th><th>Runs</th><th>Iterations per "
+            "Run</th><th>Mean</th><th>Fastest</th><th>Slowest</th>";
+      if (base) {
+        os << "<th>Change</th><th>p-value</th>";
+      }
+      os << "</tr>\n";
+      for (const auto &name : benchmark::benchmark_execution_order) {
+        const auto &this_result = results.at(name);
+        os << "<tr><td><a href=\"#" << detail::html_escape(name) << "\">"
+           << detail::html_escape(name) << "</a></td><td>" << this_result.num_warmup_runs
+           << "</td><td>" << this_result.samples.size() << "</td><td>"
+           << this_result.num_iterations << "</td><td>"
+           << detail::format_duration(this_result.mean_execution_time) << "</td><td>"
+           << detail::format_duration(this_result.fastest_execution_time) << "</td><td>"
+           << detail::format_duration(this_result.slowest_execution_time) << "</td>";
+        if (base) {
+          const auto it = base->entries.find(name);
+          if (it != base->entries.end()) {
+            const auto comparison = compare_samples(it->second.samples, this_result.samples);
+            os << std::fixed << std::setprecision(2) << "<td>" << std::showpos
+               << comparison.relative_change * 100 << std::noshowpos << " %</td><td>"
+               << std::setprecision(4) << comparison.p_value << "</td>";
+            os.unsetf(std::ios::fixed);
+          } else {
+            os << "<td></td><td></td>";
+          }
+        }
+        os << "</tr>\n";
+      }
+      os << "</table>\n";
+
+      const auto benchmark_families = families();
+      if (!benchmark_families.empty()) {
+        os << "<h2>Families</h2>\n<div class=\"charts\">\n";
+        for (const auto &[family, members] : benchmark_families) {
+          os << family_chart(family, members, results, base) << "\n";
+        }
+        os << "</div>\n";
+      }
+
+      for (const auto &name : benchmark::benchmark_execution_order) {
+        const auto &this_result = results.at(name);
+        os << "<h2 id=\"" << detail::html_escape(name) << "\">" << detail::html_escape(name)
+           << "</h2>\n<div class=\"charts\">\n";
+        if (this_result.samples.empty()) {
+          os << "</div>\n";
+          continue;
+        }
+        const std::vector<long double> *baseline_samples = nullptr;
+        if (base) {
+          const auto it = base->entries.find(name);
+          if (it != base->entries.end())
+            baseline_samples = &it->second.samples;
+        }
+        os << "<figure>" << distribution_chart(this_result.samples, baseline_samples)
+           << "<figcaption>Distribution of the mean execution time per run ("
+           << this_result.samples.size() << " runs)</figcaption></figure>\n";
+        os << "<figure>" << regression_chart(this_result)
+           << "<figcaption>Total time vs. iterations</figcaption></figure>\n";
+        os << "</div>\n";
+      }
+
+      os << "</body>\n</html>\n";
+      result = true;
+    }
+    os.close();
+    return result;
+  }
+};
+
+} // namespace criterion
+
+
+#pragma once
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// #include <criterion/details/benchmark_config.hpp>
+
+namespace criterion {
+
+// Append-only storage for benchmark names. Names are copied into large chunks, so registering
+// 100k instances costs a handful of allocations, and views into the arena stay valid for as long
+// as the arena lives
+class name_arena {
+  static constexpr std::size_t chunk_size = 64 * 1024;
+  std::vector<std::unique_ptr<char[]>> chunks_;
+  char *current_{nullptr};
+  std::size_t used_{chunk_size};
+
+public:
+  // Stores the concatenation of `first` and `second`
+  std::string_view store(std::string_view first, std::string_view second = {}) {
+    const auto size = first.size() + second.size();
+    if (size == 0)
+      return {};
+    char *destination = nullptr;
+    if (size > chunk_size) {
+      chunks_.push_back(std::make_unique<char[]>(size));
+      destination = chunks_.back().get();
+    } else {
+      if (used_ + size > chunk_size) {
+        chunks_.push_back(std::make_unique<char[]>(chunk_size));
+        current_ = chunks_.back().get();
+        used_ = 0;
+      }
+      destination = current_ + used_;
+      used_ += size;
+    }
+    std::copy(first.begin(), first.end(), destination);
+    std::copy(second.begin(), second.end(), destination + first.size());
+    return {destination, size};
+  }
+};
+
+// A registered benchmark instance. Instances share the config of their template rather than each
+// holding a copy of its std::function and names
+struct benchmark_instance {
+  std::shared_ptr<const benchmark_config> prototype;
+  std::string_view template_name; // name the template was registered under, e.g., "Forward"
+  std::string_view name;          // full name, e.g., "Forward<std::vector<int>>/1K"
+  void *parameters;
+  std::shared_ptr<void> owned_parameters;
+  benchmark_config::ParameterFactory parameter_factory;
+
+  // e.g., "/1K"
+  std::string_view instance_name() const { return name.substr(prototype->name.size()); }
+
+  // The config to run this instance with
+  benchmark_config config() const {
+    auto result = *prototype;
+    result.parameterized_instance_name = std::string(instance_name());
+    result.parameters = parameters;
+    result.owned_parameters = owned_parameters;
+    result.parameter_factory = parameter_factory;
+    return result;
+  }
+};
+
+// One of `count` disjoint parts of a list of benchmarks, e.g., "2/4" for the second of four. The
+// k-th benchmark of the list (from 0) is in shard k % count + 1, which spreads the instances of a
+// template, e.g., over growing input sizes, across the shards. Processes given the same list
+// always pick the same benchmarks
+struct benchmark_shard {
+  std::size_t index; // from 1
+  std::size_t count;
+
+  static std::optional<benchmark_shard> parse(const std::string &value) {
+    const auto separator = value.find('/');
+    if (separator == std::string::npos)
+      return std::nullopt;
+    const auto number = [](const std::string &digits) -> std::optional<std::size_t> {
+      if (digits.empty() || digits.size() > 9)
+        return std::nullopt;
+      for (const auto c : digits) {
+        if (!std::isdigit(static_cast<unsigned char>(c)))
+          return std::nullopt;
+      }
+      return static_cast<std::size_t>(std::stoul(digits));
+    };
+    const auto index = number(value.substr(0, separator));
+    const auto count = number(value.substr(separator + 1));
+    if (!index || !count || index.value() < 1 || index.value() > count.value())
+      return std::nullopt;
+    return benchmark_shard{index.value(), count.value()};
+  }
+
+  template <class T> std::vector<T> select(const std::vector<T> &items) const {
+    std::vector<T> result;
+    for (std::size_t k = index - 1; k < items.size(); k += count) {
+      result.push_back(items[k]);
+    }
+    return result;
+  }
+};
+
+// Benchmark templates, looked up by name in O(1), and their instances in registration order
+class benchmark_registry {
+  name_arena names_;
+  std::unordered_map<std::string, std::vector<std::shared_ptr<const benchmark_config>>>
+      templates_;
+  std::vector<benchmark_instance> instances_;
+  std::unordered_map<std::string, benchmark_options> template_options_;
+  std::unordered_map<std::string, benchmark_options> instance_options_;
+
+public:
+  // The registry used by the BENCHMARK and INVOKE_BENCHMARK macros
+  static benchmark_registry &global() {
+    static benchmark_registry registry;
+    return registry;
+  }
+
+  // Several configs can share a template name, e.g., one per type of a TYPED_BENCHMARK
+  void register_template(const std::string &template_name, benchmark_config config) {
+    templates_[template_name].push_back(
+        std::make_shared<const benchmark_config>(std::move(config)));
+  }
+
+  // Adds an instance of every config registered under `template_name`
+  void instantiate(const std::string &template_name, std::string_view instance_name,
+                   void *parameters, const std::shared_ptr<void> &owned_parameters,
+                   const benchmark_config::ParameterFactory &parameter_factory = nullptr) {
+    const auto it = templates_.find(template_name);
+    if (it == templates_.end())
+      return;
+    for (const auto &prototype : it->second) {
+      instances_.push_back({prototype, it->first, names_.store(prototype->name, instance_name),
+                            parameters, owned_parameters, parameter_factory});
+    }
+  }
+
+  // Adds a standalone instance, e.g., from criterion::register_benchmark
+  void register_instance(const benchmark_config &config) {
+    auto prototype = std::make_shared<const benchmark_config>(config);
+    const auto name = names_.store(config.name, config.parameterized_instance_name);
+    instances_.push_back({prototype, name.substr(0, config.name.size()), name, config.parameters,
+                          config.owned_parameters, config.parameter_factory});
+  }
+
+  // Options for every instance of a template, e.g., from BENCHMARK_OPTIONS
+  void set_template_options(const std::string &template_name, const benchmark_options &options) {
+    auto &current = template_options_[template_name];
+    current = current.merged_with(options);
+  }
+
+  // Options for one instance of a template, e.g., ("MergeSort", "/10M"), overriding the
+  // template's options
+  void set_instance_options(const std::string &template_name, const std::string &instance_name,
+                            const benchmark_options &options) {
+    auto &current = instance_options_[template_name + instance_name];
+    current = current.merged_with(options);
+  }
+
+  // The config to run `instance` with, with template and instance options applied
+  benchmark_config configure(const benchmark_instance &instance) const {
+    auto config = instance.config();
+    const auto template_name = std::string(instance.template_name);
+    config.template_name = template_name;
+    if (const auto it = template_options_.find(template_name); it != template_options_.end()) {
+      config.options = config.options.merged_with(it->second);
+    }
+    const auto key = template_name + std::string(instance.instance_name());
+    if (const auto it = instance_options_.find(key); it != instance_options_.end()) {
+      config.options = config.options.merged_with(it->second);
+    }
+    return config;
+  }
+
+  // Makes room for `count` instances, e.g., before instantiating a generated suite, so adding
+  // them never moves the instances already registered
+  void reserve(std::size_t count) { instances_.reserve(count); }
+
+  const std::vector<benchmark_instance> &instances() const { return instances_; }
+
+  // Instance name -> name its template was registered under, e.g.,
+  // "Forward<std::vector<int>>/1K" -> "Forward"
+  std::unordered_map<std::string, std::string> template_names() const {
+    std::unordered_map<std::string, std::string> result;
+    for (const auto &instance : instances_) {
+      result.emplace(instance.name, instance.template_name);
+    }
+    return result;
+  }
+
+  // Instances whose name matches `regex_string`, in registration order
+  std::vector<const benchmark_instance *> filter(const std::string &regex_string) const {
+    const std::regex regexp(regex_string);
+    std::vector<const benchmark_instance *> result;
+    for (const auto &instance : instances_) {
+      if (std::regex_search(instance.name.begin(), instance.name.end(), regexp)) {
+        result.push_back(&instance);
+      }
+    }
+    return result;
+  }
+};
+
+} // namespace criterion
+
+
+#pragma once
+// #include <criterion/details/baseline.hpp>
+// #include <criterion/details/benchmark.hpp>
+// #include <criterion/details/benchmark_result.hpp>
+// #include <criterion/details/json_string.hpp>
+// #include <criterion/details/registry.hpp>
+// #include <criterion/details/statistics.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+namespace criterion {
+
+namespace detail {
+
+// Just enough of JSON to read Google Benchmark output: a value is null, a boolean, a number, a
+// string, an array or an object
+struct json_value {
+  enum class kind { null, boolean, number, string, array, object };
+  kind type{kind::null};
+  bool boolean{false};
+  long double number{0};
+  std::string string;
+  std::vector<json_value> array;
+  std::vector<std::pair<std::string, json_value>> object; // members, in order
+
+  const json_value *find(const std::string &key) const {
+    for (const auto &[name, member] : object) {
+      if (name == key)
+        return &member;
+    }
+    return nullptr;
+  }
+};
+
+class json_parser {
+  const std::string &text_;
+  std::size_t i_{0};
+
+  void skip_whitespace() {
+    while (i_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[i_])))
+      i_ += 1;
+  }
+
+  bool consume(const std::string &token) {
+    if (text_.compare(i_, token.size(), token) != 0)
+      return false;
+    i_ += token.size();
+    return true;
+  }
+
+  std::optional<std::string> parse_string() {
+    if (i_ >= text_.size() || text_[i_] != '"')
+      return std::nullopt;
+    i_ += 1;
+    std::string result;
+    while (i_ < text_.size() && text_[i_] != '"') {
+      if (text_[i_] == '\\' && i_ + 1 < text_.size()) {
+        i_ += 1;
+        i_ = json_unescape(text_, i_, result);
+      } else {
+        result += text_[i_];
+      }
+      i_ += 1;
+    }
+    if (i_ >= text_.size())
+      return std::nullopt;
+    i_ += 1;
+    return result;
+  }
+
+  std::optional<json_value> parse_value(std::size_t depth) {
+    skip_whitespace();
+    if (i_ >= text_.size() || depth > 64)
+      return std::nullopt;
+    json_value value;
+    const auto c = text_[i_];
+    if (c == '{') {
+      i_ += 1;
+      value.type = json_value::kind::object;
+      skip_whitespace();
+      if (consume("}"))
+        return value;
+      while (true) {
+        skip_whitespace();
+        const auto key = parse_string();
+        skip_whitespace();
+        if (!key || !consume(":"))
+          return std::nullopt;
+        auto member = parse_value(depth + 1);
+        if (!member)
+          return std::nullopt;
+        value.object.push_back({key.value(), std::move(member.value())});
+        skip_whitespace();
+        if (consume("}"))
+          return value;
+        if (!consume(","))
+          return std::nullopt;
+      }
+    } else if (c == '[') {
+      i_ += 1;
+      value.type = json_value::kind::array;
+      skip_whitespace();
+      if (consume("]"))
+        return value;
+      while (true) {
+        auto element = parse_value(depth + 1);
+        if (!element)
+          return std::nullopt;
+        value.array.push_back(std::move(element.value()));
+        skip_whitespace();
+        if (consume("]"))
+          return value;
+        if (!consume(","))
+          return std::nullopt;
+      }
+    } else if (c == '"') {
+      const auto string = parse_string();
+      if (!string)
+        return std::nullopt;
+      value.type = json_value::kind::string;
+      value.string = string.value();
+      return value;
+    } else if (consume("true")) {
+      value.type = json_value::kind::boolean;
+      value.boolean = true;
+      return value;
+    } else if (consume("false")) {
+      value.type = json_value::kind::boolean;
+      return value;
+    } else if (consume("null")) {
+      return value;
+    }
+
+    const char *begin = text_.c_str() + i_;
+    char *end = nullptr;
+    value.number = std::strtold(begin, &end);
+    if (end == begin)
+      return std::nullopt;
+    i_ += end - begin;
+    value.type = json_value::kind::number;
+    return value;
+  }
+
+public:
+  explicit json_parser(const std::string &text) : text_(text) {}
+
+  std::optional<json_value> parse() {
+    auto value = parse_value(0);
+    skip_whitespace();
+    if (!value || i_ != text_.size())
+      return std::nullopt;
+    return value;
+  }
+};
+
+} // namespace detail
+
+// Results in the JSON schema of Google Benchmark, so that its tools (e.g., compare.py) work on
+// criterion results. Runs are reported as repetitions, with the mean execution time per
+// iteration as their time, followed by the mean, median, stddev and cv aggregates over the
+// repetitions. Criterion measures wall-clock time only, so cpu_time is the same as real_time
+class gbench_json {
+  static std::string host_name() {
+#if defined(__unix__) || defined(__APPLE__)
+    char name[256]{};
+    if (gethostname(name, sizeof(name) - 1) == 0)
+      return name;
+#endif
+    return "";
+  }
+
+  // Clock speed of the first CPU in MHz, if known
+  static std::optional<long double> mhz_per_cpu() {
+#if defined(__linux__)
+    std::ifstream is("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(is, line)) {
+      if (line.rfind("cpu MHz", 0) == 0) {
+        const auto colon = line.find(':');
+        if (colon == std::string::npos)
+          break;
+        char *end = nullptr;
+        const auto value = std::strtold(line.c_str() + colon + 1, &end);
+        if (end != line.c_str() + colon + 1 && value > 0)
+          return value;
+        break;
+      }
+    }
+    // e.g., on ARM, where /proc/cpuinfo has no clock speed
+    std::ifstream max_frequency("/sys/devices/system/cpu/cpu0/cpufreq/cpuinfo_max_freq");
+    long double khz = 0;
+    if (max_frequency >> khz && khz > 0)
+      return khz / 1000;
+#endif
+    return std::nullopt;
+  }
+
+  // true if the frequency governor of any CPU is not "performance", i.e., clock speeds can change
+  // during the run. std::nullopt if no governor can be read, e.g., in most VMs
+  static std::optional<bool> cpu_scaling_enabled() {
+#if defined(__linux__)
+    std::optional<bool> result;
+    for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu) {
+      std::ifstream is("/sys/devices/system/cpu/cpu" + std::to_string(cpu) +
+                       "/cpufreq/scaling_governor");
+      std::string governor;
+      if (!(is >> governor))
+        continue;
+      result = result.value_or(false) || governor != "performance";
+    }
+    return result;
+#else
+    return std::nullopt;
+#endif
+  }
+
+  // Nanoseconds per unit of Google Benchmark's time_unit
+  static std::optional<long double> time_unit_scale(const std::string &unit) {
+    if (unit == "ns")
+      return 1;
+    if (unit == "us")
+      return 1e3;
+    if (unit == "ms")
+      return 1e6;
+    if (unit == "s")
+      return 1e9;
+    return std::nullopt;
+  }
+
+public:
+  static inline std::string executable; // reported in the context, e.g., argv[0]
+  static inline std::size_t max_repetitions = 100;
+
+  static bool write_results(const std::string &filename,
+                            const std::unordered_map<std::string, benchmark_result> &results) {
+    std::ofstream os(filename);
+    if (!os.is_open())
+      return false;
+
+    // only fields criterion can measure are written, e.g., no caches or library_build_type
+    const std::time_t t = std::time(nullptr);
+    os << "{\n  \"context\": {\n"
+       << "    \"date\": \"" << std::put_time(std::localtime(&t), "%Y-%m-%dT%H:%M:%S%z") << "\",\n"
+       << "    \"host_name\": \"" << detail::json_escape(host_name()) << "\",\n"
+       << "    \"executable\": \"" << detail::json_escape(executable) << "\",\n"
+       << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+    if (const auto mhz = mhz_per_cpu()) {
+      os << "    \"mhz_per_cpu\": " << static_cast<long long>(std::llround(mhz.value())) << ",\n";
+    }
+    if (const auto scaling = cpu_scaling_enabled()) {
+      os << "    \"cpu_scaling_enabled\": " << (scaling.value() ? "true" : "false") << ",\n";
+    }
+#if defined(__unix__) || defined(__APPLE__)
+    double load_average[3]{};
+    if (getloadavg(load_average, 3) == 3) {
+      os << "    \"load_avg\": [" << load_average[0] << "," << load_average[1] << ","
+         << load_average[2] << "],\n";
+    }
+#endif
+    os << "    \"json_schema_version\": 1\n"
+       << "  },\n  \"benchmarks\": [";
+
+    // family (the name the template was registered under, or the name up to the first '/' if
+    // it is not registered, e.g., for merged results) and instance indices, in execution order
+    const auto template_names = benchmark_registry::global().template_names();
+    std::unordered_map<std::string, std::size_t> families;
+    std::vector<std::size_t> family_sizes;
+
+    os << std::setprecision(std::numeric_limits<long double>::max_digits10);
+    bool first{true};
+    const auto entry = [&](const std::string &name, const std::string &run_name,
+                           std::size_t family_index, std::size_t instance_index,
+                           std::size_t repetitions, std::size_t repetition,
+                           const std::string &aggregate, std::size_t iterations, long double time) {
+      os << (first ? "\n" : ",\n");
+      first = false;
+      os << "    {\n"
+         << "      \"name\": \"" << detail::json_escape(name) << "\",\n"
+         << "      \"family_index\": " << family_index << ",\n"
+         << "      \"per_family_instance_index\": " << instance_index << ",\n"
+         << "      \"run_name\": \"" << detail::json_escape(run_name) << "\",\n"
+         << "      \"run_type\": \"" << (aggregate.empty() ? "iteration" : "aggregate") << "\",\n"
+         << "      \"repetitions\": " << repetitions << ",\n";
+      if (aggregate.empty()) {
+        os << "      \"repetition_index\": " << repetition << ",\n";
+      } else {
+        os << "      \"aggregate_name\": \"" << aggregate << "\",\n"
+           << "      \"aggregate_unit\": \"" << (aggregate == "cv" ? "percentage" : "time")
+           << "\",\n";
+      }
+      os << "      \"threads\": 1,\n"
+         << "      \"iterations\": " << iterations << ",\n"
+         << "      \"real_time\": " << time << ",\n"
+         << "      \"cpu_time\": " << time << ",\n"
+         << "      \"time_unit\": \"ns\"\n"
+         << "    }";
+    };
+
+    for (const auto &name : benchmark::benchmark_execution_order) {
+      const auto &result = results.at(name);
+      const auto template_name = template_names.find(name);
+      const auto family = template_name == template_names.end() ? name.substr(0, name.find('/'))
+                                                                : template_name->second;
+      if (families.find(family) == families.end()) {
+        families[family] = family_sizes.size();
+        family_sizes.push_back(0);
+      }
+      const auto family_index = families[family];
+      const auto instance_index = family_sizes[family_index]++;
+
+      // fast benchmarks can have 100,000s of runs, so consecutive runs are grouped into at most
+      // max_repetitions repetitions
+      const auto &samples = result.samples;
+      const auto runs_per_repetition = (samples.size() + max_repetitions - 1) / max_repetitions;
+      std::vector<long double> times;
+      std::vector<std::size_t> iterations;
+      for (std::size_t begin = 0; begin < samples.size(); begin += runs_per_repetition) {
+        const auto end = std::min(begin + runs_per_repetition, samples.size());
+        times.push_back(std::accumulate(samples.begin() + begin, samples.begin() + end, 0.0L) /
+                        (end - begin));
+        iterations.push_back((end - begin) * result.num_iterations);
+      }
+
+      for (std::size_t i = 0; i < times.size(); ++i) {
+        entry(name, name, family_index, instance_index, times.size(), i, "", iterations[i],
+              times[i]);
+      }
+      if (times.size() > 1) {
+        const auto mean = sample_mean(times);
+        const auto stddev = std::sqrt(sample_variance(times));
+        const auto aggregate = [&](const std::string &aggregate_name, long double value) {
+          entry(name + "_" + aggregate_name, name, family_index, instance_index, times.size(), 0,
+                aggregate_name, iterations.front(), value);
+        };
+        aggregate("mean", mean);
+        aggregate("median", sample_median(times));
+        aggregate("stddev", stddev);
+        aggregate("cv", mean > 0 ? stddev / mean : 0);
+      }
+    }
+    os << "\n  ]\n}\n";
+    return os.good();
+  }
+
+  // Reads Google Benchmark JSON output as a baseline. The times of the repetitions of each
+  // benchmark become its samples; if only aggregates were reported, the mean is the only sample
+  static std::optional<baseline> read_baseline(const std::string &filename,
+                                               const std::string &baseline_name) {
+    std::ifstream is(filename);
+    if (!is.is_open())
+      return std::nullopt;
+    std::stringstream buffer;
+    buffer << is.rdbuf();
+    const auto text = buffer.str();
+    const auto document = detail::json_parser(text).parse();
+    if (!document)
+      return std::nullopt;
+    const auto benchmarks = document->find("benchmarks");
+    if (!benchmarks || benchmarks->type != detail::json_value::kind::array)
+      return std::nullopt;
+
+    baseline result;
+    result.name = baseline_name;
+    // means of benchmarks that only reported aggregates
+    std::unordered_map<std::string, baseline::entry> means;
+    std::vector<std::string> means_order;
+    for (const auto &b : benchmarks->array) {
+      const auto name = b.find("name");
+      const auto run_name = b.find("run_name");
+      const auto run_type = b.find("run_type");
+      const auto aggregate = b.find("aggregate_name");
+      const auto iterations = b.find("iterations");
+      const auto real_time = b.find("real_time");
+      const auto time_unit = b.find("time_unit");
+      if (!name || !iterations || !real_time)
+        continue;
+      const auto scale = time_unit_scale(time_unit ? time_unit->string : "ns");
+      if (!scale)
+        continue;
+      const auto time = real_time->number * scale.value();
+      const auto benchmark_name = run_name ? run_name->string : name->string;
+
+      if (run_type && run_type->string == "aggregate") {
+        if (aggregate && aggregate->string == "mean") {
+          if (means.find(benchmark_name) == means.end())
+            means_order.push_back(benchmark_name);
+          means[benchmark_name] =
+              baseline::entry{static_cast<std::size_t>(iterations->number), {time}};
+        }
+        continue;
+      }
+      auto it = result.entries.find(benchmark_name);
+      if (it == result.entries.end()) {
+        result.add(benchmark_name,
+                   baseline::entry{static_cast<std::size_t>(iterations->number), {}});
+        it = result.entries.find(benchmark_name);
+      }
+      it->second.samples.push_back(time);
+    }
+    for (const auto &benchmark_name : means_order) {
+      if (result.entries.find(benchmark_name) == result.entries.end()) {
+        result.add(benchmark_name, means[benchmark_name]);
+      }
+    }
+    return result;
+  }
+};
+
+} // namespace criterion
+
+
+#pragma once
+// #include <criterion/details/analysis.hpp>
+// #include <criterion/details/benchmark_result.hpp>
+// #include <criterion/details/gbench_json.hpp>
+// #include <criterion/details/statistics.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace criterion {
+
+// Combines the results of several runs of a suite, e.g., of its shards (see --shard) on different
+// machines, into one set of results. Every input is one of:
+//
+//   a file from --export_samples  every measured iteration, from which results are recomputed
+//   a saved baseline              the mean of each run, from which results are recomputed
+//   a JSON or JSON Lines export   results as they were reported, without their samples
+//
+// A benchmark found in more than one input is taken from the last of them
+class result_merge {
+  // A result from a JSON or JSON Lines export. Exports only summarize the runs, so the mean is
+  // the only sample
+  static std::optional<benchmark_result> from_json(const detail::json_value &object) {
+    using kind = detail::json_value::kind;
+    const auto name = object.find("name");
+    if (!name || name->type != kind::string)
+      return std::nullopt;
+    const auto number = [&object](const std::string &key) -> long double {
+      const auto value = object.find(key);
+      return value && value->type == kind::number ? value->number : 0;
+    };
+
+    benchmark_result result{};
+    result.name = name->string;
+    result.num_warmup_runs = static_cast<std::size_t>(number("warmup_runs"));
+    result.mean_execution_time = number("mean_execution_time");
+    result.fastest_execution_time = number("fastest_execution_time");
+    result.slowest_execution_time = number("slowest_execution_time");
+    result.lowest_rsd_mean = number("lowest_rsd_execution_time");
+    result.lowest_rsd = number("lowest_rsd_percentage");
+    result.lowest_rsd_index = static_cast<std::size_t>(number("lowest_rsd_index"));
+    result.average_iteration_performance = number("average_iteration_performance");
+    result.fastest_iteration_performance = number("fastest_iteration_performance");
+    result.slowest_iteration_performance = number("slowest_iteration_performance");
+    result.samples.push_back(result.mean_execution_time);
+    result.num_runs = std::max(static_cast<std::size_t>(number("runs")), std::size_t{1});
+    result.num_iterations = static_cast<std::size_t>(number("iterations")) / result.num_runs;
+    if (const auto allocations = object.find("allocations_per_iteration");
+        allocations && allocations->type == kind::number) {
+      result.allocations_per_iteration = allocations->number;
+    }
+    if (const auto interference = object.find("interference");
+        interference && interference->type == kind::string) {
+      result.interference = interference->string;
+    }
+    return result;
+  }
+
+  // Results from a JSON export ({"benchmarks": [...]}) or a JSON Lines export (an object per line)
+  static std::optional<std::vector<benchmark_result>> read_json(const std::string &text) {
+    std::vector<detail::json_value> objects;
+    // a JSON Lines export with a single benchmark is also one JSON document, but without
+    // "benchmarks"
+    const auto document = detail::json_parser(text).parse();
+    const auto benchmarks = document.has_value() ? document->find("benchmarks") : nullptr;
+    if (benchmarks) {
+      if (benchmarks->type != detail::json_value::kind::array)
+        return std::nullopt;
+      objects = benchmarks->array;
+    } else {
+      std::istringstream lines(text);
+      std::string line;
+      while (std::getline(lines, line)) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+          continue;
+        auto object = detail::json_parser(line).parse();
+        if (!object.has_value() || object->type != detail::json_value::kind::object)
+          return std::nullopt;
+        objects.push_back(std::move(object.value()));
+      }
+    }
+
+    std::vector<benchmark_result> results;
+    for (const auto &object : objects) {
+      auto result = from_json(object);
+      if (!result.has_value())
+        return std::nullopt;
+      results.push_back(std::move(result.value()));
+    }
+    return results;
+  }
+
+  std::unordered_map<std::string, std::size_t> index_; // name -> position in benchmarks
+
+public:
+  struct entry {
+    benchmark_result result;
+    // set if the result was recomputed from samples, not read from a JSON or JSON Lines export
+    std::optional<sample_estimate> estimate;
+    std::string source; // the input it was taken from
+  };
+
+  std::vector<entry> benchmarks;
+
+  // (benchmark, input) for every benchmark that an input replaced, e.g., because two shards ran it
+  std::vector<std::pair<std::string, std::string>> duplicates;
+
+  // Adds the results in `filename`. Samples are analyzed with `options`, like --analyze does
+  bool add(const std::string &filename, const analysis_options &options) {
+    std::optional<std::vector<benchmark_result>> exported;
+    if (!analysis::is_sample_file(filename)) {
+      std::ifstream is(filename);
+      if (!is.is_open())
+        return false;
+      std::stringstream buffer;
+      buffer << is.rdbuf();
+      exported = read_json(buffer.str());
+    }
+
+    std::vector<entry> added;
+    if (exported.has_value()) {
+      for (const auto &result : exported.value()) {
+        added.push_back({result, std::nullopt, filename});
+      }
+    } else {
+      const auto stored = analysis::load(filename, options);
+      if (!stored.has_value())
+        return false;
+      for (const auto &[result, estimate] : stored->benchmarks) {
+        added.push_back({result, estimate, filename});
+      }
+    }
+
+    for (auto &e : added) {
+      const auto [it, inserted] = index_.insert({e.result.name, benchmarks.size()});
+      if (inserted) {
+        benchmarks.push_back(std::move(e));
+      } else {
+        duplicates.push_back({e.result.name, filename});
+        benchmarks[it->second] = std::move(e);
+      }
+    }
+    return true;
+  }
+
+  // Orders the benchmarks like `order`, e.g., the registration order of this binary, so shards
+  // merge into the order an unsharded run would have. Benchmarks not in `order` come last, in the
+  // order of the inputs
+  void sort(const std::vector<std::string> &order) {
+    std::unordered_map<std::string, std::size_t> position;
+    for (std::size_t i = 0; i < order.size(); ++i) {
+      position.insert({order[i], i});
+    }
+    const auto rank = [&position, &order](const entry &e) {
+      const auto it = position.find(e.result.name);
+      return it == position.end() ? order.size() : it->second;
+    };
+    std::stable_sort(benchmarks.begin(), benchmarks.end(),
+                     [&rank](const entry &a, const entry &b) { return rank(a) < rank(b); });
+    for (std::size_t i = 0; i < benchmarks.size(); ++i) {
+      index_[benchmarks[i].result.name] = i;
+    }
+  }
+};
+
+} // namespace criterion
+
+
+#pragma once
+// #include <criterion/details/benchmark.hpp>
+// #include <criterion/details/benchmark_result.hpp>
+// #include <criterion/details/html_writer.hpp>
+// #include <criterion/details/thresholds.hpp>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace criterion {
+
+// JUnit XML for CI systems. Every benchmark is a test case, grouped into one test suite per
+// benchmark family (the part of the name before '/'), that fails if any of its threshold
+// checks failed (see thresholds)
+class junit_writer {
+  static std::string family(const std::string &name) { return name.substr(0, name.find('/')); }
+
+public:
+  static bool write_results(const std::string &filename,
+                            const std::unordered_map<std::string, benchmark_result> &results,
+                            const std::vector<threshold_check> &checks) {
+    std::ofstream os(filename);
+    if (!os.is_open())
+      return false;
+
+    std::unordered_map<std::string, std::vector<const threshold_check *>> checks_of;
+    for (const auto &check : checks) {
+      checks_of[check.benchmark].push_back(&check);
+    }
+
+    // suites in the order their first benchmark ran
+    std::vector<std::string> suites;
+    std::map<std::string, std::vector<std::string>> cases;
+    for (const auto &name : benchmark::benchmark_execution_order) {
+      if (results.find(name) == results.end())
+        continue;
+      auto &suite = cases[family(name)];
+      if (suite.empty())
+        suites.push_back(family(name));
+      suite.push_back(name);
+    }
+
+    const auto failed = [&](const std::string &name) {
+      const auto it = checks_of.find(name);
+      if (it == checks_of.end())
+        return false;
+      for (const auto check : it->second) {
+        if (!check->passed)
+          return true;
+      }
+      return false;
+    };
+
+    // total time spent in measured iterations, in seconds
+    const auto seconds = [&](const std::string &name) {
+      const auto &result = results.at(name);
+      return result.mean_execution_time * result.num_runs * result.num_iterations / 1E9;
+    };
+
+    std::size_t total_failures = 0;
+    long double total_time = 0;
+    for (const auto &[name, result] : results) {
+      total_failures += failed(name) ? 1 : 0;
+      total_time += seconds(name);
+    }
+
+    os << std::fixed << std::setprecision(6);
+    os << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+    os << "<testsuites name=\"criterion\" tests=\"" << results.size() << "\" failures=\""
+       << total_failures << "\" time=\"" << total_time << "\">\n";
+    for (const auto &suite : suites) {
+      std::size_t suite_failures = 0;
+      long double suite_time = 0;
+      for (const auto &name : cases.at(suite)) {
+        suite_failures += failed(name) ? 1 : 0;
+        suite_time += seconds(name);
+      }
+      os << "  <testsuite name=\"" << detail::html_escape(suite) << "\" tests=\""
+         << cases.at(suite).size() << "\" failures=\"" << suite_failures << "\" time=\""
+         << suite_time << "\">\n";
+      for (const auto &name : cases.at(suite)) {
+        const auto &result = results.at(name);
+        os << "    <testcase name=\"" << detail::html_escape(name) << "\" classname=\""
+           << detail::html_escape(suite) << "\" time=\"" << seconds(name) << "\">\n";
+
+        const auto it = checks_of.find(name);
+        std::vector<const threshold_check *> failures;
+        if (it != checks_of.end()) {
+          for (const auto check : it->second) {
+            if (!check->passed)
+              failures.push_back(check);
+          }
+        }
+        if (!failures.empty()) {
+          os << "      <failure message=\"" << detail::html_escape(failures.front()->message())
+             << "\" type=\"" << to_string(failures.front()->metric) << "\">";
+          for (const auto check : failures) {
+            os << detail::html_escape(check->message()) << "\n";
+          }
+          os << "</failure>\n";
+        }
+
+        std::stringstream out;
+        out << std::fixed << std::setprecision(2) << "mean_execution_time: "
+            << result.mean_execution_time << " ns\n"
+            << "iterations: " << result.num_runs * result.num_iterations << "\n";
+        if (result.allocations_per_iteration.has_value()) {
+          out << "allocations_per_iteration: " << result.allocations_per_iteration.value() << "\n";
+        }
+        if (it != checks_of.end()) {
+          for (const auto check : it->second) {
+            out << check->message() << "\n";
+          }
+        }
+        os << "      <system-out>" << detail::html_escape(out.str()) << "</system-out>\n";
+        os << "    </testcase>\n";
+      }
+      os << "  </testsuite>\n";
+    }
+    os << "</testsuites>\n";
+    return os.good();
+  }
+};
+
+} // namespace criterion
+
+
+#pragma once
+// #include <criterion/details/benchmark.hpp>
+// #include <criterion/details/benchmark_result.hpp>
+// #include <criterion/details/statistics.hpp>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#include <sys/types.h>
+#endif
+
+namespace criterion {
+
+// Results as OpenMetrics gauges, e.g., for the textfile collector of node_exporter:
+//
+//   criterion_mean_seconds{benchmark="MergeSort/1K",family="MergeSort",parameters="1K",
+//                          cpu="AMD EPYC 7B13",revision="a1b2c3d"} 1.912e-05
+//
+// Times are in seconds, the base unit of OpenMetrics
+class openmetrics_writer {
+  // Label values escape backslashes, quotes and line feeds only, as OpenMetrics requires
+  static std::string escape_label(const std::string &value) {
+    std::string result;
+    for (const auto c : value) {
+      if (c == '"' || c == '\\') {
+        result += '\\';
+        result += c;
+      } else if (c == '\n') {
+        result += "\\n";
+      } else {
+        result += c;
+      }
+    }
+    return result;
+  }
+
+  // (extra labels, e.g., ",quantile=\"0.9\"", value) of one metric for one benchmark
+  using values = std::vector<std::pair<std::string, long double>>;
+
+public:
+  static inline std::string revision{"unknown"}; // label of every sample, e.g., from --revision
+
+  // e.g., "AMD EPYC 7B13", or "unknown"
+  static std::string cpu_model() {
+#if defined(__linux__)
+    std::ifstream is("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(is, line)) {
+      if (line.rfind("model name", 0) == 0) {
+        const auto colon = line.find(':');
+        if (colon != std::string::npos && colon + 2 <= line.size())
+          return line.substr(colon + 2);
+      }
+    }
+#elif defined(__APPLE__)
+    char brand[256]{};
+    std::size_t size = sizeof(brand) - 1;
+    if (sysctlbyname("machdep.cpu.brand_string", brand, &size, nullptr, 0) == 0)
+      return brand;
+#endif
+    return "unknown";
+  }
+
+  static bool write_results(const std::string &filename,
+                            const std::unordered_map<std::string, benchmark_result> &results) {
+    std::ofstream os(filename);
+    if (!os.is_open())
+      return false;
+
+    const auto cpu = cpu_model();
+    const auto labels = [&](const std::string &name) {
+      const auto separator = name.find('/');
+      return "benchmark=\"" + escape_label(name) + "\",family=\"" +
+             escape_label(name.substr(0, separator)) + "\",parameters=\"" +
+             escape_label(separator == std::string::npos ? "" : name.substr(separator + 1)) +
+             "\",cpu=\"" + escape_label(cpu) + "\",revision=\"" + escape_label(revision) + "\"";
+    };
+
+    // one metric family at a time, with a sample per benchmark that has a value for it
+    os << std::setprecision(10);
+    const auto gauge =
+        [&](const std::string &metric, const std::string &unit, const std::string &help,
+            const std::function<values(const benchmark_result &)> &values_of) {
+          os << "# TYPE " << metric << " gauge\n";
+          if (!unit.empty())
+            os << "# UNIT " << metric << " " << unit << "\n";
+          os << "# HELP " << metric << " " << help << "\n";
+          for (const auto &name : benchmark::benchmark_execution_order) {
+            const auto it = results.find(name);
+            if (it == results.end())
+              continue;
+            for (const auto &[extra_labels, value] : values_of(it->second)) {
+              os << metric << "{" << labels(name) << extra_labels << "} " << value << "\n";
+            }
+          }
+        };
+    const auto seconds = [](long double ns) { return ns / 1E9; };
+    // a metric with one unlabeled value per benchmark
+    const auto single = [](std::function<long double(const benchmark_result &)> value_of) {
+      return [value_of](const benchmark_result &r) { return values{{"", value_of(r)}}; };
+    };
+
+    gauge("criterion_mean_seconds", "seconds", "Mean execution time per iteration",
+          single([&](const benchmark_result &r) { return seconds(r.mean_execution_time); }));
+    gauge("criterion_median_seconds", "seconds", "Median of the mean execution time of each run",
+          single([&](const benchmark_result &r) {
+            return seconds(r.samples.empty() ? r.mean_execution_time : sample_median(r.samples));
+          }));
+    gauge("criterion_quantile_seconds", "seconds",
+          "Quantiles of the mean execution time of each run", [&](const benchmark_result &r) {
+            values result;
+            for (const auto q : {"0.5", "0.9", "0.99"}) {
+              if (!r.samples.empty()) {
+                result.push_back({",quantile=\"" + std::string(q) + "\"",
+                                  seconds(sample_quantile(r.samples, std::stold(q)))});
+              }
+            }
+            return result;
+          });
+    gauge("criterion_fastest_seconds", "seconds", "Fastest execution time of an iteration",
+          single([&](const benchmark_result &r) { return seconds(r.fastest_execution_time); }));
+    gauge("criterion_slowest_seconds", "seconds", "Slowest execution time of an iteration",
+          single([&](const benchmark_result &r) { return seconds(r.slowest_execution_time); }));
+    gauge("criterion_throughput_iterations_per_second", "",
+          "Iterations per second in the average case",
+          single([](const benchmark_result &r) { return r.average_iteration_performance; }));
+    gauge("criterion_lowest_rsd_percent", "", "Lowest relative standard deviation of a run",
+          single([](const benchmark_result &r) { return r.lowest_rsd; }));
+    gauge("criterion_runs", "", "Number of benchmark runs",
+          single([](const benchmark_result &r) { return r.num_runs; }));
+    gauge("criterion_iterations", "", "Number of measured iterations",
+          single([](const benchmark_result &r) { return r.num_runs * r.num_iterations; }));
+    gauge("criterion_allocations_per_iteration", "", "Heap allocations per iteration, if counted",
+          [](const benchmark_result &r) {
+            values result;
+            if (r.allocations_per_iteration.has_value())
+              result.push_back({"", r.allocations_per_iteration.value()});
+            return result;
+          });
+
+    os << "# EOF\n";
+    return os.good();
+  }
+};
+
+} // namespace criterion
+
+
+#pragma once
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace criterion {
+
+// Instance name for a generated parameter value, e.g., "/8", "/1000", "/1K" (1024) or "/16M".
+// Binary suffixes are only used for exact multiples, so every value gets a distinct name
+inline std::string range_instance_name(long long value) {
+  static const char *suffixes[] = {"", "K", "M", "G", "T"};
+  std::size_t suffix = 0;
+  auto magnitude = value;
+  while (magnitude != 0 && magnitude % 1024 == 0 && suffix + 1 < std::size(suffixes)) {
+    magnitude /= 1024;
+    suffix += 1;
+  }
+  return "/" + std::to_string(magnitude) + suffixes[suffix];
+}
+
+// first, first * multiplier, first * multiplier^2, ... up to and including last
+inline std::vector<long long> geometric_range(long long first, long long last,
+                                              long long multiplier) {
+  if (first <= 0 || last < first || multiplier < 2) {
+    throw std::invalid_argument("criterion: geometric range requires 0 < first <= last and a "
+                                "multiplier of at least 2");
+  }
+
+  std::vector<long long> result;
+  for (auto value = first; value < last; value *= multiplier) {
+    result.push_back(value);
+    if (value > last / multiplier)
+      break;
+  }
+  if (result.empty() || result.back() != last) {
+    result.push_back(last);
+  }
+  return result;
+}
+
+// first, first + step, first + 2 * step, ... up to and including last
+inline std::vector<long long> linear_range(long long first, long long last, long long step) {
+  if (last < first || step < 1) {
+    throw std::invalid_argument("criterion: linear range requires first <= last and a step of at "
+                                "least 1");
+  }
+
+  std::vector<long long> result;
+  for (auto value = first; value < last; value += step) {
+    result.push_back(value);
+    if (value > last - step)
+      break;
+  }
+  if (result.empty() || result.back() != last) {
+    result.push_back(last);
+  }
+  return result;
+}
+
+} // namespace criterion
+
+
+#pragma once
+#include <array>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// #include <criterion/details/range.hpp>
+
+namespace criterion {
+
+// A parameter value with the label used for it in instance names
+template <class T> struct named_value {
+  std::string label;
+  T value;
+};
+
+template <class T> named_value<std::decay_t<T>> named(const std::string &label, T &&value) {
+  return {label, std::forward<T>(value)};
+}
+
+// One dimension of a parameter grid, e.g., "size" with values 10, 100 and 1000
+template <class T> struct grid_axis {
+  std::string name;
+  std::vector<named_value<T>> values;
+};
+
+// Keeps only the grid points for which `predicate(arguments...)` returns true
+template <class Predicate> struct grid_filter { Predicate predicate; };
+
+template <class Predicate> grid_filter<std::decay_t<Predicate>> where(Predicate &&predicate) {
+  return {std::forward<Predicate>(predicate)};
+}
+
+// Keeps only the grid points whose instance name matches `regex_string`
+struct grid_name_filter {
+  std::regex regexp;
+
+  bool operator()(const std::string &instance_name) const {
+    std::smatch matches;
+    return std::regex_search(instance_name, matches, regexp);
+  }
+};
+
+inline grid_name_filter matching(const std::string &regex_string) {
+  return {std::regex(regex_string)};
+}
+
+namespace detail {
+
+template <class> inline constexpr bool always_false = false;
+
+template <class T> std::string grid_label(const T &value) {
+  if constexpr (std::is_integral_v<T>) {
+    return range_instance_name(static_cast<long long>(value)).substr(1);
+  } else if constexpr (std::is_arithmetic_v<T>) {
+    std::stringstream os;
+    os << value;
+    return os.str();
+  } else if constexpr (std::is_convertible_v<const T &, std::string>) {
+    return std::string(value);
+  } else {
+    static_assert(always_false<T>, "use criterion::named(label, value) for this axis value");
+  }
+}
+
+template <class T> struct axis_value_type { using type = T; };
+template <class T> struct axis_value_type<named_value<T>> { using type = T; };
+
+template <class T, class U> named_value<T> to_named_value(U &&value) {
+  if constexpr (std::is_same_v<std::decay_t<U>, named_value<T>>) {
+    return std::forward<U>(value);
+  } else {
+    return {grid_label(value), std::forward<U>(value)};
+  }
+}
+
+template <class T> struct is_vector : std::false_type {};
+template <class T, class A> struct is_vector<std::vector<T, A>> : std::true_type {};
+
+template <class T> struct is_grid_filter : std::false_type {};
+template <class P> struct is_grid_filter<grid_filter<P>> : std::true_type {};
+
+} // namespace detail
+
+template <class T> grid_axis<T> axis(const std::string &name, const std::vector<T> &values) {
+  grid_axis<T> result{name, {}};
+  for (const auto &value : values) {
+    result.values.push_back(detail::to_named_value<T>(value));
+  }
+  return result;
+}
+
+template <class First, class... Rest,
+          class = std::enable_if_t<!detail::is_vector<std::decay_t<First>>::value>>
+auto axis(const std::string &name, First &&first, Rest &&...rest) {
+  using T = typename detail::axis_value_type<std::decay_t<First>>::type;
+  grid_axis<T> result{name, {}};
+  result.values.push_back(detail::to_named_value<T>(std::forward<First>(first)));
+  (result.values.push_back(detail::to_named_value<T>(std::forward<Rest>(rest))), ...);
+  return result;
+}
+
+// Calls `fn(instance_name, arguments)` for every point in the Cartesian product of `axes`, in
+// row-major order, with names like "/fn:int/size:1K". Points rejected by `filter` are skipped
+template <class ArgTuple, class AxisTuple, class Filter, class Fn, std::size_t... I>
+void for_each_grid_point(const AxisTuple &axes, const Filter &filter, Fn &&fn,
+                         std::index_sequence<I...>) {
+  constexpr auto N = sizeof...(I);
+  static_assert(N > 0, "a grid needs at least one axis");
+  const std::array<std::size_t, N> sizes{std::get<I>(axes).values.size()...};
+  for (const auto size : sizes) {
+    if (size == 0)
+      return;
+  }
+
+  std::array<std::size_t, N> index{};
+  while (true) {
+    std::string instance_name{""};
+    ((instance_name += "/" +
+                       (std::get<I>(axes).name.empty() ? "" : std::get<I>(axes).name + ":") +
+                       std::get<I>(axes).values[index[I]].label),
+     ...);
+
+    ArgTuple arguments{static_cast<std::tuple_element_t<I, ArgTuple>>(
+        std::get<I>(axes).values[index[I]].value)...};
+
+    bool keep = true;
+    if constexpr (std::is_same_v<Filter, grid_name_filter>) {
+      keep = filter(instance_name);
+    } else if constexpr (detail::is_grid_filter<Filter>::value) {
+      keep = std::apply(filter.predicate, std::as_const(arguments));
+    }
+    if (keep) {
+      fn(instance_name, std::move(arguments));
+    }
+
+    // odometer increment, last axis fastest
+    std::size_t axis = N;
+    while (axis > 0) {
+      axis -= 1;
+      if (++index[axis] < sizes[axis])
+        break;
+      index[axis] = 0;
+      if (axis == 0)
+        return;
+    }
+  }
+}
+
+} // namespace criterion
+
+
+#pragma once
+#include <algorithm>
+#include <chrono>
+// #include <criterion/details/benchmark.hpp>
+// #include <criterion/details/benchmark_config.hpp>
+// #include <criterion/details/csv_writer.hpp>
+// #include <criterion/details/grid.hpp>
+// #include <criterion/details/range.hpp>
+// #include <criterion/details/registry.hpp>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace criterion {
+
+struct benchmark_registration_helper_struct {
+  static void register_benchmark(const benchmark_config &config) {
+    benchmark_registry::global().register_instance(config);
+  }
+
+  // Only the benchmarks in this shard of the (filtered) list are listed and run, e.g., --shard 2/4
+  static inline std::optional<benchmark_shard> shard;
+
+  static std::vector<const benchmark_instance *>
+  select(const std::vector<const benchmark_instance *> &instances) {
+    return shard.has_value() ? shard->select(instances) : instances;
+  }
+
+  static void execute_registered_benchmarks() {
+    const auto &registry = benchmark_registry::global();
+    std::vector<const benchmark_instance *> instances;
+    instances.reserve(registry.instances().size());
+    for (const auto &instance : registry.instances()) {
+      instances.push_back(&instance);
+    }
+    execute(select(instances));
+  }
+
+  static void list_registered_benchmarks() { list_filtered_registered_benchmarks(""); }
+
+  static void list_filtered_registered_benchmarks(const std::string &regex_string) {
+    for (const auto instance : select(benchmark_registry::global().filter(regex_string))) {
+      std::cout << instance->name << "\n";
+    }
+  }
+
+  static void execute_filtered_registered_benchmarks(const std::string &regex_string) {
+    execute(select(benchmark_registry::global().filter(regex_string)));
+  }
+
+  static void execute(const std::vector<const benchmark_instance *> &instances) {
+    if (benchmark::time_budget.has_value()) {
+      execute_benchmarks_within_budget(instances, benchmark::time_budget.value());
+      return;
+    }
+    const auto &registry = benchmark_registry::global();
+    for (const auto instance : instances) {
+      benchmark{registry.configure(*instance)}.run();
+    }
+  }
+
+  // Runs a short pilot of every instance, then splits what is left of `budget` across them based
+  // on their cost and variance (see allocate_time_budget). The outcome, including instances that
+  // got less time than they would without a budget, is saved in benchmark::budget_report
+  static void execute_benchmarks_within_budget(
+      const std::vector<const benchmark_instance *> &instances, std::chrono::nanoseconds budget) {
+    using namespace std::chrono;
+    const auto &registry = benchmark_registry::global();
+    const auto start = steady_clock::now();
+    const auto elapsed = [&start]() {
+      return static_cast<long double>(
+          duration_cast<nanoseconds>(steady_clock::now() - start).count());
+    };
+
+    // spend at most a tenth of the budget on pilots
+    const auto pilot_time = static_cast<long double>(budget.count()) / 10 /
+                            static_cast<long double>(std::max(instances.size(), std::size_t{1}));
+
+    // Lazy parameters are built once per instance, for its pilot, and shared with its run
+    std::vector<benchmark_config> configs;
+    std::vector<budget_pilot> pilots;
+    configs.reserve(instances.size());
+    pilots.reserve(instances.size());
+    for (const auto instance : instances) {
+      auto config = registry.configure(*instance);
+      if (config.parameter_factory) {
+        config.owned_parameters = config.parameter_factory();
+        config.parameters = config.owned_parameters.get();
+        config.parameter_factory = nullptr;
+      }
+      pilots.push_back(benchmark{config}.pilot(pilot_time));
+      configs.push_back(std::move(config));
+    }
+
+    time_budget_report report{.budget = static_cast<long double>(budget.count()),
+                              .pilot_time = elapsed(),
+                              .elapsed_time = 0,
+                              .num_benchmarks = instances.size(),
+                              .under_sampled = {}};
+
+    const auto allocations = allocate_time_budget(pilots, report.budget - report.pilot_time);
+    for (std::size_t i = 0; i < instances.size(); ++i) {
+      auto config = std::move(configs[i]); // released, with its parameters, after the run
+      const auto &allocation = allocations[i];
+      if (pilots[i].allocatable) {
+        // an allocation never exceeds the budget, but keep the conversion defined regardless
+        const auto time = nanoseconds(static_cast<nanoseconds::rep>(
+            std::clamp(allocation.time, (long double)0, static_cast<long double>(budget.count()))));
+        config.options.min_time = time;
+        config.options.max_time = time;
+        config.options.batch_size = allocation.batch_size;
+      }
+      if (allocation.under_sampled) {
+        report.under_sampled.push_back(
+            {pilots[i].name, allocation.time, allocation.iterations,
+             allocation.relative_standard_error});
+      }
+      benchmark{config}.run();
+    }
+
+    report.elapsed_time = elapsed();
+    benchmark::budget_report = report;
+  }
+};
+
+} // namespace criterion
+
+#define SETUP_BENCHMARK(...)                                                                       \
+  __VA_ARGS__                                                                                      \
+  ::criterion::allocation_counter::mark_start();                                                   \
+  __benchmark_start_timestamp =                                                                    \
+      std::chrono::steady_clock::now(); // updated benchmark start timestamp
+
+#define TEARDOWN_BENCHMARK(...)                                                                    \
+  __benchmark_teardown_timestamp = std::chrono::steady_clock::now();                               \
+  ::criterion::allocation_counter::mark_end();                                                     \
+  __VA_ARGS__
+
+namespace criterion {
+
+struct benchmark_template_registration_helper_struct {
+  static void register_benchmark_template(const benchmark_config &config) {
+    benchmark_registry::global().register_template(config.name, config);
+  }
+
+  // Same as above, but found under `template_name` rather than the name of the benchmark
+  static void register_benchmark_template(const std::string &template_name,
+                                          const benchmark_config &config) {
+    benchmark_registry::global().register_template(template_name, config);
+  }
+
+  template <class ArgTuple>
+  static void execute_registered_benchmark_template(const std::string &template_name,
+                                                    const std::string &instance_name,
+                                                    ArgTuple &arg_tuple) {
+    benchmark_registry::global().instantiate(template_name, instance_name, (void *)(&arg_tuple),
+                                             nullptr);
+  }
+
+  // Same as above, but each instance shares ownership of arguments generated at runtime
+  template <class ArgTuple>
+  static void execute_registered_benchmark_template(const std::string &template_name,
+                                                    const std::string &instance_name,
+                                                    std::shared_ptr<ArgTuple> arg_tuple) {
+    benchmark_registry::global().instantiate(template_name, instance_name,
+                                             (void *)(arg_tuple.get()), arg_tuple);
+  }
+
+  // Same as above, but the arguments are only created by `factory` when the instance is run
+  template <class ArgTuple>
+  static void
+  execute_registered_benchmark_template_lazily(const std::string &template_name,
+                                               const std::string &instance_name,
+                                               std::shared_ptr<ArgTuple> (*factory)()) {
+    benchmark_registry::global().instantiate(
+        template_name, instance_name, nullptr, nullptr,
+        [factory]() { return std::shared_ptr<void>(factory()); });
+  }
+
+  // One instance per value, named "/8", "/16", "/1K" etc., for benchmarks with one parameter
+  template <class ArgTuple>
+  static void
+  execute_registered_benchmark_template_for_range(const std::string &template_name,
+                                                  const std::vector<long long> &values) {
+    static_assert(std::tuple_size_v<ArgTuple> == 1,
+                  "range invocations require a benchmark with exactly one parameter");
+    using Arg = std::tuple_element_t<0, ArgTuple>;
+    for (const auto value : values) {
+      execute_registered_benchmark_template(
+          template_name, range_instance_name(value),
+          std::make_shared<ArgTuple>(static_cast<Arg>(value)));
+    }
+  }
+
+  // One instance per point in the Cartesian product of `args` - one criterion::axis per benchmark
+  // parameter, optionally followed by a criterion::where or criterion::matching filter
+  template <class ArgTuple, class... Args>
+  static void execute_registered_benchmark_template_for_grid(const std::string &template_name,
+                                                             const Args &...args) {
+    constexpr auto num_axes = std::tuple_size_v<ArgTuple>;
+    static_assert(sizeof...(Args) == num_axes || sizeof...(Args) == num_axes + 1,
+                  "grid invocations require one axis per benchmark parameter, optionally "
+                  "followed by a filter");
+
+    const auto arguments = std::forward_as_tuple(args...);
+    const auto register_instance = [&](const std::string &instance_name, ArgTuple &&arg_tuple) {
+      execute_registered_benchmark_template(template_name, instance_name,
+                                            std::make_shared<ArgTuple>(std::move(arg_tuple)));
+    };
+
+    if constexpr (sizeof...(Args) == num_axes) {
+      for_each_grid_point<ArgTuple>(arguments, nullptr, register_instance,
+                                    std::make_index_sequence<num_axes>{});
+    } else {
+      for_each_grid_point<ArgTuple>(arguments, std::get<num_axes>(arguments), register_instance,
+                                    std::make_index_sequence<num_axes>{});
+    }
+  }
+};
+
+} // namespace criterion
+
+#define CONCAT_IMPL(a, b) a##b
+#define CONCAT(a, b) CONCAT_IMPL(a, b)
+
+#define BENCHMARK_WITHOUT_PARAMETERS(Name)                                                         \
+  typedef std::tuple<> CONCAT(Name, BenchmarkParameters);                                          \
+  namespace detail {                                                                               \
+  /* forward declare the benchmark function that we define later */                                \
+  template <class T = CONCAT(Name, BenchmarkParameters)>                                           \
+  struct CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__)) {                          \
+    static inline void CONCAT(Name, CONCAT(_registered_fun_, __LINE__))(                           \
+        std::chrono::steady_clock::time_point &,                                                   \
+        std::optional<std::chrono::steady_clock::time_point> &, void *);                           \
+  };                                                                                               \
+                                                                                                   \
+  namespace /* ensure internal linkage for struct */                                               \
+  {                                                                                                \
+  /* helper struct for static registration in ctor */                                              \
+  struct CONCAT(Name, CONCAT(_register_struct_, __LINE__)) {                                       \
+    CONCAT(Name, CONCAT(_register_struct_, __LINE__))() { /* called once before main */            \
       criterion::benchmark_template_registration_helper_struct::register_benchmark_template(       \
           criterion::benchmark_config{                                                             \
               .name = #Name,                                                                       \
@@ -3548,15 +8977,829 @@ struct benchmark_template_registration_helper_struct {
           __benchmark_teardown_timestamp,                                                          \
       [[maybe_unused]] void *__benchmark_parameters)
 
-#define BENCHMARK_WITH_PARAMETERS(Name, ...)                                                       \
+#define BENCHMARK_WITH_PARAMETERS(Name, ...)                                                       \
+  typedef std::tuple<__VA_ARGS__> CONCAT(Name, BenchmarkParameters);                               \
+  namespace detail {                                                                               \
+  /* forward declare the benchmark function that we define later */                                \
+  template <class T = CONCAT(Name, BenchmarkParameters)>                                           \
+  struct CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__)) {                          \
+    static inline void CONCAT(Name, CONCAT(_registered_fun_, __LINE__))(                           \
+        std::chrono::steady_clock::time_point &,                                                   \
+        std::optional<std::chrono::steady_clock::time_point> &, void *);                           \
+  };                                                                                               \
+                                                                                                   \
+  namespace /* ensure internal linkage for struct */                                               \
+  {                                                                                                \
+  /* helper struct for static registration in ctor */                                              \
+  struct CONCAT(Name, CONCAT(_register_struct_, __LINE__)) {                                       \
+    CONCAT(Name, CONCAT(_register_struct_, __LINE__))() { /* called once before main */            \
+      criterion::benchmark_template_registration_helper_struct::register_benchmark_template(       \
+          criterion::benchmark_config{                                                             \
+              .name = #Name,                                                                       \
+              .fn = CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__)) <               \
+                    CONCAT(Name, BenchmarkParameters) >                                            \
+                    ::CONCAT(Name, CONCAT(_registered_fun_, __LINE__))});                          \
+    }                                                                                              \
+  } CONCAT(Name, CONCAT(_register_struct_instance_, __LINE__));                                    \
+  }                                                                                                \
+  }                                                                                                \
+                                                                                                   \
+  /* now actually defined to allow BENCHMARK("name") { ... } syntax */                             \
+  template <class T>                                                                               \
+  void detail::CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__))<T>::CONCAT(          \
+      Name, CONCAT(_registered_fun_, __LINE__))(                                                   \
+      [[maybe_unused]] std::chrono::steady_clock::time_point & __benchmark_start_timestamp,        \
+      [[maybe_unused]] std::optional<std::chrono::steady_clock::time_point> &                      \
+          __benchmark_teardown_timestamp,                                                          \
+      [[maybe_unused]] void *__benchmark_parameters)
+
+#define GET_ARGUMENT_TUPLE *((T *)__benchmark_parameters)
+
+#define GET_ARGUMENT(index) std::get<index>(*((T *)__benchmark_parameters));
+
+#define BENCHMARK_1(Name) BENCHMARK_WITHOUT_PARAMETERS(Name)
+
+#define BENCHMARK_2(Name, A) BENCHMARK_WITH_PARAMETERS(Name, A)
+#define BENCHMARK_3(Name, A, B) BENCHMARK_WITH_PARAMETERS(Name, A, B)
+#define BENCHMARK_4(Name, A, B, C) BENCHMARK_WITH_PARAMETERS(Name, A, B, C)
+#define BENCHMARK_5(Name, A, B, C, D) BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D)
+#define BENCHMARK_6(Name, A, B, C, D, E) BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F)
+#define BENCHMARK_7(Name, A, B, C, D, E, F) BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F)
+#define BENCHMARK_8(Name, A, B, C, D, E, F, G) BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G)
+#define BENCHMARK_9(Name, A, B, C, D, E, F, G, H)                                                  \
+  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H)
+#define BENCHMARK_10(Name, A, B, C, D, E, F, G, H, I)                                              \
+  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I)
+#define BENCHMARK_11(Name, A, B, C, D, E, F, G, H, I, J)                                           \
+  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J)
+#define BENCHMARK_12(Name, A, B, C, D, E, F, G, H, I, J, K)                                        \
+  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K)
+#define BENCHMARK_13(Name, A, B, C, D, E, F, G, H, I, J, K, L)                                     \
+  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L)
+#define BENCHMARK_14(Name, A, B, C, D, E, F, G, H, I, J, K, L, M)                                  \
+  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L, M)
+#define BENCHMARK_15(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N)                               \
+  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N)
+#define BENCHMARK_16(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O)                            \
+  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O)
+#define BENCHMARK_17(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P)                         \
+  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P)
+#define BENCHMARK_18(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q)                      \
+  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q)
+#define BENCHMARK_19(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R)                   \
+  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R)
+#define BENCHMARK_20(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S)                \
+  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S)
+#define BENCHMARK_21(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T)             \
+  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T)
+#define BENCHMARK_22(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T, U)          \
+  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T, U)
+#define BENCHMARK_23(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T, U, V)       \
+  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T, U, V)
+#define BENCHMARK_24(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T, U, V, W)    \
+  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T, U,   \
+                            V, W)
+#define BENCHMARK_25(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T, U, V, W, X) \
+  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T, U,   \
+                            V, W, X)
+#define BENCHMARK_26(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T, U, V, W, X, \
+                     Y)                                                                            \
+  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T, U,   \
+                            V, W, X, Y)
+#define BENCHMARK_27(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T, U, V, W, X, \
+                     Y, Z)                                                                         \
+  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T, U,   \
+                            V, W, X, Y, Z)
+
+// The interim macro that simply strips the excess and ends up with the required macro
+#define BENCHMARK_X(Name, x, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T, U, V, W,  \
+                    X, Y, Z, FUNC, ...)                                                            \
+  FUNC
+
+// BENCHMARK macro supports no more than 26 parameters
+// The macro that the programmer uses
+#define BENCHMARK(...)                                                                             \
+  BENCHMARK_X(, ##__VA_ARGS__, BENCHMARK_27(__VA_ARGS__), BENCHMARK_26(__VA_ARGS__),               \
+              BENCHMARK_25(__VA_ARGS__), BENCHMARK_24(__VA_ARGS__), BENCHMARK_23(__VA_ARGS__),     \
+              BENCHMARK_22(__VA_ARGS__), BENCHMARK_21(__VA_ARGS__), BENCHMARK_20(__VA_ARGS__),     \
+              BENCHMARK_19(__VA_ARGS__), BENCHMARK_18(__VA_ARGS__), BENCHMARK_17(__VA_ARGS__),     \
+              BENCHMARK_16(__VA_ARGS__), BENCHMARK_15(__VA_ARGS__), BENCHMARK_14(__VA_ARGS__),     \
+              BENCHMARK_13(__VA_ARGS__), BENCHMARK_12(__VA_ARGS__), BENCHMARK_11(__VA_ARGS__),     \
+              BENCHMARK_10(__VA_ARGS__), BENCHMARK_9(__VA_ARGS__), BENCHMARK_8(__VA_ARGS__),       \
+              BENCHMARK_7(__VA_ARGS__), BENCHMARK_6(__VA_ARGS__), BENCHMARK_5(__VA_ARGS__),        \
+              BENCHMARK_4(__VA_ARGS__), BENCHMARK_3(__VA_ARGS__), BENCHMARK_2(__VA_ARGS__),        \
+              BENCHMARK_1(__VA_ARGS__))
+
+#define INVOKE_BENCHMARK(TemplateName, InstanceName, ...)                                          \
+                                                                                                   \
+  namespace /* ensure internal linkage for struct */                                               \
+  {                                                                                                \
+  static CONCAT(TemplateName, BenchmarkParameters)                                                 \
+      CONCAT(CONCAT(TemplateName, _benchmark_template_parameters), __LINE__) = {__VA_ARGS__};      \
+  /* helper struct for static registration in ctor */                                              \
+  struct CONCAT(TemplateName, CONCAT(_instantiation_struct_, __LINE__)) {                          \
+    CONCAT(TemplateName, CONCAT(_instantiation_struct_, __LINE__))                                 \
+    () { /* called once before main */                                                             \
+      criterion::benchmark_template_registration_helper_struct::                                   \
+          execute_registered_benchmark_template<CONCAT(TemplateName, BenchmarkParameters)>(        \
+              #TemplateName, InstanceName,                                                         \
+              CONCAT(CONCAT(TemplateName, _benchmark_template_parameters), __LINE__));             \
+    }                                                                                              \
+  } CONCAT(TemplateName, CONCAT(_instantiation_struct_instance_, __LINE__));                       \
+  }
+
+// Run a benchmark for first, first * Multiplier, first * Multiplier^2, ... up to and including Last
+#define INVOKE_BENCHMARK_RANGE(TemplateName, First, Last, Multiplier)                              \
+                                                                                                   \
+  namespace /* ensure internal linkage for struct */                                               \
+  {                                                                                                \
+  /* helper struct for static registration in ctor */                                              \
+  struct CONCAT(TemplateName, CONCAT(_range_struct_, __LINE__)) {                                  \
+    CONCAT(TemplateName, CONCAT(_range_struct_, __LINE__))() { /* called once before main */       \
+      criterion::benchmark_template_registration_helper_struct::                                   \
+          execute_registered_benchmark_template_for_range<CONCAT(TemplateName,                     \
+                                                                 BenchmarkParameters)>(            \
+              #TemplateName, criterion::geometric_range(First, Last, Multiplier));                 \
+    }                                                                                              \
+  } CONCAT(TemplateName, CONCAT(_range_struct_instance_, __LINE__));                               \
+  }
+
+// Run a benchmark for first, first + Step, first + 2 * Step, ... up to and including Last
+#define INVOKE_BENCHMARK_DENSE_RANGE(TemplateName, First, Last, Step)                              \
+                                                                                                   \
+  namespace /* ensure internal linkage for struct */                                               \
+  {                                                                                                \
+  /* helper struct for static registration in ctor */                                              \
+  struct CONCAT(TemplateName, CONCAT(_dense_range_struct_, __LINE__)) {                            \
+    CONCAT(TemplateName, CONCAT(_dense_range_struct_, __LINE__))() { /* called once before main */ \
+      criterion::benchmark_template_registration_helper_struct::                                   \
+          execute_registered_benchmark_template_for_range<CONCAT(TemplateName,                     \
+                                                                 BenchmarkParameters)>(            \
+              #TemplateName, criterion::linear_range(First, Last, Step));                          \
+    }                                                                                              \
+  } CONCAT(TemplateName, CONCAT(_dense_range_struct_instance_, __LINE__));                         \
+  }
+
+// Run a benchmark for every combination of parameter values, e.g.,
+// INVOKE_BENCHMARK_GRID(ToString, criterion::axis("fn", ...), criterion::axis("size", 10, 1000))
+#define INVOKE_BENCHMARK_GRID(TemplateName, ...)                                                   \
+                                                                                                   \
+  namespace /* ensure internal linkage for struct */                                               \
+  {                                                                                                \
+  /* helper struct for static registration in ctor */                                              \
+  struct CONCAT(TemplateName, CONCAT(_grid_struct_, __LINE__)) {                                   \
+    CONCAT(TemplateName, CONCAT(_grid_struct_, __LINE__))() { /* called once before main */        \
+      criterion::benchmark_template_registration_helper_struct::                                   \
+          execute_registered_benchmark_template_for_grid<CONCAT(TemplateName,                      \
+                                                                BenchmarkParameters)>(             \
+              #TemplateName, __VA_ARGS__);                                                         \
+    }                                                                                              \
+  } CONCAT(TemplateName, CONCAT(_grid_struct_instance_, __LINE__));                                \
+  }
+
+#define GET_FIRST(first, ...) first
+#define GET_REST(first, ...) __VA_ARGS__
+
+#define INVOKE_BENCHMARK_N(TemplateName, Index, PackedArgument)                                    \
+                                                                                                   \
+  namespace /* ensure internal linkage for struct */                                               \
+  {                                                                                                \
+  static CONCAT(TemplateName, BenchmarkParameters)                                                 \
+      CONCAT(CONCAT(CONCAT(TemplateName, _benchmark_template_parameters), __LINE__),               \
+             Index) = {GET_REST(PackedArgument)};                                                  \
+  /* helper struct for static registration in ctor */                                              \
+  struct CONCAT(TemplateName, CONCAT(CONCAT(_instantiation_struct_, __LINE__), Index)) {           \
+    CONCAT(TemplateName, CONCAT(CONCAT(_instantiation_struct_, __LINE__),                          \
+                                Index)()) { /* called once before main */                          \
+      criterion::benchmark_template_registration_helper_struct::                                   \
+          execute_registered_benchmark_template<CONCAT(TemplateName, BenchmarkParameters)>(        \
+              #TemplateName, GET_FIRST(PackedArgument),                                            \
+              CONCAT(CONCAT(CONCAT(TemplateName, _benchmark_template_parameters), __LINE__),       \
+                     Index));                                                                      \
+    }                                                                                              \
+  } CONCAT(TemplateName, CONCAT(CONCAT(_instantiation_struct_instance_, __LINE__), Index));        \
+  }
+
+// Measurement settings for every instance of a benchmark, as criterion::benchmark_options fields,
+// e.g., BENCHMARK_OPTIONS(MergeSort, .warmup_runs = 1, .max_time = std::chrono::seconds(5))
+#define BENCHMARK_OPTIONS(TemplateName, ...)                                                       \
+                                                                                                   \
+  namespace /* ensure internal linkage for struct */                                               \
+  {                                                                                                \
+  /* helper struct for static registration in ctor */                                              \
+  struct CONCAT(TemplateName, CONCAT(_options_struct_, __LINE__)) {                                \
+    CONCAT(TemplateName, CONCAT(_options_struct_, __LINE__))() { /* called once before main */     \
+      criterion::benchmark_registry::global().set_template_options(                                \
+          #TemplateName, criterion::benchmark_options{__VA_ARGS__});                               \
+    }                                                                                              \
+  } CONCAT(TemplateName, CONCAT(_options_struct_instance_, __LINE__));                             \
+  }
+
+// Same as BENCHMARK_OPTIONS, but only for one instance, overriding the options of the benchmark,
+// e.g., BENCHMARK_INSTANCE_OPTIONS(MergeSort, "/10M", .samples = 3, .batch_size = 1)
+#define BENCHMARK_INSTANCE_OPTIONS(TemplateName, InstanceName, ...)                                \
+                                                                                                   \
+  namespace /* ensure internal linkage for struct */                                               \
+  {                                                                                                \
+  /* helper struct for static registration in ctor */                                              \
+  struct CONCAT(TemplateName, CONCAT(_instance_options_struct_, __LINE__)) {                       \
+    CONCAT(TemplateName, CONCAT(_instance_options_struct_, __LINE__))() {                          \
+      criterion::benchmark_registry::global().set_instance_options(                                \
+          #TemplateName, InstanceName, criterion::benchmark_options{__VA_ARGS__});                 \
+    }                                                                                              \
+  } CONCAT(TemplateName, CONCAT(_instance_options_struct_instance_, __LINE__));                    \
+  }
+
+// Same as INVOKE_BENCHMARK, but the arguments are only evaluated when the instance is run, and
+// released as soon as it completes, e.g., INVOKE_LAZY_BENCHMARK(Lookup, "/1G", MakeTable(1 << 30))
+#define INVOKE_LAZY_BENCHMARK(TemplateName, InstanceName, ...)                                     \
+                                                                                                   \
+  namespace /* ensure internal linkage for struct */                                               \
+  {                                                                                                \
+  /* helper struct for static registration in ctor */                                              \
+  struct CONCAT(TemplateName, CONCAT(_lazy_instantiation_struct_, __LINE__)) {                     \
+    CONCAT(TemplateName, CONCAT(_lazy_instantiation_struct_, __LINE__))                            \
+    () { /* called once before main */                                                             \
+      using ArgTuple = CONCAT(TemplateName, BenchmarkParameters);                                  \
+      criterion::benchmark_template_registration_helper_struct::                                   \
+          execute_registered_benchmark_template_lazily<ArgTuple>(                                  \
+              #TemplateName, InstanceName,                                                         \
+              []() { return std::make_shared<ArgTuple>(ArgTuple{__VA_ARGS__}); });                 \
+    }                                                                                              \
+  } CONCAT(TemplateName, CONCAT(_lazy_instantiation_struct_instance_, __LINE__));                  \
+  }
+
+#define INVOKE_LAZY_BENCHMARK_N(TemplateName, Index, PackedArgument)                               \
+                                                                                                   \
+  namespace /* ensure internal linkage for struct */                                               \
+  {                                                                                                \
+  /* helper struct for static registration in ctor */                                              \
+  struct CONCAT(TemplateName, CONCAT(CONCAT(_lazy_instantiation_struct_, __LINE__), Index)) {      \
+    CONCAT(TemplateName, CONCAT(CONCAT(_lazy_instantiation_struct_, __LINE__),                     \
+                                Index)()) { /* called once before main */                          \
+      using ArgTuple = CONCAT(TemplateName, BenchmarkParameters);                                  \
+      criterion::benchmark_template_registration_helper_struct::                                   \
+          execute_registered_benchmark_template_lazily<ArgTuple>(                                  \
+              #TemplateName, GET_FIRST(PackedArgument),                                            \
+              []() { return std::make_shared<ArgTuple>(ArgTuple{GET_REST(PackedArgument)}); });    \
+    }                                                                                              \
+  } CONCAT(TemplateName, CONCAT(CONCAT(_lazy_instantiation_struct_instance_, __LINE__), Index));   \
+  }
+
+#define _Args(...) __VA_ARGS__
+#define STRIP_PARENS(X) X
+#define PASS_PARAMETERS(X) STRIP_PARENS(_Args X)
+
+#define STRINGIZE(arg) STRINGIZE1(arg)
+#define STRINGIZE1(arg) STRINGIZE2(arg)
+#define STRINGIZE2(arg) #arg
+
+#define CONCATENATE(arg1, arg2) CONCATENATE1(arg1, arg2)
+#define CONCATENATE1(arg1, arg2) CONCATENATE2(arg1, arg2)
+#define CONCATENATE2(arg1, arg2) arg1##arg2
+
+#define FOR_EACH_1(what, first, x, ...) what(1, first, x);
+
+#define FOR_EACH_2(what, first, x, ...)                                                            \
+  what(2, first, x);                                                                               \
+  FOR_EACH_1(what, first, __VA_ARGS__);
+
+#define FOR_EACH_3(what, first, x, ...)                                                            \
+  what(3, first, x);                                                                               \
+  FOR_EACH_2(what, first, __VA_ARGS__);
+
+#define FOR_EACH_4(what, first, x, ...)                                                            \
+  what(4, first, x);                                                                               \
+  FOR_EACH_3(what, first, __VA_ARGS__);
+
+#define FOR_EACH_5(what, first, x, ...)                                                            \
+  what(5, first, x);                                                                               \
+  FOR_EACH_4(what, first, __VA_ARGS__);
+
+#define FOR_EACH_6(what, first, x, ...)                                                            \
+  what(6, first, x);                                                                               \
+  FOR_EACH_5(what, first, __VA_ARGS__);
+
+#define FOR_EACH_7(what, first, x, ...)                                                            \
+  what(7, first, x);                                                                               \
+  FOR_EACH_6(what, first, __VA_ARGS__);
+
+#define FOR_EACH_8(what, first, x, ...)                                                            \
+  what(8, first, x);                                                                               \
+  FOR_EACH_7(what, first, __VA_ARGS__);
+
+#define FOR_EACH_9(what, first, x, ...)                                                            \
+  what(9, first, x);                                                                               \
+  FOR_EACH_8(what, first, __VA_ARGS__);
+
+#define FOR_EACH_10(what, first, x, ...)                                                           \
+  what(10, first, x);                                                                              \
+  FOR_EACH_9(what, first, __VA_ARGS__);
+
+#define FOR_EACH_11(what, first, x, ...)                                                           \
+  what(11, first, x);                                                                              \
+  FOR_EACH_10(what, first, __VA_ARGS__);
+
+#define FOR_EACH_12(what, first, x, ...)                                                           \
+  what(12, first, x);                                                                              \
+  FOR_EACH_11(what, first, __VA_ARGS__);
+
+#define FOR_EACH_13(what, first, x, ...)                                                           \
+  what(13, first, x);                                                                              \
+  FOR_EACH_12(what, first, __VA_ARGS__);
+
+#define FOR_EACH_14(what, first, x, ...)                                                           \
+  what(14, first, x);                                                                              \
+  FOR_EACH_13(what, first, __VA_ARGS__);
+
+#define FOR_EACH_15(what, first, x, ...)                                                           \
+  what(15, first, x);                                                                              \
+  FOR_EACH_14(what, first, __VA_ARGS__);
+
+#define FOR_EACH_16(what, first, x, ...)                                                           \
+  what(16, first, x);                                                                              \
+  FOR_EACH_15(what, first, __VA_ARGS__);
+
+#define FOR_EACH_17(what, first, x, ...)                                                           \
+  what(17, first, x);                                                                              \
+  FOR_EACH_16(what, first, __VA_ARGS__);
+
+#define FOR_EACH_18(what, first, x, ...)                                                           \
+  what(18, first, x);                                                                              \
+  FOR_EACH_17(what, first, __VA_ARGS__);
+
+#define FOR_EACH_19(what, first, x, ...)                                                           \
+  what(19, first, x);                                                                              \
+  FOR_EACH_18(what, first, __VA_ARGS__);
+
+#define FOR_EACH_20(what, first, x, ...)                                                           \
+  what(20, first, x);                                                                              \
+  FOR_EACH_19(what, first, __VA_ARGS__);
+
+#define FOR_EACH_21(what, first, x, ...)                                                           \
+  what(21, first, x);                                                                              \
+  FOR_EACH_20(what, first, __VA_ARGS__);
+
+#define FOR_EACH_22(what, first, x, ...)                                                           \
+  what(22, first, x);                                                                              \
+  FOR_EACH_21(what, first, __VA_ARGS__);
+
+#define FOR_EACH_23(what, first, x, ...)                                                           \
+  what(23, first, x);                                                                              \
+  FOR_EACH_22(what, first, __VA_ARGS__);
+
+#define FOR_EACH_24(what, first, x, ...)                                                           \
+  what(24, first, x);                                                                              \
+  FOR_EACH_23(what, first, __VA_ARGS__);
+
+#define FOR_EACH_25(what, first, x, ...)                                                           \
+  what(25, first, x);                                                                              \
+  FOR_EACH_24(what, first, __VA_ARGS__);
+
+#define FOR_EACH_26(what, first, x, ...)                                                           \
+  what(26, first, x);                                                                              \
+  FOR_EACH_25(what, first, __VA_ARGS__);
+
+#define FOR_EACH_27(what, first, x, ...)                                                           \
+  what(27, first, x);                                                                              \
+  FOR_EACH_26(what, first, __VA_ARGS__);
+
+#define FOR_EACH_28(what, first, x, ...)                                                           \
+  what(28, first, x);                                                                              \
+  FOR_EACH_27(what, first, __VA_ARGS__);
+
+#define FOR_EACH_29(what, first, x, ...)                                                           \
+  what(29, first, x);                                                                              \
+  FOR_EACH_28(what, first, __VA_ARGS__);
+
+#define FOR_EACH_30(what, first, x, ...)                                                           \
+  what(30, first, x);                                                                              \
+  FOR_EACH_29(what, first, __VA_ARGS__);
+
+#define FOR_EACH_31(what, first, x, ...)                                                           \
+  what(31, first, x);                                                                              \
+  FOR_EACH_30(what, first, __VA_ARGS__);
+
+#define FOR_EACH_32(what, first, x, ...)                                                           \
+  what(32, first, x);                                                                              \
+  FOR_EACH_31(what, first, __VA_ARGS__);
+
+#define FOR_EACH_33(what, first, x, ...)                                                           \
+  what(33, first, x);                                                                              \
+  FOR_EACH_32(what, first, __VA_ARGS__);
+
+#define FOR_EACH_34(what, first, x, ...)                                                           \
+  what(34, first, x);                                                                              \
+  FOR_EACH_33(what, first, __VA_ARGS__);
+
+#define FOR_EACH_35(what, first, x, ...)                                                           \
+  what(35, first, x);                                                                              \
+  FOR_EACH_34(what, first, __VA_ARGS__);
+
+#define FOR_EACH_36(what, first, x, ...)                                                           \
+  what(36, first, x);                                                                              \
+  FOR_EACH_35(what, first, __VA_ARGS__);
+
+#define FOR_EACH_37(what, first, x, ...)                                                           \
+  what(37, first, x);                                                                              \
+  FOR_EACH_36(what, first, __VA_ARGS__);
+
+#define FOR_EACH_38(what, first, x, ...)                                                           \
+  what(38, first, x);                                                                              \
+  FOR_EACH_37(what, first, __VA_ARGS__);
+
+#define FOR_EACH_39(what, first, x, ...)                                                           \
+  what(39, first, x);                                                                              \
+  FOR_EACH_38(what, first, __VA_ARGS__);
+
+#define FOR_EACH_40(what, first, x, ...)                                                           \
+  what(40, first, x);                                                                              \
+  FOR_EACH_39(what, first, __VA_ARGS__);
+
+#define FOR_EACH_41(what, first, x, ...)                                                           \
+  what(41, first, x);                                                                              \
+  FOR_EACH_40(what, first, __VA_ARGS__);
+
+#define FOR_EACH_42(what, first, x, ...)                                                           \
+  what(42, first, x);                                                                              \
+  FOR_EACH_41(what, first, __VA_ARGS__);
+
+#define FOR_EACH_43(what, first, x, ...)                                                           \
+  what(43, first, x);                                                                              \
+  FOR_EACH_42(what, first, __VA_ARGS__);
+
+#define FOR_EACH_44(what, first, x, ...)                                                           \
+  what(44, first, x);                                                                              \
+  FOR_EACH_43(what, first, __VA_ARGS__);
+
+#define FOR_EACH_45(what, first, x, ...)                                                           \
+  what(45, first, x);                                                                              \
+  FOR_EACH_44(what, first, __VA_ARGS__);
+
+#define FOR_EACH_46(what, first, x, ...)                                                           \
+  what(46, first, x);                                                                              \
+  FOR_EACH_45(what, first, __VA_ARGS__);
+
+#define FOR_EACH_47(what, first, x, ...)                                                           \
+  what(47, first, x);                                                                              \
+  FOR_EACH_46(what, first, __VA_ARGS__);
+
+#define FOR_EACH_48(what, first, x, ...)                                                           \
+  what(48, first, x);                                                                              \
+  FOR_EACH_47(what, first, __VA_ARGS__);
+
+#define FOR_EACH_49(what, first, x, ...)                                                           \
+  what(49, first, x);                                                                              \
+  FOR_EACH_48(what, first, __VA_ARGS__);
+
+#define FOR_EACH_50(what, first, x, ...)                                                           \
+  what(50, first, x);                                                                              \
+  FOR_EACH_49(what, first, __VA_ARGS__);
+
+#define FOR_EACH_51(what, first, x, ...)                                                           \
+  what(51, first, x);                                                                              \
+  FOR_EACH_50(what, first, __VA_ARGS__);
+
+#define FOR_EACH_52(what, first, x, ...)                                                           \
+  what(52, first, x);                                                                              \
+  FOR_EACH_51(what, first, __VA_ARGS__);
+
+#define FOR_EACH_53(what, first, x, ...)                                                           \
+  what(53, first, x);                                                                              \
+  FOR_EACH_52(what, first, __VA_ARGS__);
+
+#define FOR_EACH_54(what, first, x, ...)                                                           \
+  what(54, first, x);                                                                              \
+  FOR_EACH_53(what, first, __VA_ARGS__);
+
+#define FOR_EACH_55(what, first, x, ...)                                                           \
+  what(55, first, x);                                                                              \
+  FOR_EACH_54(what, first, __VA_ARGS__);
+
+#define FOR_EACH_56(what, first, x, ...)                                                           \
+  what(56, first, x);                                                                              \
+  FOR_EACH_55(what, first, __VA_ARGS__);
+
+#define FOR_EACH_57(what, first, x, ...)                                                           \
+  what(57, first, x);                                                                              \
+  FOR_EACH_56(what, first, __VA_ARGS__);
+
+#define FOR_EACH_58(what, first, x, ...)                                                           \
+  what(58, first, x);                                                                              \
+  FOR_EACH_57(what, first, __VA_ARGS__);
+
+#define FOR_EACH_59(what, first, x, ...)                                                           \
+  what(59, first, x);                                                                              \
+  FOR_EACH_58(what, first, __VA_ARGS__);
+
+#define FOR_EACH_60(what, first, x, ...)                                                           \
+  what(60, first, x);                                                                              \
+  FOR_EACH_59(what, first, __VA_ARGS__);
+
+#define FOR_EACH_61(what, first, x, ...)                                                           \
+  what(61, first, x);                                                                              \
+  FOR_EACH_60(what, first, __VA_ARGS__);
+
+#define FOR_EACH_62(what, first, x, ...)                                                           \
+  what(62, first, x);                                                                              \
+  FOR_EACH_61(what, first, __VA_ARGS__);
+
+#define FOR_EACH_63(what, first, x, ...)                                                           \
+  what(63, first, x);                                                                              \
+  FOR_EACH_62(what, first, __VA_ARGS__);
+
+#define FOR_EACH_NARG(...) FOR_EACH_NARG_(__VA_ARGS__, FOR_EACH_RSEQ_N())
+#define FOR_EACH_NARG_(...) FOR_EACH_ARG_N(__VA_ARGS__)
+#define FOR_EACH_ARG_N(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, \
+                       _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32,  \
+                       _33, _34, _35, _36, _37, _38, _39, _40, _41, _42, _43, _44, _45, _46, _47,  \
+                       _48, _49, _50, _51, _52, _53, _54, _55, _56, _57, _58, _59, _60, _61, _62,  \
+                       _63, N, ...)                                                                \
+  N
+#define FOR_EACH_RSEQ_N()                                                                          \
+  63, 62, 61, 60, 59, 58, 57, 56, 55, 54, 53, 52, 51, 50, 49, 48, 47, 46, 45, 44, 43, 42, 41, 40,  \
+      39, 38, 37, 36, 35, 34, 33, 32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17,  \
+      16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0
+
+#define FOR_EACH_(N, what, first, x, ...) CONCATENATE(FOR_EACH_, N)(what, first, x, __VA_ARGS__)
+#define FOR_EACH(what, first, ...) FOR_EACH_(FOR_EACH_NARG(__VA_ARGS__), what, first, __VA_ARGS__)
+
+#define INVOKE_BENCHMARK_FOR_EACH_HELPER(Index, TemplateName, ...)                                 \
+  INVOKE_BENCHMARK_N(TemplateName, Index, PASS_PARAMETERS(__VA_ARGS__))
+
+#define INVOKE_BENCHMARK_FOR_EACH(TemplateName, ...)                                               \
+  FOR_EACH(INVOKE_BENCHMARK_FOR_EACH_HELPER, TemplateName, __VA_ARGS__)
+
+#define INVOKE_LAZY_BENCHMARK_FOR_EACH_HELPER(Index, TemplateName, ...)                            \
+  INVOKE_LAZY_BENCHMARK_N(TemplateName, Index, PASS_PARAMETERS(__VA_ARGS__))
+
+// Same as INVOKE_BENCHMARK_FOR_EACH, but each argument list is only evaluated when its instance is
+// run, and released as soon as it completes
+#define INVOKE_LAZY_BENCHMARK_FOR_EACH(TemplateName, ...)                                          \
+  FOR_EACH(INVOKE_LAZY_BENCHMARK_FOR_EACH_HELPER, TemplateName, __VA_ARGS__)
+
+
+#pragma once
+#if __has_include(<coroutine>) && defined(__cpp_impl_coroutine)
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// #include <criterion/details/macros.hpp>
+
+namespace criterion {
+
+namespace async {
+class executor;
+}
+
+namespace detail {
+
+// State shared by task<T> promises regardless of the result type
+struct task_promise_base {
+  std::coroutine_handle<> continuation{std::noop_coroutine()};
+  std::exception_ptr exception{nullptr};
+
+  struct final_awaiter {
+    bool await_ready() const noexcept { return false; }
+
+    // symmetric transfer back to whoever co_await-ed this task
+    template <class Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+      return handle.promise().continuation;
+    }
+
+    void await_resume() const noexcept {}
+  };
+
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+  final_awaiter final_suspend() const noexcept { return {}; }
+  void unhandled_exception() noexcept { exception = std::current_exception(); }
+};
+
+} // namespace detail
+
+// Lazily started coroutine. Nothing runs until the task is co_await-ed or handed
+// to an executor; awaiting a task resumes the caller through symmetric transfer
+template <class T = void> class task {
+public:
+  struct promise_type : detail::task_promise_base {
+    std::optional<T> value;
+
+    task get_return_object() {
+      return task{std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+
+    template <class U> void return_value(U &&v) { value.emplace(std::forward<U>(v)); }
+
+    T result() {
+      if (exception)
+        std::rethrow_exception(exception);
+      return std::move(*value);
+    }
+  };
+
+  task(task &&other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+  task(const task &) = delete;
+  task &operator=(const task &) = delete;
+  ~task() {
+    if (handle_)
+      handle_.destroy();
+  }
+
+  bool await_ready() const noexcept { return false; }
+
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+    handle_.promise().continuation = awaiting;
+    return handle_;
+  }
+
+  T await_resume() { return handle_.promise().result(); }
+
+private:
+  friend class async::executor;
+  explicit task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+  std::coroutine_handle<promise_type> handle_;
+};
+
+template <> class task<void> {
+public:
+  struct promise_type : detail::task_promise_base {
+    task get_return_object() {
+      return task{std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+
+    void return_void() const noexcept {}
+
+    void result() {
+      if (exception)
+        std::rethrow_exception(exception);
+    }
+  };
+
+  task(task &&other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+  task(const task &) = delete;
+  task &operator=(const task &) = delete;
+  ~task() {
+    if (handle_)
+      handle_.destroy();
+  }
+
+  bool await_ready() const noexcept { return false; }
+
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+    handle_.promise().continuation = awaiting;
+    return handle_;
+  }
+
+  void await_resume() { handle_.promise().result(); }
+
+private:
+  friend class async::executor;
+  explicit task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+  std::coroutine_handle<promise_type> handle_;
+};
+
+namespace async {
+
+// Single-threaded run loop with a ready queue and a timer queue.
+//
+// Timers run on a virtual clock: when nothing is ready, the clock jumps straight
+// to the earliest deadline, so sleep_for() measures the cost of suspending,
+// queueing and resuming a coroutine and never the requested delay itself
+class executor {
+  struct timer {
+    std::chrono::nanoseconds deadline;
+    std::uint64_t sequence; // keeps timers with equal deadlines in FIFO order
+    std::coroutine_handle<> handle;
+
+    bool operator>(const timer &other) const {
+      return deadline != other.deadline ? deadline > other.deadline : sequence > other.sequence;
+    }
+  };
+
+  std::deque<std::coroutine_handle<>> ready_;
+  std::priority_queue<timer, std::vector<timer>, std::greater<timer>> timers_;
+  std::chrono::nanoseconds now_{0};
+  std::uint64_t sequence_{0};
+
+  static inline thread_local executor *current_{nullptr};
+
+  void drain() {
+    while (true) {
+      if (ready_.empty()) {
+        if (timers_.empty())
+          break;
+        // advance the virtual clock and release every timer that is now due
+        now_ = timers_.top().deadline;
+        while (!timers_.empty() && timers_.top().deadline <= now_) {
+          ready_.push_back(timers_.top().handle);
+          timers_.pop();
+        }
+      }
+      auto handle = ready_.front();
+      ready_.pop_front();
+      handle.resume();
+    }
+  }
+
+public:
+  executor() = default;
+  executor(const executor &) = delete;
+  executor &operator=(const executor &) = delete;
+
+  // Executor driving the coroutine that is currently running on this thread
+  static executor *current() { return current_; }
+
+  // Executor reused by ASYNC_BENCHMARK bodies, so the run loop is not rebuilt every iteration
+  static executor &this_thread() {
+    static thread_local executor instance;
+    return instance;
+  }
+
+  std::chrono::nanoseconds now() const { return now_; }
+
+  void schedule(std::coroutine_handle<> handle) { ready_.push_back(handle); }
+
+  void schedule_after(std::chrono::nanoseconds delay, std::coroutine_handle<> handle) {
+    timers_.push(timer{now_ + delay, sequence_++, handle});
+  }
+
+  // Start `t` and run the loop until there is nothing left to resume
+  template <class T> T run(task<T> t) {
+    // restores current() and drops pending work even if a resumed coroutine throws,
+    // so the thread-local executor is not left pointing at handles that `t` destroys
+    struct run_scope {
+      executor &self;
+      executor *previous;
+      ~run_scope() {
+        self.ready_.clear();
+        self.timers_ = {};
+        current_ = previous;
+      }
+    } scope{*this, std::exchange(current_, this)};
+    schedule(t.handle_);
+    drain();
+    return t.handle_.promise().result();
+  }
+};
+
+// Reschedule the calling coroutine at the back of the ready queue
+inline auto yield() {
+  struct awaiter {
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) const {
+      executor::current()->schedule(handle);
+    }
+    void await_resume() const noexcept {}
+  };
+  return awaiter{};
+}
+
+// Suspend the calling coroutine on the (virtual) timer queue
+inline auto sleep_for(std::chrono::nanoseconds delay) {
+  struct awaiter {
+    std::chrono::nanoseconds delay;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) const {
+      executor::current()->schedule_after(delay, handle);
+    }
+    void await_resume() const noexcept {}
+  };
+  return awaiter{delay};
+}
+
+} // namespace async
+
+} // namespace criterion
+
+// Same as BENCHMARK, but the body is a coroutine returning criterion::task<>.
+// Each iteration starts the coroutine on criterion::async::executor::this_thread() and
+// completes once the executor has nothing left to resume
+#define ASYNC_BENCHMARK(Name, ...)                                                                 \
   typedef std::tuple<__VA_ARGS__> CONCAT(Name, BenchmarkParameters);                               \
   namespace detail {                                                                               \
-  /* forward declare the benchmark function that we define later */                                \
+  /* forward declare the benchmark coroutine that we define later */                               \
   template <class T = CONCAT(Name, BenchmarkParameters)>                                           \
   struct CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__)) {                          \
-    static inline void CONCAT(Name, CONCAT(_registered_fun_, __LINE__))(                           \
+    static criterion::task<> CONCAT(Name, CONCAT(_registered_coroutine_, __LINE__))(               \
         std::chrono::steady_clock::time_point &,                                                   \
         std::optional<std::chrono::steady_clock::time_point> &, void *);                           \
+                                                                                                   \
+    static inline void CONCAT(Name, CONCAT(_registered_fun_, __LINE__))(                           \
+        std::chrono::steady_clock::time_point &start,                                              \
+        std::optional<std::chrono::steady_clock::time_point> &teardown, void *parameters) {        \
+      criterion::async::executor::this_thread().run(                                               \
+          CONCAT(Name, CONCAT(_registered_coroutine_, __LINE__))(start, teardown, parameters));    \
+    }                                                                                              \
   };                                                                                               \
                                                                                                    \
   namespace /* ensure internal linkage for struct */                                               \
@@ -3570,423 +9813,607 @@ struct benchmark_template_registration_helper_struct {
               .fn = CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__)) <               \
                     CONCAT(Name, BenchmarkParameters) >                                            \
                     ::CONCAT(Name, CONCAT(_registered_fun_, __LINE__))});                          \
+      /* benchmarks without parameters have a single, implicit instance */                         \
+      if constexpr (std::tuple_size_v<CONCAT(Name, BenchmarkParameters)> == 0) {                   \
+        criterion::benchmark_template_registration_helper_struct::                                 \
+            execute_registered_benchmark_template(#Name, "",                                       \
+                                                  criterion::benchmark_config::empty_tuple);       \
+      }                                                                                            \
     }                                                                                              \
   } CONCAT(Name, CONCAT(_register_struct_instance_, __LINE__));                                    \
   }                                                                                                \
   }                                                                                                \
                                                                                                    \
-  /* now actually defined to allow BENCHMARK("name") { ... } syntax */                             \
+  /* now actually defined to allow ASYNC_BENCHMARK("name") { ... } syntax */                       \
   template <class T>                                                                               \
-  void detail::CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__))<T>::CONCAT(          \
-      Name, CONCAT(_registered_fun_, __LINE__))(                                                   \
-      [[maybe_unused]] std::chrono::steady_clock::time_point & __benchmark_start_timestamp,        \
-      [[maybe_unused]] std::optional<std::chrono::steady_clock::time_point> &                      \
-          __benchmark_teardown_timestamp,                                                          \
-      [[maybe_unused]] void *__benchmark_parameters)
-
-#define GET_ARGUMENT_TUPLE *((T *)__benchmark_parameters)
-
-#define GET_ARGUMENT(index) std::get<index>(*((T *)__benchmark_parameters));
-
-#define BENCHMARK_1(Name) BENCHMARK_WITHOUT_PARAMETERS(Name)
-
-#define BENCHMARK_2(Name, A) BENCHMARK_WITH_PARAMETERS(Name, A)
-#define BENCHMARK_3(Name, A, B) BENCHMARK_WITH_PARAMETERS(Name, A, B)
-#define BENCHMARK_4(Name, A, B, C) BENCHMARK_WITH_PARAMETERS(Name, A, B, C)
-#define BENCHMARK_5(Name, A, B, C, D) BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D)
-#define BENCHMARK_6(Name, A, B, C, D, E) BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F)
-#define BENCHMARK_7(Name, A, B, C, D, E, F) BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F)
-#define BENCHMARK_8(Name, A, B, C, D, E, F, G) BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G)
-#define BENCHMARK_9(Name, A, B, C, D, E, F, G, H)                                                  \
-  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H)
-#define BENCHMARK_10(Name, A, B, C, D, E, F, G, H, I)                                              \
-  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I)
-#define BENCHMARK_11(Name, A, B, C, D, E, F, G, H, I, J)                                           \
-  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J)
-#define BENCHMARK_12(Name, A, B, C, D, E, F, G, H, I, J, K)                                        \
-  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K)
-#define BENCHMARK_13(Name, A, B, C, D, E, F, G, H, I, J, K, L)                                     \
-  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L)
-#define BENCHMARK_14(Name, A, B, C, D, E, F, G, H, I, J, K, L, M)                                  \
-  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L, M)
-#define BENCHMARK_15(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N)                               \
-  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N)
-#define BENCHMARK_16(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O)                            \
-  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O)
-#define BENCHMARK_17(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P)                         \
-  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P)
-#define BENCHMARK_18(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q)                      \
-  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q)
-#define BENCHMARK_19(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R)                   \
-  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R)
-#define BENCHMARK_20(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S)                \
-  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S)
-#define BENCHMARK_21(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T)             \
-  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T)
-#define BENCHMARK_22(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T, U)          \
-  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T, U)
-#define BENCHMARK_23(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T, U, V)       \
-  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T, U, V)
-#define BENCHMARK_24(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T, U, V, W)    \
-  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T, U,   \
-                            V, W)
-#define BENCHMARK_25(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T, U, V, W, X) \
-  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T, U,   \
-                            V, W, X)
-#define BENCHMARK_26(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T, U, V, W, X, \
-                     Y)                                                                            \
-  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T, U,   \
-                            V, W, X, Y)
-#define BENCHMARK_27(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T, U, V, W, X, \
-                     Y, Z)                                                                         \
-  BENCHMARK_WITH_PARAMETERS(Name, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T, U,   \
-                            V, W, X, Y, Z)
-
-// The interim macro that simply strips the excess and ends up with the required macro
-#define BENCHMARK_X(Name, x, A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T, U, V, W,  \
-                    X, Y, Z, FUNC, ...)                                                            \
-  FUNC
-
-// BENCHMARK macro supports no more than 26 parameters
-// The macro that the programmer uses
-#define BENCHMARK(...)                                                                             \
-  BENCHMARK_X(, ##__VA_ARGS__, BENCHMARK_27(__VA_ARGS__), BENCHMARK_26(__VA_ARGS__),               \
-              BENCHMARK_25(__VA_ARGS__), BENCHMARK_24(__VA_ARGS__), BENCHMARK_23(__VA_ARGS__),     \
-              BENCHMARK_22(__VA_ARGS__), BENCHMARK_21(__VA_ARGS__), BENCHMARK_20(__VA_ARGS__),     \
-              BENCHMARK_19(__VA_ARGS__), BENCHMARK_18(__VA_ARGS__), BENCHMARK_17(__VA_ARGS__),     \
-              BENCHMARK_16(__VA_ARGS__), BENCHMARK_15(__VA_ARGS__), BENCHMARK_14(__VA_ARGS__),     \
-              BENCHMARK_13(__VA_ARGS__), BENCHMARK_12(__VA_ARGS__), BENCHMARK_11(__VA_ARGS__),     \
-              BENCHMARK_10(__VA_ARGS__), BENCHMARK_9(__VA_ARGS__), BENCHMARK_8(__VA_ARGS__),       \
-              BENCHMARK_7(__VA_ARGS__), BENCHMARK_6(__VA_ARGS__), BENCHMARK_5(__VA_ARGS__),        \
-              BENCHMARK_4(__VA_ARGS__), BENCHMARK_3(__VA_ARGS__), BENCHMARK_2(__VA_ARGS__),        \
-              BENCHMARK_1(__VA_ARGS__))
-
-#define INVOKE_BENCHMARK(TemplateName, InstanceName, ...)                                          \
-                                                                                                   \
-  namespace /* ensure internal linkage for struct */                                               \
-  {                                                                                                \
-  static CONCAT(TemplateName, BenchmarkParameters)                                                 \
-      CONCAT(CONCAT(TemplateName, _benchmark_template_parameters), __LINE__) = {__VA_ARGS__};      \
-  /* helper struct for static registration in ctor */                                              \
-  struct CONCAT(TemplateName, CONCAT(_instantiation_struct_, __LINE__)) {                          \
-    CONCAT(TemplateName, CONCAT(_instantiation_struct_, __LINE__))                                 \
-    () { /* called once before main */                                                             \
-      criterion::benchmark_template_registration_helper_struct::                                   \
-          execute_registered_benchmark_template<CONCAT(TemplateName, BenchmarkParameters)>(        \
-              #TemplateName, InstanceName,                                                         \
-              CONCAT(CONCAT(TemplateName, _benchmark_template_parameters), __LINE__));             \
-    }                                                                                              \
-  } CONCAT(TemplateName, CONCAT(_instantiation_struct_instance_, __LINE__));                       \
-  }
-
-#define GET_FIRST(first, ...) first
-#define GET_REST(first, ...) __VA_ARGS__
-
-#define INVOKE_BENCHMARK_N(TemplateName, Index, PackedArgument)                                    \
-                                                                                                   \
-  namespace /* ensure internal linkage for struct */                                               \
-  {                                                                                                \
-  static CONCAT(TemplateName, BenchmarkParameters)                                                 \
-      CONCAT(CONCAT(CONCAT(TemplateName, _benchmark_template_parameters), __LINE__),               \
-             Index) = {GET_REST(PackedArgument)};                                                  \
-  /* helper struct for static registration in ctor */                                              \
-  struct CONCAT(TemplateName, CONCAT(CONCAT(_instantiation_struct_, __LINE__), Index)) {           \
-    CONCAT(TemplateName, CONCAT(CONCAT(_instantiation_struct_, __LINE__),                          \
-                                Index)()) { /* called once before main */                          \
-      criterion::benchmark_template_registration_helper_struct::                                   \
-          execute_registered_benchmark_template<CONCAT(TemplateName, BenchmarkParameters)>(        \
-              #TemplateName, GET_FIRST(PackedArgument),                                            \
-              CONCAT(CONCAT(CONCAT(TemplateName, _benchmark_template_parameters), __LINE__),       \
-                     Index));                                                                      \
-    }                                                                                              \
-  } CONCAT(TemplateName, CONCAT(CONCAT(_instantiation_struct_instance_, __LINE__), Index));        \
-  }
-
-#define _Args(...) __VA_ARGS__
-#define STRIP_PARENS(X) X
-#define PASS_PARAMETERS(X) STRIP_PARENS(_Args X)
-
-#define STRINGIZE(arg) STRINGIZE1(arg)
-#define STRINGIZE1(arg) STRINGIZE2(arg)
-#define STRINGIZE2(arg) #arg
-
-#define CONCATENATE(arg1, arg2) CONCATENATE1(arg1, arg2)
-#define CONCATENATE1(arg1, arg2) CONCATENATE2(arg1, arg2)
-#define CONCATENATE2(arg1, arg2) arg1##arg2
-
-#define FOR_EACH_1(what, first, x, ...) what(1, first, x);
-
-#define FOR_EACH_2(what, first, x, ...)                                                            \
-  what(2, first, x);                                                                               \
-  FOR_EACH_1(what, first, __VA_ARGS__);
-
-#define FOR_EACH_3(what, first, x, ...)                                                            \
-  what(3, first, x);                                                                               \
-  FOR_EACH_2(what, first, __VA_ARGS__);
-
-#define FOR_EACH_4(what, first, x, ...)                                                            \
-  what(4, first, x);                                                                               \
-  FOR_EACH_3(what, first, __VA_ARGS__);
-
-#define FOR_EACH_5(what, first, x, ...)                                                            \
-  what(5, first, x);                                                                               \
-  FOR_EACH_4(what, first, __VA_ARGS__);
+  criterion::task<> detail::CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__))<T>::    \
+      CONCAT(Name, CONCAT(_registered_coroutine_, __LINE__))(                                      \
+          [[maybe_unused]] std::chrono::steady_clock::time_point & __benchmark_start_timestamp,    \
+          [[maybe_unused]] std::optional<std::chrono::steady_clock::time_point> &                  \
+              __benchmark_teardown_timestamp,                                                      \
+          [[maybe_unused]] void *__benchmark_parameters)
 
-#define FOR_EACH_6(what, first, x, ...)                                                            \
-  what(6, first, x);                                                                               \
-  FOR_EACH_5(what, first, __VA_ARGS__);
+#endif
 
-#define FOR_EACH_7(what, first, x, ...)                                                            \
-  what(7, first, x);                                                                               \
-  FOR_EACH_6(what, first, __VA_ARGS__);
 
-#define FOR_EACH_8(what, first, x, ...)                                                            \
-  what(8, first, x);                                                                               \
-  FOR_EACH_7(what, first, __VA_ARGS__);
+#pragma once
+#if defined(__unix__) || defined(__APPLE__)
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
 
-#define FOR_EACH_9(what, first, x, ...)                                                            \
-  what(9, first, x);                                                                               \
-  FOR_EACH_8(what, first, __VA_ARGS__);
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/prctl.h>
+#endif
 
-#define FOR_EACH_10(what, first, x, ...)                                                           \
-  what(10, first, x);                                                                              \
-  FOR_EACH_9(what, first, __VA_ARGS__);
+// #include <criterion/details/macros.hpp>
 
-#define FOR_EACH_11(what, first, x, ...)                                                           \
-  what(11, first, x);                                                                              \
-  FOR_EACH_10(what, first, __VA_ARGS__);
+namespace criterion {
 
-#define FOR_EACH_12(what, first, x, ...)                                                           \
-  what(12, first, x);                                                                              \
-  FOR_EACH_11(what, first, __VA_ARGS__);
+// Sense-reversing spin barrier that lives in memory shared between processes
+class process_barrier {
+  std::atomic<std::uint32_t> count_{0};
+  std::atomic<std::uint32_t> generation_{0};
+  std::uint32_t parties_;
 
-#define FOR_EACH_13(what, first, x, ...)                                                           \
-  what(13, first, x);                                                                              \
-  FOR_EACH_12(what, first, __VA_ARGS__);
+public:
+  explicit process_barrier(std::uint32_t parties) : parties_(parties) {}
+
+  // `still_alive` is polled while spinning; return false from it to abandon the wait
+  template <class Predicate> bool wait(Predicate &&still_alive) {
+    const auto generation = generation_.load(std::memory_order_acquire);
+    if (count_.fetch_add(1, std::memory_order_acq_rel) + 1 == parties_) {
+      count_.store(0, std::memory_order_relaxed);
+      generation_.fetch_add(1, std::memory_order_release);
+      return true;
+    }
 
-#define FOR_EACH_14(what, first, x, ...)                                                           \
-  what(14, first, x);                                                                              \
-  FOR_EACH_13(what, first, __VA_ARGS__);
+    std::size_t spins = 0;
+    while (generation_.load(std::memory_order_acquire) == generation) {
+      if (++spins % 1024 == 0) {
+        std::this_thread::yield();
+        if (spins % (1024 * 64) == 0 && !still_alive())
+          return false;
+      }
+    }
+    return true;
+  }
+};
 
-#define FOR_EACH_15(what, first, x, ...)                                                           \
-  what(15, first, x);                                                                              \
-  FOR_EACH_14(what, first, __VA_ARGS__);
+// N cooperating processes (rank 0 is the benchmark process) sharing an mmap(MAP_SHARED) region.
+//
+// Workers are forked once per benchmark instance and then run the benchmark body in lock-step
+// with rank 0: every iteration starts and ends on a process-shared barrier, so the time measured
+// by rank 0 covers the cross-process work of all ranks
+class process_group {
+  static_assert(std::atomic<std::uint32_t>::is_always_lock_free,
+                "process_group requires address-free atomics");
 
-#define FOR_EACH_16(what, first, x, ...)                                                           \
-  what(16, first, x);                                                                              \
-  FOR_EACH_15(what, first, __VA_ARGS__);
+  enum class command : std::uint32_t { run, stop };
 
-#define FOR_EACH_17(what, first, x, ...)                                                           \
-  what(17, first, x);                                                                              \
-  FOR_EACH_16(what, first, __VA_ARGS__);
+  struct control_block {
+    process_barrier barrier;      // used at the start and end of every iteration
+    process_barrier user_barrier; // exposed to benchmark bodies through barrier()
+    std::atomic<command> next{command::run};
 
-#define FOR_EACH_18(what, first, x, ...)                                                           \
-  what(18, first, x);                                                                              \
-  FOR_EACH_17(what, first, __VA_ARGS__);
+    explicit control_block(std::uint32_t parties) : barrier(parties), user_barrier(parties) {}
+  };
 
-#define FOR_EACH_19(what, first, x, ...)                                                           \
-  what(19, first, x);                                                                              \
-  FOR_EACH_18(what, first, __VA_ARGS__);
+  // keep the user area cache-line aligned and away from the control block
+  static constexpr std::size_t control_block_size = (sizeof(control_block) + 127) / 128 * 128;
 
-#define FOR_EACH_20(what, first, x, ...)                                                           \
-  what(20, first, x);                                                                              \
-  FOR_EACH_19(what, first, __VA_ARGS__);
+  std::size_t num_processes_;
+  std::size_t shared_memory_size_;
+  std::size_t rank_{0};
+  void *region_{nullptr};
+  control_block *control_{nullptr};
+  std::vector<pid_t> workers_;
 
-#define FOR_EACH_21(what, first, x, ...)                                                           \
-  what(21, first, x);                                                                              \
-  FOR_EACH_20(what, first, __VA_ARGS__);
+  bool workers_alive() {
+    for (const auto pid : workers_) {
+      int status = 0;
+      if (waitpid(pid, &status, WNOHANG) == pid)
+        return false;
+    }
+    return true;
+  }
 
-#define FOR_EACH_22(what, first, x, ...)                                                           \
-  what(22, first, x);                                                                              \
-  FOR_EACH_21(what, first, __VA_ARGS__);
+  void synchronize() {
+    if (rank_ == 0) {
+      if (!control_->barrier.wait([this] { return workers_alive(); })) {
+        throw std::runtime_error("criterion: a benchmark worker process exited unexpectedly");
+      }
+    } else if (!control_->barrier.wait([] { return getppid() != 1; })) {
+      _exit(1); // the benchmark process is gone
+    }
+  }
 
-#define FOR_EACH_23(what, first, x, ...)                                                           \
-  what(23, first, x);                                                                              \
-  FOR_EACH_22(what, first, __VA_ARGS__);
+  [[noreturn]] void run_worker(std::size_t rank,
+                               const std::function<void(process_group &)> &body) {
+    rank_ = rank;
+    workers_.clear();
+#if defined(__linux__)
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+#endif
+    while (true) {
+      synchronize();
+      if (control_->next.load(std::memory_order_acquire) == command::stop)
+        _exit(0);
+      try {
+        body(*this);
+      } catch (...) {
+        _exit(1); // never unwind into the benchmark process's copy of the stack
+      }
+      synchronize();
+    }
+  }
 
-#define FOR_EACH_24(what, first, x, ...)                                                           \
-  what(24, first, x);                                                                              \
-  FOR_EACH_23(what, first, __VA_ARGS__);
+public:
+  process_group(std::size_t num_processes, std::size_t shared_memory_size)
+      : num_processes_(std::max<std::size_t>(num_processes, 1)),
+        shared_memory_size_(shared_memory_size) {}
 
-#define FOR_EACH_25(what, first, x, ...)                                                           \
-  what(25, first, x);                                                                              \
-  FOR_EACH_24(what, first, __VA_ARGS__);
+  process_group(const process_group &) = delete;
+  process_group &operator=(const process_group &) = delete;
 
-#define FOR_EACH_26(what, first, x, ...)                                                           \
-  what(26, first, x);                                                                              \
-  FOR_EACH_25(what, first, __VA_ARGS__);
+  ~process_group() { stop(); }
 
-#define FOR_EACH_27(what, first, x, ...)                                                           \
-  what(27, first, x);                                                                              \
-  FOR_EACH_26(what, first, __VA_ARGS__);
+  // 0 in the benchmark process, 1..size()-1 in the workers
+  std::size_t rank() const { return rank_; }
 
-#define FOR_EACH_28(what, first, x, ...)                                                           \
-  what(28, first, x);                                                                              \
-  FOR_EACH_27(what, first, __VA_ARGS__);
+  std::size_t size() const { return num_processes_; }
 
-#define FOR_EACH_29(what, first, x, ...)                                                           \
-  what(29, first, x);                                                                              \
-  FOR_EACH_28(what, first, __VA_ARGS__);
+  // Zero-initialized at the start of every benchmark instance
+  void *shared_memory() const { return static_cast<char *>(region_) + control_block_size; }
 
-#define FOR_EACH_30(what, first, x, ...)                                                           \
-  what(30, first, x);                                                                              \
-  FOR_EACH_29(what, first, __VA_ARGS__);
+  std::size_t shared_memory_size() const { return shared_memory_size_; }
 
-#define FOR_EACH_31(what, first, x, ...)                                                           \
-  what(31, first, x);                                                                              \
-  FOR_EACH_30(what, first, __VA_ARGS__);
+  template <class T> T *shared_memory_as() const { return static_cast<T *>(shared_memory()); }
 
-#define FOR_EACH_32(what, first, x, ...)                                                           \
-  what(32, first, x);                                                                              \
-  FOR_EACH_31(what, first, __VA_ARGS__);
+  // Wait until every process in the group has reached this point
+  void barrier() {
+    if (rank_ == 0) {
+      if (!control_->user_barrier.wait([this] { return workers_alive(); })) {
+        throw std::runtime_error("criterion: a benchmark worker process exited unexpectedly");
+      }
+    } else if (!control_->user_barrier.wait([] { return getppid() != 1; })) {
+      _exit(1); // the benchmark process is gone
+    }
+  }
 
-#define FOR_EACH_33(what, first, x, ...)                                                           \
-  what(33, first, x);                                                                              \
-  FOR_EACH_32(what, first, __VA_ARGS__);
+  // Map the shared region and fork the workers. Each worker runs `body` once per iteration
+  void start(const std::function<void(process_group &)> &body) {
+    stop();
 
-#define FOR_EACH_34(what, first, x, ...)                                                           \
-  what(34, first, x);                                                                              \
-  FOR_EACH_33(what, first, __VA_ARGS__);
+    const auto total_size = control_block_size + shared_memory_size_;
+    region_ = mmap(nullptr, total_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (region_ == MAP_FAILED) {
+      region_ = nullptr;
+      throw std::runtime_error("criterion: failed to map " + std::to_string(total_size) +
+                               " bytes of shared memory");
+    }
+    control_ = new (region_) control_block(static_cast<std::uint32_t>(num_processes_));
+
+    for (std::size_t rank = 1; rank < num_processes_; rank++) {
+      const auto pid = fork();
+      if (pid < 0) {
+        stop();
+        throw std::runtime_error("criterion: failed to fork benchmark worker process");
+      } else if (pid == 0) {
+        run_worker(rank, body);
+      }
+      workers_.push_back(pid);
+    }
+  }
 
-#define FOR_EACH_35(what, first, x, ...)                                                           \
-  what(35, first, x);                                                                              \
-  FOR_EACH_34(what, first, __VA_ARGS__);
+  // Run one iteration on every rank; rank 0 runs `body` in this process
+  template <class Body> void run_iteration(Body &&body) {
+    synchronize();
+    body(*this);
+    synchronize();
+  }
 
-#define FOR_EACH_36(what, first, x, ...)                                                           \
-  what(36, first, x);                                                                              \
-  FOR_EACH_35(what, first, __VA_ARGS__);
+  // Release the workers, wait for them to exit and unmap the shared region
+  void stop() {
+    if (region_ == nullptr)
+      return;
 
-#define FOR_EACH_37(what, first, x, ...)                                                           \
-  what(37, first, x);                                                                              \
-  FOR_EACH_36(what, first, __VA_ARGS__);
+    if (!workers_.empty()) {
+      control_->next.store(command::stop, std::memory_order_release);
+      if (control_->barrier.wait([this] { return workers_alive(); })) {
+        for (const auto pid : workers_) {
+          waitpid(pid, nullptr, 0);
+        }
+      } else {
+        for (const auto pid : workers_) {
+          kill(pid, SIGKILL);
+          waitpid(pid, nullptr, 0);
+        }
+      }
+      workers_.clear();
+    }
 
-#define FOR_EACH_38(what, first, x, ...)                                                           \
-  what(38, first, x);                                                                              \
-  FOR_EACH_37(what, first, __VA_ARGS__);
+    control_->~control_block();
+    munmap(region_, control_block_size + shared_memory_size_);
+    region_ = nullptr;
+    control_ = nullptr;
+  }
+};
 
-#define FOR_EACH_39(what, first, x, ...)                                                           \
-  what(39, first, x);                                                                              \
-  FOR_EACH_38(what, first, __VA_ARGS__);
+} // namespace criterion
 
-#define FOR_EACH_40(what, first, x, ...)                                                           \
-  what(40, first, x);                                                                              \
-  FOR_EACH_39(what, first, __VA_ARGS__);
+#define GET_PROCESS_GROUP (__benchmark_process_group)
 
-#define FOR_EACH_41(what, first, x, ...)                                                           \
-  what(41, first, x);                                                                              \
-  FOR_EACH_40(what, first, __VA_ARGS__);
+// Same as BENCHMARK, but the body runs in NumProcesses processes at once (rank 0 being the
+// benchmark process) that share SharedMemorySize bytes of mmap(MAP_SHARED) memory.
+// Use GET_PROCESS_GROUP inside the body to get the rank, the shared memory and a barrier
+#define MULTIPROCESS_BENCHMARK(Name, NumProcesses, SharedMemorySize, ...)                          \
+  typedef std::tuple<__VA_ARGS__> CONCAT(Name, BenchmarkParameters);                               \
+  namespace detail {                                                                               \
+  /* forward declare the benchmark function that we define later */                                \
+  template <class T = CONCAT(Name, BenchmarkParameters)>                                           \
+  struct CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__)) {                          \
+    static inline void CONCAT(Name, CONCAT(_registered_body_, __LINE__))(                          \
+        std::chrono::steady_clock::time_point &,                                                   \
+        std::optional<std::chrono::steady_clock::time_point> &, void *,                            \
+        criterion::process_group &);                                                               \
+                                                                                                   \
+    static criterion::process_group &process_group() {                                             \
+      static criterion::process_group group{NumProcesses, SharedMemorySize};                       \
+      return group;                                                                                \
+    }                                                                                              \
+                                                                                                   \
+    static inline void CONCAT(Name, CONCAT(_registered_fun_, __LINE__))(                           \
+        std::chrono::steady_clock::time_point &start,                                              \
+        std::optional<std::chrono::steady_clock::time_point> &teardown, void *parameters) {        \
+      process_group().run_iteration([&](criterion::process_group &group) {                         \
+        CONCAT(Name, CONCAT(_registered_body_, __LINE__))(start, teardown, parameters, group);     \
+      });                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    static void start_workers(void *parameters) {                                                  \
+      process_group().start([parameters](criterion::process_group &group) {                        \
+        std::chrono::steady_clock::time_point start;                                               \
+        std::optional<std::chrono::steady_clock::time_point> teardown;                             \
+        CONCAT(Name, CONCAT(_registered_body_, __LINE__))(start, teardown, parameters, group);     \
+      });                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    static void stop_workers(void *) { process_group().stop(); }                                   \
+  };                                                                                               \
+                                                                                                   \
+  namespace /* ensure internal linkage for struct */                                               \
+  {                                                                                                \
+  /* helper struct for static registration in ctor */                                              \
+  struct CONCAT(Name, CONCAT(_register_struct_, __LINE__)) {                                       \
+    CONCAT(Name, CONCAT(_register_struct_, __LINE__))() { /* called once before main */            \
+      using wrapper = CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__)) <             \
+                      CONCAT(Name, BenchmarkParameters) >;                                         \
+      criterion::benchmark_template_registration_helper_struct::register_benchmark_template(       \
+          criterion::benchmark_config{                                                             \
+              .name = #Name,                                                                       \
+              .fn = wrapper::CONCAT(Name, CONCAT(_registered_fun_, __LINE__)),                     \
+              .before_instance = wrapper::start_workers,                                           \
+              .after_instance = wrapper::stop_workers});                                           \
+      /* benchmarks without parameters have a single, implicit instance */                         \
+      if constexpr (std::tuple_size_v<CONCAT(Name, BenchmarkParameters)> == 0) {                   \
+        criterion::benchmark_template_registration_helper_struct::                                 \
+            execute_registered_benchmark_template(#Name, "",                                       \
+                                                  criterion::benchmark_config::empty_tuple);       \
+      }                                                                                            \
+    }                                                                                              \
+  } CONCAT(Name, CONCAT(_register_struct_instance_, __LINE__));                                    \
+  }                                                                                                \
+  }                                                                                                \
+                                                                                                   \
+  /* now actually defined to allow MULTIPROCESS_BENCHMARK("name") { ... } syntax */                \
+  template <class T>                                                                               \
+  void detail::CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__))<T>::CONCAT(          \
+      Name, CONCAT(_registered_body_, __LINE__))(                                                  \
+      [[maybe_unused]] std::chrono::steady_clock::time_point & __benchmark_start_timestamp,        \
+      [[maybe_unused]] std::optional<std::chrono::steady_clock::time_point> &                      \
+          __benchmark_teardown_timestamp,                                                          \
+      [[maybe_unused]] void *__benchmark_parameters,                                               \
+      [[maybe_unused]] criterion::process_group & __benchmark_process_group)
 
-#define FOR_EACH_42(what, first, x, ...)                                                           \
-  what(42, first, x);                                                                              \
-  FOR_EACH_41(what, first, __VA_ARGS__);
+#endif
 
-#define FOR_EACH_43(what, first, x, ...)                                                           \
-  what(43, first, x);                                                                              \
-  FOR_EACH_42(what, first, __VA_ARGS__);
 
-#define FOR_EACH_44(what, first, x, ...)                                                           \
-  what(44, first, x);                                                                              \
-  FOR_EACH_43(what, first, __VA_ARGS__);
+#pragma once
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
 
-#define FOR_EACH_45(what, first, x, ...)                                                           \
-  what(45, first, x);                                                                              \
-  FOR_EACH_44(what, first, __VA_ARGS__);
+// #include <criterion/details/macros.hpp>
 
-#define FOR_EACH_46(what, first, x, ...)                                                           \
-  what(46, first, x);                                                                              \
-  FOR_EACH_45(what, first, __VA_ARGS__);
+namespace criterion {
 
-#define FOR_EACH_47(what, first, x, ...)                                                           \
-  what(47, first, x);                                                                              \
-  FOR_EACH_46(what, first, __VA_ARGS__);
+template <class... Types> struct type_list {};
 
-#define FOR_EACH_48(what, first, x, ...)                                                           \
-  what(48, first, x);                                                                              \
-  FOR_EACH_47(what, first, __VA_ARGS__);
+template <auto... Values> struct value_list {};
 
-#define FOR_EACH_49(what, first, x, ...)                                                           \
-  what(49, first, x);                                                                              \
-  FOR_EACH_48(what, first, __VA_ARGS__);
+// Stands in for a type in generic lambdas, e.g., [](auto tag) { using U = typename
+// decltype(tag)::type; }
+template <class T> struct type_tag { using type = T; };
 
-#define FOR_EACH_50(what, first, x, ...)                                                           \
-  what(50, first, x);                                                                              \
-  FOR_EACH_49(what, first, __VA_ARGS__);
+namespace detail {
 
-#define FOR_EACH_51(what, first, x, ...)                                                           \
-  what(51, first, x);                                                                              \
-  FOR_EACH_50(what, first, __VA_ARGS__);
+// Splits a stringized, parenthesized list like "(std::map<int, int>, std::list<int>)" on its
+// top-level commas: {"std::map<int, int>", "std::list<int>"}
+inline std::vector<std::string> split_stringized_list(const std::string &list) {
+  auto trim = [](const std::string &s) {
+    const auto first = s.find_first_not_of(" \t\n");
+    if (first == std::string::npos)
+      return std::string{""};
+    const auto last = s.find_last_not_of(" \t\n");
+    return s.substr(first, last - first + 1);
+  };
 
-#define FOR_EACH_52(what, first, x, ...)                                                           \
-  what(52, first, x);                                                                              \
-  FOR_EACH_51(what, first, __VA_ARGS__);
+  auto input = trim(list);
+  if (input.size() >= 2 && input.front() == '(' && input.back() == ')')
+    input = input.substr(1, input.size() - 2);
+
+  std::vector<std::string> result;
+  std::string current{""};
+  int depth = 0;
+  for (const auto c : input) {
+    if (c == '<' || c == '(' || c == '[' || c == '{') {
+      depth += 1;
+    } else if (c == '>' || c == ')' || c == ']' || c == '}') {
+      depth -= 1;
+    } else if (c == ',' && depth == 0) {
+      result.push_back(trim(current));
+      current.clear();
+      continue;
+    }
+    current += c;
+  }
+  result.push_back(trim(current));
+  return result;
+}
 
-#define FOR_EACH_53(what, first, x, ...)                                                           \
-  what(53, first, x);                                                                              \
-  FOR_EACH_52(what, first, __VA_ARGS__);
+} // namespace detail
 
-#define FOR_EACH_54(what, first, x, ...)                                                           \
-  what(54, first, x);                                                                              \
-  FOR_EACH_53(what, first, __VA_ARGS__);
+struct typed_benchmark_registration_helper_struct {
+  // Registers one template per type, all found under `template_name` by the INVOKE_BENCHMARK
+  // macros and named after the type, e.g., "Forward<std::vector<int>>"
+  template <class ArgTuple, class MakeFn, class... Types>
+  static void register_typed_benchmark_template(const std::string &template_name,
+                                                const std::string &stringized_types,
+                                                MakeFn &&make_fn, type_list<Types...>) {
+    const auto type_names = detail::split_stringized_list(stringized_types);
+    std::size_t index = 0;
+    (benchmark_template_registration_helper_struct::register_benchmark_template(
+         template_name,
+         benchmark_config{.name = template_name + "<" +
+                                  (index < type_names.size() ? type_names[index++] : "") + ">",
+                          .fn = make_fn(type_tag<Types>{})}),
+     ...);
+
+    // benchmarks without parameters have a single, implicit instance per type
+    if constexpr (std::tuple_size_v<ArgTuple> == 0) {
+      benchmark_template_registration_helper_struct::execute_registered_benchmark_template(
+          template_name, "", benchmark_config::empty_tuple);
+    }
+  }
+
+  // Same as above, but one template per compile-time value, e.g., "Blocked<16>"
+  template <class ArgTuple, class MakeFn, auto... Values>
+  static void register_value_benchmark_template(const std::string &template_name,
+                                                const std::string &stringized_values,
+                                                MakeFn &&make_fn, value_list<Values...>) {
+    const auto value_names = detail::split_stringized_list(stringized_values);
+    std::size_t index = 0;
+    const auto value_name = [&](auto value) {
+      const auto name = index < value_names.size() ? value_names[index] : "";
+      index += 1;
+      if constexpr (std::is_same_v<decltype(value), bool>) {
+        return std::string{value ? "true" : "false"};
+      } else if constexpr (std::is_integral_v<decltype(value)>) {
+        return std::to_string(value);
+      } else {
+        return name;
+      }
+    };
+    (benchmark_template_registration_helper_struct::register_benchmark_template(
+         template_name,
+         benchmark_config{.name = template_name + "<" + value_name(Values) + ">",
+                          .fn = make_fn(std::integral_constant<decltype(Values), Values>{})}),
+     ...);
+
+    // benchmarks without parameters have a single, implicit instance per value
+    if constexpr (std::tuple_size_v<ArgTuple> == 0) {
+      benchmark_template_registration_helper_struct::execute_registered_benchmark_template(
+          template_name, "", benchmark_config::empty_tuple);
+    }
+  }
+};
 
-#define FOR_EACH_55(what, first, x, ...)                                                           \
-  what(55, first, x);                                                                              \
-  FOR_EACH_54(what, first, __VA_ARGS__);
+} // namespace criterion
 
-#define FOR_EACH_56(what, first, x, ...)                                                           \
-  what(56, first, x);                                                                              \
-  FOR_EACH_55(what, first, __VA_ARGS__);
+// Same as BENCHMARK, but the body is instantiated once per type in the parenthesized Types list,
+// e.g., TYPED_BENCHMARK(Forward, (std::vector<int>, std::list<int>), std::size_t).
+// Use TypeParam inside the body to refer to the type of the current instantiation
+#define TYPED_BENCHMARK(Name, Types, ...)                                                          \
+  typedef std::tuple<__VA_ARGS__> CONCAT(Name, BenchmarkParameters);                               \
+  namespace detail {                                                                               \
+  /* forward declare the benchmark function that we define later */                                \
+  template <class TypeParam, class T = CONCAT(Name, BenchmarkParameters)>                          \
+  struct CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__)) {                          \
+    static inline void CONCAT(Name, CONCAT(_registered_fun_, __LINE__))(                           \
+        std::chrono::steady_clock::time_point &,                                                   \
+        std::optional<std::chrono::steady_clock::time_point> &, void *);                           \
+  };                                                                                               \
+                                                                                                   \
+  namespace /* ensure internal linkage for struct */                                               \
+  {                                                                                                \
+  /* helper struct for static registration in ctor */                                              \
+  struct CONCAT(Name, CONCAT(_register_struct_, __LINE__)) {                                       \
+    CONCAT(Name, CONCAT(_register_struct_, __LINE__))() { /* called once before main */            \
+      criterion::typed_benchmark_registration_helper_struct::register_typed_benchmark_template<    \
+          CONCAT(Name, BenchmarkParameters)>(                                                      \
+          #Name, #Types,                                                                           \
+          [](auto tag) {                                                                           \
+            using TypeParam = typename decltype(tag)::type;                                        \
+            return criterion::benchmark_config::Fn{                                                \
+                CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__)) <                   \
+                TypeParam > ::CONCAT(Name, CONCAT(_registered_fun_, __LINE__))};                   \
+          },                                                                                       \
+          criterion::type_list<PASS_PARAMETERS(Types)>{});                                         \
+    }                                                                                              \
+  } CONCAT(Name, CONCAT(_register_struct_instance_, __LINE__));                                    \
+  }                                                                                                \
+  }                                                                                                \
+                                                                                                   \
+  /* now actually defined to allow TYPED_BENCHMARK("name") { ... } syntax */                       \
+  template <class TypeParam, class T>                                                              \
+  void detail::CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__))<TypeParam, T>::      \
+      CONCAT(Name, CONCAT(_registered_fun_, __LINE__))(                                            \
+          [[maybe_unused]] std::chrono::steady_clock::time_point & __benchmark_start_timestamp,    \
+          [[maybe_unused]] std::optional<std::chrono::steady_clock::time_point> &                  \
+              __benchmark_teardown_timestamp,                                                      \
+          [[maybe_unused]] void *__benchmark_parameters)
+
+// Same as BENCHMARK, but the body is instantiated once per value in the parenthesized Values list,
+// with the value available as a compile-time constant named ValueName, e.g.,
+// VALUE_BENCHMARK(Blocked, BlockSize, (16, 32, 64, 128), std::size_t)
+#define VALUE_BENCHMARK(Name, ValueName, Values, ...)                                              \
+  typedef std::tuple<__VA_ARGS__> CONCAT(Name, BenchmarkParameters);                               \
+  namespace detail {                                                                               \
+  /* forward declare the benchmark function that we define later */                                \
+  template <auto ValueName, class T = CONCAT(Name, BenchmarkParameters)>                           \
+  struct CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__)) {                          \
+    static inline void CONCAT(Name, CONCAT(_registered_fun_, __LINE__))(                           \
+        std::chrono::steady_clock::time_point &,                                                   \
+        std::optional<std::chrono::steady_clock::time_point> &, void *);                           \
+  };                                                                                               \
+                                                                                                   \
+  namespace /* ensure internal linkage for struct */                                               \
+  {                                                                                                \
+  /* helper struct for static registration in ctor */                                              \
+  struct CONCAT(Name, CONCAT(_register_struct_, __LINE__)) {                                       \
+    CONCAT(Name, CONCAT(_register_struct_, __LINE__))() { /* called once before main */            \
+      criterion::typed_benchmark_registration_helper_struct::register_value_benchmark_template<    \
+          CONCAT(Name, BenchmarkParameters)>(                                                      \
+          #Name, #Values,                                                                          \
+          [](auto constant) {                                                                      \
+            return criterion::benchmark_config::Fn{                                                \
+                CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__)) <                   \
+                decltype(constant)::value > ::CONCAT(Name, CONCAT(_registered_fun_, __LINE__))};   \
+          },                                                                                       \
+          criterion::value_list<PASS_PARAMETERS(Values)>{});                                       \
+    }                                                                                              \
+  } CONCAT(Name, CONCAT(_register_struct_instance_, __LINE__));                                    \
+  }                                                                                                \
+  }                                                                                                \
+                                                                                                   \
+  /* now actually defined to allow VALUE_BENCHMARK("name") { ... } syntax */                       \
+  template <auto ValueName, class T>                                                               \
+  void detail::CONCAT(Name, CONCAT(__benchmark_function_wrapper__, __LINE__))<ValueName, T>::      \
+      CONCAT(Name, CONCAT(_registered_fun_, __LINE__))(                                            \
+          [[maybe_unused]] std::chrono::steady_clock::time_point & __benchmark_start_timestamp,    \
+          [[maybe_unused]] std::optional<std::chrono::steady_clock::time_point> &                  \
+              __benchmark_teardown_timestamp,                                                      \
+          [[maybe_unused]] void *__benchmark_parameters)
 
-#define FOR_EACH_57(what, first, x, ...)                                                           \
-  what(57, first, x);                                                                              \
-  FOR_EACH_56(what, first, __VA_ARGS__);
 
-#define FOR_EACH_58(what, first, x, ...)                                                           \
-  what(58, first, x);                                                                              \
-  FOR_EACH_57(what, first, __VA_ARGS__);
+#pragma once
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
-#define FOR_EACH_59(what, first, x, ...)                                                           \
-  what(59, first, x);                                                                              \
-  FOR_EACH_58(what, first, __VA_ARGS__);
+// #include <criterion/details/allocations.hpp>
+// #include <criterion/details/benchmark_config.hpp>
+// #include <criterion/details/macros.hpp>
 
-#define FOR_EACH_60(what, first, x, ...)                                                           \
-  what(60, first, x);                                                                              \
-  FOR_EACH_59(what, first, __VA_ARGS__);
+namespace criterion {
 
-#define FOR_EACH_61(what, first, x, ...)                                                           \
-  what(61, first, x);                                                                              \
-  FOR_EACH_60(what, first, __VA_ARGS__);
+// Passed to benchmarks registered with criterion::register_benchmark that take it as their first
+// argument. end_setup() and begin_teardown() do what SETUP_BENCHMARK and TEARDOWN_BENCHMARK do for
+// BENCHMARK - everything before end_setup() and after begin_teardown() is not measured
+class benchmark_fixture {
+  std::chrono::steady_clock::time_point &start_timestamp_;
+  std::optional<std::chrono::steady_clock::time_point> &teardown_timestamp_;
 
-#define FOR_EACH_62(what, first, x, ...)                                                           \
-  what(62, first, x);                                                                              \
-  FOR_EACH_61(what, first, __VA_ARGS__);
+public:
+  benchmark_fixture(std::chrono::steady_clock::time_point &start_timestamp,
+                    std::optional<std::chrono::steady_clock::time_point> &teardown_timestamp)
+      : start_timestamp_(start_timestamp), teardown_timestamp_(teardown_timestamp) {}
 
-#define FOR_EACH_63(what, first, x, ...)                                                           \
-  what(63, first, x);                                                                              \
-  FOR_EACH_62(what, first, __VA_ARGS__);
+  void end_setup() {
+    allocation_counter::mark_start();
+    start_timestamp_ = std::chrono::steady_clock::now();
+  }
 
-#define FOR_EACH_NARG(...) FOR_EACH_NARG_(__VA_ARGS__, FOR_EACH_RSEQ_N())
-#define FOR_EACH_NARG_(...) FOR_EACH_ARG_N(__VA_ARGS__)
-#define FOR_EACH_ARG_N(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, \
-                       _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32,  \
-                       _33, _34, _35, _36, _37, _38, _39, _40, _41, _42, _43, _44, _45, _46, _47,  \
-                       _48, _49, _50, _51, _52, _53, _54, _55, _56, _57, _58, _59, _60, _61, _62,  \
-                       _63, N, ...)                                                                \
-  N
-#define FOR_EACH_RSEQ_N()                                                                          \
-  63, 62, 61, 60, 59, 58, 57, 56, 55, 54, 53, 52, 51, 50, 49, 48, 47, 46, 45, 44, 43, 42, 41, 40,  \
-      39, 38, 37, 36, 35, 34, 33, 32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17,  \
-      16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0
+  void begin_teardown() {
+    teardown_timestamp_ = std::chrono::steady_clock::now();
+    allocation_counter::mark_end();
+  }
+};
 
-#define FOR_EACH_(N, what, first, x, ...) CONCATENATE(FOR_EACH_, N)(what, first, x, __VA_ARGS__)
-#define FOR_EACH(what, first, ...) FOR_EACH_(FOR_EACH_NARG(__VA_ARGS__), what, first, __VA_ARGS__)
+// Register a benchmark at runtime, e.g., from main() before calling criterion_main:
+//
+//   criterion::register_benchmark("Replay/" + request.id, Replay, request.body);
+//
+// `fn` is called once per iteration with the parameters, which are copied (or moved) into storage
+// owned by the benchmark. If `fn` takes a criterion::benchmark_fixture& as its first argument, it
+// can exclude setup and teardown from the measurement. Anything after the first '/' in `name` is
+// the instance name, like the names given to INVOKE_BENCHMARK
+template <class Fn, class... Params>
+void register_benchmark(const std::string &name, Fn &&fn, Params &&...params) {
+  using ArgTuple = std::tuple<std::decay_t<Params>...>;
+  using Callable = std::decay_t<Fn>;
+  static_assert(std::is_invocable_v<Callable &, benchmark_fixture &, std::decay_t<Params> &...> ||
+                    std::is_invocable_v<Callable &, std::decay_t<Params> &...>,
+                "register_benchmark requires a callable that takes the benchmark parameters, "
+                "optionally preceded by a criterion::benchmark_fixture&");
+
+  auto arguments = std::make_shared<ArgTuple>(std::forward<Params>(params)...);
+
+  benchmark_config config;
+  const auto slash = name.find('/');
+  config.name = name.substr(0, slash);
+  config.parameterized_instance_name = slash == std::string::npos ? "" : name.substr(slash);
+  config.parameters = (void *)(arguments.get());
+  config.owned_parameters = arguments;
+  config.fn = [callable = Callable(std::forward<Fn>(fn))](
+                  std::chrono::steady_clock::time_point &start_timestamp,
+                  std::optional<std::chrono::steady_clock::time_point> &teardown_timestamp,
+                  void *parameters) mutable {
+    auto &arg_tuple = *static_cast<ArgTuple *>(parameters);
+    if constexpr (std::is_invocable_v<Callable &, benchmark_fixture &,
+                                      std::decay_t<Params> &...>) {
+      benchmark_fixture fixture{start_timestamp, teardown_timestamp};
+      std::apply([&](auto &...args) { callable(fixture, args...); }, arg_tuple);
+    } else {
+      std::apply([&](auto &...args) { callable(args...); }, arg_tuple);
+    }
+  };
 
-#define INVOKE_BENCHMARK_FOR_EACH_HELPER(Index, TemplateName, ...)                                 \
-  INVOKE_BENCHMARK_N(TemplateName, Index, PASS_PARAMETERS(__VA_ARGS__))
+  benchmark_registration_helper_struct::register_benchmark(config);
+}
 
-#define INVOKE_BENCHMARK_FOR_EACH(TemplateName, ...)                                               \
-  FOR_EACH(INVOKE_BENCHMARK_FOR_EACH_HELPER, TemplateName, __VA_ARGS__)
+} // namespace criterion
 
-  
 
 
 //  (C) Copyright 2015 - 2018 Christopher Beck
@@ -6933,6 +13360,26 @@ public:
 // #include <criterion/details/indicators.hpp>
 #include <sstream>
 #include <string>
+#include <utility>
+#include <vector>
+
+// Short forms of options, e.g., -e for --export_results. structopt gives every field the short
+// form of its first letter, so fields that share one, e.g., export_results and export_samples,
+// would take it from each other. These short forms are expanded to their long form before parsing
+// instead (see expand_criterion_short_options), and the help only shows the ones listed here
+static inline const std::vector<std::pair<char, std::string>> criterion_short_options{
+    {'w', "warmup"},     {'l', "list"},        {'r', "run_filtered"},  {'e', "export_results"},
+    {'a', "antagonist"}, {'t', "time_budget"}, {'s', "save_baseline"}, {'b', "baseline"},
+    {'n', "noise_threshold"}, {'q', "quiet"}, {'h', "help"}};
+
+// e.g., "-e,--export_results", or "--export_samples" for an option without a short form
+static inline std::string criterion_option_flags(const std::string &long_name) {
+  for (const auto &[short_name, name] : criterion_short_options) {
+    if (name == long_name)
+      return std::string{'-', short_name} + ",--" + long_name;
+  }
+  return "--" + long_name;
+}
 
 static inline void print_criterion_help(const std::string &program_name) {
   std::cout << "\n";
@@ -6942,14 +13389,46 @@ static inline void print_criterion_help(const std::string &program_name) {
   std::cout << "\n";
   std::cout << termcolor::bold << "SYNOPSIS\n" << termcolor::reset;
   std::cout << termcolor::bold << "     " << program_name << "\n           " << termcolor::reset
-            << "[" << termcolor::bold << "-w,--warmup" << termcolor::reset << " <number>]\n"
-            << "           [" << termcolor::bold << "-l,--list" << termcolor::reset << "] "
+            << "[" << termcolor::bold << criterion_option_flags("warmup") << termcolor::reset
+            << " <number>]\n"
+            << "           [" << termcolor::bold << criterion_option_flags("list")
+            << termcolor::reset << "] "
             << "[" << termcolor::bold << "--list_filtered" << termcolor::reset << " <regex>] "
-            << "[" << termcolor::bold << "-r,--run_filtered" << termcolor::reset << " <regex>] "
-            << "\n           [" << termcolor::bold << "-e,--export_results" << termcolor::reset
-            << " {csv,json,md,asciidoc} <filename>]\n"
-            << "           [" << termcolor::bold << "-q,--quiet" << termcolor::reset << "] "
-            << "[" << termcolor::bold << "-h,--help" << termcolor::reset << "] ";
+            << "[" << termcolor::bold << criterion_option_flags("run_filtered") << termcolor::reset
+            << " <regex>] "
+            << "\n           [" << termcolor::bold << criterion_option_flags("export_results")
+            << termcolor::reset << " {csv,json,jsonl,md,asciidoc,html,gbench-json,junit,"
+            << "openmetrics} <filename>]\n"
+            << "           [" << termcolor::bold << criterion_option_flags("antagonist")
+            << termcolor::reset << " <list>] [" << termcolor::bold
+            << criterion_option_flags("time_budget") << termcolor::reset << " <duration>]\n"
+            << "           [" << termcolor::bold << criterion_option_flags("save_baseline")
+            << termcolor::reset << " <name>] [" << termcolor::bold
+            << criterion_option_flags("baseline") << termcolor::reset << " <name>] ["
+            << termcolor::bold << criterion_option_flags("noise_threshold") << termcolor::reset
+            << " <percent>]\n"
+            << "           [" << termcolor::bold << "--history" << termcolor::reset
+            << " <filename>] [" << termcolor::bold << "--revision" << termcolor::reset
+            << " <label>] [" << termcolor::bold << "--history_report" << termcolor::reset
+            << "]\n"
+            << "           [" << termcolor::bold << "--export_samples" << termcolor::reset
+            << " <filename>] [" << termcolor::bold << "--analyze" << termcolor::reset
+            << " <filename>] [" << termcolor::bold << "--estimator" << termcolor::reset
+            << " <name>]\n"
+            << "           [" << termcolor::bold << "--confidence" << termcolor::reset
+            << " <percent>] [" << termcolor::bold << "--outliers" << termcolor::reset
+            << " {keep,severe,mild}]\n"
+            << "           [" << termcolor::bold << "--reporters" << termcolor::reset
+            << " <format:filename,...>] [" << termcolor::bold << "--thresholds" << termcolor::reset
+            << " <filename>]\n"
+            << "           [" << termcolor::bold << "--trace" << termcolor::reset
+            << " <filename>] [" << termcolor::bold << "--compare" << termcolor::reset
+            << " <reference>]\n"
+            << "           [" << termcolor::bold << "--shard" << termcolor::reset << " <i/N>] ["
+            << termcolor::bold << "--merge" << termcolor::reset << " <filename>...]\n"
+            << "           [" << termcolor::bold << criterion_option_flags("quiet")
+            << termcolor::reset << "] "
+            << "[" << termcolor::bold << criterion_option_flags("help") << termcolor::reset << "] ";
   std::cout << "\n";
   std::cout << termcolor::bold << "DESCRIPTION\n" << termcolor::reset;
   std::cout
@@ -6958,12 +13437,13 @@ static inline void print_criterion_help(const std::string &program_name) {
   std::cout << "\n";
   std::cout << "     The options are as follows:\n";
   std::cout << "\n";
-  std::cout << termcolor::bold << "     -w,--warmup " << termcolor::reset << termcolor::underline
-            << "number" << termcolor::reset << "\n";
+  std::cout << termcolor::bold << "     " << criterion_option_flags("warmup") << " "
+            << termcolor::reset << termcolor::underline << "number" << termcolor::reset << "\n";
   std::cout << "          Number of warmup runs (at least 1) to execute before the benchmark "
                "(default=3)\n";
   std::cout << "\n";
-  std::cout << termcolor::bold << "     -l,--list " << termcolor::reset << "\n";
+  std::cout << termcolor::bold << "     " << criterion_option_flags("list") << " "
+            << termcolor::reset << "\n";
   std::cout << "          Print the list of available benchmarks\n";
   std::cout << "\n";
   std::cout << termcolor::bold << "     --list_filtered " << termcolor::reset
@@ -6971,12 +13451,13 @@ static inline void print_criterion_help(const std::string &program_name) {
   std::cout
       << "          Print a filtered list of available benchmarks (based on user-provided regex)\n";
   std::cout << "\n";
-  std::cout << termcolor::bold << "     -r,--run_filtered " << termcolor::reset << termcolor::underline
-            << "regex" << termcolor::reset << "\n";
+  std::cout << termcolor::bold << "     " << criterion_option_flags("run_filtered") << " "
+            << termcolor::reset << termcolor::underline << "regex" << termcolor::reset << "\n";
   std::cout
       << "          Run a filtered list of available benchmarks (based on user-provided regex)\n";
   std::cout << "\n";
-  std::cout << termcolor::bold << "     -e,--export_results " << termcolor::reset
+  std::cout << termcolor::bold << "     " << criterion_option_flags("export_results") << " "
+            << termcolor::reset
             << termcolor::underline << "format" << termcolor::reset << " " << termcolor::underline
             << "filename" << termcolor::reset << "\n";
   std::cout
@@ -6986,28 +13467,163 @@ static inline void print_criterion_help(const std::string &program_name) {
             << "       Comma separated values (CSV) delimited text file\n";
   std::cout << "          " << termcolor::bold << "json" << termcolor::reset
             << "      JavaScript Object Notation (JSON) text file\n";
+  std::cout << "          " << termcolor::bold << "jsonl" << termcolor::reset
+            << "     JSON Lines text file, one object per benchmark\n";
   std::cout << "          " << termcolor::bold << "md" << termcolor::reset
             << "        Markdown (md) text file\n";
   std::cout << "          " << termcolor::bold << "asciidoc" << termcolor::reset
             << "  AsciiDoc (asciidoc) text file\n";
+  std::cout << "          " << termcolor::bold << "html" << termcolor::reset
+            << "      Self-contained HTML report with charts\n";
+  std::cout << "          " << termcolor::bold << "gbench-json" << termcolor::reset
+            << "  Google Benchmark JSON, e.g., for compare.py\n";
+  std::cout << "          " << termcolor::bold << "junit" << termcolor::reset
+            << "     JUnit XML, one test case per benchmark, failed by --thresholds\n";
+  std::cout << "          " << termcolor::bold << "openmetrics" << termcolor::reset
+            << "  OpenMetrics gauges, e.g., for the node_exporter textfile collector\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     " << criterion_option_flags("antagonist") << " "
+            << termcolor::reset << termcolor::underline << "list" << termcolor::reset << "\n";
+  std::cout << "          Run background threads alongside each benchmark, e.g., "
+               "membw:2,llc-thrash:1,cpu-spin:2,smt-sibling\n";
+  std::cout << "\n";
+  std::cout << "          " << termcolor::bold << "membw:N" << termcolor::reset
+            << "       N threads saturating memory bandwidth\n";
+  std::cout << "          " << termcolor::bold << "llc-thrash:N" << termcolor::reset
+            << "  N threads evicting the last level cache\n";
+  std::cout << "          " << termcolor::bold << "cpu-spin:N" << termcolor::reset
+            << "    N threads spinning on other cores\n";
+  std::cout << "          " << termcolor::bold << "smt-sibling" << termcolor::reset
+            << "   1 thread spinning on the SMT sibling of the benchmark core\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     " << criterion_option_flags("time_budget") << " "
+            << termcolor::reset << termcolor::underline << "duration" << termcolor::reset << "\n";
+  std::cout << "          Finish all benchmarks within the given time, e.g., 15m, 90s or 1h30m. "
+               "A short pilot\n          run of each benchmark decides how much of the budget "
+               "it gets\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     " << criterion_option_flags("save_baseline") << " "
+            << termcolor::reset << termcolor::underline << "name" << termcolor::reset << "\n";
+  std::cout << "          Save the samples of every benchmark that was run as a named baseline in "
+               ".criterion/baselines\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     " << criterion_option_flags("baseline") << " "
+            << termcolor::reset << termcolor::underline << "name" << termcolor::reset << "\n";
+  std::cout << "          Compare against a saved baseline, or Google Benchmark JSON output if "
+               "name ends in\n          .json. Exits with status 1 if any benchmark regressed\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     " << criterion_option_flags("noise_threshold") << " "
+            << termcolor::reset
+            << termcolor::underline << "percent" << termcolor::reset << "\n";
+  std::cout << "          Changes smaller than this are reported as no change (default=2)\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     --history " << termcolor::reset << termcolor::underline
+            << "filename" << termcolor::reset << "\n";
+  std::cout << "          Append the results to a JSON Lines history file, one record per "
+               "benchmark\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     --revision " << termcolor::reset << termcolor::underline
+            << "label" << termcolor::reset << "\n";
+  std::cout << "          Revision to record the results under, e.g., a commit hash "
+               "(default=unknown)\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     --history_report " << termcolor::reset << "\n";
+  std::cout << "          Report change points in the history file instead of running "
+               "benchmarks\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     --export_samples " << termcolor::reset
+            << termcolor::underline << "filename" << termcolor::reset << "\n";
+  std::cout << "          Stream the duration, start time, batch size and CPU of every measured "
+               "iteration\n          to a binary file (see sample_format.hpp for the layout)\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     --analyze " << termcolor::reset << termcolor::underline
+            << "filename" << termcolor::reset << "\n";
+  std::cout << "          Recompute results from a file written by --export_samples or a saved "
+               "baseline,\n          instead of running benchmarks\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     --estimator " << termcolor::reset << termcolor::underline
+            << "name" << termcolor::reset << "\n";
+  std::cout << "          Estimator used by --analyze (default=mean)\n";
+  std::cout << "\n";
+  std::cout << "          " << termcolor::bold << "mean" << termcolor::reset
+            << "        Mean of the run means, as reported when benchmarks run\n";
+  std::cout << "          " << termcolor::bold << "median" << termcolor::reset
+            << "      Median of the run medians\n";
+  std::cout << "          " << termcolor::bold << "lowest_rsd" << termcolor::reset
+            << "  Mean of the run with the lowest relative standard deviation\n";
   std::cout << "\n";
-  std::cout << termcolor::bold << "     -q,--quiet " << termcolor::reset << "\n";
+  std::cout << termcolor::bold << "     --confidence " << termcolor::reset << termcolor::underline
+            << "percent" << termcolor::reset << "\n";
+  std::cout << "          Confidence level of intervals and baseline comparisons (default=95)\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     --outliers " << termcolor::reset << termcolor::underline
+            << "policy" << termcolor::reset << "\n";
+  std::cout << "          Outliers that --analyze leaves out: keep all, drop severe, or drop mild "
+               "and severe\n          (default=keep)\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     --reporters " << termcolor::reset << termcolor::underline
+            << "list" << termcolor::reset << "\n";
+  std::cout << "          Export to several files at once, e.g., "
+               "csv:results.csv,jsonl:results.jsonl,html:report.html\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     --thresholds " << termcolor::reset << termcolor::underline
+            << "filename" << termcolor::reset << "\n";
+  std::cout << "          Check benchmarks against limits, one \"<regex> <metric> <limit>\" per "
+               "line, with\n          max_time, max_regression or max_allocations. Exits with "
+               "status 1 if any check fails\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     --trace " << termcolor::reset << termcolor::underline
+            << "filename" << termcolor::reset << "\n";
+  std::cout << "          Write a timeline of the run in the Chrome trace event format, for "
+               "chrome://tracing\n          or ui.perfetto.dev\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     --compare " << termcolor::reset << termcolor::underline
+            << "reference" << termcolor::reset << "\n";
+  std::cout << "          Rank the instances of each benchmark relative to a reference: first, "
+               "fastest, or the\n          instances with a name segment, e.g., make_shared or "
+               "int (for fn:int)\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     --shard " << termcolor::reset << termcolor::underline
+            << "i/N" << termcolor::reset << "\n";
+  std::cout << "          Only list and run the i-th of N parts of the (filtered) benchmarks, "
+               "e.g., 2/4, to\n          spread them across machines\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     --merge " << termcolor::reset << termcolor::underline
+            << "filename..." << termcolor::reset << "\n";
+  std::cout << "          Combine the results in JSON or JSON Lines exports, --export_samples "
+               "files or saved\n          baselines, e.g., of every shard, instead of running "
+               "benchmarks\n";
+  std::cout << "\n";
+  std::cout << termcolor::bold << "     " << criterion_option_flags("quiet") << " "
+            << termcolor::reset << "\n";
   std::cout << "          Run benchmarks quietly, suppressing activity indicators\n";
   std::cout << "\n";
-  std::cout << termcolor::bold << "     -h,--help " << termcolor::reset << "\n";
+  std::cout << termcolor::bold << "     " << criterion_option_flags("help") << " "
+            << termcolor::reset << "\n";
   std::cout << "          Print this help message\n";
 }
 
 #pragma once
+// #include <criterion/details/analysis.hpp>
 // #include <criterion/details/asciidoc_writer.hpp>
+// #include <criterion/details/baseline.hpp>
 // #include <criterion/details/csv_writer.hpp>
+// #include <criterion/details/gbench_json.hpp>
 // #include <criterion/details/help.hpp>
+// #include <criterion/details/html_writer.hpp>
 // #include <criterion/details/indicators.hpp>
 // #include <criterion/details/json_writer.hpp>
+// #include <criterion/details/junit_writer.hpp>
 // #include <criterion/details/macros.hpp>
 // #include <criterion/details/md_writer.hpp>
+// #include <criterion/details/merge.hpp>
+// #include <criterion/details/openmetrics_writer.hpp>
 // #include <criterion/details/structopt.hpp>
+// #include <criterion/details/thresholds.hpp>
+#include <cstdlib>
 #include <cstring>
+#include <exception>
+#include <new>
 
 static inline void signal_handler(int signal) {
   indicators::show_console_cursor(true);
@@ -7020,7 +13636,17 @@ namespace criterion {
 struct options {
 
   struct export_options : structopt::sub_command {
-    enum class format_type { csv, json, md, asciidoc };
+    enum class format_type {
+      csv,
+      json,
+      jsonl,
+      md,
+      asciidoc,
+      html,
+      gbench_json,
+      junit,
+      openmetrics
+    };
 
     // Export format
     format_type format;
@@ -7048,9 +13674,69 @@ struct options {
   // Run benchmarks quietly
   std::optional<bool> quiet = false;
 
+  // --antagonist membw:2,llc-thrash:1,cpu-spin:2,smt-sibling
+  std::optional<std::string> antagonist;
+
+  // --time_budget 15m
+  std::optional<std::string> time_budget;
+
+  // Save samples as a named baseline, e.g., --save_baseline main
+  std::optional<std::string> save_baseline;
+
+  // Compare against a named baseline, e.g., --baseline main
+  std::optional<std::string> baseline;
+
+  // Changes smaller than this percentage are reported as "No change" (default=2)
+  std::optional<double> noise_threshold;
+
   // Prints help
   std::optional<bool> help = false;
 
+  // Append results to a JSON Lines history file, e.g., --history results.jsonl
+  std::optional<std::string> history;
+
+  // Revision label for the results appended to the history, e.g., --revision $(git rev-parse HEAD)
+  std::optional<std::string> revision;
+
+  // Report change points in the history instead of running benchmarks
+  std::optional<bool> history_report = false;
+
+  // Stream every measured iteration to a binary file, e.g., --export_samples samples.cbin
+  std::optional<std::string> export_samples;
+
+  // Recompute results from stored samples instead of running benchmarks, e.g.,
+  // --analyze samples.cbin or --analyze .criterion/baselines/main.baseline
+  std::optional<std::string> analyze;
+
+  // Estimator used by --analyze: mean, median or lowest_rsd (default=mean)
+  std::optional<std::string> estimator;
+
+  // Confidence level of intervals and significance tests, in percent (default=95)
+  std::optional<double> confidence;
+
+  // Outliers left out by --analyze: keep, severe or mild (default=keep)
+  std::optional<std::string> outliers;
+
+  // Export to several files at once, e.g., --reporters csv:result.csv,json:result.json
+  std::optional<std::string> reporters;
+
+  // Limits that benchmarks must stay within, e.g., --thresholds thresholds.txt
+  std::optional<std::string> thresholds;
+
+  // Write a timeline of the run in the Chrome trace event format, e.g., --trace trace.json
+  std::optional<std::string> trace;
+
+  // Rank the instances of each benchmark template relative to a reference, e.g., --compare first,
+  // --compare fastest or --compare make_shared
+  std::optional<std::string> compare;
+
+  // Only list and run one part of the benchmarks, e.g., --shard 2/4 for the second of four
+  std::optional<std::string> shard;
+
+  // Combine the results of several runs, e.g., of shards, instead of running benchmarks, e.g.,
+  // --merge shard1.json shard2.json
+  std::optional<std::vector<std::string>> merge;
+
   // Remaining arguments
   std::vector<std::string> remaining;
 };
@@ -7059,7 +13745,432 @@ struct options {
 
 STRUCTOPT(criterion::options::export_options, format, filename);
 STRUCTOPT(criterion::options, warmup, list, list_filtered, run_filtered, export_results, quiet,
-          help, remaining);
+          antagonist, time_budget, save_baseline, baseline, noise_threshold, help, history,
+          revision, history_report, export_samples, analyze, estimator, confidence,
+          outliers, reporters, thresholds, trace, compare, shard, merge, remaining);
+
+// Reporter that exports results in `format` (csv, json, jsonl, md, asciidoc, html, gbench-json,
+// junit or openmetrics) to `filename`. CSV and JSON Lines are appended to as benchmarks complete;
+// the other formats are rewritten after every benchmark, except HTML whose charts are only drawn
+// at the end of the run and JUnit whose test cases need the threshold `checks` made after the run
+static inline std::shared_ptr<criterion::reporter>
+make_criterion_reporter(const std::string &format, const std::string &filename,
+                        const criterion::baseline *baseline,
+                        const std::vector<criterion::threshold_check> *checks) {
+  if (format == "csv") {
+    return std::make_shared<criterion::csv_reporter>(filename);
+  } else if (format == "jsonl") {
+    return std::make_shared<criterion::jsonl_reporter>(filename);
+  } else if (format == "json") {
+    return std::make_shared<criterion::snapshot_reporter>(filename, [](const std::string &path) {
+      return criterion::json_writer::write_results(path, criterion::benchmark::results);
+    });
+  } else if (format == "md") {
+    return std::make_shared<criterion::snapshot_reporter>(filename, [](const std::string &path) {
+      return criterion::md_writer::write_results(path, criterion::benchmark::results);
+    });
+  } else if (format == "asciidoc") {
+    return std::make_shared<criterion::snapshot_reporter>(filename, [](const std::string &path) {
+      return criterion::asciidoc_writer::write_results(path, criterion::benchmark::results);
+    });
+  } else if (format == "gbench-json" || format == "gbench_json") {
+    return std::make_shared<criterion::snapshot_reporter>(filename, [](const std::string &path) {
+      return criterion::gbench_json::write_results(path, criterion::benchmark::results);
+    });
+  } else if (format == "openmetrics") {
+    return std::make_shared<criterion::snapshot_reporter>(filename, [](const std::string &path) {
+      return criterion::openmetrics_writer::write_results(path, criterion::benchmark::results);
+    });
+  } else if (format == "html") {
+    return std::make_shared<criterion::snapshot_reporter>(
+        filename,
+        [baseline](const std::string &path) {
+          return criterion::html_writer::write_results(path, criterion::benchmark::results,
+                                                       baseline);
+        },
+        false);
+  } else if (format == "junit") {
+    return std::make_shared<criterion::snapshot_reporter>(
+        filename,
+        [checks](const std::string &path) {
+          return criterion::junit_writer::write_results(path, criterion::benchmark::results,
+                                                        *checks);
+        },
+        false);
+  }
+  return nullptr;
+}
+
+// The arguments with every short form in criterion_short_options, e.g., -e, replaced by its long
+// form, e.g., --export_results, so it cannot be parsed as another option with the same initial.
+// The gbench-json export format is passed on as gbench_json, the name of its enum value
+static inline std::vector<std::string> expand_criterion_short_options(int argc, char *argv[]) {
+  std::vector<std::string> arguments(argv, argv + argc);
+  for (std::size_t i = 1; i < arguments.size(); ++i) {
+    auto &argument = arguments[i];
+    if (argument == "--")
+      break;
+    if (argument.size() == 2 && argument[0] == '-') {
+      for (const auto &[short_name, long_name] : criterion_short_options) {
+        if (argument[1] == short_name) {
+          argument = "--" + long_name;
+          break;
+        }
+      }
+    }
+    if (argument == "--export_results" && i + 1 < arguments.size() &&
+        arguments[i + 1] == "gbench-json") {
+      arguments[i + 1] = "gbench_json";
+    }
+  }
+  return arguments;
+}
+
+// Prints "Error: <message>" and exits with status 1, e.g.,
+// criterion_error("Invalid shard \"", value, "\"")
+template <class... Message>
+[[noreturn]] static inline void criterion_error(const Message &...message) {
+  std::cout << termcolor::bold << termcolor::red << "Error: ";
+  (std::cout << ... << message);
+  std::cout << termcolor::reset << "\n";
+  exit(1);
+}
+
+// Prints "Warning: <message>" and carries on
+template <class... Message> static inline void criterion_warning(const Message &...message) {
+  std::cout << termcolor::bold << termcolor::yellow << "Warning: ";
+  (std::cout << ... << message);
+  std::cout << termcolor::reset << "\n";
+}
+
+// Handles the options that do something other than run benchmarks, e.g., --help or --list, and
+// exits if one of them is set. --list and --list_filtered only show the benchmarks of --shard
+static inline void run_criterion_commands(const criterion::options &options,
+                                          const char *program_name) {
+  if (options.shard.has_value()) {
+    const auto shard = criterion::benchmark_shard::parse(options.shard.value());
+    if (!shard.has_value())
+      criterion_error("Invalid shard \"", options.shard.value(),
+                      "\" (use i/N with 1 <= i <= N, e.g., 2/4)");
+    criterion::benchmark_registration_helper_struct::shard = shard.value();
+  }
+
+  if (options.help.value() == true) {
+    print_criterion_help(program_name);
+    exit(0);
+  } else if (options.list.value() == true) {
+    criterion::benchmark_registration_helper_struct::list_registered_benchmarks();
+    exit(0);
+  } else if (options.list_filtered.has_value()) {
+    criterion::benchmark_registration_helper_struct::list_filtered_registered_benchmarks(
+        options.list_filtered.value());
+    exit(0);
+  } else if (options.history_report.value() == true) {
+    if (!options.history.has_value())
+      criterion_error("--history_report requires --history <filename>");
+    const auto records = criterion::history::load(options.history.value());
+    if (!records.has_value())
+      criterion_error("Failed to read history from ", options.history.value());
+    for (const auto &series : criterion::history::analyze(records.value())) {
+      if (options.quiet.value() == false || !series.change_points.empty()) {
+        criterion::console_writer::write_history(series);
+      }
+    }
+    exit(0);
+  } else if (!options.remaining.empty()) {
+    criterion_error("Unrecognized argument \"", options.remaining[0], "\"");
+  }
+}
+
+// Applies the options that change how benchmarks are selected and measured
+static inline void apply_criterion_measurement_options(const criterion::options &options) {
+  if (options.warmup.has_value()) {
+    const auto warmup = options.warmup.value();
+    if (warmup > 0) {
+      criterion::benchmark::warmup_runs = options.warmup.value();
+    } else {
+      criterion::benchmark::warmup_runs = 1;
+    }
+  }
+
+  if (options.quiet.value() == true) {
+    criterion::benchmark::show_console_output = false;
+  }
+
+  if (options.antagonist.has_value()) {
+    const auto profile = criterion::interference_profile::parse(options.antagonist.value());
+    if (!profile.has_value())
+      criterion_error("Invalid antagonist list \"", options.antagonist.value(),
+                      "\" (use membw:N, llc-thrash:N, cpu-spin:N or smt-sibling, with N <= ",
+                      criterion::interference_profile::max_threads, ")");
+    criterion::benchmark::interference = profile.value();
+  }
+
+  if (options.time_budget.has_value()) {
+    const auto budget = criterion::parse_duration(options.time_budget.value());
+    if (!budget.has_value())
+      criterion_error("Invalid time budget \"", options.time_budget.value(), "\"");
+    criterion::benchmark::time_budget = budget.value();
+  }
+}
+
+// The baseline to compare against, from --baseline: a saved baseline, or the output of a Google
+// Benchmark binary if it ends in .json. Also checks the name given to --save_baseline
+static inline std::optional<criterion::baseline>
+load_criterion_baseline(const criterion::options &options) {
+  const auto gbench_baseline = options.baseline.has_value() && options.baseline->size() > 5 &&
+                               options.baseline->substr(options.baseline->size() - 5) == ".json";
+
+  for (const auto &baseline_name :
+       {options.save_baseline, gbench_baseline ? std::nullopt : options.baseline}) {
+    if (baseline_name.has_value() && !criterion::baseline::valid_name(baseline_name.value()))
+      criterion_error("Invalid baseline name \"", baseline_name.value(),
+                      "\" (use letters, digits, '_', '.' and '-')");
+  }
+
+  std::optional<criterion::baseline> baseline;
+  if (gbench_baseline) {
+    const auto &filename = options.baseline.value();
+    baseline = criterion::gbench_json::read_baseline(
+        filename, std::filesystem::path(filename).stem().string());
+    if (!baseline.has_value())
+      criterion_error("Failed to read Google Benchmark results from ", filename);
+  } else if (options.baseline.has_value()) {
+    baseline = criterion::baseline::load(options.baseline.value());
+    if (!baseline.has_value())
+      criterion_error("Failed to load baseline \"", options.baseline.value(), "\" from ",
+                      criterion::baseline::path(options.baseline.value()));
+  }
+  return baseline;
+}
+
+// Options of --analyze and --merge, with intervals at `confidence` percent
+static inline criterion::analysis_options
+make_criterion_analysis_options(const criterion::options &options, double confidence) {
+  criterion::analysis_options analysis_options;
+  analysis_options.confidence_level = confidence / 100;
+  if (options.estimator.has_value()) {
+    const auto method = criterion::analysis::parse_estimator(options.estimator.value());
+    if (!method.has_value())
+      criterion_error("Invalid estimator \"", options.estimator.value(),
+                      "\" (use mean, median or lowest_rsd)");
+    analysis_options.method = method.value();
+  }
+  if (options.outliers.has_value()) {
+    const auto policy = criterion::analysis::parse_outlier_policy(options.outliers.value());
+    if (!policy.has_value())
+      criterion_error("Invalid outlier policy \"", options.outliers.value(),
+                      "\" (use keep, severe or mild)");
+    analysis_options.outliers = policy.value();
+  }
+  return analysis_options;
+}
+
+static inline std::optional<criterion::thresholds>
+load_criterion_thresholds(const criterion::options &options) {
+  if (!options.thresholds.has_value())
+    return std::nullopt;
+  auto thresholds = criterion::thresholds::load(options.thresholds.value());
+  if (!thresholds.has_value())
+    criterion_error("Failed to read thresholds from ", options.thresholds.value(),
+                    " (use one \"<regex> <metric> <limit>\" per line)");
+  if (thresholds->uses(criterion::threshold_metric::max_allocations) &&
+      !criterion::allocation_counter::enabled) {
+    criterion_warning("max_allocations is not checked, since allocations are only counted if "
+                      "CRITERION_COUNT_ALLOCATIONS is defined");
+  }
+  return thresholds;
+}
+
+// Starts a reporter for --export_results and for each entry of --reporters, which receive each
+// result as soon as its benchmark completes, so a crash or timeout keeps the results so far
+static inline void add_criterion_reporters(const criterion::options &options,
+                                           const criterion::baseline *baseline,
+                                           const std::vector<criterion::threshold_check> *checks) {
+  std::vector<std::pair<std::string, std::string>> reports; // (format, filename)
+  if (options.export_results.has_value()) {
+    using format_type = criterion::options::export_options::format_type;
+    const auto &export_options = options.export_results.value();
+    const std::unordered_map<format_type, std::string> formats{
+        {format_type::csv, "csv"},
+        {format_type::json, "json"},
+        {format_type::jsonl, "jsonl"},
+        {format_type::md, "md"},
+        {format_type::asciidoc, "asciidoc"},
+        {format_type::html, "html"},
+        {format_type::gbench_json, "gbench-json"},
+        {format_type::junit, "junit"},
+        {format_type::openmetrics, "openmetrics"}};
+    reports.push_back({formats.at(export_options.format), export_options.filename});
+  }
+  if (options.reporters.has_value()) {
+    std::stringstream list(options.reporters.value());
+    std::string report;
+    while (std::getline(list, report, ',')) {
+      const auto separator = report.find(':');
+      if (separator == std::string::npos || separator + 1 == report.size())
+        criterion_error("Invalid reporter \"", report, "\" (use format:filename)");
+      reports.push_back({report.substr(0, separator), report.substr(separator + 1)});
+    }
+  }
+  for (const auto &[format, filename] : reports) {
+    auto reporter = make_criterion_reporter(format, filename, baseline, checks);
+    if (!reporter)
+      criterion_error("Unknown export format \"", format,
+                      "\" (use csv, json, jsonl, md, asciidoc, html, gbench-json, junit or "
+                      "openmetrics)");
+    reporter->on_run_start();
+    if (!reporter->good())
+      criterion_error("Failed to open ", filename);
+    criterion::benchmark::reporters.push_back(std::move(reporter));
+  }
+}
+
+// Adds a result that was not measured in this run, e.g., from --merge or --analyze
+static inline void add_criterion_result(const criterion::benchmark_result &result) {
+  criterion::benchmark::benchmark_execution_order.push_back(result.name);
+  criterion::benchmark::results.insert_or_assign(result.name, result);
+  for (const auto &reporter : criterion::benchmark::reporters) {
+    reporter->on_benchmark_complete(result);
+  }
+}
+
+// --merge: combines the results, samples or baselines of earlier runs, e.g., of shards
+static inline void merge_criterion_results(const criterion::options &options,
+                                           const criterion::analysis_options &analysis_options) {
+  criterion::result_merge merged;
+  for (const auto &filename : options.merge.value()) {
+    if (!merged.add(filename, analysis_options))
+      criterion_error("Failed to read results, samples or a baseline from ", filename);
+  }
+  for (const auto &[name, filename] : merged.duplicates) {
+    criterion_warning(name, " is in more than one input; using ", filename);
+  }
+  const auto summarized =
+      std::any_of(merged.benchmarks.begin(), merged.benchmarks.end(),
+                  [](const criterion::result_merge::entry &e) { return !e.estimate; });
+  if (summarized &&
+      (options.baseline || options.save_baseline || options.thresholds || options.compare)) {
+    criterion_warning("JSON and JSON Lines exports have no samples, so their results are "
+                      "compared by their mean alone; merge --export_samples files instead");
+  }
+  std::vector<std::string> registration_order;
+  for (const auto &instance : criterion::benchmark_registry::global().instances()) {
+    registration_order.emplace_back(instance.name);
+  }
+  merged.sort(registration_order);
+  for (const auto &[result, estimate, source] : merged.benchmarks) {
+    add_criterion_result(result);
+    if (criterion::benchmark::show_console_output) {
+      if (estimate.has_value()) {
+        criterion::console_writer::write_analysis(result, estimate.value());
+      } else {
+        criterion::console_writer::write_result(result);
+      }
+    }
+  }
+}
+
+// --analyze: recomputes results from stored samples or a baseline
+static inline void analyze_criterion_samples(const criterion::options &options,
+                                             const criterion::analysis_options &analysis_options) {
+  const auto &filename = options.analyze.value();
+  if (analysis_options.method == criterion::estimator::lowest_rsd &&
+      !criterion::analysis::is_sample_file(filename))
+    criterion_error("--estimator lowest_rsd requires samples written by --export_samples");
+  const auto analysis = criterion::analysis::load(filename, analysis_options);
+  if (!analysis.has_value())
+    criterion_error("Failed to read samples or a baseline from ", filename);
+  for (const auto &[result, estimate] : analysis->benchmarks) {
+    add_criterion_result(result);
+    if (criterion::benchmark::show_console_output) {
+      criterion::console_writer::write_analysis(result, estimate);
+    }
+  }
+}
+
+// Fits benchmark families registered with BENCHMARK_COMPLEXITY. Returns true if a fit grows
+// faster than expected
+static inline bool report_criterion_complexity() {
+  bool failed = false;
+  for (const auto &family :
+       criterion::complexity_registration_helper_struct::registered_families()) {
+    for (const auto &curve : family.curves) {
+      const auto fit = curve.best_fit();
+      if (!fit.has_value())
+        continue;
+      if (criterion::benchmark::show_console_output || family.failed(curve)) {
+        criterion::console_writer::write_complexity(family, curve, fit.value());
+      }
+      failed = failed || family.failed(curve);
+    }
+  }
+  return failed;
+}
+
+// --compare: ranks the instances of each benchmark template relative to a reference instance
+static inline void report_criterion_family_comparisons(const std::string &reference,
+                                                       double confidence) {
+  const auto comparisons = criterion::family_comparison::compare(
+      criterion::benchmark::benchmark_execution_order, criterion::benchmark::results, reference,
+      confidence / 100, criterion::benchmark_registry::global().template_names());
+  if (comparisons.empty()) {
+    criterion_warning("No benchmark has a reference instance \"", reference,
+                      "\" and other instances to compare it with");
+  }
+  for (const auto &comparison : comparisons) {
+    criterion::console_writer::write_family_comparison(comparison);
+  }
+}
+
+// Compares the results with `baseline`, by benchmark name. Sets `regressed` if any benchmark
+// got significantly slower
+static inline std::unordered_map<std::string, criterion::baseline_comparison>
+report_criterion_baseline_comparisons(const criterion::baseline &baseline, double noise_threshold,
+                                      double confidence, bool &regressed) {
+  std::unordered_map<std::string, criterion::baseline_comparison> comparisons;
+  for (const auto &comparison : baseline.compare(criterion::benchmark::results,
+                                                 noise_threshold / 100, 1 - confidence / 100)) {
+    const auto this_regressed = comparison.verdict == criterion::baseline_verdict::regressed;
+    if (criterion::benchmark::show_console_output || this_regressed) {
+      criterion::console_writer::write_baseline_comparison(comparison);
+    }
+    regressed = regressed || this_regressed;
+    comparisons.insert_or_assign(comparison.name, comparison);
+  }
+  return comparisons;
+}
+
+// Checks the results against --thresholds. Returns true if any check failed
+static inline bool report_criterion_threshold_checks(
+    const criterion::thresholds &thresholds,
+    const std::unordered_map<std::string, criterion::baseline_comparison> &comparisons,
+    double confidence, std::vector<criterion::threshold_check> &checks) {
+  bool failed = false;
+  checks = thresholds.evaluate(criterion::benchmark::benchmark_execution_order,
+                               criterion::benchmark::results, comparisons, confidence / 100);
+  for (const auto &check : checks) {
+    if (criterion::benchmark::show_console_output || !check.passed) {
+      criterion::console_writer::write_threshold_check(check);
+    }
+    failed = failed || !check.passed;
+  }
+  return failed;
+}
+
+// --save_baseline and --history
+static inline void save_criterion_results(const criterion::options &options) {
+  if (options.save_baseline.has_value() &&
+      !criterion::baseline::save(options.save_baseline.value(), criterion::benchmark::results))
+    criterion_error("Failed to save baseline to ",
+                    criterion::baseline::path(options.save_baseline.value()));
+
+  if (options.history.has_value() &&
+      !criterion::history::append(options.history.value(), options.revision.value_or("unknown"),
+                                  criterion::benchmark::benchmark_execution_order,
+                                  criterion::benchmark::results))
+    criterion_error("Failed to append results to ", options.history.value());
+}
 
 static inline int criterion_main(int argc, char *argv[]) {
   const auto program_name = argv[0];
@@ -7072,80 +14183,161 @@ static inline int criterion_main(int argc, char *argv[]) {
   std::signal(SIGFPE, signal_handler);
 
   try {
-    auto options = structopt::app(program_name).parse<criterion::options>(argc, argv);
-
-    if (options.help.value() == true) {
-      print_criterion_help(program_name);
-      exit(0);
-    } else if (options.list.value() == true) {
-      criterion::benchmark_registration_helper_struct::list_registered_benchmarks();
-      exit(0);
-    } else if (options.list_filtered.has_value()) {
-      criterion::benchmark_registration_helper_struct::list_filtered_registered_benchmarks(
-          options.list_filtered.value());
-      exit(0);
-    } else if (!options.remaining.empty()) {
-      std::cout << termcolor::bold << termcolor::red;
-      std::cout << "Error: Unrecognized argument \"";
-      std::cout << options.remaining[0];
-      std::cout << "\"" << termcolor::reset << "\n";
-      exit(1);
-    }
-
-    if (options.warmup.has_value()) {
-      const auto warmup = options.warmup.value();
-      if (warmup > 0) {
-        criterion::benchmark::warmup_runs = options.warmup.value();
-      } else {
-        criterion::benchmark::warmup_runs = 1;
-      }
+    auto options = structopt::app(program_name)
+                       .parse<criterion::options>(expand_criterion_short_options(argc, argv));
+    criterion::gbench_json::executable = program_name;
+    criterion::openmetrics_writer::revision = options.revision.value_or("unknown");
+
+    run_criterion_commands(options, program_name);
+    apply_criterion_measurement_options(options);
+
+    const auto baseline = load_criterion_baseline(options);
+
+    const auto noise_threshold = options.noise_threshold.value_or(2.0);
+    if (noise_threshold < 0)
+      criterion_error("Invalid noise threshold \"", noise_threshold, "\"");
+
+    const auto confidence = options.confidence.value_or(95.0);
+    if (!(confidence > 0 && confidence < 100))
+      criterion_error("Invalid confidence level \"", confidence,
+                      "\" (use a percentage between 0 and 100)");
+
+    const auto analysis_options = make_criterion_analysis_options(options, confidence);
+
+    criterion::sample_writer sample_export;
+    if (options.export_samples.has_value()) {
+      if (!sample_export.open(options.export_samples.value()))
+        criterion_error("Failed to open ", options.export_samples.value());
+      criterion::benchmark::sample_export = &sample_export;
     }
 
-    if (options.quiet.value() == true) {
-      criterion::benchmark::show_console_output = false;
+    criterion::trace_writer trace;
+    if (options.trace.has_value()) {
+      if (!trace.open(options.trace.value(), program_name))
+        criterion_error("Failed to open ", options.trace.value());
+      criterion::benchmark::trace = &trace;
     }
 
-    // Run benchmarks
-    if (options.run_filtered.has_value()) { // Run filtered
+    const auto thresholds = load_criterion_thresholds(options);
+    std::vector<criterion::threshold_check> threshold_checks; // made after the run
+
+    add_criterion_reporters(options, baseline.has_value() ? &baseline.value() : nullptr,
+                            &threshold_checks);
+
+    // Run benchmarks, recompute their results from stored samples, or merge earlier results
+    if (options.merge.has_value()) {
+      merge_criterion_results(options, analysis_options);
+    } else if (options.analyze.has_value()) {
+      analyze_criterion_samples(options, analysis_options);
+    } else if (options.run_filtered.has_value()) { // Run filtered
       criterion::benchmark_registration_helper_struct::execute_filtered_registered_benchmarks(
           options.run_filtered.value());
     } else {
       criterion::benchmark_registration_helper_struct::execute_registered_benchmarks();
     }
 
-    if (options.export_results.has_value()) {
-      auto export_options = options.export_results.value();
-      if (export_options.format == criterion::options::export_options::format_type::csv) {
-        // CSV export
-        criterion::csv_writer::write_results(export_options.filename,
-                                             criterion::benchmark::results);
-      } else if (export_options.format == criterion::options::export_options::format_type::json) {
-        // JSON export
-        criterion::json_writer::write_results(export_options.filename,
-                                              criterion::benchmark::results);
-      } else if (export_options.format == criterion::options::export_options::format_type::md) {
-        // Markdown export
-        criterion::md_writer::write_results(export_options.filename, criterion::benchmark::results);
-      } else if (export_options.format ==
-                 criterion::options::export_options::format_type::asciidoc) {
-        // Markdown export
-        criterion::asciidoc_writer::write_results(export_options.filename,
-                                                  criterion::benchmark::results);
+    if (options.export_samples.has_value()) {
+      criterion::benchmark::sample_export = nullptr;
+      if (!sample_export.close())
+        criterion_error("Failed to write samples to ", options.export_samples.value());
+    }
+
+    // Complexity fits, baseline comparisons and exports, after the last benchmark
+    const auto report_start = std::chrono::steady_clock::now();
+
+    // Report on how the time budget was spent, and which benchmarks it did not cover
+    if (criterion::benchmark::budget_report.has_value()) {
+      const auto &report = criterion::benchmark::budget_report.value();
+      if (criterion::benchmark::show_console_output || !report.under_sampled.empty()) {
+        criterion::console_writer::write_time_budget(report);
       }
     }
 
+    const auto complexity_failed = report_criterion_complexity();
+
+    if (options.compare.has_value()) {
+      report_criterion_family_comparisons(options.compare.value(), confidence);
+    }
+
+    // Compare against the baseline, if any, before it is possibly overwritten below
+    bool regressed = false;
+    std::unordered_map<std::string, criterion::baseline_comparison> comparisons;
+    if (baseline.has_value()) {
+      comparisons = report_criterion_baseline_comparisons(baseline.value(), noise_threshold,
+                                                          confidence, regressed);
+    }
+
+    // Failures are also reported by the junit export, through threshold_checks
+    const auto threshold_failed =
+        thresholds.has_value() && report_criterion_threshold_checks(thresholds.value(), comparisons,
+                                                                    confidence, threshold_checks);
+
+    save_criterion_results(options);
+
+    // Write the complete results, e.g., HTML charts
+    for (const auto &reporter : criterion::benchmark::reporters) {
+      reporter->on_run_end();
+    }
+    for (const auto &reporter : criterion::benchmark::reporters) {
+      if (!reporter->good())
+        criterion_error("Failed to write results to ", reporter->destination());
+    }
+
+    if (options.trace.has_value()) {
+      trace.complete(trace.thread_track("benchmark"), "report", "phase", report_start,
+                     std::chrono::steady_clock::now());
+      criterion::benchmark::trace = nullptr;
+      if (!trace.close())
+        criterion_error("Failed to write trace to ", options.trace.value());
+    }
+
+    if (complexity_failed || regressed || threshold_failed) {
+      return 1;
+    }
+
   } catch (structopt::exception &e) {
     const auto message = e.what();
     if (message && std::strlen(message) > 0)
       std::cout << termcolor::bold << termcolor::red << message << termcolor::reset << "\n";
     print_criterion_help(program_name);
     exit(1);
+  } catch (std::exception &e) {
+    // e.g., a benchmark worker process that exited unexpectedly
+    criterion_error(e.what());
   }
   return 0;
 }
 
+// Counting allocations replaces the global operator new, which may only be done once in a
+// program, so it is opt-in: define CRITERION_COUNT_ALLOCATIONS before including criterion in the
+// file with CRITERION_BENCHMARK_MAIN
+#if defined(CRITERION_COUNT_ALLOCATIONS)
+// not inlined, or GCC sees free() of memory from operator new (-Wmismatched-new-delete)
+#if defined(__GNUC__)
+#define CRITERION_NOINLINE __attribute__((noinline))
+#else
+#define CRITERION_NOINLINE
+#endif
+#define CRITERION_ALLOCATION_COUNTER                                                               \
+  CRITERION_NOINLINE void *operator new(std::size_t size) {                                        \
+    ::criterion::allocation_counter::allocations.fetch_add(1, std::memory_order_relaxed);          \
+    if (void *pointer = std::malloc(size == 0 ? 1 : size))                                         \
+      return pointer;                                                                              \
+    throw std::bad_alloc();                                                                        \
+  }                                                                                                \
+  CRITERION_NOINLINE void operator delete(void *pointer) noexcept { std::free(pointer); }          \
+  CRITERION_NOINLINE void operator delete(void *pointer, std::size_t) noexcept {                   \
+    std::free(pointer);                                                                            \
+  }                                                                                                \
+  [[maybe_unused]] static const bool criterion_allocation_counter_enabled =                        \
+      (::criterion::allocation_counter::enabled = true);
+#else
+#define CRITERION_ALLOCATION_COUNTER
+#endif
+
 #define CRITERION_BENCHMARK_MAIN(...)                                                              \
-  int main(int argc, char *argv[]) { criterion_main(argc, argv); }
+  CRITERION_ALLOCATION_COUNTER                                                                     \
+  int main(int argc, char *argv[]) { return criterion_main(argc, argv); }
 
   
 